@@ -27,6 +27,9 @@ subject to the following restrictions:
 #include "TaruData.h"
 #include "landscapeData.h"
 #include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphaseMt.h"
+#include "BulletCollision/BroadphaseCollision/btHashedGridBroadphase.h"
+#include "BulletCollision/BroadphaseCollision/btParallelLinearBvhBroadphase.h"
 
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
 
@@ -76,6 +79,12 @@ class BenchmarkDemo : public CommonRigidBodyMTBase
 	void	createTest5();
 	void	createTest6();
 	void	createTest7();
+	void	createTest8();
+	void	createTest9();
+	void	createTest10();
+	void	createTest11();
+	void	createTest12();
+	void	createTest13();
 
 	void createWall(const btVector3& offsetPosition,int stackSize,const btVector3& boxSize);
 	void createPyramid(const btVector3& offsetPosition,int stackSize,const btVector3& boxSize);
@@ -504,6 +513,36 @@ void	BenchmarkDemo::initPhysics()
 			createTest7();
 			break;
 		}
+		case 8:
+		{
+			createTest8();
+			break;
+		}
+		case 9:
+		{
+			createTest9();
+			break;
+		}
+		case 10:
+		{
+			createTest10();
+			break;
+		}
+		case 11:
+		{
+			createTest11();
+			break;
+		}
+		case 12:
+		{
+			createTest12();
+			break;
+		}
+		case 13:
+		{
+			createTest13();
+			break;
+		}
 
 
 	default:
@@ -1291,6 +1330,499 @@ void	BenchmarkDemo::createTest7()
 	initRays();
 }
 
+
+///BroadphaseBenchmark moves many proxies through a broadphase and measures setAabb and calculateOverlappingPairs per frame
+struct BroadphaseBenchmark
+{
+	struct Object
+	{
+		btVector3			base;
+		btVector3			center;
+		btVector3			extents;
+		btScalar			time;
+		btBroadphaseProxy*	proxy;
+	};
+
+	enum
+	{
+		NUM_OBJECTS = 50000,
+		NUM_WARMUP_FRAMES = 8,
+		NUM_FRAMES = 32
+	};
+
+	btAlignedObjectArray<Object>	m_objects;
+	int								m_numObjects;
+	btScalar						m_speed;
+	btScalar						m_amplitude;
+	btScalar						m_spread;	//if non-zero, the objects move around random positions in a cube of this size
+	btScalar						m_radius;	//if non-zero, all objects have the same size
+
+	BroadphaseBenchmark()
+	:m_numObjects(NUM_OBJECTS),
+	m_speed(btScalar(0.005)),
+	m_amplitude(btScalar(100)),
+	m_spread(0),
+	m_radius(0)
+	{
+	}
+
+	void	update(btBroadphaseInterface* bp, btDispatcher* dispatcher)
+	{
+		for (int i=0;i<m_objects.size();i++)
+		{
+			Object& o = m_objects[i];
+			o.time += m_speed;
+			o.center[0] = btCos(o.time*btScalar(2.17))*m_amplitude + btSin(o.time)*m_amplitude/2;
+			o.center[1] = btCos(o.time*btScalar(1.38))*m_amplitude + btSin(o.time)*m_amplitude;
+			o.center[2] = btSin(o.time*btScalar(0.777))*m_amplitude;
+			o.center += o.base;
+			bp->setAabb(o.proxy,o.center-o.extents,o.center+o.extents,dispatcher);
+		}
+		bp->calculateOverlappingPairs(dispatcher);
+	}
+
+	///returns the average time per frame in microseconds
+	unsigned long	run(btBroadphaseInterface* bp, btDispatcher* dispatcher, int& numOverlaps)
+	{
+		srand(180673);
+		m_objects.resize(m_numObjects);
+		for (int i=0;i<m_objects.size();i++)
+		{
+			Object& o = m_objects[i];
+			o.center = btVector3(btScalar(rand()%16384),btScalar(rand()%16384),btScalar(rand()%16384))*(btScalar(50)/btScalar(16384));
+			o.extents = btVector3(btScalar(rand()%16384),btScalar(rand()%16384),btScalar(rand()%16384))*(btScalar(1)/btScalar(16384))+btVector3(1,1,1);
+			o.time = btScalar(rand()%16384)*(btScalar(2000)/btScalar(16384));
+			o.base = btVector3(btScalar(rand()%16384),btScalar(rand()%16384),btScalar(rand()%16384))*(m_spread/btScalar(16384));
+			if (m_radius>0)
+			{
+				o.extents = btVector3(m_radius,m_radius,m_radius);
+			}
+			o.proxy = bp->createProxy(o.center-o.extents,o.center+o.extents,0,0,1,1,dispatcher);
+		}
+		for (int i=0;i<NUM_WARMUP_FRAMES;i++)
+		{
+			update(bp,dispatcher);
+		}
+		btClock clock;
+		for (int i=0;i<NUM_FRAMES;i++)
+		{
+			update(bp,dispatcher);
+		}
+		unsigned long us = clock.getTimeMicroseconds()/NUM_FRAMES;
+
+		//count the pairs that really overlap, the pair cache may also hold pairs that wait for cleanup
+		numOverlaps = 0;
+		btBroadphasePairArray& pairs = bp->getOverlappingPairCache()->getOverlappingPairArray();
+		for (int i=0;i<pairs.size();i++)
+		{
+			btBroadphaseProxy* pa = pairs[i].m_pProxy0;
+			btBroadphaseProxy* pb = pairs[i].m_pProxy1;
+			if (TestAabbAgainstAabb2(pa->m_aabbMin,pa->m_aabbMax,pb->m_aabbMin,pb->m_aabbMax))
+			{
+				numOverlaps++;
+			}
+		}
+		for (int i=0;i<m_objects.size();i++)
+		{
+			bp->destroyProxy(m_objects[i].proxy,dispatcher);
+		}
+		m_objects.clear();
+		return us;
+	}
+};
+
+///createTest8 compares btDbvtBroadphase (binary and wide tree) with btDbvtBroadphaseMt using 1, 2, 4, 8 and 16 threads
+void	BenchmarkDemo::createTest8()
+{
+	BroadphaseBenchmark benchmark;
+	int numOverlaps = 0;
+	unsigned long serialTime;
+	{
+		btDbvtBroadphase bp;
+		bp.m_deferedcollide = true;
+		serialTime = benchmark.run(&bp,m_dispatcher,numOverlaps);
+	}
+	printf("btDbvtBroadphase: %d objects, %lu us per frame, %d overlaps\n",int(BroadphaseBenchmark::NUM_OBJECTS),serialTime,numOverlaps);
+	{
+		btDbvtBroadphase bp;
+		bp.m_deferedcollide = true;
+		bp.m_usewidetree = true;
+		unsigned long us = benchmark.run(&bp,m_dispatcher,numOverlaps);
+		printf("btDbvtBroadphase (wide tree): %lu us per frame, %d overlaps, speedup %.2f\n",
+			us,numOverlaps,us? float(serialTime)/float(us) : 0.f);
+	}
+
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	int savedNumThreads = scheduler->getNumThreads();
+	for (int numThreads=1;numThreads<=16;numThreads*=2)
+	{
+		if (numThreads>scheduler->getMaxNumThreads())
+		{
+			break;
+		}
+		scheduler->setNumThreads(numThreads);
+#else
+	{
+		int numThreads = 1;
+#endif //BT_THREADSAFE
+		btDbvtBroadphaseMt bp;
+		unsigned long us = benchmark.run(&bp,m_dispatcher,numOverlaps);
+		printf("btDbvtBroadphaseMt (%s, %d threads): %lu us per frame, %d overlaps, speedup %.2f\n",
+			btGetTaskScheduler()->getName(),numThreads,us,numOverlaps,us? float(serialTime)/float(us) : 0.f);
+	}
+#if BT_THREADSAFE
+	scheduler->setNumThreads(savedNumThreads);
+#endif //BT_THREADSAFE
+}
+
+///createTest10 compares btDbvtBroadphase with btHashedGridBroadphase using 1, 2, 4, 8 and 16 threads on 200000 spheres of the same size
+void	BenchmarkDemo::createTest10()
+{
+	BroadphaseBenchmark benchmark;
+	benchmark.m_numObjects = 200000;
+	benchmark.m_amplitude = btScalar(2);
+	benchmark.m_spread = btScalar(150);
+	benchmark.m_radius = btScalar(0.5);
+	int numOverlaps = 0;
+	unsigned long serialTime;
+	{
+		btDbvtBroadphase bp;
+		bp.m_deferedcollide = true;
+		serialTime = benchmark.run(&bp,m_dispatcher,numOverlaps);
+	}
+	printf("btDbvtBroadphase: %d spheres, %lu us per frame, %d overlaps\n",benchmark.m_numObjects,serialTime,numOverlaps);
+
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	int savedNumThreads = scheduler->getNumThreads();
+	for (int numThreads=1;numThreads<=16;numThreads*=2)
+	{
+		if (numThreads>scheduler->getMaxNumThreads())
+		{
+			break;
+		}
+		scheduler->setNumThreads(numThreads);
+#else
+	{
+		int numThreads = 1;
+#endif //BT_THREADSAFE
+		btHashedGridBroadphase bp(btScalar(1.),4);
+		unsigned long us = benchmark.run(&bp,m_dispatcher,numOverlaps);
+		printf("btHashedGridBroadphase (%s, %d threads): %lu us per frame, %d overlaps, speedup %.2f\n",
+			btGetTaskScheduler()->getName(),numThreads,us,numOverlaps,us? float(serialTime)/float(us) : 0.f);
+	}
+#if BT_THREADSAFE
+	scheduler->setNumThreads(savedNumThreads);
+#endif //BT_THREADSAFE
+}
+
+///createTest11 compares btDbvtBroadphase with btParallelLinearBvhBroadphase using 1, 2, 4, 8 and 16 threads on fast moving objects
+void	BenchmarkDemo::createTest11()
+{
+	BroadphaseBenchmark benchmark;
+	benchmark.m_speed = btScalar(0.1);
+	int numOverlaps = 0;
+	unsigned long serialTime;
+	{
+		btDbvtBroadphase bp;
+		bp.m_deferedcollide = true;
+		serialTime = benchmark.run(&bp,m_dispatcher,numOverlaps);
+	}
+	printf("btDbvtBroadphase: %d objects, %lu us per frame, %d overlaps\n",benchmark.m_numObjects,serialTime,numOverlaps);
+
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	int savedNumThreads = scheduler->getNumThreads();
+	for (int numThreads=1;numThreads<=16;numThreads*=2)
+	{
+		if (numThreads>scheduler->getMaxNumThreads())
+		{
+			break;
+		}
+		scheduler->setNumThreads(numThreads);
+#else
+	{
+		int numThreads = 1;
+#endif //BT_THREADSAFE
+		btParallelLinearBvhBroadphase bp;
+		unsigned long us = benchmark.run(&bp,m_dispatcher,numOverlaps);
+		printf("btParallelLinearBvhBroadphase (%s, %d threads): %lu us per frame, %d overlaps, speedup %.2f\n",
+			btGetTaskScheduler()->getName(),numThreads,us,numOverlaps,us? float(serialTime)/float(us) : 0.f);
+	}
+#if BT_THREADSAFE
+	scheduler->setNumThreads(savedNumThreads);
+#endif //BT_THREADSAFE
+}
+
+///createTest12 compares btCollisionWorld::rayTest, one ray at a time, with rayTestBatch, which traces packets of coherent rays, on the landscape mesh
+void	BenchmarkDemo::createTest12()
+{
+	setCameraDistance(btScalar(150.));
+	createLargeMeshBody();
+	m_dynamicsWorld->updateAabbs();
+
+	//a 256x256 camera image looking down at the landscape
+	const int resolution = 256;
+	const int numRays = resolution*resolution;
+	btAlignedObjectArray<btVector3> rayFrom;
+	btAlignedObjectArray<btVector3> rayTo;
+	rayFrom.resize(numRays);
+	rayTo.resize(numRays);
+	const btVector3 eye(0,60,-120);
+	for (int j=0;j<resolution;j++)
+	{
+		for (int i=0;i<resolution;i++)
+		{
+			btVector3 target(btScalar(i-resolution/2),btScalar(-60),btScalar(j-resolution/2));
+			rayFrom[j*resolution+i] = eye;
+			rayTo[j*resolution+i] = eye+(target-eye)*btScalar(1.5);
+		}
+	}
+
+	btAlignedObjectArray<btScalar> hitFractions;
+	btAlignedObjectArray<const btCollisionObject*> hitObjects;
+	hitFractions.resize(numRays);
+	hitObjects.resize(numRays);
+
+	btClock clock;
+	int numHits = 0;
+	for (int i=0;i<numRays;i++)
+	{
+		btCollisionWorld::ClosestRayResultCallback cb(rayFrom[i],rayTo[i]);
+		m_dynamicsWorld->rayTest(rayFrom[i],rayTo[i],cb);
+		hitFractions[i] = cb.m_closestHitFraction;
+		numHits += cb.hasHit() ? 1 : 0;
+	}
+	unsigned long serialTime = clock.getTimeMicroseconds();
+	printf("rayTest: %d rays, %lu us, %d hits\n",numRays,serialTime,numHits);
+
+	btAlignedObjectArray<btScalar> referenceFractions = hitFractions;
+	btCollisionWorld::RayTestBatchResults results;
+	results.m_hitFractions = &hitFractions[0];
+	results.m_collisionObjects = &hitObjects[0];
+	clock.reset();
+	m_dynamicsWorld->rayTestBatch(&rayFrom[0],&rayTo[0],numRays,results);
+	unsigned long batchTime = clock.getTimeMicroseconds();
+	int numDifferent = 0;
+	numHits = 0;
+	for (int i=0;i<numRays;i++)
+	{
+		numHits += hitObjects[i] ? 1 : 0;
+		numDifferent += btFabs(hitFractions[i]-referenceFractions[i])>btScalar(1e-5) ? 1 : 0;
+	}
+	printf("rayTestBatch (%s, %d threads): %lu us, %d hits, %d different, speedup %.2f\n",
+		btGetTaskScheduler()->getName(),btGetTaskScheduler()->getNumThreads(),
+		batchTime,numHits,numDifferent,batchTime? float(serialTime)/float(batchTime) : 0.f);
+}
+
+///a resting stack of convex hulls with many faces and edges, which makes the separating axis test expensive
+struct SatStackBenchmark
+{
+	enum
+	{
+		NUM_WARMUP_STEPS = 150,
+		NUM_STEPS = 150
+	};
+
+	///measures the collision detection time only
+	struct TimedWorld : public btDiscreteDynamicsWorld
+	{
+		unsigned long m_collisionTime;
+
+		TimedWorld(btDispatcher* dispatcher,btBroadphaseInterface* broadphase,btConstraintSolver* solver,btCollisionConfiguration* collisionConfiguration)
+			:btDiscreteDynamicsWorld(dispatcher,broadphase,solver,collisionConfiguration),
+			m_collisionTime(0)
+		{
+		}
+		virtual void performDiscreteCollisionDetection()
+		{
+			btClock clock;
+			btDiscreteDynamicsWorld::performDiscreteCollisionDetection();
+			m_collisionTime += clock.getTimeMicroseconds();
+		}
+	};
+
+	static void createHullShape(btConvexHullShape& hull)
+	{
+		//a 24 sided prism with a ring of points around its middle, 98 faces and 72 unique edges
+		for (int i=0;i<24;i++)
+		{
+			btScalar angle = SIMD_2_PI*btScalar(i)/btScalar(24);
+			hull.addPoint(btVector3(btScalar(0.5)*btCos(angle),btScalar(-0.25),btScalar(0.5)*btSin(angle)),false);
+			hull.addPoint(btVector3(btScalar(0.5)*btCos(angle),btScalar(0.25),btScalar(0.5)*btSin(angle)),false);
+			hull.addPoint(btVector3(btScalar(0.55)*btCos(angle+btScalar(0.13)),0,btScalar(0.55)*btSin(angle+btScalar(0.13))),false);
+		}
+		hull.recalcLocalAabb();
+		hull.initializePolyhedralFeatures();
+	}
+
+	static void addStack(btDiscreteDynamicsWorld* world, btConvexHullShape* hull, btAlignedObjectArray<btRigidBody*>& bodies)
+	{
+		btVector3 localInertia;
+		hull->calculateLocalInertia(btScalar(1.),localInertia);
+		for (int x=0;x<3;x++)
+		{
+			for (int z=0;z<3;z++)
+			{
+				for (int y=0;y<5;y++)
+				{
+					btTransform trans;
+					trans.setIdentity();
+					trans.setOrigin(btVector3(btScalar(x)*btScalar(1.5),btScalar(0.3)+btScalar(y)*btScalar(0.52),btScalar(z)*btScalar(1.5)));
+					btRigidBody* body = new btRigidBody(btScalar(1.),0,hull,localInertia);
+					body->setWorldTransform(trans);
+					body->setActivationState(DISABLE_DEACTIVATION);
+					world->addRigidBody(body);
+					bodies.push_back(body);
+				}
+			}
+		}
+	}
+
+	///returns the collision detection time in microseconds, and the sum of the body heights and the number of contacts at the end
+	static unsigned long run(btScalar featureCacheTolerance, btScalar& sumHeight, int& numContacts)
+	{
+		btDefaultCollisionConfiguration collisionConfiguration;
+		btCollisionDispatcher dispatcher(&collisionConfiguration);
+		btDbvtBroadphase broadphase;
+		btSequentialImpulseConstraintSolver solver;
+		TimedWorld world(&dispatcher,&broadphase,&solver,&collisionConfiguration);
+		world.getDispatchInfo().m_enableSatConvex = true;
+		world.getDispatchInfo().m_satFeatureCacheTolerance = featureCacheTolerance;
+
+		btBoxShape groundShape(btVector3(50,1,50));
+		groundShape.initializePolyhedralFeatures();
+		btRigidBody ground(0,0,&groundShape);
+		btTransform trans;
+		trans.setIdentity();
+		trans.setOrigin(btVector3(0,-1,0));
+		ground.setWorldTransform(trans);
+		world.addRigidBody(&ground);
+
+		btConvexHullShape hull;
+		createHullShape(hull);
+		btAlignedObjectArray<btRigidBody*> bodies;
+		addStack(&world,&hull,bodies);
+
+		for (int i=0;i<NUM_WARMUP_STEPS;i++)
+		{
+			world.stepSimulation(btScalar(1.)/btScalar(60.),0);
+		}
+		world.m_collisionTime = 0;
+		for (int i=0;i<NUM_STEPS;i++)
+		{
+			world.stepSimulation(btScalar(1.)/btScalar(60.),0);
+		}
+
+		sumHeight = 0;
+		for (int i=0;i<bodies.size();i++)
+		{
+			sumHeight += bodies[i]->getWorldTransform().getOrigin().y();
+			world.removeRigidBody(bodies[i]);
+			delete bodies[i];
+		}
+		numContacts = 0;
+		for (int i=0;i<dispatcher.getNumManifolds();i++)
+		{
+			numContacts += dispatcher.getManifoldByIndexInternal(i)->getNumContacts();
+		}
+		world.removeRigidBody(&ground);
+		return world.m_collisionTime;
+	}
+};
+
+///createTest13 compares the separating axis test of a resting stack of convex hulls with and without
+///btDispatcherInfo::m_satFeatureCacheTolerance, which reuses the separating feature while the hulls barely move
+void	BenchmarkDemo::createTest13()
+{
+	btScalar sumHeight;
+	int numContacts;
+	unsigned long fullTime = SatStackBenchmark::run(0,sumHeight,numContacts);
+	printf("separating axis test: %lu us for %d steps, height sum %f, %d contacts\n",fullTime,int(SatStackBenchmark::NUM_STEPS),sumHeight,numContacts);
+	const btScalar tolerance = btScalar(0.02);
+	unsigned long cachedTime = SatStackBenchmark::run(tolerance,sumHeight,numContacts);
+	printf("separating axis test with feature cache tolerance %f: %lu us, height sum %f, %d contacts, speedup %.2f\n",
+		tolerance,cachedTime,sumHeight,numContacts,cachedTime? float(fullTime)/float(cachedTime) : 0.f);
+
+	setCameraDistance(btScalar(10.));
+	m_dynamicsWorld->getDispatchInfo().m_enableSatConvex = true;
+	m_dynamicsWorld->getDispatchInfo().m_satFeatureCacheTolerance = tolerance;
+	btBoxShape* groundShape = new btBoxShape(btVector3(50,1,50));
+	groundShape->initializePolyhedralFeatures();
+	m_collisionShapes.push_back(groundShape);
+	btTransform trans;
+	trans.setIdentity();
+	trans.setOrigin(btVector3(0,-1,0));
+	createRigidBody(0,trans,groundShape);
+	btConvexHullShape* hull = new btConvexHullShape();
+	SatStackBenchmark::createHullShape(*hull);
+	m_collisionShapes.push_back(hull);
+	btAlignedObjectArray<btRigidBody*> bodies;
+	SatStackBenchmark::addStack(m_dynamicsWorld,hull,bodies);
+}
+
+struct DbvtTraversalCounter : btDbvt::ICollide
+{
+	int m_count;
+
+	DbvtTraversalCounter() : m_count(0) {}
+	void	Process(const btDbvtNode*,const btDbvtNode*)	{ ++m_count; }
+	void	Process(const btDbvtNode*)						{ ++m_count; }
+};
+
+///measures btDbvt self collision and ray tests, returns the time in microseconds
+static unsigned long	timeDbvtTraversal(btDbvt& tree, int& numHits)
+{
+	DbvtTraversalCounter counter;
+	btClock clock;
+	for (int i=0;i<8;i++)
+	{
+		tree.collideTTpersistentStack(tree.m_root,tree.m_root,counter);
+	}
+	srand(1234);
+	for (int i=0;i<100000;i++)
+	{
+		btVector3 from(btScalar(rand()%100),btScalar(rand()%100),btScalar(-10));
+		btVector3 to(btScalar(rand()%100),btScalar(rand()%100),btScalar(110));
+		btDbvt::rayTest(tree.m_root,from,to,counter);
+	}
+	numHits = counter.m_count;
+	return clock.getTimeMicroseconds();
+}
+
+///createTest9 measures btDbvt traversal on a tree fragmented by many insert/remove cycles, before and after btDbvt::optimizeLayout
+void	BenchmarkDemo::createTest9()
+{
+	const int numLeaves = 100000;
+	btDbvt tree;
+	btAlignedObjectArray<btDbvtNode*> leaves;
+	srand(180673);
+	for (int i=0;i<numLeaves;i++)
+	{
+		btVector3 center(btScalar(rand()%1000),btScalar(rand()%1000),btScalar(rand()%1000));
+		leaves.push_back(tree.insert(btDbvtVolume::FromCE(center*btScalar(0.1),btVector3(btScalar(0.5),btScalar(0.5),btScalar(0.5))),0));
+	}
+	//move every leaf a few times in random order, so the nodes end up scattered in memory
+	for (int pass=0;pass<8;pass++)
+	{
+		for (int i=0;i<numLeaves;i++)
+		{
+			btDbvtNode* leaf = leaves[rand()%numLeaves];
+			btVector3 center(btScalar(rand()%1000),btScalar(rand()%1000),btScalar(rand()%1000));
+			btDbvtVolume volume = btDbvtVolume::FromCE(center*btScalar(0.1),btVector3(btScalar(0.5),btScalar(0.5),btScalar(0.5)));
+			tree.update(leaf,volume);
+		}
+		tree.optimizeIncremental(numLeaves/100);
+	}
+	int numHits = 0;
+	unsigned long fragmentedTime = timeDbvtTraversal(tree,numHits);
+	printf("btDbvt fragmented: %d leaves, %lu us, %d hits\n",numLeaves,fragmentedTime,numHits);
+	tree.optimizeLayout();
+	unsigned long layoutTime = timeDbvtTraversal(tree,numHits);
+	printf("btDbvt after optimizeLayout: %lu us, %d hits, speedup %.2f\n",layoutTime,numHits,layoutTime? float(fragmentedTime)/float(layoutTime) : 0.f);
+}
+
 void	BenchmarkDemo::exitPhysics()
 {
 	int i;
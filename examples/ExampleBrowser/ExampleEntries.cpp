@@ -229,6 +229,12 @@ static ExampleEntry gDefaultExamples[]=
 	ExampleEntry(1,"Prim vs Mesh", "Benchmark the performance and stability of rigid bodies using primitive collision shapes (btSphereShape, btBoxShape), resting on a triangle mesh, btBvhTriangleMeshShape.", BenchmarkCreateFunc, 5),
 	ExampleEntry(1,"Convex vs Mesh", "Benchmark the performance and stability of rigid bodies using convex hull collision shapes (btConvexHullShape), resting on a triangle mesh, btBvhTriangleMeshShape.", BenchmarkCreateFunc, 6),
 	ExampleEntry(1,"Raycast", "Benchmark the performance of the btCollisionWorld::rayTest. Note that currently the rays are not rendered.", BenchmarkCreateFunc, 7),
+	ExampleEntry(1,"Broadphase Mt", "Benchmark the update of 50000 moving objects in btDbvtBroadphase, with its binary and its wide tree, and in the multithreaded btDbvtBroadphaseMt, using 1, 2, 4, 8 and 16 threads. The results are printed to the console.", BenchmarkCreateFunc, 8),
+	ExampleEntry(1,"Dbvt layout", "Benchmark btDbvt self collision and ray tests on a tree fragmented by many updates, before and after btDbvt::optimizeLayout. The results are printed to the console.", BenchmarkCreateFunc, 9),
+	ExampleEntry(1,"Hashed grid", "Benchmark the update of 200000 moving spheres of the same size in btDbvtBroadphase and in the multi-level btHashedGridBroadphase, using 1, 2, 4, 8 and 16 threads. The results are printed to the console.", BenchmarkCreateFunc, 10),
+	ExampleEntry(1,"Linear BVH", "Benchmark the update of 50000 fast moving objects in btDbvtBroadphase and in btParallelLinearBvhBroadphase, which rebuilds a linear bvh every frame, using 1, 2, 4, 8 and 16 threads. The results are printed to the console.", BenchmarkCreateFunc, 11),
+	ExampleEntry(1,"Ray packets", "Benchmark 65536 coherent rays on the landscape mesh, cast one by one with btCollisionWorld::rayTest and as ray packets with rayTestBatch. The results are printed to the console.", BenchmarkCreateFunc, 12),
+	ExampleEntry(1,"SAT feature cache", "Benchmark the separating axis test of a resting stack of convex hulls with 98 faces, with and without btDispatcherInfo::m_satFeatureCacheTolerance, which reuses the separating feature of the last query while the hulls barely move. The results are printed to the console.", BenchmarkCreateFunc, 13),
 //#endif
 
 
@@ -44,6 +44,9 @@ public:
 
     virtual void uploadBulletFileToSharedMemory(const char* data, int len) = 0;
 
+    ///append rays to a streamed raycast batch, a new batch starts when the command has no streaming rays yet
+    virtual void uploadRaysToSharedMemory(struct SharedMemoryCommand& command, const double* rayFromWorldArray, const double* rayToWorldArray, int numRays) = 0;
+
     virtual int getNumDebugLines() const = 0;
 
     virtual const float* getDebugLinesFrom() const = 0;
@@ -2671,6 +2671,7 @@ B3_SHARED_API	b3SharedMemoryCommandHandle b3CreateRaycastCommandInit(b3PhysicsCl
     b3Assert(command);
     command->m_type = CMD_REQUEST_RAY_CAST_INTERSECTIONS;
 	command->m_requestRaycastIntersections.m_numRays = 1;
+	command->m_requestRaycastIntersections.m_numStreamingRays = 0;
 	command->m_requestRaycastIntersections.m_rayFromPositions[0][0] = rayFromWorldX;
 	command->m_requestRaycastIntersections.m_rayFromPositions[0][1] = rayFromWorldY;
 	command->m_requestRaycastIntersections.m_rayFromPositions[0][2] = rayFromWorldZ;
@@ -2691,6 +2692,7 @@ B3_SHARED_API	b3SharedMemoryCommandHandle b3CreateRaycastBatchCommandInit(b3Phys
     command->m_type = CMD_REQUEST_RAY_CAST_INTERSECTIONS;
 	command->m_updateFlags = 0;
 	command->m_requestRaycastIntersections.m_numRays = 0;
+	command->m_requestRaycastIntersections.m_numStreamingRays = 0;
 	return (b3SharedMemoryCommandHandle)command;
 }
 
@@ -2716,6 +2718,36 @@ B3_SHARED_API void b3RaycastBatchAddRay(b3SharedMemoryCommandHandle commandHandl
 }
 
 
+B3_SHARED_API void b3RaycastBatchAddRays(b3PhysicsClientHandle physClient, b3SharedMemoryCommandHandle commandHandle, const double* rayFromWorldArray, const double* rayToWorldArray, int numRays)
+{
+	PhysicsClient *cl = (PhysicsClient *)physClient;
+	b3Assert(cl);
+	struct SharedMemoryCommand* command = (struct SharedMemoryCommand*) commandHandle;
+	b3Assert(command);
+	b3Assert(command->m_type == CMD_REQUEST_RAY_CAST_INTERSECTIONS);
+	if (command->m_type == CMD_REQUEST_RAY_CAST_INTERSECTIONS)
+	{
+		int numInlineRays = command->m_requestRaycastIntersections.m_numRays;
+		if ((command->m_requestRaycastIntersections.m_numStreamingRays == 0) && (numInlineRays + numRays <= MAX_RAY_INTERSECTION_BATCH_SIZE))
+		{
+			for (int i=0;i<numRays;i++)
+			{
+				b3RaycastBatchAddRay(commandHandle, &rayFromWorldArray[i*3], &rayToWorldArray[i*3]);
+			}
+		} else
+		{
+			//too many rays for the command, move the batch to the stream buffer
+			if (numInlineRays)
+			{
+				cl->uploadRaysToSharedMemory(*command, &command->m_requestRaycastIntersections.m_rayFromPositions[0][0],
+					&command->m_requestRaycastIntersections.m_rayToPositions[0][0], numInlineRays);
+				command->m_requestRaycastIntersections.m_numRays = 0;
+			}
+			cl->uploadRaysToSharedMemory(*command, rayFromWorldArray, rayToWorldArray, numRays);
+		}
+	}
+}
+
 B3_SHARED_API void b3GetRaycastInformation(b3PhysicsClientHandle physClient, struct b3RaycastInformation* raycastInfo)
 {
 	PhysicsClient* cl = (PhysicsClient* ) physClient;
@@ -51,6 +51,8 @@ struct PhysicsClientSharedMemoryInternalData {
 	b3AlignedObjectArray<b3MouseEvent> m_cachedMouseEvents;
 	b3AlignedObjectArray<double> m_cachedMassMatrix;
 	b3AlignedObjectArray<b3RayHitInfo>	m_raycastHits;
+	b3AlignedObjectArray<b3RayData>	m_raycastRequests;
+	int m_raycastStartIndex;
 
     b3AlignedObjectArray<int> m_bodyIdsRequestInfo;
 	b3AlignedObjectArray<int> m_constraintIdsRequestInfo;
@@ -74,6 +76,7 @@ struct PhysicsClientSharedMemoryInternalData {
           m_testBlock1(0),
 		  m_cachedCameraPixelsWidth(0),
 		  m_cachedCameraPixelsHeight(0),
+		  m_raycastStartIndex(0),
 		  m_counter(0),		  
           m_isConnected(false),
           m_waitingForServer(false),
@@ -935,10 +938,26 @@ const SharedMemoryStatus* PhysicsClientSharedMemory::processServerStatus() {
 					{
 						b3Printf("Raycast completed");
 					}
-					m_data->m_raycastHits.clear();
-					for (int i=0;i<serverCmd.m_raycastHits.m_numRaycastHits;i++)
+					if (serverCmd.m_raycastHits.m_numStreamingRaycastHits)
 					{
-						m_data->m_raycastHits.push_back(serverCmd.m_raycastHits.m_rayHits[i]);
+						//hits of a streamed batch arrive in parts, see submitClientCommand
+						if (m_data->m_raycastStartIndex==0)
+						{
+							m_data->m_raycastHits.clear();
+						}
+						const b3RayHitInfo* rayHits = (const b3RayHitInfo*)m_data->m_testBlock1->m_bulletStreamDataServerToClientRefactor;
+						for (int i=0;i<serverCmd.m_raycastHits.m_numStreamingRaycastHits;i++)
+						{
+							m_data->m_raycastHits.push_back(rayHits[i]);
+						}
+						m_data->m_raycastStartIndex += serverCmd.m_raycastHits.m_numStreamingRaycastHits;
+					} else
+					{
+						m_data->m_raycastHits.clear();
+						for (int i=0;i<serverCmd.m_raycastHits.m_numRaycastHits;i++)
+						{
+							m_data->m_raycastHits.push_back(serverCmd.m_raycastHits.m_rayHits[i]);
+						}
 					}
 					break;
 				}
@@ -1474,6 +1493,18 @@ const SharedMemoryStatus* PhysicsClientSharedMemory::processServerStatus() {
 
         }
 
+        if ((serverCmd.m_type == CMD_REQUEST_RAY_CAST_INTERSECTIONS_COMPLETED) &&
+            (serverCmd.m_raycastHits.m_numStreamingRaycastHits > 0) &&
+            (m_data->m_raycastStartIndex < m_data->m_raycastRequests.size()))
+        {
+            SharedMemoryCommand& command = m_data->m_testBlock1->m_clientCommands[0];
+
+            // continue with the remaining rays of the batch
+            command.m_type = CMD_REQUEST_RAY_CAST_INTERSECTIONS;
+            submitClientCommand(command);
+            return 0;
+        }
+
         if ((serverCmd.m_type == CMD_DEBUG_LINES_COMPLETED) &&
             (serverCmd.m_sendDebugLinesArgs.m_numRemainingDebugLines > 0)) 
 		{
@@ -1533,6 +1564,15 @@ bool PhysicsClientSharedMemory::submitClientCommand(const SharedMemoryCommand& c
         if (&m_data->m_testBlock1->m_clientCommands[0] != &command) {
             m_data->m_testBlock1->m_clientCommands[0] = command;
         }
+        if ((command.m_type == CMD_REQUEST_RAY_CAST_INTERSECTIONS) &&
+            (command.m_requestRaycastIntersections.m_numStreamingRays > 0))
+        {
+            // upload the next part of a streamed ray batch, the server returns the hits in the same buffer
+            int numRays = b3Min(m_data->m_raycastRequests.size() - m_data->m_raycastStartIndex, int(MAX_RAY_INTERSECTION_BATCH_SIZE_STREAMING));
+            memcpy(m_data->m_testBlock1->m_bulletStreamDataServerToClientRefactor,
+                   &m_data->m_raycastRequests[m_data->m_raycastStartIndex], numRays * sizeof(b3RayData));
+            m_data->m_testBlock1->m_clientCommands[0].m_requestRaycastIntersections.m_numStreamingRays = numRays;
+        }
         m_data->m_testBlock1->m_numClientCommands++;
         m_data->m_waitingForServer = true;
         return true;
@@ -1554,6 +1594,27 @@ void PhysicsClientSharedMemory::uploadBulletFileToSharedMemory(const char* data,
     }
 }
 
+void PhysicsClientSharedMemory::uploadRaysToSharedMemory(struct SharedMemoryCommand& command, const double* rayFromWorldArray, const double* rayToWorldArray, int numRays)
+{
+    // the rays are kept on the client side, submitClientCommand uploads them in parts
+    if (command.m_requestRaycastIntersections.m_numStreamingRays == 0)
+    {
+        m_data->m_raycastRequests.clear();
+        m_data->m_raycastStartIndex = 0;
+    }
+    for (int i = 0; i < numRays; i++)
+    {
+        b3RayData ray;
+        for (int j = 0; j < 3; j++)
+        {
+            ray.m_rayFromPosition[j] = rayFromWorldArray[i * 3 + j];
+            ray.m_rayToPosition[j] = rayToWorldArray[i * 3 + j];
+        }
+        m_data->m_raycastRequests.push_back(ray);
+    }
+    command.m_requestRaycastIntersections.m_numStreamingRays = m_data->m_raycastRequests.size();
+}
+
 void PhysicsClientSharedMemory::getCachedCameraImage(struct b3CameraImageData* cameraData)
 {
 	cameraData->m_pixelWidth = m_data->m_cachedCameraPixelsWidth;
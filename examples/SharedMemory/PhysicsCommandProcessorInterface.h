@@ -27,6 +27,13 @@ public:
 	virtual void setGuiHelper(struct GUIHelperInterface* guiHelper) = 0;
 	virtual void setTimeOut(double timeOutInSeconds) = 0;
 
+	///returns true if the server reads the data that the client puts in bufferServerToClient before processCommand.
+	///The networked and shared memory processors only send the command itself.
+	virtual bool canReceiveClientStreamData() const
+	{
+		return false;
+	}
+
 };
 
 
@@ -62,6 +62,7 @@ struct PhysicsDirectInternalData
 	btAlignedObjectArray<b3MouseEvent> m_cachedMouseEvents;
 
 	btAlignedObjectArray<b3RayHitInfo>	m_raycastHits;
+	btAlignedObjectArray<b3RayData>	m_raycastRequests;
 
 	PhysicsCommandProcessorInterface* m_commandProcessor;
 	bool m_ownsCommandProcessor;
@@ -488,6 +489,80 @@ bool PhysicsDirect::processContactPointData(const struct SharedMemoryCommand& or
 }
 
 
+bool PhysicsDirect::processRaycast(const struct SharedMemoryCommand& orgCommand)
+{
+	SharedMemoryCommand command = orgCommand;
+
+	const SharedMemoryStatus& serverCmd = m_data->m_serverStatus;
+	int numRays = m_data->m_raycastRequests.size();
+	int startRay = 0;
+	//TCP, UDP and shared memory processors only send the command, so the rays are sent inline, MAX_RAY_INTERSECTION_BATCH_SIZE at a time
+	bool streaming = m_data->m_commandProcessor->canReceiveClientStreamData();
+	btAlignedObjectArray<b3RayHitInfo> raycastHits;
+
+	do
+	{
+		if (streaming)
+		{
+			//upload the next part of the batch, the server returns one hit per ray in the same buffer
+			int numStreamingRays = btMin(numRays-startRay, int(MAX_RAY_INTERSECTION_BATCH_SIZE_STREAMING));
+			memcpy(&m_data->m_bulletStreamDataServerToClient[0], &m_data->m_raycastRequests[startRay], numStreamingRays*sizeof(b3RayData));
+			command.m_requestRaycastIntersections.m_numStreamingRays = numStreamingRays;
+		} else
+		{
+			int numInlineRays = btMin(numRays-startRay, int(MAX_RAY_INTERSECTION_BATCH_SIZE));
+			for (int i=0;i<numInlineRays;i++)
+			{
+				const b3RayData& ray = m_data->m_raycastRequests[startRay+i];
+				for (int j=0;j<3;j++)
+				{
+					command.m_requestRaycastIntersections.m_rayFromPositions[i][j] = ray.m_rayFromPosition[j];
+					command.m_requestRaycastIntersections.m_rayToPositions[i][j] = ray.m_rayToPosition[j];
+				}
+			}
+			command.m_requestRaycastIntersections.m_numRays = numInlineRays;
+			command.m_requestRaycastIntersections.m_numStreamingRays = 0;
+		}
+
+		bool hasStatus = m_data->m_commandProcessor->processCommand(command,m_data->m_serverStatus,&m_data->m_bulletStreamDataServerToClient[0],SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE);
+
+		b3Clock clock;
+		double startTime = clock.getTimeInSeconds();
+		double timeOutInSeconds = m_data->m_timeOutInSeconds;
+
+		while ((!hasStatus) && (clock.getTimeInSeconds()-startTime < timeOutInSeconds))
+		{
+			const  SharedMemoryStatus* stat = processServerStatus();
+			if (stat)
+			{
+				hasStatus = true;
+			}
+		}
+
+		m_data->m_hasStatus = hasStatus;
+		int numHits = streaming ? serverCmd.m_raycastHits.m_numStreamingRaycastHits : serverCmd.m_raycastHits.m_numRaycastHits;
+		if (!hasStatus || (serverCmd.m_type != CMD_REQUEST_RAY_CAST_INTERSECTIONS_COMPLETED) || (numHits == 0))
+		{
+			break;
+		}
+
+		const b3RayHitInfo* rayHits = streaming ? (const b3RayHitInfo*)&m_data->m_bulletStreamDataServerToClient[0] : serverCmd.m_raycastHits.m_rayHits;
+		for (int i=0;i<numHits;i++)
+		{
+			raycastHits.push_back(rayHits[i]);
+		}
+		startRay += numHits;
+	} while (startRay < numRays);
+
+	m_data->m_raycastHits = raycastHits;
+	if (m_data->m_hasStatus)
+	{
+		//the status of the last part only holds its own hits, report the whole batch like a streamed one so that postProcessStatus keeps m_raycastHits
+		m_data->m_serverStatus.m_raycastHits.m_numStreamingRaycastHits = m_data->m_raycastHits.size();
+	}
+	return m_data->m_hasStatus;
+}
+
 bool PhysicsDirect::processCamera(const struct SharedMemoryCommand& orgCommand)
 {
 	SharedMemoryCommand command = orgCommand;
@@ -662,10 +737,14 @@ void PhysicsDirect::postProcessStatus(const struct SharedMemoryStatus& serverCmd
 		{
 			b3Printf("Raycast completed");
 		}
-		m_data->m_raycastHits.clear();
-		for (int i=0;i<serverCmd.m_raycastHits.m_numRaycastHits;i++)
+		//hits of streamed batches are collected in processRaycast
+		if (serverCmd.m_raycastHits.m_numStreamingRaycastHits==0)
 		{
-			m_data->m_raycastHits.push_back(serverCmd.m_raycastHits.m_rayHits[i]);
+			m_data->m_raycastHits.clear();
+			for (int i=0;i<serverCmd.m_raycastHits.m_numRaycastHits;i++)
+			{
+				m_data->m_raycastHits.push_back(serverCmd.m_raycastHits.m_rayHits[i]);
+			}
 		}
 		break;
 	}
@@ -1088,6 +1167,10 @@ bool PhysicsDirect::submitClientCommand(const struct SharedMemoryCommand& comman
 	{
 		return processOverlappingObjects(command);
 	}
+	if ((command.m_type == CMD_REQUEST_RAY_CAST_INTERSECTIONS) && (command.m_requestRaycastIntersections.m_numStreamingRays > 0))
+	{
+		return processRaycast(command);
+	}
 
 	bool hasStatus = m_data->m_commandProcessor->processCommand(command,m_data->m_serverStatus,&m_data->m_bulletStreamDataServerToClient[0],SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE);
 	m_data->m_hasStatus = hasStatus;
@@ -1198,6 +1281,26 @@ void PhysicsDirect::setSharedMemoryKey(int key)
 	//m_data->m_physicsClient->setSharedMemoryKey(key);
 }
 
+void PhysicsDirect::uploadRaysToSharedMemory(struct SharedMemoryCommand& command, const double* rayFromWorldArray, const double* rayToWorldArray, int numRays)
+{
+	//the rays are kept on the client side, processRaycast streams them in parts
+	if (command.m_requestRaycastIntersections.m_numStreamingRays == 0)
+	{
+		m_data->m_raycastRequests.clear();
+	}
+	for (int i=0;i<numRays;i++)
+	{
+		b3RayData ray;
+		for (int j=0;j<3;j++)
+		{
+			ray.m_rayFromPosition[j] = rayFromWorldArray[i*3+j];
+			ray.m_rayToPosition[j] = rayToWorldArray[i*3+j];
+		}
+		m_data->m_raycastRequests.push_back(ray);
+	}
+	command.m_requestRaycastIntersections.m_numStreamingRays = m_data->m_raycastRequests.size();
+}
+
 void PhysicsDirect::uploadBulletFileToSharedMemory(const char* data, int len)
 {
 	if (len>SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE)
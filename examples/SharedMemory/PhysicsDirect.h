@@ -18,6 +18,8 @@ protected:
 
 	bool processCamera(const struct SharedMemoryCommand& orgCommand);
 
+	bool processRaycast(const struct SharedMemoryCommand& orgCommand);
+
     bool processContactPointData(const struct SharedMemoryCommand& orgCommand);
 
 	bool processOverlappingObjects(const struct SharedMemoryCommand& orgCommand);
@@ -77,6 +79,8 @@ public:
 
     void uploadBulletFileToSharedMemory(const char* data, int len);
 
+    virtual void uploadRaysToSharedMemory(struct SharedMemoryCommand& command, const double* rayFromWorldArray, const double* rayToWorldArray, int numRays);
+
     virtual int getNumDebugLines() const;
 
     virtual const float* getDebugLinesFrom() const;
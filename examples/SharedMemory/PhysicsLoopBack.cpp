@@ -145,6 +145,11 @@ void PhysicsLoopBack::uploadBulletFileToSharedMemory(const char* data, int len)
 	m_data->m_physicsClient->uploadBulletFileToSharedMemory(data,len);
 }
 
+void PhysicsLoopBack::uploadRaysToSharedMemory(struct SharedMemoryCommand& command, const double* rayFromWorldArray, const double* rayToWorldArray, int numRays)
+{
+	m_data->m_physicsClient->uploadRaysToSharedMemory(command, rayFromWorldArray, rayToWorldArray, numRays);
+}
+
 int PhysicsLoopBack::getNumDebugLines() const
 {
 	return m_data->m_physicsClient->getNumDebugLines();
@@ -59,6 +59,8 @@ public:
 
     void uploadBulletFileToSharedMemory(const char* data, int len);
 
+    virtual void uploadRaysToSharedMemory(struct SharedMemoryCommand& command, const double* rayFromWorldArray, const double* rayToWorldArray, int numRays);
+
     virtual int getNumDebugLines() const;
 
     virtual const float* getDebugLinesFrom() const;
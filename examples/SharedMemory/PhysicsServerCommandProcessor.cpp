@@ -7,6 +7,7 @@
 #include "../Extras/InverseDynamics/btMultiBodyTreeCreator.hpp"
 
 #include "BulletCollision/CollisionDispatch/btInternalEdgeUtility.h"
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
 
 #include "BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h"
 #include "BulletDynamics/Featherstone/btMultiBodyPoint2Point.h"
@@ -2267,8 +2268,13 @@ void PhysicsServerCommandProcessor::createEmptyDynamicsWorld()
 #else
     m_data->m_collisionConfiguration = new btDefaultCollisionConfiguration();
 #endif
+#if BT_THREADSAFE
+    ///the pairs are processed in parallel when a task scheduler is set (see btSetTaskScheduler), the results don't depend on the number of threads
+    m_data->m_dispatcher = new btCollisionDispatcherMt(m_data->m_collisionConfiguration);
+#else
     ///use the default collision dispatcher. For parallel processing you can use a diffent dispatcher (see Extras/BulletMultiThreaded)
     m_data->m_dispatcher = new	btCollisionDispatcher(m_data->m_collisionConfiguration);
+#endif
     
 
 	m_data->m_broadphaseCollisionFilterCallback = new MyOverlapFilterCallback();
@@ -4547,37 +4553,78 @@ bool PhysicsServerCommandProcessor::processRequestRaycastIntersectionsCommand(co
 	bool hasStatus = true;
 	BT_PROFILE("CMD_REQUEST_RAY_CAST_INTERSECTIONS");
 	serverStatusOut.m_raycastHits.m_numRaycastHits = 0;
+	serverStatusOut.m_raycastHits.m_numStreamingRaycastHits = 0;
 
-	for (int ray=0;ray<clientCmd.m_requestRaycastIntersections.m_numRays;ray++)
+	//large batches are streamed, the rays come in and the hits go out through the stream buffer
+	bool streaming = clientCmd.m_requestRaycastIntersections.m_numStreamingRays>0;
+	int numRays = btMin(clientCmd.m_requestRaycastIntersections.m_numRays,MAX_RAY_INTERSECTION_BATCH_SIZE);
+	if (streaming)
 	{
-		btVector3 rayFromWorld(clientCmd.m_requestRaycastIntersections.m_rayFromPositions[ray][0],
-			clientCmd.m_requestRaycastIntersections.m_rayFromPositions[ray][1],
-			clientCmd.m_requestRaycastIntersections.m_rayFromPositions[ray][2]);
-		btVector3 rayToWorld(clientCmd.m_requestRaycastIntersections.m_rayToPositions[ray][0],
-			clientCmd.m_requestRaycastIntersections.m_rayToPositions[ray][1],
-			clientCmd.m_requestRaycastIntersections.m_rayToPositions[ray][2]);
-
-		btCollisionWorld::ClosestRayResultCallback rayResultCallback(rayFromWorld,rayToWorld);
-		rayResultCallback.m_flags |= btTriangleRaycastCallback::kF_UseGjkConvexCastRaytest;
+		int maxStreamingRays = bufferSizeInBytes/int(sizeof(b3RayHitInfo));
+		numRays = btMin(clientCmd.m_requestRaycastIntersections.m_numStreamingRays,maxStreamingRays);
+	}
+	btAlignedObjectArray<btVector3> rayFromWorld;
+	btAlignedObjectArray<btVector3> rayToWorld;
+	rayFromWorld.resize(numRays);
+	rayToWorld.resize(numRays);
+	if (streaming)
+	{
+		const b3RayData* rays = (const b3RayData*)bufferServerToClient;
+		for (int ray=0;ray<numRays;ray++)
+		{
+			rayFromWorld[ray].setValue(rays[ray].m_rayFromPosition[0],rays[ray].m_rayFromPosition[1],rays[ray].m_rayFromPosition[2]);
+			rayToWorld[ray].setValue(rays[ray].m_rayToPosition[0],rays[ray].m_rayToPosition[1],rays[ray].m_rayToPosition[2]);
+		}
+	} else
+	{
+		for (int ray=0;ray<numRays;ray++)
+		{
+			rayFromWorld[ray].setValue(clientCmd.m_requestRaycastIntersections.m_rayFromPositions[ray][0],
+				clientCmd.m_requestRaycastIntersections.m_rayFromPositions[ray][1],
+				clientCmd.m_requestRaycastIntersections.m_rayFromPositions[ray][2]);
+			rayToWorld[ray].setValue(clientCmd.m_requestRaycastIntersections.m_rayToPositions[ray][0],
+				clientCmd.m_requestRaycastIntersections.m_rayToPositions[ray][1],
+				clientCmd.m_requestRaycastIntersections.m_rayToPositions[ray][2]);
+		}
+	}
 
-		m_data->m_dynamicsWorld->rayTest(rayFromWorld,rayToWorld,rayResultCallback);
-		int rayHits = serverStatusOut.m_raycastHits.m_numRaycastHits;
+	btAlignedObjectArray<btScalar> hitFractions;
+	btAlignedObjectArray<const btCollisionObject*> hitObjects;
+	btAlignedObjectArray<btVector3> hitPositions;
+	btAlignedObjectArray<btVector3> hitNormals;
+	hitFractions.resize(numRays);
+	hitObjects.resize(numRays);
+	hitPositions.resize(numRays);
+	hitNormals.resize(numRays);
+	if (numRays)
+	{
+		btCollisionWorld::RayTestBatchResults results;
+		results.m_hitFractions = &hitFractions[0];
+		results.m_collisionObjects = &hitObjects[0];
+		results.m_hitPointWorld = &hitPositions[0];
+		results.m_hitNormalWorld = &hitNormals[0];
+		m_data->m_dynamicsWorld->rayTestBatch(&rayFromWorld[0],&rayToWorld[0],numRays,results,btTriangleRaycastCallback::kF_UseGjkConvexCastRaytest);
+	}
 
-		if (rayResultCallback.hasHit())
+	//the rays were copied above, so the hits can overwrite the streamed rays
+	b3RayHitInfo* hits = streaming ? (b3RayHitInfo*)bufferServerToClient : serverStatusOut.m_raycastHits.m_rayHits;
+	for (int ray=0;ray<numRays;ray++)
+	{
+		b3RayHitInfo& hit = hits[ray];
+		if (hitObjects[ray])
 		{
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitFraction 
-				= rayResultCallback.m_closestHitFraction;
+			hit.m_hitFraction = hitFractions[ray];
 
 			int objectUniqueId = -1;
 			int linkIndex = -1;
 
-			const btRigidBody* body = btRigidBody::upcast(rayResultCallback.m_collisionObject);
+			const btRigidBody* body = btRigidBody::upcast(hitObjects[ray]);
 			if (body)
 			{
-				objectUniqueId = rayResultCallback.m_collisionObject->getUserIndex2();
+				objectUniqueId = hitObjects[ray]->getUserIndex2();
 			} else
 			{
-				const btMultiBodyLinkCollider* mblB = btMultiBodyLinkCollider::upcast(rayResultCallback.m_collisionObject);
+				const btMultiBodyLinkCollider* mblB = btMultiBodyLinkCollider::upcast(hitObjects[ray]);
 				if (mblB && mblB->m_multiBody)
 				{
 					linkIndex = mblB->m_link;
@@ -4585,38 +4632,32 @@ bool PhysicsServerCommandProcessor::processRequestRaycastIntersectionsCommand(co
 				}
 			}
 
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitObjectUniqueId 
-				= objectUniqueId;
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitObjectLinkIndex
-				= linkIndex;
-
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitPositionWorld[0] 
-				= rayResultCallback.m_hitPointWorld[0];
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitPositionWorld[1] 
-				= rayResultCallback.m_hitPointWorld[1];
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitPositionWorld[2] 
-				= rayResultCallback.m_hitPointWorld[2];
-						
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitNormalWorld[0] 
-				= rayResultCallback.m_hitNormalWorld[0]; 
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitNormalWorld[1] 
-				= rayResultCallback.m_hitNormalWorld[1]; 
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitNormalWorld[2] 
-				= rayResultCallback.m_hitNormalWorld[2]; 
-
+			hit.m_hitObjectUniqueId = objectUniqueId;
+			hit.m_hitObjectLinkIndex = linkIndex;
+			for (int i=0;i<3;i++)
+			{
+				hit.m_hitPositionWorld[i] = hitPositions[ray][i];
+				hit.m_hitNormalWorld[i] = hitNormals[ray][i];
+			}
 		} else
 		{
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitFraction = 1;
-			serverStatusOut.m_raycastHits.m_rayHits[serverStatusOut.m_raycastHits.m_numRaycastHits].m_hitObjectUniqueId = -1;
-			serverStatusOut.m_raycastHits.m_rayHits[serverStatusOut.m_raycastHits.m_numRaycastHits].m_hitObjectLinkIndex = -1;
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitPositionWorld[0] = 0;
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitPositionWorld[1] = 0;
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitPositionWorld[2] = 0;
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitNormalWorld[0] = 0;
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitNormalWorld[1] = 0;
-			serverStatusOut.m_raycastHits.m_rayHits[rayHits].m_hitNormalWorld[2] = 0;
-		}
-		serverStatusOut.m_raycastHits.m_numRaycastHits++;
+			hit.m_hitFraction = 1;
+			hit.m_hitObjectUniqueId = -1;
+			hit.m_hitObjectLinkIndex = -1;
+			for (int i=0;i<3;i++)
+			{
+				hit.m_hitPositionWorld[i] = 0;
+				hit.m_hitNormalWorld[i] = 0;
+			}
+		}
+	}
+	if (streaming)
+	{
+		serverStatusOut.m_raycastHits.m_numStreamingRaycastHits = numRays;
+		serverStatusOut.m_numDataStreamBytes = numRays*sizeof(b3RayHitInfo);
+	} else
+	{
+		serverStatusOut.m_raycastHits.m_numRaycastHits = numRays;
 	}
 	serverStatusOut.m_type = CMD_REQUEST_RAY_CAST_INTERSECTIONS_COMPLETED;
 	return hasStatus;
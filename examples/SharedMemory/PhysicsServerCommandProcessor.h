@@ -132,6 +132,11 @@ public:
 		return false;
 	};
 
+	virtual bool canReceiveClientStreamData() const
+	{
+		return true;
+	}
+
 	virtual void renderScene(int renderFlags);
 	virtual void   physicsDebugDraw(int debugDrawFlags);
 	virtual void setGuiHelper(struct GUIHelperInterface* guiHelper);
@@ -276,17 +276,31 @@ enum EnumRequestContactDataUpdateFlags
 	CMD_REQUEST_CONTACT_POINT_HAS_LINK_INDEX_B_FILTER = 8,
 };
 
+struct b3RayData
+{
+	double m_rayFromPosition[3];
+	double m_rayToPosition[3];
+};
+
+///number of streamed rays that fit in one round trip, b3RayHitInfo is larger than b3RayData
+#define MAX_RAY_INTERSECTION_BATCH_SIZE_STREAMING (SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE/sizeof(b3RayHitInfo))
+
 struct RequestRaycastIntersections
 {
 	int m_numRays;
 	double m_rayFromPositions[MAX_RAY_INTERSECTION_BATCH_SIZE][3];
 	double m_rayToPositions[MAX_RAY_INTERSECTION_BATCH_SIZE][3];
+	///if non-zero, the rays are b3RayData in the stream buffer and m_numRays is ignored.
+	///the client splits larger batches into several requests of at most MAX_RAY_INTERSECTION_BATCH_SIZE_STREAMING rays
+	int m_numStreamingRays;
 };
 
 struct SendRaycastHits
 {
 	int m_numRaycastHits;
 	b3RayHitInfo m_rayHits[MAX_RAY_INTERSECTION_BATCH_SIZE];
+	///hits of streamed rays are b3RayHitInfo in the stream buffer, one per ray
+	int m_numStreamingRaycastHits;
 };
 
 struct RequestContactDataArgs
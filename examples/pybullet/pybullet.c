@@ -4451,28 +4451,21 @@ static PyObject* pybullet_rayTestBatch(PyObject* self, PyObject* args, PyObject*
 			} else
 			{
 				int i;
+				//large batches are streamed to the server, or split into several commands over TCP and UDP, so there is no limit on the number of rays
+				double* rayFromWorldArray = (double*)malloc(sizeof(double) * 3 * (lenFrom + 1));
+				double* rayToWorldArray = (double*)malloc(sizeof(double) * 3 * (lenFrom + 1));
 
-				if (lenFrom >= MAX_RAY_INTERSECTION_BATCH_SIZE)
-				{
-					PyErr_SetString(SpamError, "Number of rays exceed the maximum batch size.");
-					Py_DECREF(seqRayFromObj);
-					Py_DECREF(seqRayToObj);
-					return NULL;
-				}
 				for (i = 0; i < lenFrom; i++)
 				{
 					PyObject* rayFromObj = PySequence_GetItem(rayFromObjList,i);
 					PyObject* rayToObj = PySequence_GetItem(seqRayToObj,i);
-					double rayFromWorld[3];
-					double rayToWorld[3];
 					
-					if ((pybullet_internalSetVectord(rayFromObj, rayFromWorld)) &&
-						(pybullet_internalSetVectord(rayToObj, rayToWorld)))
-					{
-						b3RaycastBatchAddRay(commandHandle, rayFromWorld, rayToWorld);	
-					} else
+					if (!pybullet_internalSetVectord(rayFromObj, &rayFromWorldArray[i * 3]) ||
+						!pybullet_internalSetVectord(rayToObj, &rayToWorldArray[i * 3]))
 					{
 						PyErr_SetString(SpamError, "Items in the from/to positions need to be an [x,y,z] list of 3 floats/doubles");
+						free(rayFromWorldArray);
+						free(rayToWorldArray);
 						Py_DECREF(seqRayFromObj);
 						Py_DECREF(seqRayToObj);
 						Py_DECREF(rayFromObj);
@@ -4482,6 +4475,9 @@ static PyObject* pybullet_rayTestBatch(PyObject* self, PyObject* args, PyObject*
 					Py_DECREF(rayFromObj);
 					Py_DECREF(rayToObj);
 				}
+				b3RaycastBatchAddRays(sm, commandHandle, rayFromWorldArray, rayToWorldArray, lenFrom);
+				free(rayFromWorldArray);
+				free(rayToWorldArray);
 			}
 		} else
 		{
@@ -131,6 +131,7 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/LinearMath/btConvexHullComputer.cpp"]\
 +["src/LinearMath/btQuickprof.cpp"]\
 +["src/LinearMath/btThreads.cpp"]\
++["src/LinearMath/btCpuFeatureUtility.cpp"]\
 +["src/LinearMath/TaskScheduler/btTaskScheduler.cpp"]\
 +["src/LinearMath/TaskScheduler/btThreadSupportPosix.cpp"]\
 +["src/LinearMath/TaskScheduler/btThreadSupportWin32.cpp"]\
@@ -139,6 +140,9 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/BulletCollision/BroadphaseCollision/btOverlappingPairCache.cpp"]\
 +["src/BulletCollision/BroadphaseCollision/btBroadphaseProxy.cpp"]\
 +["src/BulletCollision/BroadphaseCollision/btDbvtBroadphase.cpp"]\
++["src/BulletCollision/BroadphaseCollision/btDbvtBroadphaseMt.cpp"]\
++["src/BulletCollision/BroadphaseCollision/btHashedGridBroadphase.cpp"]\
++["src/BulletCollision/BroadphaseCollision/btParallelLinearBvhBroadphase.cpp"]\
 +["src/BulletCollision/BroadphaseCollision/btQuantizedBvh.cpp"]\
 +["src/BulletCollision/BroadphaseCollision/btCollisionAlgorithm.cpp"]\
 +["src/BulletCollision/BroadphaseCollision/btDispatcher.cpp"]\
@@ -157,6 +161,7 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/BulletCollision/CollisionDispatch/btSimulationIslandManager.cpp"]\
 +["src/BulletCollision/CollisionDispatch/btBoxBoxDetector.cpp"]\
 +["src/BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.cpp"]\
++["src/BulletCollision/CollisionDispatch/btConvexConvexSpecializedAlgorithm.cpp"]\
 +["src/BulletCollision/CollisionDispatch/btSphereBoxCollisionAlgorithm.cpp"]\
 +["src/BulletCollision/CollisionDispatch/btCollisionDispatcher.cpp"]\
 +["src/BulletCollision/CollisionDispatch/btConvexPlaneCollisionAlgorithm.cpp"]\
@@ -264,6 +269,7 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyFixedConstraint.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyPoint2Point.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyConstraintSolver.cpp"]\
++["src/BulletDynamics/Featherstone/btMultiBodyConstraintSolverMt.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyJointLimitConstraint.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodySliderConstraint.cpp"]\
 +["src/BulletDynamics/Vehicle/btRaycastVehicle.cpp"]\
@@ -150,6 +150,7 @@ public:
 	virtual void  getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const;
 	
 	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
+	virtual void	rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
 
 	
@@ -287,6 +288,18 @@ void	btAxisSweep3Internal<BP_FP_INT_TYPE>::rayTest(const btVector3& rayFrom,cons
 	}
 }
 
+template <typename BP_FP_INT_TYPE>
+void	btAxisSweep3Internal<BP_FP_INT_TYPE>::rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	if (m_raycastAccelerator)
+	{
+		m_raycastAccelerator->rayTestPacket(rayFrom,rayTo,rayCallbacks,numRays,aabbMin,aabbMax);
+	} else
+	{
+		btBroadphaseInterface::rayTestPacket(rayFrom,rayTo,rayCallbacks,numRays,aabbMin,aabbMax);
+	}
+}
+
 template <typename BP_FP_INT_TYPE>
 void	btAxisSweep3Internal<BP_FP_INT_TYPE>::aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback)
 {
@@ -714,6 +727,10 @@ void	btAxisSweep3Internal<BP_FP_INT_TYPE>::calculateOverlappingPairs(btDispatche
 		//printf("overlappingPairArray.size()=%d\n",overlappingPairArray.size());
 	}
 
+	if (m_pairCache->hasSortedPairs())
+	{
+		m_pairCache->sortOverlappingPairs(dispatcher);
+	}
 }
 
 
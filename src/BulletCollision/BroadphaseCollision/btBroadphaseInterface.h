@@ -64,6 +64,16 @@ public:
 
 	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0)) = 0;
 
+	///rayTestPacket casts numRays coherent rays, rayCallbacks[i] receives the proxies along ray i.
+	///The default implementation casts the rays one by one, btDbvtBroadphase traces them together as ray packets.
+	virtual void	rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0))
+	{
+		for (int i=0;i<numRays;i++)
+		{
+			rayTest(rayFrom[i],rayTo[i],*rayCallbacks[i],aabbMin,aabbMax);
+		}
+	}
+
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
@@ -66,25 +66,45 @@ static void						getmaxdepth(const btDbvtNode* node,int depth,int& maxdepth)
 	} else maxdepth=btMax(maxdepth,depth);
 }
 
+//
+static void						allocateblock(	btAlignedObjectArray<btDbvtNode*>& blocks,
+											  btDbvtNode*& freelist,
+											  int size)
+{
+	btDbvtNode*	block=(btDbvtNode*)btAlignedAlloc(sizeof(btDbvtNode)*size,16);
+	blocks.push_back(block);
+	for(int i=size-1;i>=0;--i)
+	{
+		btDbvtNode*	node=new(&block[i]) btDbvtNode();
+		node->parent=freelist;
+		freelist=node;
+	}
+}
+
+//
+static void						freeblocks(btAlignedObjectArray<btDbvtNode*>& blocks)
+{
+	for(int i=0;i<blocks.size();++i)
+	{
+		btAlignedFree(blocks[i]);
+	}
+	blocks.clear();
+}
+
 //
 static DBVT_INLINE void			deletenode(	btDbvt* pdbvt,
 										   btDbvtNode* node)
 {
-	btAlignedFree(pdbvt->m_free);
+	node->parent=pdbvt->m_free;
 	pdbvt->m_free=node;
 }
 
 //
-static void						recursedeletenode(	btDbvt* pdbvt,
-												  btDbvtNode* node)
+static DBVT_INLINE void			deleteinternal(	btDbvt* pdbvt,
+											   btDbvtNode* node)
 {
-	if(!node->isleaf())
-	{
-		recursedeletenode(pdbvt,node->childs[0]);
-		recursedeletenode(pdbvt,node->childs[1]);
-	}
-	if(node==pdbvt->m_root) pdbvt->m_root=0;
-	deletenode(pdbvt,node);
+	node->parent=pdbvt->m_ifree;
+	pdbvt->m_ifree=node;
 }
 
 //
@@ -92,11 +112,12 @@ static DBVT_INLINE btDbvtNode*	createnode(	btDbvt* pdbvt,
 										   btDbvtNode* parent,
 										   void* data)
 {
-	btDbvtNode*	node;
-	if(pdbvt->m_free)
-	{ node=pdbvt->m_free;pdbvt->m_free=0; }
-	else
-	{ node=new(btAlignedAlloc(sizeof(btDbvtNode),16)) btDbvtNode(); }
+	if(!pdbvt->m_free)
+	{
+		allocateblock(pdbvt->m_lblocks,pdbvt->m_free,btMax<int>(btDbvt::NODEBLOCK_MINSIZE,pdbvt->m_leaves/2));
+	}
+	btDbvtNode*	node=pdbvt->m_free;
+	pdbvt->m_free	=	node->parent;
 	node->parent	=	parent;
 	node->data		=	data;
 	node->childs[1]	=	0;
@@ -115,13 +136,39 @@ static DBVT_INLINE btDbvtNode*	createnode(	btDbvt* pdbvt,
 }
 
 //
-static DBVT_INLINE btDbvtNode*	createnode(	btDbvt* pdbvt,
-										   btDbvtNode* parent,
-										   const btDbvtVolume& volume0,
-										   const btDbvtVolume& volume1,
-										   void* data)
+static DBVT_INLINE btDbvtNode*	createinternal(	btDbvt* pdbvt,
+											   btDbvtNode* parent)
 {
-	btDbvtNode*	node=createnode(pdbvt,parent,data);
+	if(!pdbvt->m_ifree)
+	{
+		allocateblock(pdbvt->m_iblocks,pdbvt->m_ifree,btMax<int>(btDbvt::NODEBLOCK_MINSIZE,pdbvt->m_leaves/2));
+	}
+	btDbvtNode*	node=pdbvt->m_ifree;
+	pdbvt->m_ifree	=	node->parent;
+	node->parent	=	parent;
+	node->childs[0]	=	0;
+	node->childs[1]	=	0;
+	++pdbvt->m_ichanges;
+	return(node);
+}
+
+//
+static DBVT_INLINE btDbvtNode*	createinternal(	btDbvt* pdbvt,
+											   btDbvtNode* parent,
+											   const btDbvtVolume& volume)
+{
+	btDbvtNode*	node=createinternal(pdbvt,parent);
+	node->volume=volume;
+	return(node);
+}
+
+//
+static DBVT_INLINE btDbvtNode*	createinternal(	btDbvt* pdbvt,
+											   btDbvtNode* parent,
+											   const btDbvtVolume& volume0,
+											   const btDbvtVolume& volume1)
+{
+	btDbvtNode*	node=createinternal(pdbvt,parent);
 	Merge(volume0,volume1,node->volume);
 	return(node);
 }
@@ -147,7 +194,7 @@ static void						insertleaf(	btDbvt* pdbvt,
 			} while(!root->isleaf());
 		}
 		btDbvtNode*	prev=root->parent;
-		btDbvtNode*	node=createnode(pdbvt,prev,leaf->volume,root->volume,0);
+		btDbvtNode*	node=createinternal(pdbvt,prev,leaf->volume,root->volume);
 		if(prev)
 		{
 			prev->childs[indexof(root)]	=	node;
@@ -188,7 +235,7 @@ static btDbvtNode*				removeleaf(	btDbvt* pdbvt,
 		{
 			prev->childs[indexof(parent)]=sibling;
 			sibling->parent=prev;
-			deletenode(pdbvt,parent);
+			deleteinternal(pdbvt,parent);
 			while(prev)
 			{
 				const btDbvtVolume	pb=prev->volume;
@@ -204,7 +251,7 @@ static btDbvtNode*				removeleaf(	btDbvt* pdbvt,
 		{								
 			pdbvt->m_root=sibling;
 			sibling->parent=0;
-			deletenode(pdbvt,parent);
+			deleteinternal(pdbvt,parent);
 			return(pdbvt->m_root);
 		}			
 	}
@@ -220,7 +267,7 @@ static void						fetchleaves(btDbvt* pdbvt,
 	{
 		fetchleaves(pdbvt,root->childs[0],leaves,depth-1);
 		fetchleaves(pdbvt,root->childs[1],leaves,depth-1);
-		deletenode(pdbvt,root);
+		deleteinternal(pdbvt,root);
 	}
 	else
 	{
@@ -322,7 +369,7 @@ static void						bottomup(	btDbvt* pdbvt,
 			}
 		}
 		btDbvtNode*	n[]	=	{leaves[minidx[0]],leaves[minidx[1]]};
-		btDbvtNode*	p	=	createnode(pdbvt,0,n[0]->volume,n[1]->volume,0);
+		btDbvtNode*	p	=	createinternal(pdbvt,0,n[0]->volume,n[1]->volume);
 		p->childs[0]		=	n[0];
 		p->childs[1]		=	n[1];
 		n[0]->parent		=	p;
@@ -383,7 +430,7 @@ static btDbvtNode*			topdown(btDbvt* pdbvt,
 			{
 				partition=count/2+1;
 			}
-			btDbvtNode*	node=createnode(pdbvt,0,vol,0);
+			btDbvtNode*	node=createinternal(pdbvt,0,vol);
 			node->childs[0]=topdown(pdbvt,&leaves[0],partition,bu_treshold);
 			node->childs[1]=topdown(pdbvt,&leaves[partition],count-partition,bu_treshold);
 			node->childs[0]->parent=node;
@@ -444,8 +491,10 @@ btDbvt::btDbvt()
 {
 	m_root		=	0;
 	m_free		=	0;
+	m_ifree		=	0;
 	m_lkhd		=	-1;
 	m_leaves	=	0;
+	m_ichanges	=	0;
 	m_opath		=	0;
 }
 
@@ -458,10 +507,12 @@ btDbvt::~btDbvt()
 //
 void			btDbvt::clear()
 {
-	if(m_root)	
-		recursedeletenode(this,m_root);
-	btAlignedFree(m_free);
-	m_free=0;
+	freeblocks(m_lblocks);
+	freeblocks(m_iblocks);
+	m_root		=	0;
+	m_free		=	0;
+	m_ifree		=	0;
+	m_ichanges	=	0;
 	m_lkhd		=	-1;
 	m_stkStack.clear();
 	m_opath		=	0;
@@ -504,7 +555,9 @@ void			btDbvt::optimizeIncremental(int passes)
 			unsigned	bit=0;
 			while(node->isinternal())
 			{
-				node=sort(node,m_root)->childs[(m_opath>>bit)&1];
+				btDbvtNode*	sorted=sort(node,m_root);
+				if(sorted!=node) ++m_ichanges;
+				node=sorted->childs[(m_opath>>bit)&1];
 				bit=(bit+1)&(sizeof(unsigned)*8-1);
 			}
 			update(node);
@@ -513,6 +566,66 @@ void			btDbvt::optimizeIncremental(int passes)
 	}
 }
 
+//
+void			btDbvt::optimizeLayout()
+{
+	m_ichanges=0;
+	if((!m_root)||m_root->isleaf())
+	{
+		freeblocks(m_iblocks);
+		m_ifree=0;
+		return;
+	}
+	/* internal nodes in depth first order	*/ 
+	tNodeArray	nodes;
+	tNodeArray	stack;
+	nodes.reserve(m_leaves);
+	stack.push_back(m_root);
+	do	{
+		btDbvtNode*	n=stack[stack.size()-1];
+		stack.pop_back();
+		nodes.push_back(n);
+		if(n->childs[1]->isinternal()) stack.push_back(n->childs[1]);
+		if(n->childs[0]->isinternal()) stack.push_back(n->childs[0]);
+	} while(stack.size()>0);
+	/* copy, the parent of an old node forwards to its copy	*/ 
+	const int	count=nodes.size();
+	const int	size=count+btMax<int>(NODEBLOCK_MINSIZE,count/4);
+	btDbvtNode*	block=(btDbvtNode*)btAlignedAlloc(sizeof(btDbvtNode)*size,16);
+	for(int i=0;i<count;++i)
+	{
+		btDbvtNode*	n=new(&block[i]) btDbvtNode();
+		n->volume		=	nodes[i]->volume;
+		n->childs[0]	=	nodes[i]->childs[0];
+		n->childs[1]	=	nodes[i]->childs[1];
+		nodes[i]->parent=	n;
+	}
+	/* relink					*/ 
+	for(int i=0;i<count;++i)
+	{
+		btDbvtNode*	n=&block[i];
+		for(int j=0;j<2;++j)
+		{
+			btDbvtNode*	c=n->childs[j];
+			if(c->isinternal()) c=c->parent;
+			c->parent=n;
+			n->childs[j]=c;
+		}
+	}
+	m_root=m_root->parent;
+	m_root->parent=0;
+	/* replace the old blocks	*/ 
+	freeblocks(m_iblocks);
+	m_iblocks.push_back(block);
+	m_ifree=0;
+	for(int i=size-1;i>=count;--i)
+	{
+		btDbvtNode*	n=new(&block[i]) btDbvtNode();
+		n->parent=m_ifree;
+		m_ifree=n;
+	}
+}
+
 //
 btDbvtNode*	btDbvt::insert(const btDbvtVolume& volume,void* data)
 {
@@ -630,7 +743,9 @@ void			btDbvt::clone(btDbvt& dest,IClone* iclone) const
 		do	{
 			const int		i=stack.size()-1;
 			const sStkCLN	e=stack[i];
-			btDbvtNode*			n=createnode(&dest,e.parent,e.node->volume,e.node->data);
+			btDbvtNode*			n=e.node->isinternal()?
+				createinternal(&dest,e.parent,e.node->volume):
+				createnode(&dest,e.parent,e.node->volume,e.node->data);
 			stack.pop_back();
 			if(e.parent!=0)
 				e.parent->childs[i&1]=n;
@@ -1327,3 +1442,125 @@ void			btDbvt::benchmark()
 	printf("\r\n\r\n");
 }
 #endif
+
+//
+// btDbvtWide
+//
+
+//
+struct	sStkBuild
+{
+	const btDbvtNode*	node;
+	int					parent;
+	int					lane;
+	sStkBuild() {}
+	sStkBuild(const btDbvtNode* n,int p,int l) : node(n),parent(p),lane(l) {}
+};
+
+// half surface area
+static DBVT_INLINE btScalar		area(const btDbvtVolume& a)
+{
+	const btVector3	edges=a.Lengths();
+	return(	edges.x()*edges.y()+
+		edges.y()*edges.z()+
+		edges.z()*edges.x());
+}
+
+//
+btDbvtWide::btDbvtWide()
+{
+	m_root	=	0;
+}
+
+//
+btDbvtWide::~btDbvtWide()
+{
+	clear();
+}
+
+//
+void			btDbvtWide::clear()
+{
+	m_nodes.clear();
+	m_leaves.clear();
+	m_stkStack.clear();
+	m_root	=	0;
+}
+
+//
+void			btDbvtWide::build(const btDbvt& tree)
+{
+	m_nodes.resize(0);
+	m_leaves.resize(0);
+	m_root	=	0;
+	if(!tree.m_root) return;
+	m_nodes.reserve(tree.m_leaves/2+1);
+	m_leaves.reserve(tree.m_leaves);
+	btAlignedObjectArray<sStkBuild>	stack;
+	stack.push_back(sStkBuild(tree.m_root,-1,0));
+	do	{
+		const sStkBuild		e=stack[stack.size()-1];
+		stack.pop_back();
+		int					ref;
+		if(e.node->isleaf())
+		{
+			ref=-1-m_leaves.size();
+			m_leaves.push_back(e.node);
+		}
+		else
+		{
+			/* gather up to DBVT_WIDE_LANES children	*/
+			const btDbvtNode*	childs[DBVT_WIDE_LANES];
+			int					count=2;
+			childs[0]=e.node->childs[0];
+			childs[1]=e.node->childs[1];
+			while(count<DBVT_WIDE_LANES)
+			{
+				int			best=-1;
+				btScalar	bestarea=0;
+				for(int i=0;i<count;++i)
+				{
+					if(childs[i]->isinternal())
+					{
+						const btScalar	a=area(childs[i]->volume);
+						if((best<0)||(a>bestarea)) { best=i;bestarea=a; }
+					}
+				}
+				if(best<0) break;
+				const btDbvtNode*	n=childs[best];
+				childs[best]=n->childs[0];
+				childs[count++]=n->childs[1];
+			}
+			ref=m_nodes.size();
+			btDbvtWideNode&		wn=m_nodes.expandNonInitializing();
+			wn.count=count;
+			for(int i=0;i<DBVT_WIDE_LANES;++i)
+			{
+				if(i<count)
+				{
+					const btDbvtVolume&	v=childs[i]->volume;
+					for(int k=0;k<3;++k)
+					{
+						wn.mi[k][i]=v.Mins()[k];
+						wn.mx[k][i]=v.Maxs()[k];
+					}
+					stack.push_back(sStkBuild(childs[i],ref,i));
+				}
+				else
+				{
+					/* empty lanes never overlap	*/
+					for(int k=0;k<3;++k)
+					{
+						wn.mi[k][i]=BT_LARGE_FLOAT;
+						wn.mx[k][i]=-BT_LARGE_FLOAT;
+					}
+				}
+				wn.childs[i]=0;
+			}
+		}
+		if(e.parent<0)
+			m_root=ref;
+		else
+			m_nodes[e.parent].childs[e.lane]=ref;
+	} while(stack.size()>0);
+}
@@ -67,9 +67,17 @@ subject to the following restrictions:
 #define DBVT_INT0_IMPL			DBVT_IMPL_GENERIC
 #endif
 
+//The wide node lanes are plain floats, SSE2 can be used whenever the compiler has it
+#if defined (BT_USE_SSE) || (defined (__SSE2__) && !defined (BT_USE_DOUBLE_PRECISION))
+#define DBVT_WIDE_IMPL			DBVT_IMPL_SSE
+#else
+#define DBVT_WIDE_IMPL			DBVT_IMPL_GENERIC
+#endif
+
 #if	(DBVT_SELECT_IMPL==DBVT_IMPL_SSE)||	\
 	(DBVT_MERGE_IMPL==DBVT_IMPL_SSE)||	\
-	(DBVT_INT0_IMPL==DBVT_IMPL_SSE)
+	(DBVT_INT0_IMPL==DBVT_IMPL_SSE)||	\
+	(DBVT_WIDE_IMPL==DBVT_IMPL_SSE)
 #include <emmintrin.h>
 #endif
 
@@ -122,6 +130,10 @@ subject to the following restrictions:
 #error "DBVT_INT0_IMPL undefined"
 #endif
 
+#ifndef DBVT_WIDE_IMPL
+#error "DBVT_WIDE_IMPL undefined"
+#endif
+
 
 //
 // Defaults volumes
@@ -209,6 +221,7 @@ struct	btDbvt
 	{
 		const btDbvtNode*	node;
 		int			mask;
+		sStkNP() {}
 		sStkNP(const btDbvtNode* n,unsigned m) : node(n),mask(m) {}
 	};
 	struct	sStkNPS
@@ -234,6 +247,7 @@ struct	btDbvt
 			DBVT_VIRTUAL void	Process(const btDbvtNode*,const btDbvtNode*)		{}
 		DBVT_VIRTUAL void	Process(const btDbvtNode*)					{}
 		DBVT_VIRTUAL void	Process(const btDbvtNode* n,btScalar)			{ Process(n); }
+		DBVT_VIRTUAL void	ProcessRays(const btDbvtNode* n,unsigned)		{ Process(n); }
 		DBVT_VIRTUAL bool	Descent(const btDbvtNode*)					{ return(true); }
 		DBVT_VIRTUAL bool	AllLeaves(const btDbvtNode*)					{ return(true); }
 	};
@@ -255,15 +269,20 @@ struct	btDbvt
 	// Constants
 	enum	{
 		SIMPLE_STACKSIZE	=	64,
-		DOUBLE_STACKSIZE	=	SIMPLE_STACKSIZE*2
+		DOUBLE_STACKSIZE	=	SIMPLE_STACKSIZE*2,
+		NODEBLOCK_MINSIZE	=	8
 	};
 
 	// Fields
 	btDbvtNode*		m_root;
-	btDbvtNode*		m_free;
+	btDbvtNode*		m_free;		// Free leaves, linked through parent
+	btDbvtNode*		m_ifree;	// Free internal nodes, linked through parent
 	int				m_lkhd;
 	int				m_leaves;
+	int				m_ichanges;	// Internal nodes created or rotated since the last optimizeLayout
 	unsigned		m_opath;
+	btAlignedObjectArray<btDbvtNode*>	m_lblocks;	// Leaf blocks, leaves never move
+	btAlignedObjectArray<btDbvtNode*>	m_iblocks;	// Internal node blocks, compacted by optimizeLayout
 
 	
 	btAlignedObjectArray<sStkNN>	m_stkStack;
@@ -277,6 +296,9 @@ struct	btDbvt
 	void			optimizeBottomUp();
 	void			optimizeTopDown(int bu_treshold=128);
 	void			optimizeIncremental(int passes);
+	///optimizeLayout moves the internal nodes into one block in depth first order, so traversals walk memory
+	///mostly forward. The topology and the leaves are unchanged, only pointers to internal nodes are invalidated.
+	void			optimizeLayout();
 	btDbvtNode*		insert(const btDbvtVolume& box,void* data);
 	void			update(btDbvtNode* leaf,int lookahead=-1);
 	void			update(btDbvtNode* leaf,btDbvtVolume& volume);
@@ -310,6 +332,14 @@ struct	btDbvt
 		void		collideTTpersistentStack(	const btDbvtNode* root0,
 		  const btDbvtNode* root1,
 		  DBVT_IPOLICY);
+
+	///collideTTNoStackAlloc is re-entrant as long as each caller provides its own stack, so disjoint
+	///node pairs of the same trees can be collided in parallel (see btDbvtBroadphaseMt)
+	DBVT_PREFIX
+		void		collideTTNoStackAlloc(	const btDbvtNode* root0,
+		  const btDbvtNode* root1,
+		  btAlignedObjectArray<sStkNN>& stack,
+		  DBVT_IPOLICY) const;
 #if 0
 	DBVT_PREFIX
 		void		collideTT(	const btDbvtNode* root0,
@@ -358,6 +388,16 @@ struct	btDbvt
 								const btVector3& aabbMax,
                                 btAlignedObjectArray<const btDbvtNode*>& stack,
 								DBVT_IPOLICY) const;
+	///rayTestPacket traces a packet of coherent rays through the tree together, each node is tested once against all rays
+	///that hit its parent, and policy.ProcessRays(leaf,rayMask) is called with the rays that hit the leaf.
+	///Node volumes are expanded by aabbMin/aabbMax like in rayTestInternal. The policy can lower packet.m_fraction to cull rays.
+	DBVT_PREFIX
+		void		rayTestPacket(	const btDbvtNode* root,
+								const btRayPacket& packet,
+								const btVector3& aabbMin,
+								const btVector3& aabbMax,
+								btAlignedObjectArray<sStkNP>& stack,
+								DBVT_IPOLICY) const;
 
 	DBVT_PREFIX
 		static void		collideKDOP(const btDbvtNode* root,
@@ -403,6 +443,68 @@ private:
 	btDbvt(const btDbvt&)	{}	
 };
 
+// Number of children per wide node, one SSE lane each
+#define DBVT_WIDE_LANES			4
+
+/* btDbvtWideNode			*/
+ATTRIBUTE_ALIGNED16(struct)	btDbvtWideNode
+{
+	btScalar	mi[3][DBVT_WIDE_LANES];		// child volumes, SoA: one row per axis, one lane per child
+	btScalar	mx[3][DBVT_WIDE_LANES];
+	int			childs[DBVT_WIDE_LANES];	// >=0: wide node index, <0: -1-leaf index
+	int			count;
+	int			padding[3];					// keep the lanes 16 byte aligned in arrays, ATTRIBUTE_ALIGNED16 may be empty
+};
+
+///The btDbvtWide class is a read-only snapshot of a btDbvt with up to 4 children per node.
+///The child volumes of a node are stored as SoA min/max lanes, so a volume is tested against all
+///children of a node with a single SSE comparison. It is built from a btDbvt in linear time, and
+///its leaves are the leaves of the source tree, so the usual ICollide policies can be used.
+///The snapshot is invalid once leaves are removed from the source tree or change their volume.
+struct	btDbvtWide
+{
+	typedef btDbvt::ICollide	ICollide;
+	/* Stack element	*/
+	struct	sStkRR
+	{
+		int		a;
+		int		b;
+		sStkRR() {}
+		sStkRR(int ra,int rb) : a(ra),b(rb) {}
+	};
+
+	// Fields
+	btAlignedObjectArray<btDbvtWideNode>	m_nodes;
+	btAlignedObjectArray<const btDbvtNode*>	m_leaves;
+	int										m_root;
+	btAlignedObjectArray<sStkRR>			m_stkStack;
+
+	// Methods
+	btDbvtWide();
+	~btDbvtWide();
+	void			clear();
+	bool			empty() const { return(0==m_leaves.size()); }
+	///collapse the binary tree into wide nodes, always expanding the child with the largest volume
+	void			build(const btDbvt& tree);
+
+	DBVT_INLINE static bool			isleaf(int ref)	{ return(ref<0); }
+	DBVT_INLINE const btDbvtNode*	leaf(int ref) const	{ return(m_leaves[-1-ref]); }
+	///returns a bit mask of the children of node that intersect [mi,mx]
+	DBVT_INLINE static unsigned		overlap(const btDbvtWideNode& node,const btScalar* mi,const btScalar* mx);
+
+	///collide this tree with other (or with itself if &other==this), reporting pairs of source leaves
+	DBVT_PREFIX
+		void		collideTT(	const btDbvtWide& other,
+		DBVT_IPOLICY);
+	DBVT_PREFIX
+		void		collideTV(	const btDbvtVolume& volume,
+		DBVT_IPOLICY) const;
+private:
+	DBVT_PREFIX
+		void		collideRefs(const btDbvtWide& other,int ra,int rb,DBVT_IPOLICY);
+	btDbvtWide(const btDbvtWide&)	{}
+};
+
 //
 // Inline's
 //
@@ -803,6 +905,16 @@ DBVT_PREFIX
 inline void		btDbvt::collideTTpersistentStack(	const btDbvtNode* root0,
 								  const btDbvtNode* root1,
 								  DBVT_IPOLICY)
+{
+	DBVT_CHECKTYPE
+		collideTTNoStackAlloc(root0,root1,m_stkStack,policy);
+}
+
+DBVT_PREFIX
+inline void		btDbvt::collideTTNoStackAlloc(	const btDbvtNode* root0,
+								  const btDbvtNode* root1,
+								  btAlignedObjectArray<sStkNN>& stkStack,
+								  DBVT_IPOLICY) const
 {
 	DBVT_CHECKTYPE
 		if(root0&&root1)
@@ -810,22 +922,22 @@ inline void		btDbvt::collideTTpersistentStack(	const btDbvtNode* root0,
 			int								depth=1;
 			int								treshold=DOUBLE_STACKSIZE-4;
 			
-			m_stkStack.resize(DOUBLE_STACKSIZE);
-			m_stkStack[0]=sStkNN(root0,root1);
+			stkStack.resize(DOUBLE_STACKSIZE);
+			stkStack[0]=sStkNN(root0,root1);
 			do	{		
-				sStkNN	p=m_stkStack[--depth];
+				sStkNN	p=stkStack[--depth];
 				if(depth>treshold)
 				{
-					m_stkStack.resize(m_stkStack.size()*2);
-					treshold=m_stkStack.size()-4;
+					stkStack.resize(stkStack.size()*2);
+					treshold=stkStack.size()-4;
 				}
 				if(p.a==p.b)
 				{
 					if(p.a->isinternal())
 					{
-						m_stkStack[depth++]=sStkNN(p.a->childs[0],p.a->childs[0]);
-						m_stkStack[depth++]=sStkNN(p.a->childs[1],p.a->childs[1]);
-						m_stkStack[depth++]=sStkNN(p.a->childs[0],p.a->childs[1]);
+						stkStack[depth++]=sStkNN(p.a->childs[0],p.a->childs[0]);
+						stkStack[depth++]=sStkNN(p.a->childs[1],p.a->childs[1]);
+						stkStack[depth++]=sStkNN(p.a->childs[0],p.a->childs[1]);
 					}
 				}
 				else if(Intersect(p.a->volume,p.b->volume))
@@ -834,23 +946,23 @@ inline void		btDbvt::collideTTpersistentStack(	const btDbvtNode* root0,
 					{
 						if(p.b->isinternal())
 						{
-							m_stkStack[depth++]=sStkNN(p.a->childs[0],p.b->childs[0]);
-							m_stkStack[depth++]=sStkNN(p.a->childs[1],p.b->childs[0]);
-							m_stkStack[depth++]=sStkNN(p.a->childs[0],p.b->childs[1]);
-							m_stkStack[depth++]=sStkNN(p.a->childs[1],p.b->childs[1]);
+							stkStack[depth++]=sStkNN(p.a->childs[0],p.b->childs[0]);
+							stkStack[depth++]=sStkNN(p.a->childs[1],p.b->childs[0]);
+							stkStack[depth++]=sStkNN(p.a->childs[0],p.b->childs[1]);
+							stkStack[depth++]=sStkNN(p.a->childs[1],p.b->childs[1]);
 						}
 						else
 						{
-							m_stkStack[depth++]=sStkNN(p.a->childs[0],p.b);
-							m_stkStack[depth++]=sStkNN(p.a->childs[1],p.b);
+							stkStack[depth++]=sStkNN(p.a->childs[0],p.b);
+							stkStack[depth++]=sStkNN(p.a->childs[1],p.b);
 						}
 					}
 					else
 					{
 						if(p.b->isinternal())
 						{
-							m_stkStack[depth++]=sStkNN(p.a,p.b->childs[0]);
-							m_stkStack[depth++]=sStkNN(p.a,p.b->childs[1]);
+							stkStack[depth++]=sStkNN(p.a,p.b->childs[0]);
+							stkStack[depth++]=sStkNN(p.a,p.b->childs[1]);
 						}
 						else
 						{
@@ -1055,6 +1167,44 @@ inline void		btDbvt::rayTestInternal(	const btDbvtNode* root,
 	}
 }
 
+//
+DBVT_PREFIX
+inline void		btDbvt::rayTestPacket(	const btDbvtNode* root,
+								const btRayPacket& packet,
+								const btVector3& aabbMin,
+								const btVector3& aabbMax,
+								btAlignedObjectArray<sStkNP>& stack,
+								DBVT_IPOLICY) const
+{
+	DBVT_CHECKTYPE
+	if(root)
+	{
+		stack.resizeNoInitialize(0);
+		stack.push_back(sStkNP(root,packet.getRayMask()));
+		btVector3 bounds[2];
+		do	
+		{
+			const sStkNP	se=stack[stack.size()-1];
+			stack.pop_back();
+			bounds[0] = se.node->volume.Mins()-aabbMax;
+			bounds[1] = se.node->volume.Maxs()-aabbMin;
+			const unsigned int mask=btRayAabbPacket(packet,bounds,(unsigned int)se.mask);
+			if(mask)
+			{
+				if(se.node->isinternal())
+				{
+					stack.push_back(sStkNP(se.node->childs[0],mask));
+					stack.push_back(sStkNP(se.node->childs[1],mask));
+				}
+				else
+				{
+					policy.ProcessRays(se.node,mask);
+				}
+			}
+		} while(stack.size());
+	}
+}
+
 //
 DBVT_PREFIX
 inline void		btDbvt::rayTest(	const btDbvtNode* root,
@@ -1322,6 +1472,169 @@ inline void		btDbvt::collideTU(	const btDbvtNode* root,
 		}
 }
 
+//
+DBVT_INLINE unsigned	btDbvtWide::overlap(const btDbvtWideNode& node,const btScalar* mi,const btScalar* mx)
+{
+#if	DBVT_WIDE_IMPL == DBVT_IMPL_SSE
+	__m128	rt=_mm_and_ps(	_mm_cmple_ps(_mm_load_ps(node.mi[0]),_mm_set1_ps(mx[0])),
+		_mm_cmpge_ps(_mm_load_ps(node.mx[0]),_mm_set1_ps(mi[0])));
+	rt=_mm_and_ps(rt,_mm_and_ps(	_mm_cmple_ps(_mm_load_ps(node.mi[1]),_mm_set1_ps(mx[1])),
+		_mm_cmpge_ps(_mm_load_ps(node.mx[1]),_mm_set1_ps(mi[1]))));
+	rt=_mm_and_ps(rt,_mm_and_ps(	_mm_cmple_ps(_mm_load_ps(node.mi[2]),_mm_set1_ps(mx[2])),
+		_mm_cmpge_ps(_mm_load_ps(node.mx[2]),_mm_set1_ps(mi[2]))));
+	return((unsigned)_mm_movemask_ps(rt));
+#else
+	unsigned	mask=0;
+	for(int i=0;i<DBVT_WIDE_LANES;++i)
+	{
+		if(	(node.mi[0][i]<=mx[0])&&(node.mx[0][i]>=mi[0])&&
+			(node.mi[1][i]<=mx[1])&&(node.mx[1][i]>=mi[1])&&
+			(node.mi[2][i]<=mx[2])&&(node.mx[2][i]>=mi[2]))
+		{
+			mask|=1u<<i;
+		}
+	}
+	return(mask);
+#endif
+}
+
+//
+DBVT_PREFIX
+inline void		btDbvtWide::collideRefs(const btDbvtWide& other,int ra,int rb,DBVT_IPOLICY)
+{
+	// ra and rb are known to intersect
+	if(isleaf(ra)&&other.isleaf(rb))
+	{
+		policy.Process(leaf(ra),other.leaf(rb));
+	}
+	else
+	{
+		m_stkStack.push_back(sStkRR(ra,rb));
+	}
+}
+
+//
+DBVT_PREFIX
+inline void		btDbvtWide::collideTT(	const btDbvtWide& other,
+									  DBVT_IPOLICY)
+{
+	DBVT_CHECKTYPE
+	if(empty()||other.empty()) return;
+	const bool	self=(&other==this);
+	if(isleaf(m_root)&&isleaf(other.m_root))
+	{
+		if((!self)&&Intersect(leaf(m_root)->volume,other.leaf(other.m_root)->volume))
+		{
+			policy.Process(leaf(m_root),other.leaf(other.m_root));
+		}
+		return;
+	}
+	m_stkStack.resize(0);
+	m_stkStack.push_back(sStkRR(m_root,other.m_root));
+	do	{
+		const sStkRR	p=m_stkStack[m_stkStack.size()-1];
+		m_stkStack.pop_back();
+		if(self&&(p.a==p.b))
+		{
+			if(isleaf(p.a)) continue;
+			const btDbvtWideNode&	n=m_nodes[p.a];
+			for(int i=0;i<n.count;++i)
+			{
+				const btScalar	mi[]={n.mi[0][i],n.mi[1][i],n.mi[2][i]};
+				const btScalar	mx[]={n.mx[0][i],n.mx[1][i],n.mx[2][i]};
+				unsigned		mask=overlap(n,mi,mx)&(~0u<<(i+1));
+				if(!isleaf(n.childs[i])) m_stkStack.push_back(sStkRR(n.childs[i],n.childs[i]));
+				for(int j=i+1;mask;++j)
+				{
+					if(mask&(1u<<j))
+					{
+						collideRefs(other,n.childs[i],n.childs[j],policy);
+						mask&=~(1u<<j);
+					}
+				}
+			}
+		}
+		else if(isleaf(p.a))
+		{
+			const btDbvtVolume&		v=leaf(p.a)->volume;
+			const btDbvtWideNode&	nb=other.m_nodes[p.b];
+			unsigned				mask=overlap(nb,&v.Mins()[0],&v.Maxs()[0]);
+			for(int j=0;mask;++j)
+			{
+				if(mask&(1u<<j))
+				{
+					collideRefs(other,p.a,nb.childs[j],policy);
+					mask&=~(1u<<j);
+				}
+			}
+		}
+		else
+		{
+			const btDbvtWideNode&	na=m_nodes[p.a];
+			for(int i=0;i<na.count;++i)
+			{
+				const btScalar	mi[]={na.mi[0][i],na.mi[1][i],na.mi[2][i]};
+				const btScalar	mx[]={na.mx[0][i],na.mx[1][i],na.mx[2][i]};
+				if(other.isleaf(p.b))
+				{
+					const btDbvtVolume&	v=other.leaf(p.b)->volume;
+					if(	(mi[0]<=v.Maxs().x())&&(mx[0]>=v.Mins().x())&&
+						(mi[1]<=v.Maxs().y())&&(mx[1]>=v.Mins().y())&&
+						(mi[2]<=v.Maxs().z())&&(mx[2]>=v.Mins().z()))
+					{
+						collideRefs(other,na.childs[i],p.b,policy);
+					}
+					continue;
+				}
+				const btDbvtWideNode&	nb=other.m_nodes[p.b];
+				unsigned				mask=overlap(nb,mi,mx);
+				for(int j=0;mask;++j)
+				{
+					if(mask&(1u<<j))
+					{
+						collideRefs(other,na.childs[i],nb.childs[j],policy);
+						mask&=~(1u<<j);
+					}
+				}
+			}
+		}
+	} while(m_stkStack.size()>0);
+}
+
+//
+DBVT_PREFIX
+inline void		btDbvtWide::collideTV(	const btDbvtVolume& volume,
+									  DBVT_IPOLICY) const
+{
+	DBVT_CHECKTYPE
+	if(empty()) return;
+	if(isleaf(m_root))
+	{
+		if(Intersect(leaf(m_root)->volume,volume)) policy.Process(leaf(m_root));
+		return;
+	}
+	const btScalar*			mi=&volume.Mins()[0];
+	const btScalar*			mx=&volume.Maxs()[0];
+	btAlignedObjectArray<int>	stack;
+	stack.push_back(m_root);
+	do	{
+		const btDbvtWideNode&	n=m_nodes[stack[stack.size()-1]];
+		stack.pop_back();
+		unsigned				mask=overlap(n,mi,mx);
+		for(int i=0;mask;++i)
+		{
+			if(mask&(1u<<i))
+			{
+				if(isleaf(n.childs[i]))
+					policy.Process(leaf(n.childs[i]));
+				else
+					stack.push_back(n.childs[i]);
+				mask&=~(1u<<i);
+			}
+		}
+	} while(stack.size()>0);
+}
+
 //
 // PP Cleanup
 //
@@ -1339,5 +1652,6 @@ inline void		btDbvt::collideTU(	const btDbvtNode* root,
 #undef DBVT_SELECT_IMPL
 #undef DBVT_MERGE_IMPL
 #undef DBVT_INT0_IMPL
+#undef DBVT_WIDE_IMPL
 
 #endif
@@ -124,6 +124,8 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 {
 	m_deferedcollide	=	false;
 	m_needcleanup		=	true;
+	m_usewidetree		=	false;
+	m_widefixeddirty	=	true;
 	m_releasepaircache	=	(paircache!=0)?false:true;
 	m_prediction		=	0;
 	m_stageCurrent		=	0;
@@ -131,6 +133,7 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 	m_fupdates			=	1;
 	m_dupdates			=	0;
 	m_cupdates			=	10;
+	m_lupdates			=	4;
 	m_newpairs			=	1;
 	m_updates_call		=	0;
 	m_updates_done		=	0;
@@ -145,8 +148,10 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 	}
 #if BT_THREADSAFE
     m_rayTestStacks.resize(BT_MAX_THREAD_COUNT);
+    m_rayPacketStacks.resize(BT_MAX_THREAD_COUNT);
 #else
     m_rayTestStacks.resize(1);
+    m_rayPacketStacks.resize(1);
 #endif
 #if DBVT_BP_PROFILE
 	clear(m_profiling);
@@ -199,7 +204,10 @@ void							btDbvtBroadphase::destroyProxy(	btBroadphaseProxy* absproxy,
 {
 	btDbvtProxy*	proxy=(btDbvtProxy*)absproxy;
 	if(proxy->stage==STAGECOUNT)
+	{
 		m_sets[1].remove(proxy->leaf);
+		m_widefixeddirty=true;
+	}
 	else
 		m_sets[0].remove(proxy->leaf);
 	listremove(proxy,m_stageRoots[proxy->stage]);
@@ -275,6 +283,68 @@ void	btDbvtBroadphase::rayTest(const btVector3& rayFrom,const btVector3& rayTo,
 }
 
 
+struct	BroadphasePacketRayTester : btDbvt::ICollide
+{
+	btBroadphaseRayCallback** m_rayCallbacks;
+	btRayPacket& m_packet;
+	const btScalar* m_invLength;
+	BroadphasePacketRayTester(btBroadphaseRayCallback** rayCallbacks,btRayPacket& packet,const btScalar* invLength)
+		:m_rayCallbacks(rayCallbacks),
+		m_packet(packet),
+		m_invLength(invLength)
+	{
+	}
+	void					ProcessRays(const btDbvtNode* leaf,unsigned rayMask)
+	{
+		btDbvtProxy*	proxy=(btDbvtProxy*)leaf->data;
+		for (int i=0;rayMask;i++,rayMask>>=1)
+		{
+			if (rayMask&1)
+			{
+				m_rayCallbacks[i]->process(proxy);
+				//the callback may have shortened the ray
+				m_packet.m_fraction[i]=m_rayCallbacks[i]->m_lambda_max*m_invLength[i];
+			}
+		}
+	}
+};
+
+void	btDbvtBroadphase::rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin,const btVector3& aabbMax)
+{
+    btAlignedObjectArray<btDbvt::sStkNP>* stack = &m_rayPacketStacks[0];
+#if BT_THREADSAFE
+    // each thread needs its own traversal stack, see rayTest
+    int threadIndex = btGetCurrentThreadIndex();
+    btAlignedObjectArray<btDbvt::sStkNP> localStack;
+    if (threadIndex < m_rayPacketStacks.size())
+    {
+        stack = &m_rayPacketStacks[threadIndex];
+    }
+    else
+    {
+        stack = &localStack;
+    }
+#endif
+	btRayPacket packet;
+	btScalar invLength[BT_RAY_PACKET_SIZE];
+	for (int first=0;first<numRays;first+=BT_RAY_PACKET_SIZE)
+	{
+		const int count=btMin(numRays-first,int(BT_RAY_PACKET_SIZE));
+		packet.init(&rayFrom[first],&rayTo[first],count);
+		for (int i=0;i<count;i++)
+		{
+			//m_lambda_max is a distance along the ray, the packet uses fractions of the ray
+			const btScalar length=(rayTo[first+i]-rayFrom[first+i]).length();
+			invLength[i]=length>SIMD_EPSILON ? btScalar(1.0)/length : btScalar(1.0);
+			packet.m_fraction[i]=rayCallbacks[first+i]->m_lambda_max*invLength[i];
+		}
+		BroadphasePacketRayTester callback(&rayCallbacks[first],packet,invLength);
+		m_sets[0].rayTestPacket(m_sets[0].m_root,packet,aabbMin,aabbMax,*stack,callback);
+		m_sets[1].rayTestPacket(m_sets[1].m_root,packet,aabbMin,aabbMax,*stack,callback);
+	}
+}
+
+
 struct	BroadphaseAabbTester : btDbvt::ICollide
 {
 	btBroadphaseAabbCallback& m_aabbCallback;
@@ -318,6 +388,7 @@ void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 		if(proxy->stage==STAGECOUNT)
 		{/* fixed -> dynamic set	*/ 
 			m_sets[1].remove(proxy->leaf);
+			m_widefixeddirty=true;
 			proxy->leaf=m_sets[0].insert(aabb,proxy);
 			docollide=true;
 		}
@@ -332,13 +403,7 @@ void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 				if(delta[0]<0) velocity[0]=-velocity[0];
 				if(delta[1]<0) velocity[1]=-velocity[1];
 				if(delta[2]<0) velocity[2]=-velocity[2];
-				if	(
-#ifdef DBVT_BP_MARGIN				
-					m_sets[0].update(proxy->leaf,aabb,velocity,DBVT_BP_MARGIN)
-#else
-					m_sets[0].update(proxy->leaf,aabb,velocity)
-#endif
-					)
+				if(updateMovingLeaf(proxy->leaf,aabb,velocity))
 				{
 					++m_updates_done;
 					docollide=true;
@@ -370,6 +435,16 @@ void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 }
 
 
+//
+bool							btDbvtBroadphase::updateMovingLeaf(btDbvtNode* leaf,btDbvtVolume& volume,const btVector3& velocity)
+{
+#ifdef DBVT_BP_MARGIN				
+	return(m_sets[0].update(leaf,volume,velocity,DBVT_BP_MARGIN));
+#else
+	return(m_sets[0].update(leaf,volume,velocity));
+#endif
+}
+
 //
 void							btDbvtBroadphase::setAabbForceUpdate(		btBroadphaseProxy* absproxy,
 														  const btVector3& aabbMin,
@@ -382,6 +457,7 @@ void							btDbvtBroadphase::setAabbForceUpdate(		btBroadphaseProxy* absproxy,
 	if(proxy->stage==STAGECOUNT)
 	{/* fixed -> dynamic set	*/ 
 		m_sets[1].remove(proxy->leaf);
+		m_widefixeddirty=true;
 		proxy->leaf=m_sets[0].insert(aabb,proxy);
 		docollide=true;
 	}
@@ -436,6 +512,10 @@ void							btDbvtBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
 
 	performDeferredRemoval(dispatcher);
 
+	if (m_paircache->hasSortedPairs())
+	{
+		m_paircache->sortOverlappingPairs(dispatcher);
+	}
 }
 
 void btDbvtBroadphase::performDeferredRemoval(btDispatcher* dispatcher)
@@ -564,22 +644,24 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 			current			=	next;
 		} while(current);
 		m_fixedleft=m_sets[1].m_leaves;
+		m_widefixeddirty=true;
 		m_needcleanup=true;
 	}
-	/* collide dynamics		*/ 
+	/* relayout				*/ 
+	for(int i=0;i<2;++i)
 	{
-		btDbvtTreeCollider	collider(this);
-		if(m_deferedcollide)
+		// every reinserted leaf counts as a change, so most frames of a moving scene
+		// would relayout, while the node order only degrades over several frames
+		if(m_sets[i].m_ichanges/m_lupdates>m_sets[i].m_leaves)
 		{
-			SPC(m_profiling.m_fdcollide);
-			m_sets[0].collideTTpersistentStack(m_sets[0].m_root,m_sets[1].m_root,collider);
-		}
-		if(m_deferedcollide)
-		{
-			SPC(m_profiling.m_ddcollide);
-			m_sets[0].collideTTpersistentStack(m_sets[0].m_root,m_sets[0].m_root,collider);
+			m_sets[i].optimizeLayout();
 		}
 	}
+	/* collide dynamics		*/ 
+	if(m_deferedcollide)
+	{
+		collideDeferred();
+	}
 	/* clean up				*/ 
 	if(m_needcleanup)
 	{
@@ -618,6 +700,38 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 	m_updates_call/=2;
 }
 
+//
+void							btDbvtBroadphase::collideDeferred()
+{
+	btDbvtTreeCollider	collider(this);
+	if(m_usewidetree)
+	{
+		m_widesets[0].build(m_sets[0]);
+		if(m_widefixeddirty)
+		{
+			m_widesets[1].build(m_sets[1]);
+			m_widefixeddirty=false;
+		}
+		{
+			SPC(m_profiling.m_fdcollide);
+			m_widesets[0].collideTT(m_widesets[1],collider);
+		}
+		{
+			SPC(m_profiling.m_ddcollide);
+			m_widesets[0].collideTT(m_widesets[0],collider);
+		}
+		return;
+	}
+	{
+		SPC(m_profiling.m_fdcollide);
+		m_sets[0].collideTTpersistentStack(m_sets[0].m_root,m_sets[1].m_root,collider);
+	}
+	{
+		SPC(m_profiling.m_ddcollide);
+		m_sets[0].collideTTpersistentStack(m_sets[0].m_root,m_sets[0].m_root,collider);
+	}
+}
+
 //
 void							btDbvtBroadphase::optimize()
 {
@@ -664,14 +778,18 @@ void btDbvtBroadphase::resetPool(btDispatcher* dispatcher)
 		//reset internal dynamic tree data structures
 		m_sets[0].clear();
 		m_sets[1].clear();
+		m_widesets[0].clear();
+		m_widesets[1].clear();
 		
 		m_deferedcollide	=	false;
 		m_needcleanup		=	true;
+		m_widefixeddirty	=	true;
 		m_stageCurrent		=	0;
 		m_fixedleft			=	0;
 		m_fupdates			=	1;
 		m_dupdates			=	0;
 		m_cupdates			=	10;
+		m_lupdates			=	4;
 		m_newpairs			=	1;
 		m_updates_call		=	0;
 		m_updates_done		=	0;
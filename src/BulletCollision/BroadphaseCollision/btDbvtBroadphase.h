@@ -76,6 +76,7 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	int						m_fupdates;					// % of fixed updates per frame
 	int						m_dupdates;					// % of dynamic updates per frame
 	int						m_cupdates;					// % of cleanup updates per frame
+	int						m_lupdates;					// Internal node changes per leaf before a set is relaid out
 	int						m_newpairs;					// Number of pairs created
 	int						m_fixedleft;				// Fixed optimization left
 	unsigned				m_updates_call;				// Number of updates call
@@ -87,7 +88,11 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	bool					m_releasepaircache;			// Release pair cache on delete
 	bool					m_deferedcollide;			// Defere dynamic/static collision to collide call
 	bool					m_needcleanup;				// Need to run cleanup?
+	bool					m_usewidetree;				// Collide deferred using 4-wide snapshots of the sets
+	bool					m_widefixeddirty;			// Leaves of the fixed set changed since its snapshot
+	btDbvtWide				m_widesets[2];				// Wide snapshots of m_sets, see m_usewidetree
     btAlignedObjectArray< btAlignedObjectArray<const btDbvtNode*> > m_rayTestStacks;
+    btAlignedObjectArray< btAlignedObjectArray<btDbvt::sStkNP> > m_rayPacketStacks;
 #if DBVT_BP_PROFILE
 	btClock					m_clock;
 	struct	{
@@ -103,12 +108,19 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	~btDbvtBroadphase();
 	void							collide(btDispatcher* dispatcher);
 	void							optimize();
+
+	///collideDeferred collides the dynamic set against the fixed set and against itself, it is called from collide when m_deferedcollide is set.
+	///If m_usewidetree is set, the sets are collided as btDbvtWide snapshots, the fixed snapshot is only rebuilt when its leaves changed.
+	virtual void					collideDeferred();
+	///updateMovingLeaf is called by setAabb when a leaf of the dynamic set moved but still overlaps its old volume, returns true if the leaf volume changed
+	virtual bool					updateMovingLeaf(btDbvtNode* leaf,btDbvtVolume& volume,const btVector3& velocity);
 	
 	/* btBroadphaseInterface Implementation	*/
 	btBroadphaseProxy*				createProxy(const btVector3& aabbMin,const btVector3& aabbMax,int shapeType,void* userPtr, int collisionFilterGroup, int collisionFilterMask,btDispatcher* dispatcher);
 	virtual void					destroyProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
 	virtual void					setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* dispatcher);
 	virtual void					rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
+	virtual void					rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 	virtual void					aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
 
 	virtual void					getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const;
@@ -0,0 +1,333 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btDbvtBroadphaseMt.h"
+#include "LinearMath/btQuickprof.h"
+
+
+static void refitSubtree( btDbvtNode* node )
+{
+    if ( node->isinternal() )
+    {
+        refitSubtree( node->childs[ 0 ] );
+        refitSubtree( node->childs[ 1 ] );
+        Merge( node->childs[ 0 ]->volume, node->childs[ 1 ]->volume, node->volume );
+    }
+}
+
+
+struct RefitSubtreesLoop : public btIParallelForBody
+{
+    btDbvtNode** m_subtrees;
+
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        for ( int i = iBegin; i < iEnd; ++i )
+        {
+            refitSubtree( m_subtrees[ i ] );
+        }
+    }
+};
+
+
+struct btDbvtPairCollector : btDbvt::ICollide
+{
+    btAlignedObjectArray<btDbvtProxy*>* m_pairs;
+
+    btDbvtPairCollector( btAlignedObjectArray<btDbvtProxy*>* pairs ) : m_pairs( pairs ) {}
+    void Process( const btDbvtNode* na, const btDbvtNode* nb )
+    {
+        if ( na != nb )
+        {
+            m_pairs->push_back( (btDbvtProxy*) na->data );
+            m_pairs->push_back( (btDbvtProxy*) nb->data );
+        }
+    }
+};
+
+
+struct CollideNodesLoop : public btIParallelForBody
+{
+    btDbvt* m_tree;
+    const btDbvt::sStkNN* m_nodes;
+    btAlignedObjectArray<btDbvtProxy*>* m_pairs;
+    btAlignedObjectArray< btAlignedObjectArray<btDbvt::sStkNN> >* m_stacks;
+
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        btAlignedObjectArray<btDbvt::sStkNN>* stack = &( *m_stacks )[ 0 ];
+#if BT_THREADSAFE
+        // each thread needs its own traversal stack
+        int threadIndex = btGetCurrentThreadIndex();
+        btAlignedObjectArray<btDbvt::sStkNN> localStack;
+        if ( threadIndex < m_stacks->size() )
+        {
+            stack = &( *m_stacks )[ threadIndex ];
+        }
+        else
+        {
+            stack = &localStack;
+        }
+#endif
+        for ( int i = iBegin; i < iEnd; ++i )
+        {
+            btAlignedObjectArray<btDbvtProxy*>& pairs = m_pairs[ i ];
+            pairs.resizeNoInitialize( 0 );
+            btDbvtPairCollector collector( &pairs );
+            m_tree->collideTTNoStackAlloc( m_nodes[ i ].a, m_nodes[ i ].b, *stack, collector );
+        }
+    }
+};
+
+
+btDbvtBroadphaseMt::btDbvtBroadphaseMt( btOverlappingPairCache* paircache )
+    : btDbvtBroadphase( paircache )
+{
+    m_deferedcollide = true;
+    m_dupdates = 1;
+    m_needrefit = false;
+    m_numTasks = 256;
+#if BT_THREADSAFE
+    m_collideStacks.resize( BT_MAX_THREAD_COUNT );
+#else
+    m_collideStacks.resize( 1 );
+#endif
+}
+
+
+btDbvtBroadphaseMt::~btDbvtBroadphaseMt()
+{
+}
+
+
+void btDbvtBroadphaseMt::resetPool( btDispatcher* dispatcher )
+{
+    btDbvtBroadphase::resetPool( dispatcher );
+    if ( m_sets[ 0 ].m_leaves + m_sets[ 1 ].m_leaves == 0 )
+    {
+        // base class resets to immediate collision
+        m_deferedcollide = true;
+        m_dupdates = 1;
+        m_needrefit = false;
+    }
+}
+
+
+bool btDbvtBroadphaseMt::updateMovingLeaf( btDbvtNode* leaf, btDbvtVolume& volume, const btVector3& velocity )
+{
+    if ( leaf->volume.Contain( volume ) )
+    {
+        return false;
+    }
+#ifdef DBVT_BP_MARGIN
+    volume.Expand( btVector3( DBVT_BP_MARGIN, DBVT_BP_MARGIN, DBVT_BP_MARGIN ) );
+#endif
+    volume.SignedExpand( velocity );
+    // enlarge the leaf in place, the ancestors are refit before the trees are collided
+    leaf->volume = volume;
+    m_needrefit = true;
+    return true;
+}
+
+
+void btDbvtBroadphaseMt::refitDynamicSet()
+{
+    BT_PROFILE( "refitDynamicSet" );
+    btDbvtNode* root = m_sets[ 0 ].m_root;
+    if ( root == NULL )
+    {
+        return;
+    }
+    // split the top of the tree breadth first into subtrees
+    m_refitNodes.resizeNoInitialize( 0 );
+    m_refitSubtrees.resizeNoInitialize( 0 );
+    m_refitSubtrees.push_back( root );
+    int head = 0;
+    while ( head < m_refitSubtrees.size() && m_refitSubtrees.size() - head < m_numTasks )
+    {
+        btDbvtNode* node = m_refitSubtrees[ head++ ];
+        if ( node->isinternal() )
+        {
+            m_refitNodes.push_back( node );
+            m_refitSubtrees.push_back( node->childs[ 0 ] );
+            m_refitSubtrees.push_back( node->childs[ 1 ] );
+        }
+    }
+    int numSubtrees = m_refitSubtrees.size() - head;
+    if ( numSubtrees > 0 )
+    {
+        RefitSubtreesLoop loop;
+        loop.m_subtrees = &m_refitSubtrees[ head ];
+        if ( btThreadsAreRunning() )
+        {
+            // called from a query inside a parallel loop, e.g. btCollisionWorld::rayTestBatch
+            loop.forLoop( 0, numSubtrees );
+        }
+        else
+        {
+            btParallelFor( 0, numSubtrees, 1, loop );
+        }
+    }
+    // children of the top nodes come after their parents, so walk backwards
+    for ( int i = m_refitNodes.size() - 1; i >= 0; --i )
+    {
+        btDbvtNode* node = m_refitNodes[ i ];
+        Merge( node->childs[ 0 ]->volume, node->childs[ 1 ]->volume, node->volume );
+    }
+}
+
+
+void btDbvtBroadphaseMt::refitIfNeeded()
+{
+    if ( m_needrefit )
+    {
+        btMutexLock( &m_refitMutex );
+        if ( m_needrefit )
+        {
+            refitDynamicSet();
+            m_needrefit = false;
+        }
+        btMutexUnlock( &m_refitMutex );
+    }
+}
+
+
+void btDbvtBroadphaseMt::rayTest( const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin, const btVector3& aabbMax )
+{
+    refitIfNeeded();
+    btDbvtBroadphase::rayTest( rayFrom, rayTo, rayCallback, aabbMin, aabbMax );
+}
+
+
+void btDbvtBroadphaseMt::rayTestPacket( const btVector3* rayFrom, const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin, const btVector3& aabbMax )
+{
+    refitIfNeeded();
+    btDbvtBroadphase::rayTestPacket( rayFrom, rayTo, rayCallbacks, numRays, aabbMin, aabbMax );
+}
+
+
+void btDbvtBroadphaseMt::aabbTest( const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback )
+{
+    refitIfNeeded();
+    btDbvtBroadphase::aabbTest( aabbMin, aabbMax, callback );
+}
+
+
+///
+/// splitCollision -- expands the node pairs in m_collideNodes breadth first (same rules as btDbvt::collideTT)
+///                   until there are enough independent pairs left, returns the index of the first unexpanded pair.
+///                   The split only depends on the trees, not on the number of threads.
+///
+int btDbvtBroadphaseMt::splitCollision( btAlignedObjectArray<btDbvtProxy*>& pairs )
+{
+    int head = 0;
+    while ( head < m_collideNodes.size() && m_collideNodes.size() - head < m_numTasks )
+    {
+        const btDbvt::sStkNN p = m_collideNodes[ head++ ];
+        if ( p.a == p.b )
+        {
+            if ( p.a->isinternal() )
+            {
+                m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 0 ], p.a->childs[ 0 ] ) );
+                m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 1 ], p.a->childs[ 1 ] ) );
+                m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 0 ], p.a->childs[ 1 ] ) );
+            }
+        }
+        else if ( Intersect( p.a->volume, p.b->volume ) )
+        {
+            if ( p.a->isinternal() )
+            {
+                if ( p.b->isinternal() )
+                {
+                    m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 0 ], p.b->childs[ 0 ] ) );
+                    m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 1 ], p.b->childs[ 0 ] ) );
+                    m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 0 ], p.b->childs[ 1 ] ) );
+                    m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 1 ], p.b->childs[ 1 ] ) );
+                }
+                else
+                {
+                    m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 0 ], p.b ) );
+                    m_collideNodes.push_back( btDbvt::sStkNN( p.a->childs[ 1 ], p.b ) );
+                }
+            }
+            else if ( p.b->isinternal() )
+            {
+                m_collideNodes.push_back( btDbvt::sStkNN( p.a, p.b->childs[ 0 ] ) );
+                m_collideNodes.push_back( btDbvt::sStkNN( p.a, p.b->childs[ 1 ] ) );
+            }
+            else
+            {
+                pairs.push_back( (btDbvtProxy*) p.a->data );
+                pairs.push_back( (btDbvtProxy*) p.b->data );
+            }
+        }
+    }
+    return head;
+}
+
+
+void btDbvtBroadphaseMt::collideDeferred()
+{
+    BT_PROFILE( "btDbvtBroadphaseMt::collideDeferred" );
+    refitIfNeeded();
+    btDbvtNode* dynamicRoot = m_sets[ 0 ].m_root;
+    btDbvtNode* fixedRoot = m_sets[ 1 ].m_root;
+    if ( dynamicRoot == NULL )
+    {
+        return;
+    }
+    m_collideNodes.resizeNoInitialize( 0 );
+    if ( fixedRoot )
+    {
+        m_collideNodes.push_back( btDbvt::sStkNN( dynamicRoot, fixedRoot ) );
+    }
+    m_collideNodes.push_back( btDbvt::sStkNN( dynamicRoot, dynamicRoot ) );
+
+    // overlaps found while splitting go first, followed by the overlaps of each node pair
+    if ( m_collidePairs.size() == 0 )
+    {
+        m_collidePairs.resize( 1 );
+    }
+    m_collidePairs[ 0 ].resizeNoInitialize( 0 );
+    int head = splitCollision( m_collidePairs[ 0 ] );
+    int numTasks = m_collideNodes.size() - head;
+    if ( m_collidePairs.size() < numTasks + 1 )
+    {
+        // only grow, so the pair arrays keep their capacity from frame to frame
+        m_collidePairs.resize( numTasks + 1 );
+    }
+    if ( numTasks > 0 )
+    {
+        CollideNodesLoop loop;
+        loop.m_tree = &m_sets[ 0 ];
+        loop.m_nodes = &m_collideNodes[ head ];
+        loop.m_pairs = &m_collidePairs[ 1 ];
+        loop.m_stacks = &m_collideStacks;
+        btParallelFor( 0, numTasks, 1, loop );
+    }
+
+    // the pair cache is not threadsafe, add the overlaps serially in a fixed order
+    for ( int i = 0; i <= numTasks; ++i )
+    {
+        const btAlignedObjectArray<btDbvtProxy*>& pairs = m_collidePairs[ i ];
+        for ( int j = 0; j < pairs.size(); j += 2 )
+        {
+            m_paircache->addOverlappingPair( pairs[ j ], pairs[ j + 1 ] );
+        }
+        m_newpairs += pairs.size() / 2;
+    }
+}
+
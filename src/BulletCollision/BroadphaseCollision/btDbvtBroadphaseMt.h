@@ -0,0 +1,70 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_DBVT_BROADPHASE_MT_H
+#define BT_DBVT_BROADPHASE_MT_H
+
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "LinearMath/btThreads.h"
+
+
+///
+/// btDbvtBroadphaseMt -- a version of btDbvtBroadphase that does the per-frame work on the dynamic tree
+///                       with btParallelFor.
+///
+///  Collision is always deferred to calculateOverlappingPairs (m_deferedcollide is forced on).
+///  setAabb enlarges the leaf of a moving proxy in place instead of removing and re-inserting it,
+///  and the dynamic tree (m_sets[0]) is refit in parallel before the trees are collided.
+///  Tree-vs-tree collision is split into independent node pairs which are collided in parallel,
+///  and the overlaps are then added to the pair cache in a fixed order, so the pair cache receives
+///  the same overlaps as btDbvtBroadphase and the result does not depend on the number of threads.
+///
+///  Since moving leaves are refit rather than re-inserted, tree quality is maintained by the
+///  incremental optimization only, so m_dupdates defaults to 1% of the dynamic leaves per frame.
+///  rayTest, rayTestPacket and aabbTest refit the dynamic tree first if a leaf was enlarged since the last
+///  refit, so queries between setAabb and calculateOverlappingPairs see the moved proxies.
+///
+struct btDbvtBroadphaseMt : public btDbvtBroadphase
+{
+    int m_numTasks;  // number of subtrees/node pairs the refit and the tree collision are split into
+
+    btDbvtBroadphaseMt( btOverlappingPairCache* paircache = 0 );
+    virtual ~btDbvtBroadphaseMt();
+
+    virtual void resetPool( btDispatcher* dispatcher ) BT_OVERRIDE;
+    virtual void collideDeferred() BT_OVERRIDE;
+    virtual bool updateMovingLeaf( btDbvtNode* leaf, btDbvtVolume& volume, const btVector3& velocity ) BT_OVERRIDE;
+    virtual void rayTest( const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3( 0, 0, 0 ), const btVector3& aabbMax = btVector3( 0, 0, 0 ) ) BT_OVERRIDE;
+    virtual void rayTestPacket( const btVector3* rayFrom, const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin = btVector3( 0, 0, 0 ), const btVector3& aabbMax = btVector3( 0, 0, 0 ) ) BT_OVERRIDE;
+    virtual void aabbTest( const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback ) BT_OVERRIDE;
+
+    ///recompute the volumes of all internal nodes of the dynamic tree, in parallel
+    void refitDynamicSet();
+
+protected:
+    bool m_needrefit;
+    btSpinMutex m_refitMutex;  // queries may run on several threads, only one of them refits
+    btAlignedObjectArray<btDbvtNode*> m_refitNodes;     // top of the tree, refit after the subtrees
+    btAlignedObjectArray<btDbvtNode*> m_refitSubtrees;
+    btAlignedObjectArray<btDbvt::sStkNN> m_collideNodes;  // node pairs to collide in parallel
+    btAlignedObjectArray< btAlignedObjectArray<btDbvtProxy*> > m_collidePairs;  // overlaps found per node pair
+    btAlignedObjectArray< btAlignedObjectArray<btDbvt::sStkNN> > m_collideStacks;  // per thread
+
+    int splitCollision( btAlignedObjectArray<btDbvtProxy*>& pairs );
+    void refitIfNeeded();
+};
+
+#endif //BT_DBVT_BROADPHASE_MT_H
+
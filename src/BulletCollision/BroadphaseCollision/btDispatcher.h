@@ -47,7 +47,9 @@ struct btDispatcherInfo
 		m_allowedCcdPenetration(btScalar(0.04)),
 		m_useConvexConservativeDistanceUtil(false),
 		m_convexConservativeDistanceThreshold(0.0f),
-		m_deterministicOverlappingPairs(false)
+		m_deterministicOverlappingPairs(false),
+		m_reduceCompoundCompoundContacts(false),
+		m_satFeatureCacheTolerance(btScalar(0.))
 	{
 
 	}
@@ -64,6 +66,12 @@ struct btDispatcherInfo
 	bool		m_useConvexConservativeDistanceUtil;
 	btScalar	m_convexConservativeDistanceThreshold;
 	bool		m_deterministicOverlappingPairs;
+	///merge the contacts of all child pairs of a compound-compound pair into a single manifold, see btCompoundCompoundCollisionAlgorithm
+	bool		m_reduceCompoundCompoundContacts;
+	///with m_enableSatConvex, overlapping hulls reuse the separating feature of the last full test while their relative
+	///motion stays below this fraction of the smaller hull's inner radius (and this angle in radians), see btSeparatingFeatureCache.
+	///Zero always runs the full test.
+	btScalar	m_satFeatureCacheTolerance;
 };
 
 enum ebtDispatcherQueryType
@@ -0,0 +1,694 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btHashedGridBroadphase.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btQuickprof.h"
+
+
+// cell coordinates are clamped, far away proxies share the outermost cells
+static const int BT_HASHED_GRID_MAX_COORD = 1<<20;
+
+static SIMD_FORCE_INLINE int hashedGridCoord(btScalar x)
+{
+	btScalar c = btScalar(floor(x));
+	c = btMax(btScalar(-BT_HASHED_GRID_MAX_COORD),btMin(c,btScalar(BT_HASHED_GRID_MAX_COORD)));
+	return int(c);
+}
+
+///
+/// visitHashedGridRow -- calls visitor(entry) for the entries of the cells (xBegin..xEnd,y,z) of a level.
+///                       Cells that are neighbours along x hash to consecutive buckets, so a row of cells
+///                       is a contiguous range of the sorted entries (split in two where the table wraps).
+///
+template <typename Visitor>
+static SIMD_FORCE_INLINE void visitHashedGridRow(const btHashedGridEntry* entries,const int* bucketStart,int numBuckets,int bucket,int xBegin,int xEnd,int y,int z,int level,Visitor& visitor)
+{
+	int endBucket = bucket+btMin(xEnd-xBegin+1,numBuckets);
+	int ranges[2][2] = {{bucketStart[bucket],bucketStart[btMin(endBucket,numBuckets)]},{0,0}};
+	if (endBucket>numBuckets)
+	{
+		ranges[1][1] = bucketStart[endBucket-numBuckets];
+	}
+	for (int r=0;r<2;r++)
+	{
+		for (int j=ranges[r][0];j<ranges[r][1];j++)
+		{
+			const btHashedGridEntry& entry = entries[j];
+			if (entry.m_cell[1]==y && entry.m_cell[2]==z && entry.m_level==level && entry.m_cell[0]>=xBegin && entry.m_cell[0]<=xEnd)
+			{
+				visitor(entry);
+			}
+		}
+	}
+}
+
+
+btHashedGridBroadphase::btHashedGridBroadphase(btScalar cellSize, int numLevels, btOverlappingPairCache* paircache)
+{
+	btAssert(cellSize>btScalar(0.));
+	btAssert(numLevels>=1 && numLevels<=16);
+	m_grainSize			=	256;
+	m_cellSize			=	cellSize;
+	m_numLevels			=	numLevels;
+	m_releasepaircache	=	(paircache!=0)?false:true;
+	m_paircache			=	paircache? paircache	: new(btAlignedAlloc(sizeof(btHashedOverlappingPairCache),16)) btHashedOverlappingPairCache();
+	m_gid				=	0;
+	m_gridValid			=	false;
+	btAssert(!m_paircache->hasDeferredRemoval());
+}
+
+
+btHashedGridBroadphase::~btHashedGridBroadphase()
+{
+	for (int i=0;i<m_proxies.size();i++)
+	{
+		btAlignedFree(m_proxies[i]);
+	}
+	if (m_releasepaircache)
+	{
+		m_paircache->~btOverlappingPairCache();
+		btAlignedFree(m_paircache);
+	}
+}
+
+
+int btHashedGridBroadphase::calculateLevel(const btVector3& aabbMin,const btVector3& aabbMax) const
+{
+	btVector3 extents = aabbMax-aabbMin;
+	btScalar size = btMax(extents[0],btMax(extents[1],extents[2]));
+	btScalar cellSize = m_cellSize;
+	for (int level=0;level<m_numLevels;level++)
+	{
+		if (size<=cellSize)
+		{
+			return level;
+		}
+		cellSize *= btScalar(2.);
+	}
+	return BT_HASHED_GRID_HUGE_LEVEL;
+}
+
+
+void btHashedGridBroadphase::calculateCell(const btVector3& aabbMin,const btVector3& aabbMax,int level,int cell[3]) const
+{
+	btVector3 center = (aabbMin+aabbMax)*(btScalar(0.5)/getCellSize(level));
+	cell[0] = hashedGridCoord(center[0]);
+	cell[1] = hashedGridCoord(center[1]);
+	cell[2] = hashedGridCoord(center[2]);
+}
+
+
+int btHashedGridBroadphase::getBucket(const int cell[3],int level) const
+{
+	// x is not scrambled, so that a row of cells along x maps to consecutive buckets
+	unsigned int hash = (unsigned int)(cell[0]) + (unsigned int)(cell[1])*73856093u + (unsigned int)(cell[2])*19349663u + (unsigned int)(level)*83492791u;
+	return int(hash & (unsigned int)(m_bucketStart.size()-2));
+}
+
+
+btBroadphaseProxy* btHashedGridBroadphase::createProxy(const btVector3& aabbMin,const btVector3& aabbMax,int /*shapeType*/,void* userPtr,int collisionFilterGroup,int collisionFilterMask,btDispatcher* /*dispatcher*/)
+{
+	btHashedGridProxy* proxy = new(btAlignedAlloc(sizeof(btHashedGridProxy),16)) btHashedGridProxy(aabbMin,aabbMax,userPtr,collisionFilterGroup,collisionFilterMask);
+	proxy->m_uniqueId = ++m_gid;
+	proxy->m_level = calculateLevel(aabbMin,aabbMax);
+	proxy->m_index = m_proxies.size();
+	m_proxies.push_back(proxy);
+	m_gridValid = false;
+	return proxy;
+}
+
+
+void btHashedGridBroadphase::destroyProxy(btBroadphaseProxy* absproxy,btDispatcher* dispatcher)
+{
+	btHashedGridProxy* proxy = static_cast<btHashedGridProxy*>(absproxy);
+	m_paircache->removeOverlappingPairsContainingProxy(proxy,dispatcher);
+	int index = proxy->m_index;
+	m_proxies[index] = m_proxies[m_proxies.size()-1];
+	m_proxies[index]->m_index = index;
+	m_proxies.pop_back();
+	proxy->~btHashedGridProxy();
+	btAlignedFree(proxy);
+	m_gridValid = false;
+}
+
+
+void btHashedGridBroadphase::setAabb(btBroadphaseProxy* absproxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* /*dispatcher*/)
+{
+	btHashedGridProxy* proxy = static_cast<btHashedGridProxy*>(absproxy);
+	proxy->m_aabbMin = aabbMin;
+	proxy->m_aabbMax = aabbMax;
+	proxy->m_level = calculateLevel(aabbMin,aabbMax);
+	m_gridValid = false;
+}
+
+
+void btHashedGridBroadphase::getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin,btVector3& aabbMax) const
+{
+	aabbMin = proxy->m_aabbMin;
+	aabbMax = proxy->m_aabbMax;
+}
+
+
+void btHashedGridBroadphase::resetPool(btDispatcher* /*dispatcher*/)
+{
+	if (m_proxies.size()==0)
+	{
+		m_gid = 0;
+		m_entries.clear();
+		m_bucketStart.clear();
+		m_hugeProxies.clear();
+		m_taskPairs.clear();
+		m_gridValid = false;
+	}
+}
+
+
+struct btHashedGridEntryLoop : public btIParallelForBody
+{
+	const btHashedGridBroadphase* m_broadphase;
+	btHashedGridProxy* const* m_proxies;
+	btHashedGridEntry* m_entries;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i=iBegin;i<iEnd;++i)
+		{
+			btHashedGridProxy* proxy = m_proxies[i];
+			btHashedGridEntry& entry = m_entries[i];
+			entry.m_aabbMin = proxy->m_aabbMin;
+			entry.m_aabbMax = proxy->m_aabbMax;
+			entry.m_proxy = proxy;
+			entry.m_level = proxy->m_level;
+			if (entry.m_level!=BT_HASHED_GRID_HUGE_LEVEL)
+			{
+				m_broadphase->calculateCell(entry.m_aabbMin,entry.m_aabbMax,entry.m_level,entry.m_cell);
+			}
+		}
+	}
+};
+
+
+///
+/// buildGrid -- bins the proxies into the hash table with a counting sort, the entries of each bucket
+///              stay in proxy order so the grid only depends on the proxies
+///
+void btHashedGridBroadphase::buildGrid()
+{
+	BT_PROFILE("btHashedGridBroadphase::buildGrid");
+	int numProxies = m_proxies.size();
+	int numBuckets = 64;
+	while (numBuckets<4*numProxies)
+	{
+		numBuckets *= 2;
+	}
+	m_bucketStart.resize(numBuckets+1);
+	for (int i=0;i<=numBuckets;i++)
+	{
+		m_bucketStart[i] = 0;
+	}
+	m_levelCounts.resize(m_numLevels);
+	for (int i=0;i<m_numLevels;i++)
+	{
+		m_levelCounts[i] = 0;
+	}
+	m_hugeProxies.resizeNoInitialize(0);
+
+	// the unsorted entries are written to the second half of the array
+	m_entries.resizeNoInitialize(2*numProxies);
+	if (numProxies>0)
+	{
+		btHashedGridEntryLoop loop;
+		loop.m_broadphase = this;
+		loop.m_proxies = &m_proxies[0];
+		loop.m_entries = &m_entries[numProxies];
+		btParallelFor(0,numProxies,m_grainSize,loop);
+	}
+
+	int numEntries = 0;
+	for (int i=0;i<numProxies;i++)
+	{
+		const btHashedGridEntry& entry = m_entries[numProxies+i];
+		if (entry.m_level==BT_HASHED_GRID_HUGE_LEVEL)
+		{
+			m_hugeProxies.push_back(entry.m_proxy);
+			continue;
+		}
+		m_bucketStart[getBucket(entry.m_cell,entry.m_level)+1]++;
+		m_levelCounts[entry.m_level]++;
+		numEntries++;
+	}
+	for (int i=0;i<numBuckets;i++)
+	{
+		m_bucketStart[i+1] += m_bucketStart[i];
+	}
+	for (int i=0;i<numProxies;i++)
+	{
+		const btHashedGridEntry& entry = m_entries[numProxies+i];
+		if (entry.m_level!=BT_HASHED_GRID_HUGE_LEVEL)
+		{
+			// m_bucketStart[bucket] is used as the insert position and ends up at the start of the next bucket
+			m_entries[m_bucketStart[getBucket(entry.m_cell,entry.m_level)]++] = entry;
+		}
+	}
+	for (int i=numBuckets;i>0;i--)
+	{
+		m_bucketStart[i] = m_bucketStart[i-1];
+	}
+	m_bucketStart[0] = 0;
+	m_entries.resizeNoInitialize(numEntries);
+	m_gridValid = true;
+}
+
+
+///collects the overlaps of one entry with the entries of a row of cells
+struct btHashedGridPairVisitor
+{
+	const btHashedGridEntry* m_a;
+	btAlignedObjectArray<btBroadphaseProxy*>* m_pairs;
+	bool m_sameLevel;
+
+	SIMD_FORCE_INLINE void operator()(const btHashedGridEntry& b)
+	{
+		// pairs of the same level are found from both sides, keep one
+		if (m_sameLevel && b.m_proxy->m_uniqueId<=m_a->m_proxy->m_uniqueId)
+		{
+			return;
+		}
+		if (TestAabbAgainstAabb2(m_a->m_aabbMin,m_a->m_aabbMax,b.m_aabbMin,b.m_aabbMax))
+		{
+			m_pairs->push_back(m_a->m_proxy);
+			m_pairs->push_back(b.m_proxy);
+		}
+	}
+};
+
+
+///tests one entry or huge proxy against the grid and collects the overlaps of a task
+struct btHashedGridPairLoop : public btIParallelForBody
+{
+	const btHashedGridBroadphase* m_broadphase;
+	btAlignedObjectArray<btBroadphaseProxy*>* m_taskPairs;
+	int m_grainSize;
+	int m_numItems;
+
+	void queryEntry(const btHashedGridEntry& a, btAlignedObjectArray<btBroadphaseProxy*>& pairs) const
+	{
+		const btHashedGridBroadphase* bp = m_broadphase;
+		int numBuckets = bp->m_bucketStart.size()-1;
+		btHashedGridPairVisitor visitor;
+		visitor.m_a = &a;
+		visitor.m_pairs = &pairs;
+		for (int level=a.m_level;level<bp->m_numLevels;level++)
+		{
+			if (bp->m_levelCounts[level]==0)
+			{
+				continue;
+			}
+			// proxies of this level are at most one cell large, so their centers are within half a cell of their aabb
+			btScalar cellSize = bp->getCellSize(level);
+			btScalar invCellSize = btScalar(1.)/cellSize;
+			btVector3 halfCell(cellSize*btScalar(0.5),cellSize*btScalar(0.5),cellSize*btScalar(0.5));
+			btVector3 lo = (a.m_aabbMin-halfCell)*invCellSize;
+			btVector3 hi = (a.m_aabbMax+halfCell)*invCellSize;
+			int cellLo[3] = {hashedGridCoord(lo[0]),hashedGridCoord(lo[1]),hashedGridCoord(lo[2])};
+			int cellHi[3] = {hashedGridCoord(hi[0]),hashedGridCoord(hi[1]),hashedGridCoord(hi[2])};
+			visitor.m_sameLevel = (level==a.m_level);
+			int cell[3];
+			cell[0] = cellLo[0];
+			for (cell[1]=cellLo[1];cell[1]<=cellHi[1];cell[1]++)
+			for (cell[2]=cellLo[2];cell[2]<=cellHi[2];cell[2]++)
+			{
+				visitHashedGridRow(&bp->m_entries[0],&bp->m_bucketStart[0],numBuckets,bp->getBucket(cell,level),cellLo[0],cellHi[0],cell[1],cell[2],level,visitor);
+			}
+		}
+	}
+
+	void queryHugeProxy(const btHashedGridProxy* a, btAlignedObjectArray<btBroadphaseProxy*>& pairs) const
+	{
+		const btHashedGridBroadphase* bp = m_broadphase;
+		for (int j=0;j<bp->m_entries.size();j++)
+		{
+			const btHashedGridEntry& b = bp->m_entries[j];
+			if (TestAabbAgainstAabb2(a->m_aabbMin,a->m_aabbMax,b.m_aabbMin,b.m_aabbMax))
+			{
+				pairs.push_back((btBroadphaseProxy*)a);
+				pairs.push_back(b.m_proxy);
+			}
+		}
+		for (int j=0;j<bp->m_hugeProxies.size();j++)
+		{
+			btHashedGridProxy* b = bp->m_hugeProxies[j];
+			if (b->m_uniqueId>a->m_uniqueId && TestAabbAgainstAabb2(a->m_aabbMin,a->m_aabbMax,b->m_aabbMin,b->m_aabbMax))
+			{
+				pairs.push_back((btBroadphaseProxy*)a);
+				pairs.push_back(b);
+			}
+		}
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		const btHashedGridBroadphase* bp = m_broadphase;
+		int numEntries = bp->m_entries.size();
+		for (int task=iBegin;task<iEnd;++task)
+		{
+			btAlignedObjectArray<btBroadphaseProxy*>& pairs = m_taskPairs[task];
+			pairs.resizeNoInitialize(0);
+			int end = btMin(m_numItems,(task+1)*m_grainSize);
+			for (int i=task*m_grainSize;i<end;++i)
+			{
+				if (i<numEntries)
+				{
+					queryEntry(bp->m_entries[i],pairs);
+				}
+				else
+				{
+					queryHugeProxy(bp->m_hugeProxies[i-numEntries],pairs);
+				}
+			}
+		}
+	}
+};
+
+
+struct btHashedGridRemovePairCallback : public btOverlapCallback
+{
+	virtual bool processOverlap(btBroadphasePair& pair)
+	{
+		return !TestAabbAgainstAabb2(pair.m_pProxy0->m_aabbMin,pair.m_pProxy0->m_aabbMax,pair.m_pProxy1->m_aabbMin,pair.m_pProxy1->m_aabbMax);
+	}
+};
+
+
+void btHashedGridBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
+{
+	BT_PROFILE("btHashedGridBroadphase::calculateOverlappingPairs");
+	{
+		BT_PROFILE("removeSeparatedPairs");
+		btHashedGridRemovePairCallback removeCallback;
+		m_paircache->processAllOverlappingPairs(&removeCallback,dispatcher);
+	}
+
+	buildGrid();
+
+	// the split into tasks only depends on the number of proxies, not on the number of threads
+	int numItems = m_entries.size()+m_hugeProxies.size();
+	int numTasks = (numItems+m_grainSize-1)/m_grainSize;
+	if (m_taskPairs.size()<numTasks)
+	{
+		// only grow, so the pair arrays keep their capacity from frame to frame
+		m_taskPairs.resize(numTasks);
+	}
+	if (numTasks>0)
+	{
+		BT_PROFILE("findOverlaps");
+		btHashedGridPairLoop loop;
+		loop.m_broadphase = this;
+		loop.m_taskPairs = &m_taskPairs[0];
+		loop.m_grainSize = m_grainSize;
+		loop.m_numItems = numItems;
+		btParallelFor(0,numTasks,1,loop);
+	}
+
+	{
+		BT_PROFILE("addPairs");
+		// the pair cache is not threadsafe, add the overlaps serially in task order
+		for (int i=0;i<numTasks;i++)
+		{
+			const btAlignedObjectArray<btBroadphaseProxy*>& pairs = m_taskPairs[i];
+			for (int j=0;j<pairs.size();j+=2)
+			{
+				m_paircache->addOverlappingPair(pairs[j],pairs[j+1]);
+			}
+		}
+	}
+
+	if (m_paircache->hasSortedPairs())
+	{
+		m_paircache->sortOverlappingPairs(dispatcher);
+	}
+}
+
+
+static SIMD_FORCE_INLINE void hashedGridRayTestProxy(btBroadphaseProxy* proxy,const btVector3& rayFrom,btBroadphaseRayCallback& rayCallback,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	btVector3 bounds[2];
+	bounds[0] = proxy->m_aabbMin-aabbMax;
+	bounds[1] = proxy->m_aabbMax-aabbMin;
+	btScalar tmin;
+	if (btRayAabb2(rayFrom,rayCallback.m_rayDirectionInverse,rayCallback.m_signs,bounds,tmin,btScalar(0.),rayCallback.m_lambda_max))
+	{
+		rayCallback.process(proxy);
+	}
+}
+
+
+struct btHashedGridRayVisitor
+{
+	const btVector3& m_rayFrom;
+	btBroadphaseRayCallback& m_rayCallback;
+	const btVector3& m_aabbMin;
+	const btVector3& m_aabbMax;
+
+	btHashedGridRayVisitor(const btVector3& rayFrom,btBroadphaseRayCallback& rayCallback,const btVector3& aabbMin,const btVector3& aabbMax)
+	:m_rayFrom(rayFrom),m_rayCallback(rayCallback),m_aabbMin(aabbMin),m_aabbMax(aabbMax)
+	{
+	}
+
+	SIMD_FORCE_INLINE void operator()(const btHashedGridEntry& entry)
+	{
+		hashedGridRayTestProxy(entry.m_proxy,m_rayFrom,m_rayCallback,m_aabbMin,m_aabbMax);
+	}
+};
+
+
+struct btHashedGridAabbVisitor
+{
+	const btVector3& m_aabbMin;
+	const btVector3& m_aabbMax;
+	btBroadphaseAabbCallback& m_callback;
+
+	btHashedGridAabbVisitor(const btVector3& aabbMin,const btVector3& aabbMax,btBroadphaseAabbCallback& callback)
+	:m_aabbMin(aabbMin),m_aabbMax(aabbMax),m_callback(callback)
+	{
+	}
+
+	SIMD_FORCE_INLINE void operator()(const btHashedGridEntry& entry)
+	{
+		if (TestAabbAgainstAabb2(m_aabbMin,m_aabbMax,entry.m_aabbMin,entry.m_aabbMax))
+		{
+			m_callback.process(entry.m_proxy);
+		}
+	}
+};
+
+
+void btHashedGridBroadphase::rayTest(const btVector3& rayFrom,const btVector3& rayTo,btBroadphaseRayCallback& rayCallback,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	if (!m_gridValid)
+	{
+		for (int i=0;i<m_proxies.size();i++)
+		{
+			hashedGridRayTestProxy(m_proxies[i],rayFrom,rayCallback,aabbMin,aabbMax);
+		}
+		return;
+	}
+	for (int i=0;i<m_hugeProxies.size();i++)
+	{
+		hashedGridRayTestProxy(m_hugeProxies[i],rayFrom,rayCallback,aabbMin,aabbMax);
+	}
+	int numBuckets = m_bucketStart.size()-1;
+	btHashedGridRayVisitor visitor(rayFrom,rayCallback,aabbMin,aabbMax);
+	btVector3 queryExtents = (-aabbMin).absolute();
+	queryExtents.setMax(aabbMax.absolute());
+	for (int level=0;level<m_numLevels;level++)
+	{
+		if (m_levelCounts[level]==0)
+		{
+			continue;
+		}
+		btScalar invCellSize = btScalar(1.)/getCellSize(level);
+		btVector3 from = rayFrom*invCellSize;
+		btVector3 to = rayTo*invCellSize;
+		btVector3 dir = to-from;
+
+		// proxy centers are within half a cell plus the query extents of the ray, so the cells
+		// within 'radius' of the cells along the ray are visited
+		int radius[3];
+		int cell[3],endCell[3],step[3];
+		btScalar tMax[3],tDelta[3];
+		int numSteps = 0;
+		bool walk = true;
+		for (int axis=0;axis<3;axis++)
+		{
+			radius[axis] = 1+int(btScalar(ceil(queryExtents[axis]*invCellSize)));
+			if (btFabs(from[axis])>=btScalar(BT_HASHED_GRID_MAX_COORD) || btFabs(to[axis])>=btScalar(BT_HASHED_GRID_MAX_COORD))
+			{
+				walk = false;
+				break;
+			}
+			cell[axis] = hashedGridCoord(from[axis]);
+			endCell[axis] = hashedGridCoord(to[axis]);
+			numSteps += endCell[axis]>cell[axis]? endCell[axis]-cell[axis] : cell[axis]-endCell[axis];
+			if (dir[axis]>btScalar(0.))
+			{
+				step[axis] = 1;
+				tMax[axis] = (btScalar(cell[axis]+1)-from[axis])/dir[axis];
+				tDelta[axis] = btScalar(1.)/dir[axis];
+			}
+			else if (dir[axis]<btScalar(0.))
+			{
+				step[axis] = -1;
+				tMax[axis] = (btScalar(cell[axis])-from[axis])/dir[axis];
+				tDelta[axis] = btScalar(-1.)/dir[axis];
+			}
+			else
+			{
+				step[axis] = 0;
+				tMax[axis] = BT_LARGE_FLOAT;
+				tDelta[axis] = BT_LARGE_FLOAT;
+			}
+		}
+		int neighbourhood = (2*radius[0]+1)*(2*radius[1]+1)*(2*radius[2]+1);
+		if (!walk || btScalar(numSteps+1)*btScalar(neighbourhood)>btScalar(4*m_levelCounts[level]))
+		{
+			// the ray is too long compared to the number of proxies in this level, test them all
+			for (int i=0;i<m_entries.size();i++)
+			{
+				if (m_entries[i].m_level==level)
+				{
+					hashedGridRayTestProxy(m_entries[i].m_proxy,rayFrom,rayCallback,aabbMin,aabbMax);
+				}
+			}
+			continue;
+		}
+
+		// start with a cell whose neighbourhood does not overlap the first one
+		int prevCell[3] = { cell[0], cell[1]-2*radius[1]-1, cell[2] };
+		int row[3];
+		for (int s=0;s<=numSteps;s++)
+		{
+			for (row[1]=cell[1]-radius[1];row[1]<=cell[1]+radius[1];row[1]++)
+			for (row[2]=cell[2]-radius[2];row[2]<=cell[2]+radius[2];row[2]++)
+			{
+				int xBegin = cell[0]-radius[0];
+				int xEnd = cell[0]+radius[0];
+				// the walk is monotone along each axis, so the cells that were in the neighbourhood of the
+				// previous cell have already been visited
+				if (s>0 &&
+					row[1]>=prevCell[1]-radius[1] && row[1]<=prevCell[1]+radius[1] &&
+					row[2]>=prevCell[2]-radius[2] && row[2]<=prevCell[2]+radius[2])
+				{
+					if (prevCell[0]<cell[0])
+					{
+						xBegin = prevCell[0]+radius[0]+1;
+					}
+					else if (prevCell[0]>cell[0])
+					{
+						xEnd = prevCell[0]-radius[0]-1;
+					}
+					else
+					{
+						continue;
+					}
+				}
+				row[0] = xBegin;
+				visitHashedGridRow(&m_entries[0],&m_bucketStart[0],numBuckets,getBucket(row,level),xBegin,xEnd,row[1],row[2],level,visitor);
+			}
+			if (s==numSteps)
+			{
+				break;
+			}
+			prevCell[0] = cell[0];
+			prevCell[1] = cell[1];
+			prevCell[2] = cell[2];
+			// step along the axis with the nearest cell boundary, axes that reached the end cell don't move
+			int axis = -1;
+			for (int a=0;a<3;a++)
+			{
+				if (cell[a]!=endCell[a] && (axis<0 || tMax[a]<tMax[axis]))
+				{
+					axis = a;
+				}
+			}
+			cell[axis] += step[axis];
+			tMax[axis] += tDelta[axis];
+		}
+	}
+}
+
+
+void btHashedGridBroadphase::aabbTest(const btVector3& aabbMin,const btVector3& aabbMax,btBroadphaseAabbCallback& callback)
+{
+	if (!m_gridValid)
+	{
+		for (int i=0;i<m_proxies.size();i++)
+		{
+			btHashedGridProxy* proxy = m_proxies[i];
+			if (TestAabbAgainstAabb2(aabbMin,aabbMax,proxy->m_aabbMin,proxy->m_aabbMax))
+			{
+				callback.process(proxy);
+			}
+		}
+		return;
+	}
+	for (int i=0;i<m_hugeProxies.size();i++)
+	{
+		btHashedGridProxy* proxy = m_hugeProxies[i];
+		if (TestAabbAgainstAabb2(aabbMin,aabbMax,proxy->m_aabbMin,proxy->m_aabbMax))
+		{
+			callback.process(proxy);
+		}
+	}
+	int numBuckets = m_bucketStart.size()-1;
+	btHashedGridAabbVisitor visitor(aabbMin,aabbMax,callback);
+	for (int level=0;level<m_numLevels;level++)
+	{
+		if (m_levelCounts[level]==0)
+		{
+			continue;
+		}
+		btScalar cellSize = getCellSize(level);
+		btScalar invCellSize = btScalar(1.)/cellSize;
+		btVector3 halfCell(cellSize*btScalar(0.5),cellSize*btScalar(0.5),cellSize*btScalar(0.5));
+		btVector3 lo = (aabbMin-halfCell)*invCellSize;
+		btVector3 hi = (aabbMax+halfCell)*invCellSize;
+		int cellLo[3] = {hashedGridCoord(lo[0]),hashedGridCoord(lo[1]),hashedGridCoord(lo[2])};
+		int cellHi[3] = {hashedGridCoord(hi[0]),hashedGridCoord(hi[1]),hashedGridCoord(hi[2])};
+		btScalar numCells = btScalar(cellHi[0]-cellLo[0]+1)*btScalar(cellHi[1]-cellLo[1]+1)*btScalar(cellHi[2]-cellLo[2]+1);
+		if (numCells>btScalar(m_levelCounts[level]))
+		{
+			// the box covers more cells than there are proxies in this level, test them all
+			for (int i=0;i<m_entries.size();i++)
+			{
+				const btHashedGridEntry& entry = m_entries[i];
+				if (entry.m_level==level && TestAabbAgainstAabb2(aabbMin,aabbMax,entry.m_aabbMin,entry.m_aabbMax))
+				{
+					callback.process(entry.m_proxy);
+				}
+			}
+			continue;
+		}
+		int cell[3];
+		cell[0] = cellLo[0];
+		for (cell[1]=cellLo[1];cell[1]<=cellHi[1];cell[1]++)
+		for (cell[2]=cellLo[2];cell[2]<=cellHi[2];cell[2]++)
+		{
+			visitHashedGridRow(&m_entries[0],&m_bucketStart[0],numBuckets,getBucket(cell,level),cellLo[0],cellHi[0],cell[1],cell[2],level,visitor);
+		}
+	}
+}
@@ -0,0 +1,140 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_HASHED_GRID_BROADPHASE_H
+#define BT_HASHED_GRID_BROADPHASE_H
+
+#include "btBroadphaseInterface.h"
+#include "btOverlappingPairCache.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
+
+
+struct btHashedGridProxy : public btBroadphaseProxy
+{
+	int		m_level;	// cell level, BT_HASHED_GRID_HUGE_LEVEL if the proxy is larger than the coarsest cell
+	int		m_index;	// index in btHashedGridBroadphase::m_proxies
+
+	btHashedGridProxy(const btVector3& aabbMin,const btVector3& aabbMax,void* userPtr,int collisionFilterGroup,int collisionFilterMask)
+	:btBroadphaseProxy(aabbMin,aabbMax,userPtr,collisionFilterGroup,collisionFilterMask)
+	{
+	}
+};
+
+enum
+{
+	BT_HASHED_GRID_HUGE_LEVEL = 0x7fffffff
+};
+
+///a proxy binned into the grid cell that contains the center of its aabb
+struct btHashedGridEntry
+{
+	btVector3			m_aabbMin;
+	btVector3			m_aabbMax;
+	btHashedGridProxy*	m_proxy;
+	int					m_cell[3];
+	int					m_level;
+};
+
+
+///
+/// btHashedGridBroadphase -- a broadphase that bins the proxies into a multi-level uniform grid stored in a hash table.
+///
+///  Each proxy goes into the level with the smallest cells that are at least as large as its aabb,
+///  level i has cells of cellSize*2^i. A proxy is binned by the center of its aabb, so it can only overlap
+///  proxies of the same level in the neighbouring cells. Proxies larger than the coarsest cell are tested
+///  against all others.
+///
+///  The grid is rebuilt in calculateOverlappingPairs, and the proxies are tested against the grid in parallel
+///  with btParallelFor. The overlaps are added to the pair cache in a fixed order, so the pair cache
+///  receives the same pairs regardless of the number of threads.
+///
+///  Works best when most proxies have a similar size (particles, debris) and the cell size is close to
+///  that size. Needs a pair cache without deferred removal, such as the default btHashedOverlappingPairCache.
+///
+class btHashedGridBroadphase : public btBroadphaseInterface
+{
+public:
+	btHashedGridBroadphase(btScalar cellSize = btScalar(1.), int numLevels = 4, btOverlappingPairCache* paircache = 0);
+	virtual ~btHashedGridBroadphase();
+
+	virtual btBroadphaseProxy*	createProxy(const btVector3& aabbMin,const btVector3& aabbMax,int shapeType,void* userPtr,int collisionFilterGroup,int collisionFilterMask,btDispatcher* dispatcher);
+	virtual void	destroyProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+	virtual void	setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* dispatcher);
+	virtual void	getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin,btVector3& aabbMax) const;
+
+	///rayTest walks the cells along the ray, it falls back to testing all proxies when the grid is out of date
+	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo,btBroadphaseRayCallback& rayCallback,const btVector3& aabbMin=btVector3(0,0,0),const btVector3& aabbMax=btVector3(0,0,0));
+	virtual void	aabbTest(const btVector3& aabbMin,const btVector3& aabbMax,btBroadphaseAabbCallback& callback);
+
+	virtual void	calculateOverlappingPairs(btDispatcher* dispatcher);
+
+	virtual btOverlappingPairCache*	getOverlappingPairCache()
+	{
+		return m_paircache;
+	}
+	virtual const btOverlappingPairCache*	getOverlappingPairCache() const
+	{
+		return m_paircache;
+	}
+
+	virtual void	getBroadphaseAabb(btVector3& aabbMin,btVector3& aabbMax) const
+	{
+		aabbMin.setValue(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT);
+		aabbMax.setValue(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+	}
+
+	virtual void	resetPool(btDispatcher* dispatcher);
+
+	virtual void	printStats()
+	{
+	}
+
+	btScalar	getCellSize(int level) const
+	{
+		return m_cellSize*btScalar(1<<level);
+	}
+
+	int		getNumLevels() const
+	{
+		return m_numLevels;
+	}
+
+	int		m_grainSize;	// proxies per task when testing the proxies against the grid
+
+protected:
+	btScalar									m_cellSize;
+	int											m_numLevels;
+	btOverlappingPairCache*						m_paircache;
+	bool										m_releasepaircache;
+	int											m_gid;
+	bool										m_gridValid;	// false after a proxy moved, until the grid is rebuilt
+	btAlignedObjectArray<btHashedGridProxy*>	m_proxies;
+	btAlignedObjectArray<btHashedGridEntry>		m_entries;		// sorted by hash bucket
+	btAlignedObjectArray<int>					m_bucketStart;	// first entry of each bucket, with an extra end entry
+	btAlignedObjectArray<int>					m_levelCounts;
+	btAlignedObjectArray<btHashedGridProxy*>	m_hugeProxies;
+	btAlignedObjectArray< btAlignedObjectArray<btBroadphaseProxy*> >	m_taskPairs;	// overlaps found per task
+
+	int		calculateLevel(const btVector3& aabbMin,const btVector3& aabbMax) const;
+	void	calculateCell(const btVector3& aabbMin,const btVector3& aabbMax,int level,int cell[3]) const;
+	int		getBucket(const int cell[3],int level) const;
+	void	buildGrid();
+
+	friend struct btHashedGridEntryLoop;
+	friend struct btHashedGridPairLoop;
+};
+
+#endif //BT_HASHED_GRID_BROADPHASE_H
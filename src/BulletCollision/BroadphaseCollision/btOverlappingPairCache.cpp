@@ -22,6 +22,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 
 #include <stdio.h>
+#include <string.h>
 
 int	gOverlappingPairs = 0;
 
@@ -34,7 +35,8 @@ int gFindPairs =0;
 
 btHashedOverlappingPairCache::btHashedOverlappingPairCache():
 	m_overlapFilterCallback(0),
-	m_ghostPairCallback(0)
+	m_ghostPairCallback(0),
+	m_sortedPairs(false)
 {
 	int initialAllocatedSize= 2;
 	m_overlappingPairArray.reserve(initialAllocatedSize);
@@ -395,34 +397,166 @@ void	btHashedOverlappingPairCache::processAllOverlappingPairs(btOverlapCallback*
 	}
 }
 
+SIMD_FORCE_INLINE bool pairSortKeyLess(const btPairSortKey& a, const btPairSortKey& b)
+{
+	return a.m_uid0 < b.m_uid0 || (a.m_uid0 == b.m_uid0 && a.m_uid1 < b.m_uid1);
+}
+
+///LSD radix sort by (m_uid0, m_uid1) with 8 bit digits, passes where all keys share the same digit are skipped
+static void radixSortPairKeys(btAlignedObjectArray<btPairSortKey>& keys, btAlignedObjectArray<btPairSortKey>& tmp)
+{
+	const int numKeys = keys.size();
+	if (numKeys < 2)
+	{
+		return;
+	}
+	tmp.resizeNoInitialize(numKeys);
+
+	int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (int i = 0; i < numKeys; i++)
+	{
+		const unsigned int uid0 = keys[i].m_uid0;
+		const unsigned int uid1 = keys[i].m_uid1;
+		for (int b = 0; b < 4; b++)
+		{
+			histograms[b][(uid1 >> (8 * b)) & 0xff]++;
+			histograms[4 + b][(uid0 >> (8 * b)) & 0xff]++;
+		}
+	}
+
+	btPairSortKey* src = &keys[0];
+	btPairSortKey* dst = &tmp[0];
+	for (int pass = 0; pass < 8; pass++)
+	{
+		int* histogram = histograms[pass];
+		const int shift = 8 * (pass & 3);
+		const unsigned int firstDigit = ((pass < 4 ? src[0].m_uid1 : src[0].m_uid0) >> shift) & 0xff;
+		if (histogram[firstDigit] == numKeys)
+		{
+			continue;
+		}
+		int offset = 0;
+		for (int d = 0; d < 256; d++)
+		{
+			int count = histogram[d];
+			histogram[d] = offset;
+			offset += count;
+		}
+		for (int i = 0; i < numKeys; i++)
+		{
+			const unsigned int key = pass < 4 ? src[i].m_uid1 : src[i].m_uid0;
+			dst[histogram[(key >> shift) & 0xff]++] = src[i];
+		}
+		btSwap(src, dst);
+	}
+	if (src != &keys[0])
+	{
+		memcpy(&keys[0], src, numKeys * sizeof(btPairSortKey));
+	}
+}
+
 void	btHashedOverlappingPairCache::sortOverlappingPairs(btDispatcher* dispatcher)
 {
-	///need to keep hashmap in sync with pair address, so rebuild all
-	btBroadphasePairArray tmpPairs;
-	int i;
-	for (i=0;i<m_overlappingPairArray.size();i++)
+	BT_PROFILE("btHashedOverlappingPairCache::sortOverlappingPairs");
+	(void) dispatcher;
+	const int numPairs = m_overlappingPairArray.size();
+	if (numPairs < 2)
 	{
-		tmpPairs.push_back(m_overlappingPairArray[i]);
+		return;
 	}
 
-	for (i=0;i<tmpPairs.size();i++)
+	// keep the pairs that are in order with respect to the previous kept pair and the next pair,
+	// this only moves the pairs added at the end or swapped into a hole by removeOverlappingPair
+	m_sortKeys.resizeNoInitialize(0);
+	m_unsortedKeys.resizeNoInitialize(0);
+	btPairSortKey key;
+	key.m_uid0 = m_overlappingPairArray[0].m_pProxy0->getUid();
+	key.m_uid1 = m_overlappingPairArray[0].m_pProxy1->getUid();
+	key.m_index = 0;
+	for (int i = 0; i < numPairs; i++)
 	{
-		removeOverlappingPair(tmpPairs[i].m_pProxy0,tmpPairs[i].m_pProxy1,dispatcher);
+		btPairSortKey nextKey;
+		bool inOrder = m_sortKeys.size() == 0 || !pairSortKeyLess(key, m_sortKeys[m_sortKeys.size() - 1]);
+		if (i + 1 < numPairs)
+		{
+			nextKey.m_uid0 = m_overlappingPairArray[i + 1].m_pProxy0->getUid();
+			nextKey.m_uid1 = m_overlappingPairArray[i + 1].m_pProxy1->getUid();
+			nextKey.m_index = i + 1;
+			inOrder = inOrder && !pairSortKeyLess(nextKey, key);
+		}
+		if (inOrder)
+		{
+			m_sortKeys.push_back(key);
+		}
+		else
+		{
+			m_unsortedKeys.push_back(key);
+		}
+		key = nextKey;
 	}
-	
-	for (i = 0; i < m_next.size(); i++)
+	if (m_unsortedKeys.size() == 0)
 	{
-		m_next[i] = BT_NULL_PAIR;
+		return;
 	}
 
-	tmpPairs.quickSort(btBroadphasePairSortPredicate());
+	if (m_unsortedKeys.size() * 4 > numPairs)
+	{
+		// too many pairs changed, sort all of them
+		for (int i = 0; i < m_unsortedKeys.size(); i++)
+		{
+			m_sortKeys.push_back(m_unsortedKeys[i]);
+		}
+		radixSortPairKeys(m_sortKeys, m_tmpSortKeys);
+	}
+	else
+	{
+		// merge the sorted changed pairs into the pairs that kept their order
+		radixSortPairKeys(m_unsortedKeys, m_tmpSortKeys);
+		m_tmpSortKeys.resizeNoInitialize(numPairs);
+		int a = 0, b = 0;
+		for (int i = 0; i < numPairs; i++)
+		{
+			if (b == m_unsortedKeys.size() || (a < m_sortKeys.size() && !pairSortKeyLess(m_unsortedKeys[b], m_sortKeys[a])))
+			{
+				m_tmpSortKeys[i] = m_sortKeys[a++];
+			}
+			else
+			{
+				m_tmpSortKeys[i] = m_unsortedKeys[b++];
+			}
+		}
+		m_sortKeys.resizeNoInitialize(numPairs);
+		memcpy(&m_sortKeys[0], &m_tmpSortKeys[0], numPairs * sizeof(btPairSortKey));
+	}
 
-	for (i=0;i<tmpPairs.size();i++)
+	// reorder the pairs, the capacity of the pair array (and so the hash mask) doesn't change
+	m_tmpPairs.resizeNoInitialize(numPairs);
+	for (int i = 0; i < numPairs; i++)
 	{
-		addOverlappingPair(tmpPairs[i].m_pProxy0,tmpPairs[i].m_pProxy1);
+		m_tmpPairs[i] = m_overlappingPairArray[m_sortKeys[i].m_index];
 	}
+	for (int i = 0; i < numPairs; i++)
+	{
+		m_overlappingPairArray[i] = m_tmpPairs[i];
+	}
+	rebuildHashTable();
+}
 
-	
+void	btHashedOverlappingPairCache::rebuildHashTable()
+{
+	int i;
+	for (i = 0; i < m_hashTable.size(); i++)
+	{
+		m_hashTable[i] = BT_NULL_PAIR;
+	}
+	for (i = 0; i < m_overlappingPairArray.size(); i++)
+	{
+		const btBroadphasePair& pair = m_overlappingPairArray[i];
+		int	hashValue = static_cast<int>(getHash(static_cast<unsigned int>(pair.m_pProxy0->getUid()),static_cast<unsigned int>(pair.m_pProxy1->getUid())) & (m_overlappingPairArray.capacity()-1));
+		m_next[i] = m_hashTable[hashValue];
+		m_hashTable[hashValue] = i;
+	}
 }
 
 
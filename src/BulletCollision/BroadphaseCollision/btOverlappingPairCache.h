@@ -86,10 +86,25 @@ public:
 
 	virtual void	sortOverlappingPairs(btDispatcher* dispatcher) = 0;
 
+	///if true, the broadphase calls sortOverlappingPairs at the end of each calculateOverlappingPairs
+	virtual bool	hasSortedPairs()
+	{
+		return false;
+	}
+
+};
 
+///sort key of a pair in btHashedOverlappingPairCache::sortOverlappingPairs
+struct btPairSortKey
+{
+	unsigned int	m_uid0;
+	unsigned int	m_uid1;
+	int				m_index;
 };
 
 /// Hash-space based Pair Cache, thanks to Erin Catto, Box2D, http://www.box2d.org, and Pierre Terdiman, Codercorner, http://codercorner.com
+///With setSortedPairs(true) the pairs are kept sorted by (proxy0 uid, proxy1 uid) after each broadphase pass, so the
+///pair order only depends on the overlapping proxies and not on the order in which the pairs were found.
 
 ATTRIBUTE_ALIGNED16(class) btHashedOverlappingPairCache : public btOverlappingPairCache
 {
@@ -102,6 +117,12 @@ protected:
 	btAlignedObjectArray<int>	m_next;
 	btOverlappingPairCallback*	m_ghostPairCallback;
 
+	bool	m_sortedPairs;
+	btAlignedObjectArray<btPairSortKey>	m_sortKeys;
+	btAlignedObjectArray<btPairSortKey>	m_unsortedKeys;
+	btAlignedObjectArray<btPairSortKey>	m_tmpSortKeys;
+	btBroadphasePairArray	m_tmpPairs;
+
 
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
@@ -267,10 +288,25 @@ private:
 		m_ghostPairCallback = ghostPairCallback;
 	}
 
+public:
+
+	///sort the pairs by (proxy0 uid, proxy1 uid), keeping the collision algorithms.
+	///Pairs that are still in order since the last sort stay in place, only the pairs added or moved since are radix sorted and merged in.
 	virtual void	sortOverlappingPairs(btDispatcher* dispatcher);
-	
 
-	
+	void	setSortedPairs(bool sortedPairs)
+	{
+		m_sortedPairs = sortedPairs;
+	}
+
+	virtual bool	hasSortedPairs()
+	{
+		return m_sortedPairs;
+	}
+
+private:
+
+	void	rebuildHashTable();
 };
 
 
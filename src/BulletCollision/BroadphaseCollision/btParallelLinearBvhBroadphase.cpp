@@ -0,0 +1,1002 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btParallelLinearBvhBroadphase.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btQuickprof.h"
+
+
+// elements per task of the bounds, radix sort and distance passes, the split only depends on the number of leaves
+static const int BT_LBVH_TASK_SIZE = 4096;
+// elements per call of the fully parallel passes
+static const int BT_LBVH_GRAIN_SIZE = 1024;
+
+#define BT_LBVH_MAX_STACK_SIZE 128
+
+//Set so that it is always greater than the actual common prefixes, and never selected as a parent node.
+//Common prefixes of the 32 bit z-curve with the 32 bit leaf index appended are at most 63 bits long.
+#define BT_LBVH_INVALID_COMMON_PREFIX 128
+
+
+//The most significant bit of a node index is set for internal nodes, and cleared for leaf nodes.
+static SIMD_FORCE_INLINE bool lbvhIsLeafNode(int index)
+{
+	return index>=0;
+}
+
+static SIMD_FORCE_INLINE int lbvhNodeIndex(int index)
+{
+	return index & 0x7fffffff;
+}
+
+static SIMD_FORCE_INLINE int lbvhInternalNode(int index)
+{
+	return int((unsigned int)(index) | 0x80000000u);
+}
+
+static SIMD_FORCE_INLINE unsigned int lbvhInterleaveBits(unsigned int x)
+{
+	x &= 0x000003FF;
+	x = (x ^ (x << 16)) & 0xFF0000FF;
+	x = (x ^ (x <<  8)) & 0x0300F00F;
+	x = (x ^ (x <<  4)) & 0x030C30C3;
+	x = (x ^ (x <<  2)) & 0x09249249;
+	return x;
+}
+
+static SIMD_FORCE_INLINE int lbvhCountLeadingZeros(unsigned long long x)
+{
+	if (x==0)
+	{
+		return 64;
+	}
+	int n = 0;
+	if ((x>>32)==0) { n += 32; x <<= 32; }
+	if ((x>>48)==0) { n += 16; x <<= 16; }
+	if ((x>>56)==0) { n += 8; x <<= 8; }
+	if ((x>>60)==0) { n += 4; x <<= 4; }
+	if ((x>>62)==0) { n += 2; x <<= 2; }
+	if ((x>>63)==0) { n += 1; }
+	return n;
+}
+
+//Same as the common prefix length, but allows for prefixes with different lengths
+static SIMD_FORCE_INLINE int lbvhSharedPrefixLength(unsigned long long prefixA,int prefixLengthA,unsigned long long prefixB,int prefixLengthB)
+{
+	return btMin(lbvhCountLeadingZeros(prefixA^prefixB),btMin(prefixLengthA,prefixLengthB));
+}
+
+
+btParallelLinearBvhBroadphase::btParallelLinearBvhBroadphase(btOverlappingPairCache* paircache)
+{
+	m_grainSize				=	256;
+	m_largeProxyFraction	=	btScalar(0.25);
+	m_releasepaircache		=	(paircache!=0)?false:true;
+	m_paircache				=	paircache? paircache	: new(btAlignedAlloc(sizeof(btHashedOverlappingPairCache),16)) btHashedOverlappingPairCache();
+	m_gid					=	0;
+	m_bvhValid				=	false;
+	m_rootNode				=	-1;
+	btAssert(!m_paircache->hasDeferredRemoval());
+}
+
+
+btParallelLinearBvhBroadphase::~btParallelLinearBvhBroadphase()
+{
+	for (int i=0;i<m_proxies.size();i++)
+	{
+		btAlignedFree(m_proxies[i]);
+	}
+	if (m_releasepaircache)
+	{
+		m_paircache->~btOverlappingPairCache();
+		btAlignedFree(m_paircache);
+	}
+}
+
+
+btBroadphaseProxy* btParallelLinearBvhBroadphase::createProxy(const btVector3& aabbMin,const btVector3& aabbMax,int /*shapeType*/,void* userPtr,int collisionFilterGroup,int collisionFilterMask,btDispatcher* /*dispatcher*/)
+{
+	btParallelLinearBvhProxy* proxy = new(btAlignedAlloc(sizeof(btParallelLinearBvhProxy),16)) btParallelLinearBvhProxy(aabbMin,aabbMax,userPtr,collisionFilterGroup,collisionFilterMask);
+	proxy->m_uniqueId = ++m_gid;
+	proxy->m_index = m_proxies.size();
+	m_proxies.push_back(proxy);
+	m_bvhValid = false;
+	return proxy;
+}
+
+
+void btParallelLinearBvhBroadphase::destroyProxy(btBroadphaseProxy* absproxy,btDispatcher* dispatcher)
+{
+	btParallelLinearBvhProxy* proxy = static_cast<btParallelLinearBvhProxy*>(absproxy);
+	m_paircache->removeOverlappingPairsContainingProxy(proxy,dispatcher);
+	int index = proxy->m_index;
+	m_proxies[index] = m_proxies[m_proxies.size()-1];
+	m_proxies[index]->m_index = index;
+	m_proxies.pop_back();
+	proxy->~btParallelLinearBvhProxy();
+	btAlignedFree(proxy);
+	m_bvhValid = false;
+}
+
+
+void btParallelLinearBvhBroadphase::setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* /*dispatcher*/)
+{
+	proxy->m_aabbMin = aabbMin;
+	proxy->m_aabbMax = aabbMax;
+	m_bvhValid = false;
+}
+
+
+void btParallelLinearBvhBroadphase::getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin,btVector3& aabbMax) const
+{
+	aabbMin = proxy->m_aabbMin;
+	aabbMax = proxy->m_aabbMax;
+}
+
+
+void btParallelLinearBvhBroadphase::resetPool(btDispatcher* /*dispatcher*/)
+{
+	if (m_proxies.size()==0)
+	{
+		m_gid = 0;
+		m_largeProxies.clear();
+		m_leaves.clear();
+		m_nodes.clear();
+		m_mortonCodes.clear();
+		m_leafProxies.clear();
+		m_sortHistograms.clear();
+		m_commonPrefixes.clear();
+		m_commonPrefixLengths.clear();
+		m_parentNodes.clear();
+		m_distanceFromRoot.clear();
+		m_levelNodes.clear();
+		m_levelStart.clear();
+		m_taskBounds.clear();
+		m_taskDepths.clear();
+		m_taskPairs.clear();
+		m_rootNode = -1;
+		m_bvhValid = false;
+	}
+}
+
+
+struct btLbvhCenterBoundsLoop : public btIParallelForBody
+{
+	const btParallelLinearBvhBroadphase* m_broadphase;
+	btVector3* m_taskBounds;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		const btAlignedObjectArray<btParallelLinearBvhProxy*>& proxies = m_broadphase->m_proxies;
+		for (int task=iBegin;task<iEnd;++task)
+		{
+			btVector3 boundsMin(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+			btVector3 boundsMax(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT);
+			int end = btMin(proxies.size(),(task+1)*BT_LBVH_TASK_SIZE);
+			for (int i=task*BT_LBVH_TASK_SIZE;i<end;++i)
+			{
+				btVector3 center = (proxies[i]->m_aabbMin+proxies[i]->m_aabbMax)*btScalar(0.5);
+				boundsMin.setMin(center);
+				boundsMax.setMax(center);
+			}
+			m_taskBounds[2*task] = boundsMin;
+			m_taskBounds[2*task+1] = boundsMax;
+		}
+	}
+};
+
+
+struct btLbvhMortonCodeLoop : public btIParallelForBody
+{
+	btParallelLinearBvhBroadphase* m_broadphase;
+	btVector3 m_boundsMin;
+	btVector3 m_scale;	// 1024 grid cells over the bounds of the centers
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btParallelLinearBvhBroadphase* bp = m_broadphase;
+		for (int i=iBegin;i<iEnd;++i)
+		{
+			const btParallelLinearBvhProxy* proxy = bp->m_proxies[bp->m_leafProxies[i]];
+			btVector3 gridPosition = ((proxy->m_aabbMin+proxy->m_aabbMax)*btScalar(0.5)-m_boundsMin)*m_scale;
+			unsigned int discretePosition[3];
+			for (int axis=0;axis<3;axis++)
+			{
+				discretePosition[axis] = (unsigned int)(btMax(btScalar(0.),btMin(gridPosition[axis],btScalar(1023.))));
+			}
+			bp->m_mortonCodes[i] = lbvhInterleaveBits(discretePosition[0]) | lbvhInterleaveBits(discretePosition[1])<<1 | lbvhInterleaveBits(discretePosition[2])<<2;
+		}
+	}
+};
+
+
+struct btLbvhRadixHistogramLoop : public btIParallelForBody
+{
+	const unsigned int* m_keys;
+	int* m_histograms;
+	int m_numKeys;
+	int m_shift;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int task=iBegin;task<iEnd;++task)
+		{
+			int* histogram = &m_histograms[task*256];
+			for (int d=0;d<256;d++)
+			{
+				histogram[d] = 0;
+			}
+			int end = btMin(m_numKeys,(task+1)*BT_LBVH_TASK_SIZE);
+			for (int i=task*BT_LBVH_TASK_SIZE;i<end;++i)
+			{
+				histogram[(m_keys[i]>>m_shift)&255]++;
+			}
+		}
+	}
+};
+
+
+struct btLbvhRadixScatterLoop : public btIParallelForBody
+{
+	const unsigned int* m_keys;
+	const int* m_values;
+	unsigned int* m_sortedKeys;
+	int* m_sortedValues;
+	const int* m_offsets;
+	int m_numKeys;
+	int m_shift;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int task=iBegin;task<iEnd;++task)
+		{
+			int offsets[256];
+			for (int d=0;d<256;d++)
+			{
+				offsets[d] = m_offsets[task*256+d];
+			}
+			int end = btMin(m_numKeys,(task+1)*BT_LBVH_TASK_SIZE);
+			for (int i=task*BT_LBVH_TASK_SIZE;i<end;++i)
+			{
+				int dst = offsets[(m_keys[i]>>m_shift)&255]++;
+				m_sortedKeys[dst] = m_keys[i];
+				m_sortedValues[dst] = m_values[i];
+			}
+		}
+	}
+};
+
+
+///
+/// sortMortonCodes -- stable LSD radix sort of the morton codes and their proxy indices, with 8 bit digits.
+///                    Each pass counts the digits per task in parallel, computes the offsets of each task serially
+///                    and scatters in parallel. Digits that are the same for all keys are skipped.
+///
+void btParallelLinearBvhBroadphase::sortMortonCodes(int numLeaves)
+{
+	BT_PROFILE("sortMortonCodes");
+	int numTasks = (numLeaves+BT_LBVH_TASK_SIZE-1)/BT_LBVH_TASK_SIZE;
+	m_sortHistograms.resizeNoInitialize(numTasks*256);
+	int src = 0;
+	for (int shift=0;shift<30;shift+=8)
+	{
+		btLbvhRadixHistogramLoop histogramLoop;
+		histogramLoop.m_keys = &m_mortonCodes[src];
+		histogramLoop.m_histograms = &m_sortHistograms[0];
+		histogramLoop.m_numKeys = numLeaves;
+		histogramLoop.m_shift = shift;
+		btParallelFor(0,numTasks,1,histogramLoop);
+
+		// turn the counts into scatter offsets, ordered by digit and then by task so the sort is stable
+		int offset = 0;
+		bool constantDigit = false;
+		for (int d=0;d<256 && !constantDigit;d++)
+		{
+			int digitStart = offset;
+			for (int task=0;task<numTasks;task++)
+			{
+				int count = m_sortHistograms[task*256+d];
+				m_sortHistograms[task*256+d] = offset;
+				offset += count;
+			}
+			constantDigit = (offset-digitStart==numLeaves);
+		}
+		if (constantDigit)
+		{
+			continue;
+		}
+		int dst = numLeaves-src;
+		btLbvhRadixScatterLoop scatterLoop;
+		scatterLoop.m_keys = &m_mortonCodes[src];
+		scatterLoop.m_values = &m_leafProxies[src];
+		scatterLoop.m_sortedKeys = &m_mortonCodes[dst];
+		scatterLoop.m_sortedValues = &m_leafProxies[dst];
+		scatterLoop.m_offsets = &m_sortHistograms[0];
+		scatterLoop.m_numKeys = numLeaves;
+		scatterLoop.m_shift = shift;
+		btParallelFor(0,numTasks,1,scatterLoop);
+		src = dst;
+	}
+	if (src!=0)
+	{
+		for (int i=0;i<numLeaves;i++)
+		{
+			m_mortonCodes[i] = m_mortonCodes[src+i];
+			m_leafProxies[i] = m_leafProxies[src+i];
+		}
+	}
+}
+
+
+///gathers the sorted leaves and computes the common prefixes of adjacent leaves
+struct btLbvhLeafLoop : public btIParallelForBody
+{
+	btParallelLinearBvhBroadphase* m_broadphase;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btParallelLinearBvhBroadphase* bp = m_broadphase;
+		int numInternalNodes = bp->m_leaves.size()-1;
+		for (int i=iBegin;i<iEnd;++i)
+		{
+			btLbvhLeaf& leaf = bp->m_leaves[i];
+			leaf.m_proxy = bp->m_proxies[bp->m_leafProxies[i]];
+			leaf.m_aabbMin = leaf.m_proxy->m_aabbMin;
+			leaf.m_aabbMax = leaf.m_proxy->m_aabbMax;
+			if (i<numInternalNodes)
+			{
+				// the tree construction needs unique keys, so the leaf index is appended to the morton codes
+				unsigned long long left = ((unsigned long long)(bp->m_mortonCodes[i])<<32) | (unsigned long long)(i);
+				unsigned long long right = ((unsigned long long)(bp->m_mortonCodes[i+1])<<32) | (unsigned long long)(i+1);
+				int length = lbvhCountLeadingZeros(left^right);
+				bp->m_commonPrefixes[i] = (left&right) & ~(~0ull>>length);
+				bp->m_commonPrefixLengths[i] = length;
+			}
+		}
+	}
+};
+
+
+///the parent of a leaf is the adjacent internal node with the higher common prefix
+struct btLbvhLeafParentLoop : public btIParallelForBody
+{
+	btParallelLinearBvhBroadphase* m_broadphase;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btParallelLinearBvhBroadphase* bp = m_broadphase;
+		int numInternalNodes = bp->m_nodes.size();
+		for (int leafIndex=iBegin;leafIndex<iEnd;++leafIndex)
+		{
+			int leftSplitIndex = leafIndex-1;
+			int rightSplitIndex = leafIndex;
+			int leftCommonPrefix = (leftSplitIndex>=0)? bp->m_commonPrefixLengths[leftSplitIndex] : BT_LBVH_INVALID_COMMON_PREFIX;
+			int rightCommonPrefix = (rightSplitIndex<numInternalNodes)? bp->m_commonPrefixLengths[rightSplitIndex] : BT_LBVH_INVALID_COMMON_PREFIX;
+			bool isLeftHigherCommonPrefix = (leftCommonPrefix>rightCommonPrefix);
+			if (leftCommonPrefix==BT_LBVH_INVALID_COMMON_PREFIX)
+			{
+				isLeftHigherCommonPrefix = false;
+			}
+			if (rightCommonPrefix==BT_LBVH_INVALID_COMMON_PREFIX)
+			{
+				isLeftHigherCommonPrefix = true;
+			}
+			// if the left node is the parent, then this node is its right child and vice versa
+			int parentNodeIndex = isLeftHigherCommonPrefix? leftSplitIndex : rightSplitIndex;
+			bp->m_nodes[parentNodeIndex].m_childNodes[isLeftHigherCommonPrefix? 1 : 0] = leafIndex;
+		}
+	}
+};
+
+
+///the parent of an internal node is the nearest internal node on either side with a lower common prefix, the one with the higher prefix of the two
+struct btLbvhInternalParentLoop : public btIParallelForBody
+{
+	btParallelLinearBvhBroadphase* m_broadphase;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btParallelLinearBvhBroadphase* bp = m_broadphase;
+		const unsigned long long* commonPrefixes = &bp->m_commonPrefixes[0];
+		const int* commonPrefixLengths = &bp->m_commonPrefixLengths[0];
+		int numInternalNodes = bp->m_nodes.size();
+		for (int internalNodeIndex=iBegin;internalNodeIndex<iEnd;++internalNodeIndex)
+		{
+			unsigned long long nodePrefix = commonPrefixes[internalNodeIndex];
+			int nodePrefixLength = commonPrefixLengths[internalNodeIndex];
+
+			//Find nearest element to left with a lower common prefix
+			int leftIndex = -1;
+			{
+				int lower = 0;
+				int upper = internalNodeIndex-1;
+				while (lower<=upper)
+				{
+					int mid = (lower+upper)/2;
+					if (lbvhSharedPrefixLength(nodePrefix,nodePrefixLength,commonPrefixes[mid],commonPrefixLengths[mid])<nodePrefixLength)
+					{
+						int right = mid+1;
+						if (right<internalNodeIndex && lbvhSharedPrefixLength(nodePrefix,nodePrefixLength,commonPrefixes[right],commonPrefixLengths[right])<nodePrefixLength)
+						{
+							lower = right;
+							leftIndex = right;
+						}
+						else
+						{
+							leftIndex = mid;
+							break;
+						}
+					}
+					else
+					{
+						upper = mid-1;
+					}
+				}
+			}
+
+			//Find nearest element to right with a lower common prefix
+			int rightIndex = -1;
+			{
+				int lower = internalNodeIndex+1;
+				int upper = numInternalNodes-1;
+				while (lower<=upper)
+				{
+					int mid = (lower+upper)/2;
+					if (lbvhSharedPrefixLength(nodePrefix,nodePrefixLength,commonPrefixes[mid],commonPrefixLengths[mid])<nodePrefixLength)
+					{
+						int left = mid-1;
+						if (left>internalNodeIndex && lbvhSharedPrefixLength(nodePrefix,nodePrefixLength,commonPrefixes[left],commonPrefixLengths[left])<nodePrefixLength)
+						{
+							upper = left;
+							rightIndex = left;
+						}
+						else
+						{
+							rightIndex = mid;
+							break;
+						}
+					}
+					else
+					{
+						lower = mid+1;
+					}
+				}
+			}
+
+			//Select parent
+			int leftPrefixLength = (leftIndex!=-1)? commonPrefixLengths[leftIndex] : BT_LBVH_INVALID_COMMON_PREFIX;
+			int rightPrefixLength = (rightIndex!=-1)? commonPrefixLengths[rightIndex] : BT_LBVH_INVALID_COMMON_PREFIX;
+			bool isLeftHigherPrefixLength = (leftPrefixLength>rightPrefixLength);
+			if (leftPrefixLength==BT_LBVH_INVALID_COMMON_PREFIX)
+			{
+				isLeftHigherPrefixLength = false;
+			}
+			else if (rightPrefixLength==BT_LBVH_INVALID_COMMON_PREFIX)
+			{
+				isLeftHigherPrefixLength = true;
+			}
+			if (leftIndex==-1 && rightIndex==-1)
+			{
+				bp->m_parentNodes[internalNodeIndex] = -1;
+				bp->m_rootNode = lbvhInternalNode(internalNodeIndex);
+			}
+			else
+			{
+				int parentNodeIndex = isLeftHigherPrefixLength? leftIndex : rightIndex;
+				bp->m_parentNodes[internalNodeIndex] = parentNodeIndex;
+				bp->m_nodes[parentNodeIndex].m_childNodes[isLeftHigherPrefixLength? 1 : 0] = lbvhInternalNode(internalNodeIndex);
+			}
+		}
+	}
+};
+
+
+struct btLbvhDistanceFromRootLoop : public btIParallelForBody
+{
+	btParallelLinearBvhBroadphase* m_broadphase;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btParallelLinearBvhBroadphase* bp = m_broadphase;
+		int numInternalNodes = bp->m_nodes.size();
+		for (int task=iBegin;task<iEnd;++task)
+		{
+			int maxDistance = 0;
+			int end = btMin(numInternalNodes,(task+1)*BT_LBVH_TASK_SIZE);
+			for (int i=task*BT_LBVH_TASK_SIZE;i<end;++i)
+			{
+				int distance = 0;
+				for (int parent=bp->m_parentNodes[i];parent!=-1;parent=bp->m_parentNodes[parent])
+				{
+					distance++;
+				}
+				bp->m_distanceFromRoot[i] = distance;
+				maxDistance = btMax(maxDistance,distance);
+			}
+			bp->m_taskDepths[task] = maxDistance;
+		}
+	}
+};
+
+
+///merges the aabbs and leaf ranges of the children of the internal nodes of one level
+struct btLbvhMergeNodesLoop : public btIParallelForBody
+{
+	btParallelLinearBvhBroadphase* m_broadphase;
+	const int* m_levelNodes;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btParallelLinearBvhBroadphase* bp = m_broadphase;
+		for (int i=iBegin;i<iEnd;++i)
+		{
+			btLbvhNode& node = bp->m_nodes[m_levelNodes[i]];
+			for (int c=0;c<2;c++)
+			{
+				int child = node.m_childNodes[c];
+				const btVector3* childMin;
+				const btVector3* childMax;
+				int childRange;
+				if (lbvhIsLeafNode(child))
+				{
+					childMin = &bp->m_leaves[child].m_aabbMin;
+					childMax = &bp->m_leaves[child].m_aabbMax;
+					childRange = child;
+				}
+				else
+				{
+					const btLbvhNode& childNode = bp->m_nodes[lbvhNodeIndex(child)];
+					childMin = &childNode.m_aabbMin;
+					childMax = &childNode.m_aabbMax;
+					childRange = childNode.m_leafRange[c];
+				}
+				if (c==0)
+				{
+					node.m_aabbMin = *childMin;
+					node.m_aabbMax = *childMax;
+				}
+				else
+				{
+					node.m_aabbMin.setMin(*childMin);
+					node.m_aabbMax.setMax(*childMax);
+				}
+				node.m_leafRange[c] = childRange;
+			}
+		}
+	}
+};
+
+
+void btParallelLinearBvhBroadphase::buildBvh()
+{
+	BT_PROFILE("btParallelLinearBvhBroadphase::buildBvh");
+	int numProxies = m_proxies.size();
+	m_largeProxies.resizeNoInitialize(0);
+	m_leaves.resizeNoInitialize(0);
+	m_nodes.resizeNoInitialize(0);
+	m_rootNode = -1;
+	m_bvhValid = true;
+	if (numProxies==0)
+	{
+		return;
+	}
+
+	// bounds of the aabb centers, the z-curve is quantized over these bounds
+	int numTasks = (numProxies+BT_LBVH_TASK_SIZE-1)/BT_LBVH_TASK_SIZE;
+	m_taskBounds.resizeNoInitialize(2*numTasks);
+	{
+		btLbvhCenterBoundsLoop loop;
+		loop.m_broadphase = this;
+		loop.m_taskBounds = &m_taskBounds[0];
+		btParallelFor(0,numTasks,1,loop);
+	}
+	btVector3 boundsMin = m_taskBounds[0];
+	btVector3 boundsMax = m_taskBounds[1];
+	for (int task=1;task<numTasks;task++)
+	{
+		boundsMin.setMin(m_taskBounds[2*task]);
+		boundsMax.setMax(m_taskBounds[2*task+1]);
+	}
+	btVector3 boundsExtents = boundsMax-boundsMin;
+	btScalar largeProxySize = m_largeProxyFraction*boundsExtents[boundsExtents.maxAxis()];
+
+	// large proxies would make the aabbs of the internal nodes large, test them separately
+	m_leafProxies.resizeNoInitialize(2*numProxies);
+	int numLeaves = 0;
+	for (int i=0;i<numProxies;i++)
+	{
+		btParallelLinearBvhProxy* proxy = m_proxies[i];
+		btVector3 extents = proxy->m_aabbMax-proxy->m_aabbMin;
+		if (extents[extents.maxAxis()]>largeProxySize)
+		{
+			m_largeProxies.push_back(proxy);
+		}
+		else
+		{
+			m_leafProxies[numLeaves++] = i;
+		}
+	}
+	if (numLeaves==0)
+	{
+		return;
+	}
+
+	m_mortonCodes.resizeNoInitialize(2*numLeaves);
+	{
+		BT_PROFILE("assignMortonCodes");
+		btLbvhMortonCodeLoop loop;
+		loop.m_broadphase = this;
+		loop.m_boundsMin = boundsMin;
+		for (int axis=0;axis<3;axis++)
+		{
+			loop.m_scale[axis] = boundsExtents[axis]>btScalar(0.)? btScalar(1024.)/boundsExtents[axis] : btScalar(0.);
+		}
+		btParallelFor(0,numLeaves,BT_LBVH_GRAIN_SIZE,loop);
+	}
+	sortMortonCodes(numLeaves);
+
+	int numInternalNodes = numLeaves-1;
+	m_leaves.resizeNoInitialize(numLeaves);
+	m_nodes.resizeNoInitialize(numInternalNodes);
+	m_commonPrefixes.resizeNoInitialize(numInternalNodes);
+	m_commonPrefixLengths.resizeNoInitialize(numInternalNodes);
+	m_parentNodes.resizeNoInitialize(numInternalNodes);
+	m_distanceFromRoot.resizeNoInitialize(numInternalNodes);
+	{
+		btLbvhLeafLoop loop;
+		loop.m_broadphase = this;
+		btParallelFor(0,numLeaves,BT_LBVH_GRAIN_SIZE,loop);
+	}
+	if (numInternalNodes==0)
+	{
+		m_rootNode = 0;
+		return;
+	}
+
+	{
+		BT_PROFILE("constructBinaryRadixTree");
+		btLbvhLeafParentLoop leafLoop;
+		leafLoop.m_broadphase = this;
+		btParallelFor(0,numLeaves,BT_LBVH_GRAIN_SIZE,leafLoop);
+		btLbvhInternalParentLoop internalLoop;
+		internalLoop.m_broadphase = this;
+		btParallelFor(0,numInternalNodes,BT_LBVH_GRAIN_SIZE,internalLoop);
+	}
+
+	{
+		BT_PROFILE("mergeNodeAabbs");
+		int numDistanceTasks = (numInternalNodes+BT_LBVH_TASK_SIZE-1)/BT_LBVH_TASK_SIZE;
+		m_taskDepths.resizeNoInitialize(numDistanceTasks);
+		btLbvhDistanceFromRootLoop distanceLoop;
+		distanceLoop.m_broadphase = this;
+		btParallelFor(0,numDistanceTasks,1,distanceLoop);
+		int maxDistance = 0;
+		for (int task=0;task<numDistanceTasks;task++)
+		{
+			maxDistance = btMax(maxDistance,m_taskDepths[task]);
+		}
+
+		// sort the internal nodes by their distance from the root
+		m_levelStart.resize(maxDistance+2);
+		for (int i=0;i<m_levelStart.size();i++)
+		{
+			m_levelStart[i] = 0;
+		}
+		for (int i=0;i<numInternalNodes;i++)
+		{
+			m_levelStart[m_distanceFromRoot[i]+1]++;
+		}
+		for (int d=0;d<=maxDistance;d++)
+		{
+			m_levelStart[d+1] += m_levelStart[d];
+		}
+		m_levelNodes.resizeNoInitialize(numInternalNodes);
+		for (int i=0;i<numInternalNodes;i++)
+		{
+			m_levelNodes[m_levelStart[m_distanceFromRoot[i]]++] = i;
+		}
+		for (int d=maxDistance+1;d>0;d--)
+		{
+			m_levelStart[d] = m_levelStart[d-1];
+		}
+		m_levelStart[0] = 0;
+
+		// the children of a node are one level deeper, so merge from the deepest level up
+		btLbvhMergeNodesLoop mergeLoop;
+		mergeLoop.m_broadphase = this;
+		mergeLoop.m_levelNodes = &m_levelNodes[0];
+		for (int d=maxDistance;d>=0;d--)
+		{
+			btParallelFor(m_levelStart[d],m_levelStart[d+1],BT_LBVH_GRAIN_SIZE/4,mergeLoop);
+		}
+	}
+}
+
+
+///tests one leaf or large proxy against the bvh and the large proxies, and collects the overlaps of a task
+struct btLbvhPairLoop : public btIParallelForBody
+{
+	const btParallelLinearBvhBroadphase* m_broadphase;
+	btAlignedObjectArray<btBroadphaseProxy*>* m_taskPairs;
+	int m_grainSize;
+	int m_numItems;
+
+	void queryLeaf(int queryLeafIndex, btAlignedObjectArray<btBroadphaseProxy*>& pairs) const
+	{
+		const btParallelLinearBvhBroadphase* bp = m_broadphase;
+		const btLbvhLeaf& query = bp->m_leaves[queryLeafIndex];
+		int stack[BT_LBVH_MAX_STACK_SIZE];
+		int stackSize = 1;
+		stack[0] = bp->m_rootNode;
+		while (stackSize)
+		{
+			int node = stack[--stackSize];
+			bool isLeaf = lbvhIsLeafNode(node);
+			int nodeIndex = lbvhNodeIndex(node);
+			// each internal node covers a contiguous range of leaves, only the leaves after the query leaf
+			// are visited so each pair is tested once
+			int highestLeafIndex = isLeaf? nodeIndex : bp->m_nodes[nodeIndex].m_leafRange[1];
+			if (highestLeafIndex<=queryLeafIndex)
+			{
+				continue;
+			}
+			if (isLeaf)
+			{
+				const btLbvhLeaf& leaf = bp->m_leaves[nodeIndex];
+				if (TestAabbAgainstAabb2(query.m_aabbMin,query.m_aabbMax,leaf.m_aabbMin,leaf.m_aabbMax))
+				{
+					pairs.push_back(query.m_proxy);
+					pairs.push_back(leaf.m_proxy);
+				}
+			}
+			else
+			{
+				const btLbvhNode& internalNode = bp->m_nodes[nodeIndex];
+				if (TestAabbAgainstAabb2(query.m_aabbMin,query.m_aabbMax,internalNode.m_aabbMin,internalNode.m_aabbMax))
+				{
+					btAssert(stackSize+2<=BT_LBVH_MAX_STACK_SIZE);
+					stack[stackSize++] = internalNode.m_childNodes[0];
+					stack[stackSize++] = internalNode.m_childNodes[1];
+				}
+			}
+		}
+		for (int j=0;j<bp->m_largeProxies.size();j++)
+		{
+			btParallelLinearBvhProxy* large = bp->m_largeProxies[j];
+			if (TestAabbAgainstAabb2(query.m_aabbMin,query.m_aabbMax,large->m_aabbMin,large->m_aabbMax))
+			{
+				pairs.push_back(query.m_proxy);
+				pairs.push_back(large);
+			}
+		}
+	}
+
+	void queryLargeProxy(int largeIndex, btAlignedObjectArray<btBroadphaseProxy*>& pairs) const
+	{
+		const btParallelLinearBvhBroadphase* bp = m_broadphase;
+		btParallelLinearBvhProxy* a = bp->m_largeProxies[largeIndex];
+		for (int j=largeIndex+1;j<bp->m_largeProxies.size();j++)
+		{
+			btParallelLinearBvhProxy* b = bp->m_largeProxies[j];
+			if (TestAabbAgainstAabb2(a->m_aabbMin,a->m_aabbMax,b->m_aabbMin,b->m_aabbMax))
+			{
+				pairs.push_back(a);
+				pairs.push_back(b);
+			}
+		}
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		int numLeaves = m_broadphase->m_leaves.size();
+		for (int task=iBegin;task<iEnd;++task)
+		{
+			btAlignedObjectArray<btBroadphaseProxy*>& pairs = m_taskPairs[task];
+			pairs.resizeNoInitialize(0);
+			int end = btMin(m_numItems,(task+1)*m_grainSize);
+			for (int i=task*m_grainSize;i<end;++i)
+			{
+				if (i<numLeaves)
+				{
+					queryLeaf(i,pairs);
+				}
+				else
+				{
+					queryLargeProxy(i-numLeaves,pairs);
+				}
+			}
+		}
+	}
+};
+
+
+struct btLbvhRemovePairCallback : public btOverlapCallback
+{
+	virtual bool processOverlap(btBroadphasePair& pair)
+	{
+		return !TestAabbAgainstAabb2(pair.m_pProxy0->m_aabbMin,pair.m_pProxy0->m_aabbMax,pair.m_pProxy1->m_aabbMin,pair.m_pProxy1->m_aabbMax);
+	}
+};
+
+
+void btParallelLinearBvhBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
+{
+	BT_PROFILE("btParallelLinearBvhBroadphase::calculateOverlappingPairs");
+	{
+		BT_PROFILE("removeSeparatedPairs");
+		btLbvhRemovePairCallback removeCallback;
+		m_paircache->processAllOverlappingPairs(&removeCallback,dispatcher);
+	}
+
+	buildBvh();
+
+	// the split into tasks only depends on the number of proxies, not on the number of threads
+	int numItems = m_leaves.size()+m_largeProxies.size();
+	int numTasks = (numItems+m_grainSize-1)/m_grainSize;
+	if (m_taskPairs.size()<numTasks)
+	{
+		// only grow, so the pair arrays keep their capacity from frame to frame
+		m_taskPairs.resize(numTasks);
+	}
+	if (numTasks>0)
+	{
+		BT_PROFILE("findOverlaps");
+		btLbvhPairLoop loop;
+		loop.m_broadphase = this;
+		loop.m_taskPairs = &m_taskPairs[0];
+		loop.m_grainSize = m_grainSize;
+		loop.m_numItems = numItems;
+		btParallelFor(0,numTasks,1,loop);
+	}
+
+	{
+		BT_PROFILE("addPairs");
+		// the pair cache is not threadsafe, add the overlaps serially in task order
+		for (int i=0;i<numTasks;i++)
+		{
+			const btAlignedObjectArray<btBroadphaseProxy*>& pairs = m_taskPairs[i];
+			for (int j=0;j<pairs.size();j+=2)
+			{
+				m_paircache->addOverlappingPair(pairs[j],pairs[j+1]);
+			}
+		}
+	}
+
+	if (m_paircache->hasSortedPairs())
+	{
+		m_paircache->sortOverlappingPairs(dispatcher);
+	}
+}
+
+
+static SIMD_FORCE_INLINE bool lbvhRayTestAabb(const btVector3& nodeMin,const btVector3& nodeMax,const btVector3& rayFrom,btBroadphaseRayCallback& rayCallback,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	btVector3 bounds[2];
+	bounds[0] = nodeMin-aabbMax;
+	bounds[1] = nodeMax-aabbMin;
+	btScalar tmin;
+	return btRayAabb2(rayFrom,rayCallback.m_rayDirectionInverse,rayCallback.m_signs,bounds,tmin,btScalar(0.),rayCallback.m_lambda_max);
+}
+
+
+void btParallelLinearBvhBroadphase::rayTest(const btVector3& rayFrom,const btVector3& /*rayTo*/,btBroadphaseRayCallback& rayCallback,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	if (!m_bvhValid)
+	{
+		for (int i=0;i<m_proxies.size();i++)
+		{
+			btParallelLinearBvhProxy* proxy = m_proxies[i];
+			if (lbvhRayTestAabb(proxy->m_aabbMin,proxy->m_aabbMax,rayFrom,rayCallback,aabbMin,aabbMax))
+			{
+				rayCallback.process(proxy);
+			}
+		}
+		return;
+	}
+	for (int i=0;i<m_largeProxies.size();i++)
+	{
+		btParallelLinearBvhProxy* proxy = m_largeProxies[i];
+		if (lbvhRayTestAabb(proxy->m_aabbMin,proxy->m_aabbMax,rayFrom,rayCallback,aabbMin,aabbMax))
+		{
+			rayCallback.process(proxy);
+		}
+	}
+	if (m_rootNode==-1)
+	{
+		return;
+	}
+	int stack[BT_LBVH_MAX_STACK_SIZE];
+	int stackSize = 1;
+	stack[0] = m_rootNode;
+	while (stackSize)
+	{
+		int node = stack[--stackSize];
+		int nodeIndex = lbvhNodeIndex(node);
+		if (lbvhIsLeafNode(node))
+		{
+			const btLbvhLeaf& leaf = m_leaves[nodeIndex];
+			if (lbvhRayTestAabb(leaf.m_aabbMin,leaf.m_aabbMax,rayFrom,rayCallback,aabbMin,aabbMax))
+			{
+				rayCallback.process(leaf.m_proxy);
+			}
+		}
+		else
+		{
+			const btLbvhNode& internalNode = m_nodes[nodeIndex];
+			if (lbvhRayTestAabb(internalNode.m_aabbMin,internalNode.m_aabbMax,rayFrom,rayCallback,aabbMin,aabbMax))
+			{
+				btAssert(stackSize+2<=BT_LBVH_MAX_STACK_SIZE);
+				stack[stackSize++] = internalNode.m_childNodes[1];
+				stack[stackSize++] = internalNode.m_childNodes[0];
+			}
+		}
+	}
+}
+
+
+void btParallelLinearBvhBroadphase::aabbTest(const btVector3& aabbMin,const btVector3& aabbMax,btBroadphaseAabbCallback& callback)
+{
+	if (!m_bvhValid)
+	{
+		for (int i=0;i<m_proxies.size();i++)
+		{
+			btParallelLinearBvhProxy* proxy = m_proxies[i];
+			if (TestAabbAgainstAabb2(aabbMin,aabbMax,proxy->m_aabbMin,proxy->m_aabbMax))
+			{
+				callback.process(proxy);
+			}
+		}
+		return;
+	}
+	for (int i=0;i<m_largeProxies.size();i++)
+	{
+		btParallelLinearBvhProxy* proxy = m_largeProxies[i];
+		if (TestAabbAgainstAabb2(aabbMin,aabbMax,proxy->m_aabbMin,proxy->m_aabbMax))
+		{
+			callback.process(proxy);
+		}
+	}
+	if (m_rootNode==-1)
+	{
+		return;
+	}
+	int stack[BT_LBVH_MAX_STACK_SIZE];
+	int stackSize = 1;
+	stack[0] = m_rootNode;
+	while (stackSize)
+	{
+		int node = stack[--stackSize];
+		int nodeIndex = lbvhNodeIndex(node);
+		if (lbvhIsLeafNode(node))
+		{
+			const btLbvhLeaf& leaf = m_leaves[nodeIndex];
+			if (TestAabbAgainstAabb2(aabbMin,aabbMax,leaf.m_aabbMin,leaf.m_aabbMax))
+			{
+				callback.process(leaf.m_proxy);
+			}
+		}
+		else
+		{
+			const btLbvhNode& internalNode = m_nodes[nodeIndex];
+			if (TestAabbAgainstAabb2(aabbMin,aabbMax,internalNode.m_aabbMin,internalNode.m_aabbMax))
+			{
+				btAssert(stackSize+2<=BT_LBVH_MAX_STACK_SIZE);
+				stack[stackSize++] = internalNode.m_childNodes[1];
+				stack[stackSize++] = internalNode.m_childNodes[0];
+			}
+		}
+	}
+}
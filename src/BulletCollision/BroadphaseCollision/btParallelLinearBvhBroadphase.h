@@ -0,0 +1,150 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARALLEL_LINEAR_BVH_BROADPHASE_H
+#define BT_PARALLEL_LINEAR_BVH_BROADPHASE_H
+
+#include "btBroadphaseInterface.h"
+#include "btOverlappingPairCache.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
+
+
+struct btParallelLinearBvhProxy : public btBroadphaseProxy
+{
+	int		m_index;	// index in btParallelLinearBvhBroadphase::m_proxies
+
+	btParallelLinearBvhProxy(const btVector3& aabbMin,const btVector3& aabbMax,void* userPtr,int collisionFilterGroup,int collisionFilterMask)
+	:btBroadphaseProxy(aabbMin,aabbMax,userPtr,collisionFilterGroup,collisionFilterMask)
+	{
+	}
+};
+
+///leaf of the bvh, the leaves are sorted along the z-curve
+struct btLbvhLeaf
+{
+	btVector3					m_aabbMin;
+	btVector3					m_aabbMax;
+	btParallelLinearBvhProxy*	m_proxy;
+};
+
+///internal node of the bvh, each internal node covers a contiguous range of leaves
+struct btLbvhNode
+{
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+	int			m_childNodes[2];	// the most significant bit is set for internal nodes
+	int			m_leafRange[2];		// lowest and highest leaf index
+};
+
+
+///
+/// btParallelLinearBvhBroadphase -- a CPU port of b3GpuParallelLinearBvh, a linear bvh that is rebuilt from scratch
+///                                  in every calculateOverlappingPairs.
+///
+///  The centers of the aabbs are quantized to a 1024^3 grid and sorted along the z-curve (morton codes) with a
+///  parallel radix sort. The binary radix tree over the sorted leaves is built with the same parent search as
+///  the OpenCL kernels, see "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d trees"
+///  [Karras 2012], and the internal node aabbs are merged level by level from the deepest level up.
+///  All stages run with btParallelFor. Each leaf is then tested against the tree, only visiting the leaves after it
+///  in z-curve order, and the overlaps are added to the pair cache in a fixed order, so the pair cache receives
+///  the same pairs regardless of the number of threads.
+///
+///  Since nothing is refit, the tree quality does not degrade in very dynamic scenes. Proxies that are large
+///  compared to the scene (ground planes, triggers) are kept out of the tree and tested against all others.
+///  Needs a pair cache without deferred removal, such as the default btHashedOverlappingPairCache.
+///
+class btParallelLinearBvhBroadphase : public btBroadphaseInterface
+{
+public:
+	btParallelLinearBvhBroadphase(btOverlappingPairCache* paircache = 0);
+	virtual ~btParallelLinearBvhBroadphase();
+
+	virtual btBroadphaseProxy*	createProxy(const btVector3& aabbMin,const btVector3& aabbMax,int shapeType,void* userPtr,int collisionFilterGroup,int collisionFilterMask,btDispatcher* dispatcher);
+	virtual void	destroyProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+	virtual void	setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* dispatcher);
+	virtual void	getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin,btVector3& aabbMax) const;
+
+	///rayTest and aabbTest traverse the bvh, they fall back to testing all proxies when the bvh is out of date
+	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo,btBroadphaseRayCallback& rayCallback,const btVector3& aabbMin=btVector3(0,0,0),const btVector3& aabbMax=btVector3(0,0,0));
+	virtual void	aabbTest(const btVector3& aabbMin,const btVector3& aabbMax,btBroadphaseAabbCallback& callback);
+
+	virtual void	calculateOverlappingPairs(btDispatcher* dispatcher);
+
+	virtual btOverlappingPairCache*	getOverlappingPairCache()
+	{
+		return m_paircache;
+	}
+	virtual const btOverlappingPairCache*	getOverlappingPairCache() const
+	{
+		return m_paircache;
+	}
+
+	virtual void	getBroadphaseAabb(btVector3& aabbMin,btVector3& aabbMax) const
+	{
+		aabbMin.setValue(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT);
+		aabbMax.setValue(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+	}
+
+	virtual void	resetPool(btDispatcher* dispatcher);
+
+	virtual void	printStats()
+	{
+	}
+
+	///rebuild the bvh from the current proxy aabbs, called by calculateOverlappingPairs
+	void	buildBvh();
+
+	int			m_grainSize;			// leaves per task when testing the leaves against the bvh
+	btScalar	m_largeProxyFraction;	// proxies larger than this fraction of the extent of all aabb centers are kept out of the bvh
+
+protected:
+	btOverlappingPairCache*						m_paircache;
+	bool										m_releasepaircache;
+	int											m_gid;
+	bool										m_bvhValid;		// false after a proxy moved, until the bvh is rebuilt
+	int											m_rootNode;		// -1 if there are no leaves
+	btAlignedObjectArray<btParallelLinearBvhProxy*>	m_proxies;
+	btAlignedObjectArray<btParallelLinearBvhProxy*>	m_largeProxies;
+	btAlignedObjectArray<btLbvhLeaf>			m_leaves;
+	btAlignedObjectArray<btLbvhNode>			m_nodes;
+	btAlignedObjectArray<unsigned int>			m_mortonCodes;	// 1 element per leaf, with a second half used by the radix sort
+	btAlignedObjectArray<int>					m_leafProxies;	// proxy index of each morton code, with a second half used by the radix sort
+	btAlignedObjectArray<int>					m_sortHistograms;	// 256 digit counts per radix sort task
+	btAlignedObjectArray<unsigned long long>	m_commonPrefixes;	// of adjacent leaves, 1 element per internal node
+	btAlignedObjectArray<int>					m_commonPrefixLengths;
+	btAlignedObjectArray<int>					m_parentNodes;	// of internal nodes, -1 for the root
+	btAlignedObjectArray<int>					m_distanceFromRoot;
+	btAlignedObjectArray<int>					m_levelNodes;	// internal nodes sorted by distance from the root
+	btAlignedObjectArray<int>					m_levelStart;
+	btAlignedObjectArray<btVector3>				m_taskBounds;	// min and max of the aabb centers per task
+	btAlignedObjectArray<int>					m_taskDepths;
+	btAlignedObjectArray< btAlignedObjectArray<btBroadphaseProxy*> >	m_taskPairs;	// overlaps found per task
+
+	void	sortMortonCodes(int numLeaves);
+
+	friend struct btLbvhCenterBoundsLoop;
+	friend struct btLbvhMortonCodeLoop;
+	friend struct btLbvhRadixHistogramLoop;
+	friend struct btLbvhRadixScatterLoop;
+	friend struct btLbvhLeafLoop;
+	friend struct btLbvhLeafParentLoop;
+	friend struct btLbvhInternalParentLoop;
+	friend struct btLbvhDistanceFromRootLoop;
+	friend struct btLbvhMergeNodesLoop;
+	friend struct btLbvhPairLoop;
+};
+
+#endif //BT_PARALLEL_LINEAR_BVH_BROADPHASE_H
@@ -684,6 +684,150 @@ void	btQuantizedBvh::walkStacklessQuantizedTreeAgainstRay(btNodeOverlapCallback*
 
 }
 
+void	btQuantizedBvh::walkStacklessQuantizedTreeAgainstRayPacket(btNodeOverlapRayPacketCallback* nodeCallback, const btRayPacket& packet, int startNodeIndex,int endNodeIndex) const
+{
+	btAssert(m_useQuantization);
+
+	int curIndex = startNodeIndex;
+	int walkIterations = 0;
+	int subTreeSize = endNodeIndex - startNodeIndex;
+	(void)subTreeSize;
+
+	const btQuantizedBvhNode* rootNode = &m_quantizedContiguousNodes[startNodeIndex];
+	int escapeIndex;
+
+	bool isLeafNode;
+	unsigned boxBoxOverlap = 0;
+	unsigned rayBoxOverlap = 0;
+
+	/* Quick pruning by quantized box around the whole packet */
+	unsigned short int quantizedQueryAabbMin[3];
+	unsigned short int quantizedQueryAabbMax[3];
+	quantizeWithClamp(quantizedQueryAabbMin,packet.m_aabbMin,0);
+	quantizeWithClamp(quantizedQueryAabbMax,packet.m_aabbMax,1);
+
+	//rays that miss an internal node are masked out until the walk leaves its subtree.
+	//A mask is only pushed when it loses rays, so the stack never grows beyond the packet size.
+	unsigned int activeMask = packet.getRayMask();
+	int maskStackEnd[BT_RAY_PACKET_SIZE];
+	unsigned int maskStack[BT_RAY_PACKET_SIZE];
+	int maskStackSize = 0;
+
+	while (curIndex < endNodeIndex)
+	{
+		//catch bugs in tree data
+		btAssert (walkIterations < subTreeSize);
+
+		while (maskStackSize && curIndex >= maskStackEnd[maskStackSize-1])
+		{
+			maskStackSize--;
+			activeMask = maskStack[maskStackSize];
+		}
+
+		walkIterations++;
+		rayBoxOverlap = 0;
+		boxBoxOverlap = testQuantizedAabbAgainstQuantizedAabb(quantizedQueryAabbMin,quantizedQueryAabbMax,rootNode->m_quantizedAabbMin,rootNode->m_quantizedAabbMax);
+		isLeafNode = rootNode->isLeafNode();
+		if (boxBoxOverlap)
+		{
+			btVector3 bounds[2];
+			bounds[0] = unQuantize(rootNode->m_quantizedAabbMin);
+			bounds[1] = unQuantize(rootNode->m_quantizedAabbMax);
+			rayBoxOverlap = btRayAabbPacket(packet,bounds,activeMask);
+		}
+
+		if (!isLeafNode && rayBoxOverlap && rayBoxOverlap != activeMask)
+		{
+			btAssert(maskStackSize < BT_RAY_PACKET_SIZE);
+			maskStackEnd[maskStackSize] = curIndex + rootNode->getEscapeIndex();
+			maskStack[maskStackSize] = activeMask;
+			maskStackSize++;
+			activeMask = rayBoxOverlap;
+		}
+
+		if (isLeafNode && rayBoxOverlap)
+		{
+			nodeCallback->processNode(rootNode->getPartId(),rootNode->getTriangleIndex(),rayBoxOverlap);
+		}
+
+		if ((rayBoxOverlap != 0) || isLeafNode)
+		{
+			rootNode++;
+			curIndex++;
+		} else
+		{
+			escapeIndex = rootNode->getEscapeIndex();
+			rootNode += escapeIndex;
+			curIndex += escapeIndex;
+		}
+	}
+	if (maxIterations < walkIterations)
+		maxIterations = walkIterations;
+}
+
+void	btQuantizedBvh::walkStacklessTreeAgainstRayPacket(btNodeOverlapRayPacketCallback* nodeCallback, const btRayPacket& packet) const
+{
+	btAssert(!m_useQuantization);
+
+	const btOptimizedBvhNode* rootNode = &m_contiguousNodes[0];
+	int escapeIndex, curIndex = 0;
+	int walkIterations = 0;
+	bool isLeafNode;
+	unsigned rayBoxOverlap = 0;
+	btVector3 bounds[2];
+
+	//same per-subtree ray mask as walkStacklessQuantizedTreeAgainstRayPacket
+	unsigned int activeMask = packet.getRayMask();
+	int maskStackEnd[BT_RAY_PACKET_SIZE];
+	unsigned int maskStack[BT_RAY_PACKET_SIZE];
+	int maskStackSize = 0;
+
+	while (curIndex < m_curNodeIndex)
+	{
+		//catch bugs in tree data
+		btAssert (walkIterations < m_curNodeIndex);
+
+		while (maskStackSize && curIndex >= maskStackEnd[maskStackSize-1])
+		{
+			maskStackSize--;
+			activeMask = maskStack[maskStackSize];
+		}
+
+		walkIterations++;
+		bounds[0] = rootNode->m_aabbMinOrg;
+		bounds[1] = rootNode->m_aabbMaxOrg;
+		rayBoxOverlap = btRayAabbPacket(packet,bounds,activeMask);
+		isLeafNode = rootNode->m_escapeIndex == -1;
+
+		if (!isLeafNode && (rayBoxOverlap != 0) && rayBoxOverlap != activeMask)
+		{
+			btAssert(maskStackSize < BT_RAY_PACKET_SIZE);
+			maskStackEnd[maskStackSize] = curIndex + rootNode->m_escapeIndex;
+			maskStack[maskStackSize] = activeMask;
+			maskStackSize++;
+			activeMask = rayBoxOverlap;
+		}
+
+		if (isLeafNode && (rayBoxOverlap != 0))
+		{
+			nodeCallback->processNode(rootNode->m_subPart,rootNode->m_triangleIndex,rayBoxOverlap);
+		}
+
+		if ((rayBoxOverlap != 0) || isLeafNode)
+		{
+			rootNode++;
+			curIndex++;
+		} else
+		{
+			escapeIndex = rootNode->m_escapeIndex;
+			rootNode += escapeIndex;
+			curIndex += escapeIndex;
+		}
+	}
+	if (maxIterations < walkIterations)
+		maxIterations = walkIterations;
+}
+
 void	btQuantizedBvh::walkStacklessQuantizedTree(btNodeOverlapCallback* nodeCallback,unsigned short int* quantizedQueryAabbMin,unsigned short int* quantizedQueryAabbMax,int startNodeIndex,int endNodeIndex) const
 {
 	btAssert(m_useQuantization);
@@ -779,6 +923,19 @@ void	btQuantizedBvh::reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallb
 }
 
 
+void	btQuantizedBvh::reportRayPacketOverlappingNodex(btNodeOverlapRayPacketCallback* nodeCallback, const btRayPacket& packet) const
+{
+	if (m_useQuantization)
+	{
+		walkStacklessQuantizedTreeAgainstRayPacket(nodeCallback, packet, 0, m_curNodeIndex);
+	}
+	else
+	{
+		walkStacklessTreeAgainstRayPacket(nodeCallback, packet);
+	}
+}
+
+
 void	btQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax) const
 {
 	//always use stackless
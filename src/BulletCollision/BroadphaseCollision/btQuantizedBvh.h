@@ -157,6 +157,18 @@ public:
 	virtual void processNode(int subPart, int triangleIndex) = 0;
 };
 
+///btNodeOverlapRayPacketCallback receives the leaves hit by a packet of rays, see btQuantizedBvh::reportRayPacketOverlappingNodex
+class btNodeOverlapRayPacketCallback
+{
+public:
+	virtual ~btNodeOverlapRayPacketCallback() {};
+
+	///rayMask has bit i set for each ray i of the packet that hits the leaf
+	virtual void processNode(int subPart, int triangleIndex, unsigned int rayMask) = 0;
+};
+
+struct btRayPacket;
+
 #include "LinearMath/btAlignedAllocator.h"
 #include "LinearMath/btAlignedObjectArray.h"
 
@@ -314,6 +326,8 @@ protected:
 	void	walkStacklessQuantizedTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax, int startNodeIndex,int endNodeIndex) const;
 	void	walkStacklessQuantizedTree(btNodeOverlapCallback* nodeCallback,unsigned short int* quantizedQueryAabbMin,unsigned short int* quantizedQueryAabbMax,int startNodeIndex,int endNodeIndex) const;
 	void	walkStacklessTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax, int startNodeIndex,int endNodeIndex) const;
+	void	walkStacklessQuantizedTreeAgainstRayPacket(btNodeOverlapRayPacketCallback* nodeCallback, const btRayPacket& packet, int startNodeIndex,int endNodeIndex) const;
+	void	walkStacklessTreeAgainstRayPacket(btNodeOverlapRayPacketCallback* nodeCallback, const btRayPacket& packet) const;
 
 	///tree traversal designed for small-memory processors like PS3 SPU
 	void	walkStacklessQuantizedTreeCacheFriendly(btNodeOverlapCallback* nodeCallback,unsigned short int* quantizedQueryAabbMin,unsigned short int* quantizedQueryAabbMax) const;
@@ -348,6 +362,9 @@ public:
 	void	reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 	void	reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget) const;
 	void	reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax) const;
+	///reportRayPacketOverlappingNodex walks all rays of the packet through the tree together, each node is unquantized once
+	///and tested against the rays that hit its parent with btRayAabbPacket. The callback can lower packet.m_fraction to cull rays that already hit.
+	void	reportRayPacketOverlappingNodex(btNodeOverlapRayPacketCallback* nodeCallback, const btRayPacket& packet) const;
 
 		SIMD_FORCE_INLINE void quantize(unsigned short* out, const btVector3& point,int isMax) const
 	{
@@ -332,6 +332,11 @@ void	btSimpleBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
 #endif//CLEAN_INVALID_PAIRS
 
 		}
+
+		if (m_pairCache->hasSortedPairs())
+		{
+			m_pairCache->sortOverlappingPairs(dispatcher);
+		}
 	}
 }
 
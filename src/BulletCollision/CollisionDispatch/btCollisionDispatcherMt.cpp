@@ -100,6 +100,15 @@ void btCollisionDispatcherMt::releaseManifold( btPersistentManifold* manifold )
     }
 }
 
+static bool isPairThreadsafe( const btBroadphasePair& pair )
+{
+    // soft body collision handlers add the contacts to the soft bodies themselves, so a soft body
+    // can't be in two pairs processed at the same time
+    const btCollisionObject* obj0 = static_cast<const btCollisionObject*>( pair.m_pProxy0->m_clientObject );
+    const btCollisionObject* obj1 = static_cast<const btCollisionObject*>( pair.m_pProxy1->m_clientObject );
+    return obj0->getInternalType() != btCollisionObject::CO_SOFT_BODY && obj1->getInternalType() != btCollisionObject::CO_SOFT_BODY;
+}
+
 struct CollisionDispatcherUpdater : public btIParallelForBody
 {
     btBroadphasePair* mPairArray;
@@ -119,7 +128,10 @@ struct CollisionDispatcherUpdater : public btIParallelForBody
         for ( int i = iBegin; i < iEnd; ++i )
         {
             btBroadphasePair* pair = &mPairArray[ i ];
-            mCallback( *pair, *mDispatcher, *mInfo );
+            if ( isPairThreadsafe( *pair ) )
+            {
+                mCallback( *pair, *mDispatcher, *mInfo );
+            }
         }
     }
 };
@@ -140,12 +152,22 @@ void btCollisionDispatcherMt::dispatchAllCollisionPairs( btOverlappingPairCache*
 
     m_batchUpdating = true;
     btParallelFor( 0, pairCount, m_grainSize, updater );
+
+    // pairs that can't be processed in parallel, in pair order
+    btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+    for ( int i = 0; i < pairCount; ++i )
+    {
+        if ( !isPairThreadsafe( pairs[ i ] ) )
+        {
+            updater.mCallback( pairs[ i ], *this, info );
+        }
+    }
     m_batchUpdating = false;
 
-    // reconstruct the manifolds array to ensure determinism
+    // reconstruct the manifolds array in pair order, so the manifolds (and the solver results)
+    // don't depend on the number of threads or the order the pairs were processed in
     m_manifoldsPtr.resizeNoInitialize( 0 );
 
-    btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
     for ( int i = 0; i < pairCount; ++i )
     {
         if (btCollisionAlgorithm* algo = pairs[ i ].m_algorithm)
@@ -20,6 +20,14 @@ subject to the following restrictions:
 #include "LinearMath/btThreads.h"
 
 
+///
+/// btCollisionDispatcherMt -- a version of btCollisionDispatcher that processes the overlapping pairs with btParallelFor.
+///
+///  Works with btDiscreteDynamicsWorld, btMultiBodyDynamicsWorld (including btMultiBodyLinkCollider pairs) and
+///  their soft body variants; pairs involving a soft body are processed serially after the parallel loop.
+///  The manifold array is rebuilt in pair order after each dispatch, so the order of the manifolds does not
+///  depend on the number of threads.
+///
 class btCollisionDispatcherMt : public btCollisionDispatcher
 {
 public:
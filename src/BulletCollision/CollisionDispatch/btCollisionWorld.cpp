@@ -22,6 +22,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionShapes/btSphereShape.h" //for raycasting
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h" //for raycasting
 #include "BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h" //for raycasting
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h" //for raycasting
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "BulletCollision/CollisionShapes/btCompoundShape.h"
 #include "BulletCollision/NarrowPhaseCollision/btSubSimplexConvexCast.h"
@@ -33,6 +34,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btQuickprof.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 #include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
 
@@ -67,12 +69,19 @@ subject to the following restrictions:
 
 
 
+static void	freeRayTestPacketScratch(btAlignedObjectArray<btRayTestPacketScratch*>& scratches);
+
 btCollisionWorld::btCollisionWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache, btCollisionConfiguration* collisionConfiguration)
 :m_dispatcher1(dispatcher),
 m_broadphasePairCache(pairCache),
 m_debugDrawer(0),
 m_forceUpdateAllAabbs(true)
 {
+#if BT_THREADSAFE
+	m_rayTestPacketScratch.resize(BT_MAX_THREAD_COUNT, 0);
+#else
+	m_rayTestPacketScratch.resize(1, 0);
+#endif
 }
 
 
@@ -97,7 +106,7 @@ btCollisionWorld::~btCollisionWorld()
 		}
 	}
 
-
+	freeRayTestPacketScratch(m_rayTestPacketScratch);
 }
 
 
@@ -288,6 +297,47 @@ void	btCollisionWorld::rayTestSingle(const btTransform& rayFromTrans,const btTra
 	btCollisionWorld::rayTestSingleInternal(rayFromTrans,rayToTrans,&colObWrap,resultCallback);
 }
 
+///BridgeTriangleRaycastCallback reports the triangle hits of a ray in the local space of a concave shape to a RayResultCallback in world space
+struct BridgeTriangleRaycastCallback : public btTriangleRaycastCallback
+{
+	btCollisionWorld::RayResultCallback* m_resultCallback;
+	const btCollisionObject*	m_collisionObject;
+	const btConcaveShape*	m_triangleMesh;
+
+	btTransform m_colObjWorldTransform;
+
+	BridgeTriangleRaycastCallback( const btVector3& from,const btVector3& to,
+	btCollisionWorld::RayResultCallback* resultCallback, const btCollisionObject* collisionObject,const btConcaveShape*	triangleMesh,const btTransform& colObjWorldTransform):
+		//@BP Mod
+		btTriangleRaycastCallback(from,to, resultCallback->m_flags),
+			m_resultCallback(resultCallback),
+			m_collisionObject(collisionObject),
+			m_triangleMesh(triangleMesh),
+			m_colObjWorldTransform(colObjWorldTransform)
+		{
+		}
+
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex )
+	{
+		btCollisionWorld::LocalShapeInfo	shapeInfo;
+		shapeInfo.m_shapePart = partId;
+		shapeInfo.m_triangleIndex = triangleIndex;
+
+		btVector3 hitNormalWorld = m_colObjWorldTransform.getBasis() * hitNormalLocal;
+
+		btCollisionWorld::LocalRayResult rayResult
+			(m_collisionObject,
+			&shapeInfo,
+			hitNormalWorld,
+			hitFraction);
+
+		bool	normalInWorldSpace = true;
+		return m_resultCallback->addSingleResult(rayResult,normalInWorldSpace);
+	}
+
+};
+
 void	btCollisionWorld::rayTestSingleInternal(const btTransform& rayFromTrans,const btTransform& rayToTrans,
 										const btCollisionObjectWrapper* collisionObjectWrap,
 										RayResultCallback& resultCallback)
@@ -353,46 +403,6 @@ void	btCollisionWorld::rayTestSingleInternal(const btTransform& rayFromTrans,con
 		if (collisionShape->isConcave())
 		{
 
-			//ConvexCast::CastResult
-				struct BridgeTriangleRaycastCallback : public btTriangleRaycastCallback
-				{
-					btCollisionWorld::RayResultCallback* m_resultCallback;
-					const btCollisionObject*	m_collisionObject;
-					const btConcaveShape*	m_triangleMesh;
-
-					btTransform m_colObjWorldTransform;
-
-					BridgeTriangleRaycastCallback( const btVector3& from,const btVector3& to,
-					btCollisionWorld::RayResultCallback* resultCallback, const btCollisionObject* collisionObject,const btConcaveShape*	triangleMesh,const btTransform& colObjWorldTransform):
-						//@BP Mod
-						btTriangleRaycastCallback(from,to, resultCallback->m_flags),
-							m_resultCallback(resultCallback),
-							m_collisionObject(collisionObject),
-							m_triangleMesh(triangleMesh),
-							m_colObjWorldTransform(colObjWorldTransform)
-						{
-						}
-
-
-					virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex )
-					{
-						btCollisionWorld::LocalShapeInfo	shapeInfo;
-						shapeInfo.m_shapePart = partId;
-						shapeInfo.m_triangleIndex = triangleIndex;
-
-						btVector3 hitNormalWorld = m_colObjWorldTransform.getBasis() * hitNormalLocal;
-
-						btCollisionWorld::LocalRayResult rayResult
-							(m_collisionObject,
-							&shapeInfo,
-							hitNormalWorld,
-							hitFraction);
-
-						bool	normalInWorldSpace = true;
-						return m_resultCallback->addSingleResult(rayResult,normalInWorldSpace);
-					}
-
-				};
 
 			btTransform worldTocollisionObject = colObjWorldTransform.inverse();
 			btVector3 rayFromLocal = worldTocollisionObject * rayFromTrans.getOrigin();
@@ -480,12 +490,20 @@ void	btCollisionWorld::rayTestSingleInternal(const btTransform& rayFromTrans,con
 				BridgeTriangleRaycastCallback	rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObjectWrap->getCollisionObject(),concaveShape, colObjWorldTransform);
 				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
 
-				btVector3 rayAabbMinLocal = rayFromLocal;
-				rayAabbMinLocal.setMin(rayToLocal);
-				btVector3 rayAabbMaxLocal = rayFromLocal;
-				rayAabbMaxLocal.setMax(rayToLocal);
+				if (collisionShape->getShapeType()==TERRAIN_SHAPE_PROXYTYPE && ((const btHeightfieldTerrainShape*)collisionShape)->getUseCellWalk())
+				{
+					///walk the cells along the ray, instead of processing all triangles in the aabb of the ray
+					const btHeightfieldTerrainShape* heightField = (const btHeightfieldTerrainShape*)collisionShape;
+					heightField->performRaycast(&rcb,rayFromLocal,rayToLocal);
+				} else
+				{
+					btVector3 rayAabbMinLocal = rayFromLocal;
+					rayAabbMinLocal.setMin(rayToLocal);
+					btVector3 rayAabbMaxLocal = rayFromLocal;
+					rayAabbMaxLocal.setMax(rayToLocal);
 
-				concaveShape->processAllTriangles(&rcb,rayAabbMinLocal,rayAabbMaxLocal);
+					concaveShape->processAllTriangles(&rcb,rayAabbMinLocal,rayAabbMaxLocal);
+				}
 			}
 		} else {
 			//			BT_PROFILE("rayTestCompound");
@@ -815,13 +833,21 @@ void	btCollisionWorld::objectQuerySingleInternal(const btConvexShape* castShape,
 					btVector3 boxMinLocal, boxMaxLocal;
 					castShape->getAabb(rotationXform, boxMinLocal, boxMaxLocal);
 
-					btVector3 rayAabbMinLocal = convexFromLocal;
-					rayAabbMinLocal.setMin(convexToLocal);
-					btVector3 rayAabbMaxLocal = convexFromLocal;
-					rayAabbMaxLocal.setMax(convexToLocal);
-					rayAabbMinLocal += boxMinLocal;
-					rayAabbMaxLocal += boxMaxLocal;
-					concaveShape->processAllTriangles(&tccb,rayAabbMinLocal,rayAabbMaxLocal);
+					if (collisionShape->getShapeType()==TERRAIN_SHAPE_PROXYTYPE && ((const btHeightfieldTerrainShape*)collisionShape)->getUseCellWalk())
+					{
+						///walk the cells touched by the swept box, instead of processing all triangles in the aabb of the sweep
+						const btHeightfieldTerrainShape* heightField = (const btHeightfieldTerrainShape*)collisionShape;
+						heightField->performConvexcast(&tccb,convexFromLocal,convexToLocal,boxMinLocal,boxMaxLocal);
+					} else
+					{
+						btVector3 rayAabbMinLocal = convexFromLocal;
+						rayAabbMinLocal.setMin(convexToLocal);
+						btVector3 rayAabbMaxLocal = convexFromLocal;
+						rayAabbMaxLocal.setMax(convexToLocal);
+						rayAabbMinLocal += boxMinLocal;
+						rayAabbMaxLocal += boxMaxLocal;
+						concaveShape->processAllTriangles(&tccb,rayAabbMinLocal,rayAabbMaxLocal);
+					}
 				}
 			}
 		} else {
@@ -959,6 +985,7 @@ struct btSingleRayCallback : public btBroadphaseRayCallback
 	btSingleRayCallback(const btVector3& rayFromWorld,const btVector3& rayToWorld,const btCollisionWorld* world,btCollisionWorld::RayResultCallback& resultCallback)
 		:m_rayFromWorld(rayFromWorld),
 		m_rayToWorld(rayToWorld),
+		m_hitNormal(btScalar(0.),btScalar(0.),btScalar(0.)),
 		m_world(world),
 		m_resultCallback(resultCallback)
 	{
@@ -1041,6 +1068,227 @@ void	btCollisionWorld::rayTest(const btVector3& rayFromWorld, const btVector3& r
 }
 
 
+///btPacketRayCallback is the broadphase callback of one ray of rayTestPacket.
+///Hits on btBvhTriangleMeshShape objects are deferred, so that rayTestPacket can trace all rays that reach a mesh together.
+struct btPacketRayCallback : public btSingleRayCallback
+{
+	struct	DeferredMesh
+	{
+		const btCollisionObject*	m_collisionObject;
+		int	m_rayIndex;
+	};
+
+	btAlignedObjectArray<DeferredMesh>&	m_deferredMeshes;
+	int	m_rayIndex;
+	btScalar	m_rayLength;
+
+	btPacketRayCallback(const btVector3& rayFromWorld,const btVector3& rayToWorld,const btCollisionWorld* world,btCollisionWorld::RayResultCallback& resultCallback,
+		btAlignedObjectArray<DeferredMesh>& deferredMeshes, int rayIndex)
+		:btSingleRayCallback(rayFromWorld,rayToWorld,world,resultCallback),
+		m_deferredMeshes(deferredMeshes),
+		m_rayIndex(rayIndex)
+	{
+		m_rayLength = m_lambda_max;
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		if (m_resultCallback.m_closestHitFraction == btScalar(0.f))
+			return false;
+
+		btCollisionObject*	collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		if (collisionObject->getCollisionShape()->getShapeType()==TRIANGLE_MESH_SHAPE_PROXYTYPE)
+		{
+			if (m_resultCallback.needsCollision(collisionObject->getBroadphaseHandle()))
+			{
+				DeferredMesh& deferred = m_deferredMeshes.expand();
+				deferred.m_collisionObject = collisionObject;
+				deferred.m_rayIndex = m_rayIndex;
+			}
+			return true;
+		}
+		bool result = btSingleRayCallback::process(proxy);
+		//the packet traversal culls the remainder of the ray beyond the closest hit
+		m_lambda_max = m_resultCallback.m_closestHitFraction*m_rayLength;
+		return result;
+	}
+};
+
+class btSortDeferredMeshPredicate
+{
+public:
+	bool operator() ( const btPacketRayCallback::DeferredMesh& lhs, const btPacketRayCallback::DeferredMesh& rhs ) const
+	{
+		if (lhs.m_collisionObject != rhs.m_collisionObject)
+			return lhs.m_collisionObject < rhs.m_collisionObject;
+		return lhs.m_rayIndex < rhs.m_rayIndex;
+	}
+};
+
+///btRayTestPacketScratch keeps the arrays of rayTestPacket and rayTestBatch between packets, so their capacity is reused.
+///The callbacks own no memory, so the arrays are emptied with resizeNoInitialize and the callbacks are constructed in place
+struct btRayTestPacketScratch
+{
+	btAlignedObjectArray<btPacketRayCallback::DeferredMesh>	m_deferredMeshes;
+	btAlignedObjectArray<btPacketRayCallback>	m_rayCallbacks;
+	btAlignedObjectArray<btBroadphaseRayCallback*>	m_rayCallbackPtrs;
+	btAlignedObjectArray<BridgeTriangleRaycastCallback>	m_triangleCallbacks;
+	btAlignedObjectArray<btTriangleRaycastCallback*>	m_triangleCallbackPtrs;
+	btAlignedObjectArray<btCollisionWorld::ClosestRayResultCallback>	m_batchCallbacks;
+	btAlignedObjectArray<btCollisionWorld::RayResultCallback*>	m_batchCallbackPtrs;
+};
+
+static btRayTestPacketScratch&	getRayTestPacketScratch(btAlignedObjectArray<btRayTestPacketScratch*>& scratches)
+{
+	int threadIndex = 0;
+#if BT_THREADSAFE
+	threadIndex = btGetCurrentThreadIndex();
+#endif
+	btRayTestPacketScratch*& scratch = scratches[threadIndex];
+	if (!scratch)
+	{
+		void* mem = btAlignedAlloc(sizeof(btRayTestPacketScratch),16);
+		scratch = new (mem) btRayTestPacketScratch();
+	}
+	return *scratch;
+}
+
+static void	freeRayTestPacketScratch(btAlignedObjectArray<btRayTestPacketScratch*>& scratches)
+{
+	for (int i=0;i<scratches.size();i++)
+	{
+		if (scratches[i])
+		{
+			scratches[i]->~btRayTestPacketScratch();
+			btAlignedFree(scratches[i]);
+		}
+	}
+}
+
+void	btCollisionWorld::rayTestPacket(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const
+{
+	btRayTestPacketScratch& scratch = getRayTestPacketScratch(m_rayTestPacketScratch);
+	btAlignedObjectArray<btPacketRayCallback::DeferredMesh>& deferredMeshes = scratch.m_deferredMeshes;
+	btAlignedObjectArray<btPacketRayCallback>& rayCallbacks = scratch.m_rayCallbacks;
+	btAlignedObjectArray<btBroadphaseRayCallback*>& rayCallbackPtrs = scratch.m_rayCallbackPtrs;
+	deferredMeshes.resize(0);
+	rayCallbacks.resizeNoInitialize(0);
+	rayCallbacks.reserve(numRays);
+	rayCallbackPtrs.resize(numRays);
+	for (int i=0;i<numRays;i++)
+	{
+		rayCallbackPtrs[i] = new (&rayCallbacks.expandNonInitializing()) btPacketRayCallback(rayFromWorld[i],rayToWorld[i],this,*resultCallbacks[i],deferredMeshes,i);
+	}
+	m_broadphasePairCache->rayTestPacket(rayFromWorld,rayToWorld,&rayCallbackPtrs[0],numRays);
+
+	///trace the rays that reach each triangle mesh together, see btBvhTriangleMeshShape::performRaycastPacket
+	deferredMeshes.quickSort(btSortDeferredMeshPredicate());
+	int groupStart = 0;
+	while (groupStart < deferredMeshes.size())
+	{
+		const btCollisionObject* collisionObject = deferredMeshes[groupStart].m_collisionObject;
+		int groupEnd = groupStart+1;
+		while (groupEnd < deferredMeshes.size() && deferredMeshes[groupEnd].m_collisionObject == collisionObject)
+			groupEnd++;
+
+		btBvhTriangleMeshShape* triangleMesh = (btBvhTriangleMeshShape*)collisionObject->getCollisionShape();
+		const btTransform& colObjWorldTransform = collisionObject->getWorldTransform();
+		btTransform worldTocollisionObject = colObjWorldTransform.inverse();
+		btAlignedObjectArray<BridgeTriangleRaycastCallback>& triangleCallbacks = scratch.m_triangleCallbacks;
+		btAlignedObjectArray<btTriangleRaycastCallback*>& triangleCallbackPtrs = scratch.m_triangleCallbackPtrs;
+		triangleCallbacks.resizeNoInitialize(0);
+		triangleCallbackPtrs.resize(0);
+		triangleCallbacks.reserve(groupEnd-groupStart);
+		for (int j=groupStart;j<groupEnd;j++)
+		{
+			int rayIndex = deferredMeshes[j].m_rayIndex;
+			RayResultCallback* resultCallback = resultCallbacks[rayIndex];
+			if (resultCallback->m_closestHitFraction == btScalar(0.f))
+				continue;
+			btVector3 rayFromLocal = worldTocollisionObject * rayFromWorld[rayIndex];
+			btVector3 rayToLocal = worldTocollisionObject * rayToWorld[rayIndex];
+			BridgeTriangleRaycastCallback* triangleCallback = new (&triangleCallbacks.expandNonInitializing())
+				BridgeTriangleRaycastCallback(rayFromLocal,rayToLocal,resultCallback,collisionObject,triangleMesh,colObjWorldTransform);
+			triangleCallback->m_hitFraction = resultCallback->m_closestHitFraction;
+			triangleCallbackPtrs.push_back(triangleCallback);
+		}
+		if (triangleCallbackPtrs.size())
+		{
+			triangleMesh->performRaycastPacket(&triangleCallbackPtrs[0],triangleCallbackPtrs.size());
+		}
+		groupStart = groupEnd;
+	}
+}
+
+
+struct btRayTestBatchLoop : public btIParallelForBody
+{
+	const btCollisionWorld*	m_world;
+	btAlignedObjectArray<btRayTestPacketScratch*>*	m_scratches;
+	const btVector3*	m_rayFromWorld;
+	const btVector3*	m_rayToWorld;
+	btCollisionWorld::RayTestBatchResults*	m_results;
+	unsigned int	m_flags;
+	int	m_collisionFilterGroup;
+	int	m_collisionFilterMask;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		btRayTestPacketScratch& scratch = getRayTestPacketScratch( *m_scratches );
+		btAlignedObjectArray<btCollisionWorld::ClosestRayResultCallback>& rayCallbacks = scratch.m_batchCallbacks;
+		btAlignedObjectArray<btCollisionWorld::RayResultCallback*>& rayCallbackPtrs = scratch.m_batchCallbackPtrs;
+		rayCallbacks.resizeNoInitialize( 0 );
+		rayCallbackPtrs.resize( 0 );
+		rayCallbacks.reserve( iEnd - iBegin );
+		for ( int i = iBegin; i < iEnd; ++i )
+		{
+			btCollisionWorld::ClosestRayResultCallback* rayCallback = new ( &rayCallbacks.expandNonInitializing() )
+				btCollisionWorld::ClosestRayResultCallback( m_rayFromWorld[ i ], m_rayToWorld[ i ] );
+			rayCallback->m_flags = m_flags;
+			rayCallback->m_collisionFilterGroup = m_collisionFilterGroup;
+			rayCallback->m_collisionFilterMask = m_collisionFilterMask;
+			rayCallbackPtrs.push_back( rayCallback );
+		}
+		m_world->rayTestPacket( &m_rayFromWorld[ iBegin ], &m_rayToWorld[ iBegin ], &rayCallbackPtrs[ 0 ], iEnd - iBegin );
+		for ( int i = iBegin; i < iEnd; ++i )
+		{
+			const btCollisionWorld::ClosestRayResultCallback& rayCallback = rayCallbacks[ i - iBegin ];
+			m_results->m_hitFractions[ i ] = rayCallback.m_closestHitFraction;
+			m_results->m_collisionObjects[ i ] = rayCallback.m_collisionObject;
+			if ( m_results->m_hitPointWorld )
+			{
+				m_results->m_hitPointWorld[ i ] = rayCallback.hasHit() ? rayCallback.m_hitPointWorld : m_rayToWorld[ i ];
+			}
+			if ( m_results->m_hitNormalWorld )
+			{
+				m_results->m_hitNormalWorld[ i ] = rayCallback.hasHit() ? rayCallback.m_hitNormalWorld : btVector3( 0, 0, 0 );
+			}
+		}
+	}
+};
+
+void	btCollisionWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, RayTestBatchResults& results,
+									   unsigned int flags, int collisionFilterGroup, int collisionFilterMask) const
+{
+	BT_PROFILE("rayTestBatch");
+	btAssert(results.m_hitFractions && results.m_collisionObjects);
+	if (numRays <= 0)
+		return;
+	btRayTestBatchLoop loop;
+	loop.m_world = this;
+	loop.m_scratches = &m_rayTestPacketScratch;
+	loop.m_rayFromWorld = rayFromWorld;
+	loop.m_rayToWorld = rayToWorld;
+	loop.m_results = &results;
+	loop.m_flags = flags;
+	loop.m_collisionFilterGroup = collisionFilterGroup;
+	loop.m_collisionFilterMask = collisionFilterMask;
+	// each batch is traced as one ray packet, and small batches keep the threads balanced
+	int grainSize = BT_RAY_PACKET_SIZE;
+	btParallelFor(0, numRays, grainSize, loop);
+}
+
+
 struct btSingleSweepCallback : public btBroadphaseRayCallback
 {
 
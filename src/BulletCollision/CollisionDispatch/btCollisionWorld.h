@@ -76,6 +76,7 @@ class btCollisionShape;
 class btConvexShape;
 class btBroadphaseInterface;
 class btSerializer;
+struct btRayTestPacketScratch;
 
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btTransform.h"
@@ -105,6 +106,9 @@ protected:
 	///it is true by default, because it is error-prone (setting the position of static objects wouldn't update their AABB)
 	bool m_forceUpdateAllAabbs;
 
+	///scratch memory of rayTestPacket and rayTestBatch, indexed by thread and allocated on first use, so the ray packets don't allocate
+	mutable btAlignedObjectArray<btRayTestPacketScratch*>	m_rayTestPacketScratch;
+
 	void	serializeCollisionObjects(btSerializer* serializer);
 
 	void serializeContactManifolds(btSerializer* serializer);
@@ -440,6 +444,24 @@ public:
 
 
 
+	///RayTestBatchResults points to caller-provided arrays with one element per ray, see rayTestBatch.
+	///The closest hit of ray i is stored at index i, m_hitPointWorld and m_hitNormalWorld are optional.
+	struct	RayTestBatchResults
+	{
+		btScalar*					m_hitFractions;		//1 if the ray has no hit
+		const btCollisionObject**	m_collisionObjects;	//0 if the ray has no hit
+		btVector3*					m_hitPointWorld;
+		btVector3*					m_hitNormalWorld;
+
+		RayTestBatchResults()
+			:m_hitFractions(0),
+			m_collisionObjects(0),
+			m_hitPointWorld(0),
+			m_hitNormalWorld(0)
+		{
+		}
+	};
+
 	int	getNumCollisionObjects() const
 	{
 		return int(m_collisionObjects.size());
@@ -449,6 +471,19 @@ public:
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value returned by the callback.
 	virtual void rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const; 
 
+	/// rayTestPacket performs numRays coherent raycasts together, resultCallbacks[i] receives the hits of ray i.
+	/// The broadphase and btBvhTriangleMeshShape trees are walked once per packet of rays, see btBroadphaseInterface::rayTestPacket.
+	/// Triangle mesh hits are reported after the hits of the other objects, so use it with callbacks that do not depend on the order of hits.
+	/// The callbacks must not trace rays with rayTestPacket themselves, it reuses the scratch memory of the thread.
+	virtual void rayTestPacket(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const;
+
+	/// rayTestBatch finds the closest hit of each of numRays rays and stores it in the results arrays.
+	/// The rays are traced as packets with rayTestPacket, and the packets are spread over threads with btParallelFor,
+	/// so the broadphase ray tests must be thread-safe (btDbvtBroadphase is).
+	/// flags are the btTriangleRaycastCallback::EFlags used for triangle meshes, as in RayResultCallback::m_flags.
+	void	rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, RayTestBatchResults& results,
+						 unsigned int flags = 0, int collisionFilterGroup = btBroadphaseProxy::DefaultFilter, int collisionFilterMask = btBroadphaseProxy::AllFilter) const;
+
 	/// convexTest performs a swept convex cast on all objects in the btCollisionWorld, and calls the resultCallback
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void    convexSweepTest (const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback,  btScalar allowedCcdPenetration = btScalar(0.)) const;
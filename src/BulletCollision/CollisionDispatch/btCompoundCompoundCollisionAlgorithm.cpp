@@ -36,6 +36,9 @@ btCompoundCompoundCollisionAlgorithm::btCompoundCompoundCollisionAlgorithm( cons
 	void* ptr = btAlignedAlloc(sizeof(btHashedSimplePairCache),16);
 	m_childCollisionAlgorithmCache= new(ptr) btHashedSimplePairCache();
 
+	ptr = btAlignedAlloc(sizeof(btHashedSimplePairCache),16);
+	m_childManifoldCache= new(ptr) btHashedSimplePairCache();
+
 	const btCollisionObjectWrapper* col0ObjWrap = body0Wrap;
 	btAssert (col0ObjWrap->getCollisionShape()->isCompound());
 
@@ -57,6 +60,12 @@ btCompoundCompoundCollisionAlgorithm::~btCompoundCompoundCollisionAlgorithm()
 	removeChildAlgorithms();
 	m_childCollisionAlgorithmCache->~btHashedSimplePairCache();
 	btAlignedFree(m_childCollisionAlgorithmCache);
+	m_childManifoldCache->~btHashedSimplePairCache();
+	btAlignedFree(m_childManifoldCache);
+	if (m_ownsManifold)
+	{
+		m_dispatcher->releaseManifold(m_sharedManifold);
+	}
 }
 
 void	btCompoundCompoundCollisionAlgorithm::getAllContactManifolds(btManifoldArray&	manifoldArray)
@@ -71,6 +80,27 @@ void	btCompoundCompoundCollisionAlgorithm::getAllContactManifolds(btManifoldArra
 			((btCollisionAlgorithm*)pairs[i].m_userPointer)->getAllContactManifolds(manifoldArray);
 		}
 	}
+	if (m_ownsManifold)
+	{
+		manifoldArray.push_back(m_sharedManifold);
+	}
+}
+
+///the private manifolds of the child pairs are not registered with the dispatcher, so they are never seen by the solver
+///and they don't report the contact started, ended and processed callbacks
+static btPersistentManifold* newChildManifold(const btPersistentManifold* reducedManifold)
+{
+	void* mem = btAlignedAlloc(sizeof(btPersistentManifold),16);
+	btPersistentManifold* manifold = new(mem) btPersistentManifold(reducedManifold->getBody0(),reducedManifold->getBody1(),0,reducedManifold->getContactBreakingThreshold(),reducedManifold->getContactProcessingThreshold());
+	manifold->setContactCallbacksEnabled(false);
+	return manifold;
+}
+
+static void deleteChildManifold(btPersistentManifold* manifold)
+{
+	manifold->clearManifold();
+	manifold->~btPersistentManifold();
+	btAlignedFree(manifold);
 }
 
 
@@ -90,6 +120,200 @@ void	btCompoundCompoundCollisionAlgorithm::removeChildAlgorithms()
 		}
 	}
 	m_childCollisionAlgorithmCache->removeAllPairs();
+
+	btSimplePairArray& manifoldPairs = m_childManifoldCache->getOverlappingPairArray();
+	for (i=0;i<manifoldPairs.size();i++)
+	{
+		deleteChildManifold((btPersistentManifold*)manifoldPairs[i].m_userPointer);
+	}
+	m_childManifoldCache->removeAllPairs();
+}
+
+void	btCompoundCompoundCollisionAlgorithm::setReduceContacts(bool reduceContacts, const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap)
+{
+	//a manifold passed in by the dispatcher (nested compounds) is already shared by all child pairs
+	if (m_sharedManifold && !m_ownsManifold)
+		return;
+	if (reduceContacts == m_ownsManifold)
+		return;
+
+	//the child algorithms keep the manifold they were created with, so they need to be recreated
+	removeChildAlgorithms();
+	if (m_ownsManifold)
+	{
+		m_dispatcher->releaseManifold(m_sharedManifold);
+		m_sharedManifold = 0;
+		m_ownsManifold = false;
+	} else
+	{
+		m_sharedManifold = m_dispatcher->getNewManifold(body0Wrap->getCollisionObject(),body1Wrap->getCollisionObject());
+		m_ownsManifold = true;
+	}
+}
+
+///selects up to 4 points: the deepest point, the point farthest from it, and the two points that maximize the area of the contact polygon
+static int selectReducedContacts(const btAlignedObjectArray<const btManifoldPoint*>& points, int* selected)
+{
+	int numPoints = points.size();
+	int i;
+	if (numPoints <= 4)
+	{
+		for (i=0;i<numPoints;i++)
+		{
+			selected[i] = i;
+		}
+		return numPoints;
+	}
+
+	int deepest = 0;
+	for (i=1;i<numPoints;i++)
+	{
+		if (points[i]->getDistance() < points[deepest]->getDistance())
+			deepest = i;
+	}
+	selected[0] = deepest;
+	const btVector3& p0 = points[deepest]->m_localPointA;
+
+	int farthest = -1;
+	btScalar maxDist2 = btScalar(0.);
+	for (i=0;i<numPoints;i++)
+	{
+		btScalar dist2 = (points[i]->m_localPointA-p0).length2();
+		if (dist2 > maxDist2)
+		{
+			maxDist2 = dist2;
+			farthest = i;
+		}
+	}
+	if (farthest < 0)
+		return 1;
+	selected[1] = farthest;
+	const btVector3& p1 = points[farthest]->m_localPointA;
+
+	int third = -1;
+	btScalar maxArea2 = btScalar(0.);
+	btVector3 normal(0,0,0);
+	for (i=0;i<numPoints;i++)
+	{
+		btVector3 n = (p1-p0).cross(points[i]->m_localPointA-p0);
+		btScalar area2 = n.length2();
+		if (area2 > maxArea2)
+		{
+			maxArea2 = area2;
+			normal = n;
+			third = i;
+		}
+	}
+	if (third < 0)
+		return 2;
+	selected[2] = third;
+	const btVector3& p2 = points[third]->m_localPointA;
+
+	//the last point adds the largest triangle on the outside of one of the edges of the first triangle
+	int fourth = -1;
+	btScalar maxArea = btScalar(0.);
+	for (i=0;i<numPoints;i++)
+	{
+		const btVector3& p = points[i]->m_localPointA;
+		btScalar area = btMax(btMax(-(p1-p0).cross(p-p0).dot(normal),-(p2-p1).cross(p-p1).dot(normal)),-(p0-p2).cross(p-p2).dot(normal));
+		if (area > maxArea)
+		{
+			maxArea = area;
+			fourth = i;
+		}
+	}
+	if (fourth < 0)
+		return 3;
+	selected[3] = fourth;
+	return 4;
+}
+
+void	btCompoundCompoundCollisionAlgorithm::reduceContacts()
+{
+	BT_PROFILE("btCompoundCompoundCollisionAlgorithm::reduceContacts");
+	int i,j;
+	m_reductionPoints.resize(0);
+	const btSimplePairArray& manifoldPairs = m_childManifoldCache->getOverlappingPairArray();
+	for (i=0;i<manifoldPairs.size();i++)
+	{
+		const btPersistentManifold* manifold = (const btPersistentManifold*)manifoldPairs[i].m_userPointer;
+		for (j=0;j<manifold->getNumContacts();j++)
+		{
+			m_reductionPoints.push_back(&manifold->getContactPoint(j));
+		}
+	}
+
+	int selected[4];
+	int numSelected = selectReducedContacts(m_reductionPoints,selected);
+	btAssert(numSelected <= MANIFOLD_CACHE_SIZE);
+
+	//the reduced manifold is updated in place, so contacts that stay close to a previous contact keep
+	//their impulses for warm starting, their lifetime and their user data
+	int numPrevious = m_sharedManifold->getNumContacts();
+	bool previousUsed[MANIFOLD_CACHE_SIZE];
+	for (i=0;i<numPrevious;i++)
+	{
+		previousUsed[i] = false;
+	}
+	int previousIndex[MANIFOLD_CACHE_SIZE];
+
+	btScalar breakingThreshold2 = m_sharedManifold->getContactBreakingThreshold()*m_sharedManifold->getContactBreakingThreshold();
+	for (i=0;i<numSelected;i++)
+	{
+		const btManifoldPoint& pt = *m_reductionPoints[selected[i]];
+		int nearest = -1;
+		btScalar shortestDist2 = breakingThreshold2;
+		for (j=0;j<numPrevious;j++)
+		{
+			btScalar dist2 = (m_sharedManifold->getContactPoint(j).m_localPointA-pt.m_localPointA).length2();
+			if (!previousUsed[j] && dist2 < shortestDist2)
+			{
+				shortestDist2 = dist2;
+				nearest = j;
+			}
+		}
+		if (nearest >= 0)
+		{
+			previousUsed[nearest] = true;
+		}
+		previousIndex[i] = nearest;
+	}
+
+	for (i=0;i<numSelected;i++)
+	{
+		if (previousIndex[i] >= 0)
+		{
+			m_sharedManifold->replaceContactPoint(*m_reductionPoints[selected[i]],previousIndex[i]);
+		}
+	}
+
+	//removeContactPoint moves the last contact into the removed slot, so remove from the back
+	for (j=numPrevious-1;j>=0;j--)
+	{
+		if (!previousUsed[j])
+		{
+			m_sharedManifold->removeContactPoint(j);
+		}
+	}
+
+	bool isNewCollision = m_sharedManifold->getNumContacts() == 0;
+	for (i=0;i<numSelected;i++)
+	{
+		if (previousIndex[i] < 0)
+		{
+			btManifoldPoint pt = *m_reductionPoints[selected[i]];
+			//the user data belongs to the contact in the child manifold
+			pt.m_userPersistentData = 0;
+			pt.m_appliedImpulse = btScalar(0.);
+			pt.m_appliedImpulseLateral1 = btScalar(0.);
+			pt.m_appliedImpulseLateral2 = btScalar(0.);
+			m_sharedManifold->addManifoldPoint(pt);
+		}
+	}
+	if (gContactStartedCallback && isNewCollision && m_sharedManifold->getNumContacts())
+	{
+		gContactStartedCallback(m_sharedManifold);
+	}
 }
 
 struct	btCompoundCompoundLeafCallback : btDbvt::ICollide
@@ -107,6 +331,7 @@ struct	btCompoundCompoundLeafCallback : btDbvt::ICollide
 	class btHashedSimplePairCache*	m_childCollisionAlgorithmCache;
 	
 	btPersistentManifold*	m_sharedManifold;
+	class btHashedSimplePairCache*	m_childManifoldCache;
 	
 	btCompoundCompoundLeafCallback (const btCollisionObjectWrapper* compound1ObjWrap,
 									const btCollisionObjectWrapper* compound0ObjWrap,
@@ -114,10 +339,12 @@ struct	btCompoundCompoundLeafCallback : btDbvt::ICollide
 									const btDispatcherInfo& dispatchInfo,
 									btManifoldResult*	resultOut,
 									btHashedSimplePairCache* childAlgorithmsCache,
-									btPersistentManifold*	sharedManifold)
+									btPersistentManifold*	sharedManifold,
+									btHashedSimplePairCache* childManifoldCache)
 		:m_numOverlapPairs(0),m_compound0ColObjWrap(compound1ObjWrap),m_compound1ColObjWrap(compound0ObjWrap),m_dispatcher(dispatcher),m_dispatchInfo(dispatchInfo),m_resultOut(resultOut),
 		m_childCollisionAlgorithmCache(childAlgorithmsCache),
-		m_sharedManifold(sharedManifold)
+		m_sharedManifold(sharedManifold),
+		m_childManifoldCache(childManifoldCache)
 	{
 
 	}
@@ -196,7 +423,14 @@ struct	btCompoundCompoundLeafCallback : btDbvt::ICollide
 				}
 				else
 				{
-					colAlgo = m_dispatcher->findAlgorithm(&compoundWrap0, &compoundWrap1, m_sharedManifold, BT_CONTACT_POINT_ALGORITHMS);
+					btPersistentManifold* childManifold = m_sharedManifold;
+					if (m_childManifoldCache)
+					{
+						childManifold = newChildManifold(m_sharedManifold);
+						btSimplePair* manifoldPair = m_childManifoldCache->addOverlappingPair(childIndex0, childIndex1);
+						manifoldPair->m_userPointer = childManifold;
+					}
+					colAlgo = m_dispatcher->findAlgorithm(&compoundWrap0, &compoundWrap1, childManifold, BT_CONTACT_POINT_ALGORITHMS);
 					pair = m_childCollisionAlgorithmCache->addOverlappingPair(childIndex0, childIndex1);
 					btAssert(pair);
 					pair->m_userPointer = colAlgo;
@@ -329,6 +563,8 @@ void btCompoundCompoundCollisionAlgorithm::processCollision (const btCollisionOb
 
 	}
 
+	setReduceContacts(dispatchInfo.m_reduceCompoundCompoundContacts,body0Wrap,body1Wrap);
+
 
 	///we need to refresh all contact manifolds
 	///note that we should actually recursively traverse all children, btCompoundShape can nested more then 1 level deep
@@ -359,12 +595,32 @@ void btCompoundCompoundCollisionAlgorithm::processCollision (const btCollisionOb
 				manifoldArray.resize(0);
 			}
 		}
+
+		btSimplePairArray& manifoldPairs = m_childManifoldCache->getOverlappingPairArray();
+		for (i=0;i<manifoldPairs.size();i++)
+		{
+			btPersistentManifold* manifold = (btPersistentManifold*)manifoldPairs[i].m_userPointer;
+			if (manifold->getNumContacts())
+			{
+				resultOut->setPersistentManifold(manifold);
+				resultOut->refreshContactPoints();
+				resultOut->setPersistentManifold(0);
+			}
+		}
+
+		//the reduced manifold is refreshed like any other manifold, before its contacts are matched with the new child contacts
+		if (m_ownsManifold && m_sharedManifold->getNumContacts())
+		{
+			resultOut->setPersistentManifold(m_sharedManifold);
+			resultOut->refreshContactPoints();
+			resultOut->setPersistentManifold(0);
+		}
 	}
 
 
 	
 
-	btCompoundCompoundLeafCallback callback(col0ObjWrap,col1ObjWrap,this->m_dispatcher,dispatchInfo,resultOut,this->m_childCollisionAlgorithmCache,m_sharedManifold);
+	btCompoundCompoundLeafCallback callback(col0ObjWrap,col1ObjWrap,this->m_dispatcher,dispatchInfo,resultOut,this->m_childCollisionAlgorithmCache,m_sharedManifold,m_ownsManifold? m_childManifoldCache : 0);
 
 
 	const btTransform	xform=col0ObjWrap->getWorldTransform().inverse()*col1ObjWrap->getWorldTransform();
@@ -431,10 +687,20 @@ void btCompoundCompoundCollisionAlgorithm::processCollision (const btCollisionOb
 		for (int i=0;i<m_removePairs.size();i++)
 		{
 			m_childCollisionAlgorithmCache->removeOverlappingPair(m_removePairs[i].m_indexA,m_removePairs[i].m_indexB);
+			btPersistentManifold* childManifold = (btPersistentManifold*)m_childManifoldCache->removeOverlappingPair(m_removePairs[i].m_indexA,m_removePairs[i].m_indexB);
+			if (childManifold)
+			{
+				deleteChildManifold(childManifold);
+			}
 		}
 		m_removePairs.clear();
 	}
 
+	if (m_ownsManifold)
+	{
+		reduceContacts();
+	}
+
 }
 
 btScalar	btCompoundCompoundCollisionAlgorithm::calculateTimeOfImpact(btCollisionObject* body0,btCollisionObject* body1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
@@ -35,17 +35,26 @@ class btCollisionObject;
 class btCollisionShape;
 
 /// btCompoundCompoundCollisionAlgorithm  supports collision between two btCompoundCollisionShape shapes
+/// By default each overlapping child pair reports its contacts in its own manifold. When btDispatcherInfo::m_reduceCompoundCompoundContacts
+/// is set, the child pairs keep their contacts in private manifolds that are not seen by the solver, and after each collision
+/// the deepest contact and the contacts that span the largest area are copied into a single manifold for the compound pair.
 class btCompoundCompoundCollisionAlgorithm  : public btCompoundCollisionAlgorithm
 {
 
 	class btHashedSimplePairCache*	m_childCollisionAlgorithmCache;
+	class btHashedSimplePairCache*	m_childManifoldCache;//private manifolds of the child pairs, only used when the contacts are reduced
 	btSimplePairArray m_removePairs;
+	btAlignedObjectArray<const btManifoldPoint*>	m_reductionPoints;
 
 
 	int	m_compoundShapeRevision0;//to keep track of changes, so that childAlgorithm array can be updated
 	int	m_compoundShapeRevision1;
 	
 	void	removeChildAlgorithms();
+
+	void	setReduceContacts(bool reduceContacts, const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap);
+
+	void	reduceContacts();
 	
 //	void	preallocateChildAlgorithms(const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap);
 
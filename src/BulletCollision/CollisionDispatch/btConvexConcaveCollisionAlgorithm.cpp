@@ -93,11 +93,6 @@ partId, int triangleIndex)
 
 
 
-	btCollisionAlgorithmConstructionInfo ci;
-	ci.m_dispatcher1 = m_dispatcher;
-
-
-
 #if 0	
 	
 	///debug drawing of the overlapping triangles
@@ -119,47 +114,87 @@ partId, int triangleIndex)
 		
 		
 		btCollisionObjectWrapper triObWrap(m_triBodyWrap,&tm,m_triBodyWrap->getCollisionObject(),m_triBodyWrap->getWorldTransform(),partId,triangleIndex);//correct transform?
-		btCollisionAlgorithm* colAlgo = 0;
-		
-		if (m_resultOut->m_closestPointDistanceThreshold > 0)
-		{
-			colAlgo = ci.m_dispatcher1->findAlgorithm(m_convexBodyWrap, &triObWrap, 0, BT_CLOSEST_POINT_ALGORITHMS);
-		}
-		else
-		{
-			colAlgo = ci.m_dispatcher1->findAlgorithm(m_convexBodyWrap, &triObWrap, m_manifoldPtr, BT_CONTACT_POINT_ALGORITHMS);
-		}
-		const btCollisionObjectWrapper* tmpWrap = 0;
+		btCollisionAlgorithm* colAlgo = findTriangleAlgorithm(&triObWrap);
+		processTriangleCollision(colAlgo,&triObWrap,partId,triangleIndex);
+		colAlgo->~btCollisionAlgorithm();
+		m_dispatcher->freeCollisionAlgorithm(colAlgo);
+	}
+
+}
 
-		if (m_resultOut->getBody0Internal() == m_triBodyWrap->getCollisionObject())
+
+void btConvexTriangleCallback::processTriangles(btVector3* triangles, const int* partIds, const int* triangleIndices, int numTriangles)
+{
+	BT_PROFILE("btConvexTriangleCallback::processTriangles");
+
+	if (!m_convexBodyWrap->getCollisionShape()->isConvex())
+	{
+		return;
+	}
+
+	///the algorithm only depends on the shape types, and the convex-triangle algorithms keep no state
+	///between calls other than the shared manifold, so one algorithm serves all triangles of the batch
+	btCollisionAlgorithm* colAlgo = 0;
+	for (int i=0;i<numTriangles;i++)
+	{
+		btVector3* triangle = &triangles[i*3];
+		if (!TestTriangleAgainstAabb2(triangle, m_aabbMin, m_aabbMax))
 		{
-			tmpWrap = m_resultOut->getBody0Wrap();
-			m_resultOut->setBody0Wrap(&triObWrap);
-			m_resultOut->setShapeIdentifiersA(partId,triangleIndex);
+			continue;
 		}
-		else
+		btTriangleShape tm(triangle[0],triangle[1],triangle[2]);
+		tm.setMargin(m_collisionMarginTriangle);
+		btCollisionObjectWrapper triObWrap(m_triBodyWrap,&tm,m_triBodyWrap->getCollisionObject(),m_triBodyWrap->getWorldTransform(),partIds[i],triangleIndices[i]);
+		if (!colAlgo)
 		{
-			tmpWrap = m_resultOut->getBody1Wrap();
-			m_resultOut->setBody1Wrap(&triObWrap);
-			m_resultOut->setShapeIdentifiersB(partId,triangleIndex);
+			colAlgo = findTriangleAlgorithm(&triObWrap);
 		}
-	
-		colAlgo->processCollision(m_convexBodyWrap,&triObWrap,*m_dispatchInfoPtr,m_resultOut);
+		processTriangleCollision(colAlgo,&triObWrap,partIds[i],triangleIndices[i]);
+	}
+	if (colAlgo)
+	{
+		colAlgo->~btCollisionAlgorithm();
+		m_dispatcher->freeCollisionAlgorithm(colAlgo);
+	}
+}
 
-		if (m_resultOut->getBody0Internal() == m_triBodyWrap->getCollisionObject())
-		{
-			m_resultOut->setBody0Wrap(tmpWrap);
-		} else
-		{
-			m_resultOut->setBody1Wrap(tmpWrap);
-		}
+
+btCollisionAlgorithm* btConvexTriangleCallback::findTriangleAlgorithm(const btCollisionObjectWrapper* triObWrap)
+{
+	if (m_resultOut->m_closestPointDistanceThreshold > 0)
+	{
+		return m_dispatcher->findAlgorithm(m_convexBodyWrap, triObWrap, 0, BT_CLOSEST_POINT_ALGORITHMS);
+	}
+	return m_dispatcher->findAlgorithm(m_convexBodyWrap, triObWrap, m_manifoldPtr, BT_CONTACT_POINT_ALGORITHMS);
+}
 
 
+void btConvexTriangleCallback::processTriangleCollision(btCollisionAlgorithm* colAlgo,const btCollisionObjectWrapper* triObWrap,int partId,int triangleIndex)
+{
+	const btCollisionObjectWrapper* tmpWrap = 0;
 
-		colAlgo->~btCollisionAlgorithm();
-		ci.m_dispatcher1->freeCollisionAlgorithm(colAlgo);
+	if (m_resultOut->getBody0Internal() == m_triBodyWrap->getCollisionObject())
+	{
+		tmpWrap = m_resultOut->getBody0Wrap();
+		m_resultOut->setBody0Wrap(triObWrap);
+		m_resultOut->setShapeIdentifiersA(partId,triangleIndex);
 	}
+	else
+	{
+		tmpWrap = m_resultOut->getBody1Wrap();
+		m_resultOut->setBody1Wrap(triObWrap);
+		m_resultOut->setShapeIdentifiersB(partId,triangleIndex);
+	}
+
+	colAlgo->processCollision(m_convexBodyWrap,triObWrap,*m_dispatchInfoPtr,m_resultOut);
 
+	if (m_resultOut->getBody0Internal() == m_triBodyWrap->getCollisionObject())
+	{
+		m_resultOut->setBody0Wrap(tmpWrap);
+	} else
+	{
+		m_resultOut->setBody1Wrap(tmpWrap);
+	}
 }
 
 
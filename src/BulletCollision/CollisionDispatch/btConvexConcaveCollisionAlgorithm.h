@@ -41,6 +41,9 @@ ATTRIBUTE_ALIGNED16(class)  btConvexTriangleCallback : public btTriangleCallback
 	btDispatcher*	m_dispatcher;
 	const btDispatcherInfo* m_dispatchInfoPtr;
 	btScalar m_collisionMarginTriangle;
+
+	btCollisionAlgorithm*	findTriangleAlgorithm(const btCollisionObjectWrapper* triObWrap);
+	void	processTriangleCollision(btCollisionAlgorithm* colAlgo,const btCollisionObjectWrapper* triObWrap,int partId,int triangleIndex);
 	
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
@@ -61,6 +64,9 @@ int	m_triangleCount;
 	virtual ~btConvexTriangleCallback();
 
 	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex);
+
+	///finds the collision algorithm once and reuses it for all triangles in the batch
+	virtual void processTriangles(btVector3* triangles, const int* partIds, const int* triangleIndices, int numTriangles);
 	
 	void clearCache();
 
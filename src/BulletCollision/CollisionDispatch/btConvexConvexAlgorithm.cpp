@@ -28,6 +28,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionShapes/btConvexShape.h"
 #include "BulletCollision/CollisionShapes/btCapsuleShape.h"
 #include "BulletCollision/CollisionShapes/btTriangleShape.h"
+#include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 
 
 
@@ -225,62 +226,6 @@ void	btConvexConvexAlgorithm ::setLowLevelOfDetail(bool useLowLevel)
 }
 
 
-struct btPerturbedContactResult : public btManifoldResult
-{
-	btManifoldResult* m_originalManifoldResult;
-	btTransform m_transformA;
-	btTransform m_transformB;
-	btTransform	m_unPerturbedTransform;
-	bool	m_perturbA;
-	btIDebugDraw*	m_debugDrawer;
-
-
-	btPerturbedContactResult(btManifoldResult* originalResult,const btTransform& transformA,const btTransform& transformB,const btTransform& unPerturbedTransform,bool perturbA,btIDebugDraw* debugDrawer)
-		:m_originalManifoldResult(originalResult),
-		m_transformA(transformA),
-		m_transformB(transformB),
-		m_unPerturbedTransform(unPerturbedTransform),
-		m_perturbA(perturbA),
-		m_debugDrawer(debugDrawer)
-	{
-	}
-	virtual ~ btPerturbedContactResult()
-	{
-	}
-
-	virtual void addContactPoint(const btVector3& normalOnBInWorld,const btVector3& pointInWorld,btScalar orgDepth)
-	{
-		btVector3 endPt,startPt;
-		btScalar newDepth;
-		btVector3 newNormal;
-
-		if (m_perturbA)
-		{
-			btVector3 endPtOrg = pointInWorld + normalOnBInWorld*orgDepth;
-			endPt = (m_unPerturbedTransform*m_transformA.inverse())(endPtOrg);
-			newDepth = (endPt -  pointInWorld).dot(normalOnBInWorld);
-			startPt = endPt - normalOnBInWorld*newDepth;
-		} else
-		{
-			endPt = pointInWorld + normalOnBInWorld*orgDepth;
-			startPt = (m_unPerturbedTransform*m_transformB.inverse())(pointInWorld);
-			newDepth = (endPt -  startPt).dot(normalOnBInWorld);
-			
-		}
-
-//#define DEBUG_CONTACTS 1
-#ifdef DEBUG_CONTACTS
-		m_debugDrawer->drawLine(startPt,endPt,btVector3(1,0,0));
-		m_debugDrawer->drawSphere(startPt,0.05,btVector3(0,1,0));
-		m_debugDrawer->drawSphere(endPt,0.05,btVector3(0,0,1));
-#endif //DEBUG_CONTACTS
-
-		
-		m_originalManifoldResult->addContactPoint(normalOnBInWorld,startPt,newDepth);
-	}
-
-};
-
 extern btScalar gContactBreakingThreshold;
 
 
@@ -510,11 +455,15 @@ void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper*
 
 			if (dispatchInfo.m_enableSatConvex)
 			{
+				//the tolerances scale with the size of the hulls
+				btScalar hullRadius = btMin(polyhedronA->getConvexPolyhedron()->m_radius,polyhedronB->getConvexPolyhedron()->m_radius);
+				m_separatingFeatureCache.m_maxRelativeTranslation = dispatchInfo.m_satFeatureCacheTolerance * hullRadius;
+				m_separatingFeatureCache.m_maxRelativeRotation = dispatchInfo.m_satFeatureCacheTolerance;
 				foundSepAxis = btPolyhedralContactClipping::findSeparatingAxis(
 					*polyhedronA->getConvexPolyhedron(), *polyhedronB->getConvexPolyhedron(),
 					body0Wrap->getWorldTransform(), 
 					body1Wrap->getWorldTransform(),
-					sepNormalWorldSpace,*resultOut);
+					sepNormalWorldSpace,*resultOut,&m_separatingFeatureCache);
 			} else
 			{
 #ifdef ZERO_MARGIN
@@ -0,0 +1,106 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btConvexConvexSpecializedAlgorithm.h"
+
+
+typedef btCollisionAlgorithm* (*btSpecializedCreateFunc)(const btConvexConvexAlgorithm::CreateFunc& createFunc, btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap);
+
+template <typename btShapeTypeA, typename btShapeTypeB>
+static btCollisionAlgorithm* createSpecializedAlgorithm(const btConvexConvexAlgorithm::CreateFunc& createFunc, btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap)
+{
+	void* mem = ci.m_dispatcher1->allocateCollisionAlgorithm(sizeof(btConvexConvexSpecializedAlgorithm<btShapeTypeA,btShapeTypeB>));
+	return new(mem) btConvexConvexSpecializedAlgorithm<btShapeTypeA,btShapeTypeB>(ci.m_manifold,ci,body0Wrap,body1Wrap,createFunc.m_pdSolver,createFunc.m_numPerturbationIterations,createFunc.m_minimumPointsPerturbationThreshold);
+}
+
+enum btSpecializedShapeIndex
+{
+	BT_SPECIALIZED_BOX,
+	BT_SPECIALIZED_SPHERE,
+	BT_SPECIALIZED_CAPSULE,
+	BT_SPECIALIZED_CYLINDER,
+	BT_SPECIALIZED_CONVEX_HULL,
+	BT_SPECIALIZED_NUM_SHAPES
+};
+
+static int getSpecializedShapeIndex(int shapeType)
+{
+	switch (shapeType)
+	{
+	case BOX_SHAPE_PROXYTYPE:
+		return BT_SPECIALIZED_BOX;
+	case SPHERE_SHAPE_PROXYTYPE:
+		return BT_SPECIALIZED_SPHERE;
+	case CAPSULE_SHAPE_PROXYTYPE:
+		return BT_SPECIALIZED_CAPSULE;
+	case CYLINDER_SHAPE_PROXYTYPE:
+		return BT_SPECIALIZED_CYLINDER;
+	case CONVEX_HULL_SHAPE_PROXYTYPE:
+		return BT_SPECIALIZED_CONVEX_HULL;
+	default:
+		return -1;
+	}
+}
+
+///capsule-capsule, capsule-sphere and sphere-capsule pairs are left to the analytic code in btConvexConvexAlgorithm
+static const btSpecializedCreateFunc gSpecializedCreateFuncs[BT_SPECIALIZED_NUM_SHAPES][BT_SPECIALIZED_NUM_SHAPES] =
+{
+	{
+		&createSpecializedAlgorithm<btBoxShape,btBoxShape>,
+		&createSpecializedAlgorithm<btBoxShape,btSphereShape>,
+		&createSpecializedAlgorithm<btBoxShape,btCapsuleShape>,
+		&createSpecializedAlgorithm<btBoxShape,btCylinderShape>,
+		&createSpecializedAlgorithm<btBoxShape,btConvexHullShape>
+	},
+	{
+		&createSpecializedAlgorithm<btSphereShape,btBoxShape>,
+		&createSpecializedAlgorithm<btSphereShape,btSphereShape>,
+		0,
+		&createSpecializedAlgorithm<btSphereShape,btCylinderShape>,
+		&createSpecializedAlgorithm<btSphereShape,btConvexHullShape>
+	},
+	{
+		&createSpecializedAlgorithm<btCapsuleShape,btBoxShape>,
+		0,
+		0,
+		&createSpecializedAlgorithm<btCapsuleShape,btCylinderShape>,
+		&createSpecializedAlgorithm<btCapsuleShape,btConvexHullShape>
+	},
+	{
+		&createSpecializedAlgorithm<btCylinderShape,btBoxShape>,
+		&createSpecializedAlgorithm<btCylinderShape,btSphereShape>,
+		&createSpecializedAlgorithm<btCylinderShape,btCapsuleShape>,
+		&createSpecializedAlgorithm<btCylinderShape,btCylinderShape>,
+		&createSpecializedAlgorithm<btCylinderShape,btConvexHullShape>
+	},
+	{
+		&createSpecializedAlgorithm<btConvexHullShape,btBoxShape>,
+		&createSpecializedAlgorithm<btConvexHullShape,btSphereShape>,
+		&createSpecializedAlgorithm<btConvexHullShape,btCapsuleShape>,
+		&createSpecializedAlgorithm<btConvexHullShape,btCylinderShape>,
+		&createSpecializedAlgorithm<btConvexHullShape,btConvexHullShape>
+	}
+};
+
+btCollisionAlgorithm* btConvexConvexSpecializedCreateFunc::CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap)
+{
+	int index0 = getSpecializedShapeIndex(body0Wrap->getCollisionShape()->getShapeType());
+	int index1 = getSpecializedShapeIndex(body1Wrap->getCollisionShape()->getShapeType());
+	if (index0 >= 0 && index1 >= 0 && gSpecializedCreateFuncs[index0][index1])
+	{
+		return gSpecializedCreateFuncs[index0][index1](*this,ci,body0Wrap,body1Wrap);
+	}
+	return btConvexConvexAlgorithm::CreateFunc::CreateCollisionAlgorithm(ci,body0Wrap,body1Wrap);
+}
@@ -0,0 +1,296 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_CONVEX_CONVEX_SPECIALIZED_ALGORITHM_H
+#define BT_CONVEX_CONVEX_SPECIALIZED_ALGORITHM_H
+
+#include "btConvexConvexAlgorithm.h"
+#include "btCollisionObjectWrapper.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btCapsuleShape.h"
+#include "BulletCollision/CollisionShapes/btCylinderShape.h"
+#include "BulletCollision/CollisionShapes/btConvexHullShape.h"
+#include "BulletCollision/NarrowPhaseCollision/btComputeGjkEpaPenetration.h"
+
+extern btScalar gContactBreakingThreshold;
+extern btScalar gGjkEpaPenetrationTolerance;
+
+///btGjkShapeWrap describes a convex shape and its world transform to the templated GJK and EPA of btComputeGjkEpaPenetration.h.
+///The supporting vertex is computed inline for each primitive, without the virtual call or the shape type switch
+///of btConvexShape::localGetSupportVertexWithoutMarginNonVirtual.
+template <typename btShapeType>
+struct btGjkShapeWrap
+{
+	const btShapeType*	m_shape;
+	btTransform			m_worldTrans;
+	btScalar			m_margin;
+
+	btGjkShapeWrap(const btShapeType* shape, const btTransform& worldTrans)
+		:m_shape(shape),
+		m_worldTrans(worldTrans),
+		m_margin(shape->getMarginNonVirtual())
+	{
+	}
+
+	SIMD_FORCE_INLINE btScalar getMargin() const
+	{
+		return m_margin;
+	}
+	SIMD_FORCE_INLINE btVector3 getObjectCenterInWorld() const
+	{
+		return m_worldTrans.getOrigin();
+	}
+	SIMD_FORCE_INLINE const btTransform& getWorldTransform() const
+	{
+		return m_worldTrans;
+	}
+	SIMD_FORCE_INLINE btVector3 getLocalSupportWithMargin(const btVector3& dir) const
+	{
+		btVector3 dirNorm = dir;
+		if (dirNorm.length2() < (SIMD_EPSILON*SIMD_EPSILON))
+		{
+			dirNorm.setValue(btScalar(-1.),btScalar(-1.),btScalar(-1.));
+		}
+		dirNorm.normalize();
+		return getLocalSupportWithoutMargin(dirNorm) + m_margin * dirNorm;
+	}
+	SIMD_FORCE_INLINE btVector3 getLocalSupportWithoutMargin(const btVector3& dir) const;
+};
+
+template <>
+SIMD_FORCE_INLINE btVector3 btGjkShapeWrap<btSphereShape>::getLocalSupportWithoutMargin(const btVector3& dir) const
+{
+	(void)dir;
+	return btVector3(0,0,0);
+}
+
+template <>
+SIMD_FORCE_INLINE btVector3 btGjkShapeWrap<btBoxShape>::getLocalSupportWithoutMargin(const btVector3& dir) const
+{
+	const btVector3& halfExtents = m_shape->getImplicitShapeDimensions();
+	return btVector3(btFsels(dir.x(), halfExtents.x(), -halfExtents.x()),
+		btFsels(dir.y(), halfExtents.y(), -halfExtents.y()),
+		btFsels(dir.z(), halfExtents.z(), -halfExtents.z()));
+}
+
+template <>
+SIMD_FORCE_INLINE btVector3 btGjkShapeWrap<btCapsuleShape>::getLocalSupportWithoutMargin(const btVector3& dir) const
+{
+	int upAxis = m_shape->getUpAxis();
+	btScalar halfHeight = m_shape->getHalfHeight();
+	btVector3 supVec(0,0,0);
+	supVec[upAxis] = dir[upAxis] < btScalar(0.) ? -halfHeight : halfHeight;
+	return supVec;
+}
+
+template <>
+SIMD_FORCE_INLINE btVector3 btGjkShapeWrap<btCylinderShape>::getLocalSupportWithoutMargin(const btVector3& dir) const
+{
+	//mapping of halfextents/dimension onto radius/height depends on how cylinder local orientation is (upAxis)
+	const btVector3& halfExtents = m_shape->getImplicitShapeDimensions();
+	int upAxis = m_shape->getUpAxis();
+	int XX = upAxis == 0 ? 1 : 0;
+	int ZZ = upAxis == 2 ? 1 : 2;
+	btScalar radius = halfExtents[XX];
+	btScalar halfHeight = halfExtents[upAxis];
+
+	btVector3 supVec;
+	btScalar s = btSqrt(dir[XX] * dir[XX] + dir[ZZ] * dir[ZZ]);
+	if (s != btScalar(0.0))
+	{
+		btScalar d = radius / s;
+		supVec[XX] = dir[XX] * d;
+		supVec[ZZ] = dir[ZZ] * d;
+	} else
+	{
+		supVec[XX] = radius;
+		supVec[ZZ] = btScalar(0.0);
+	}
+	supVec[upAxis] = dir[upAxis] < btScalar(0.0) ? -halfHeight : halfHeight;
+	return supVec;
+}
+
+template <>
+SIMD_FORCE_INLINE btVector3 btGjkShapeWrap<btConvexHullShape>::getLocalSupportWithoutMargin(const btVector3& dir) const
+{
+	const btVector3& localScaling = m_shape->getLocalScalingNV();
+	const btVector3* points = m_shape->getUnscaledPoints();
+	btVector3 vec = dir * localScaling;
+	btScalar maxDot;
+	long ptIndex = vec.maxDot(points, m_shape->getNumPoints(), maxDot);
+	btAssert(ptIndex >= 0);
+	if (ptIndex<0)
+	{
+		ptIndex = 0;
+	}
+	return points[ptIndex] * localScaling;
+}
+
+struct btGjkDistanceInfo
+{
+	btVector3	m_pointOnA;
+	btVector3	m_pointOnB;
+	btVector3	m_normalBtoA;
+	btScalar	m_distance;
+};
+
+///btConvexConvexSpecializedAlgorithm is a btConvexConvexAlgorithm for a fixed pair of primitive shape types.
+///It runs the templated GJK and EPA of btComputeGjkEpaPenetration.h instantiated for btGjkShapeWrap<btShapeTypeA>
+///and btGjkShapeWrap<btShapeTypeB>, so all support functions are inlined. Otherwise it behaves like btGjkPairDetector with
+///the btGjkEpaPenetrationDepthSolver, except that GJK starts from the direction between the shape centers, and the
+///multipoint perturbation only runs when the unperturbed query found a contact. No state is kept between queries,
+///so the contacts only depend on the current transforms, like those of btConvexConvexAlgorithm. Polyhedral pairs that have polyhedral
+///features use the separating axis test and clipping of btConvexConvexAlgorithm.
+///btConvexConvexSpecializedCreateFunc creates the instantiations for boxes, spheres, capsules, cylinders and convex hulls.
+template <typename btShapeTypeA, typename btShapeTypeB>
+class btConvexConvexSpecializedAlgorithm : public btConvexConvexAlgorithm
+{
+public:
+
+	btConvexConvexSpecializedAlgorithm(btPersistentManifold* mf,const btCollisionAlgorithmConstructionInfo& ci,const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap, btConvexPenetrationDepthSolver* pdSolver, int numPerturbationIterations, int minimumPointsPerturbationThreshold)
+		:btConvexConvexAlgorithm(mf,ci,body0Wrap,body1Wrap,pdSolver,numPerturbationIterations,minimumPointsPerturbationThreshold)
+	{
+	}
+
+	virtual void processCollision (const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
+	{
+		const btShapeTypeA* shape0 = static_cast<const btShapeTypeA*>(body0Wrap->getCollisionShape());
+		const btShapeTypeB* shape1 = static_cast<const btShapeTypeB*>(body1Wrap->getCollisionShape());
+
+		if (shape0->isPolyhedral() && shape1->isPolyhedral() &&
+			static_cast<const btPolyhedralConvexShape*>(body0Wrap->getCollisionShape())->getConvexPolyhedron() &&
+			static_cast<const btPolyhedralConvexShape*>(body1Wrap->getCollisionShape())->getConvexPolyhedron())
+		{
+			btConvexConvexAlgorithm::processCollision(body0Wrap,body1Wrap,dispatchInfo,resultOut);
+			return;
+		}
+
+		if (!m_manifoldPtr)
+		{
+			//swapped?
+			m_manifoldPtr = m_dispatcher->getNewManifold(body0Wrap->getCollisionObject(),body1Wrap->getCollisionObject());
+			m_ownManifold = true;
+		}
+		resultOut->setPersistentManifold(m_manifoldPtr);
+
+		const btTransform& transA = body0Wrap->getWorldTransform();
+		const btTransform& transB = body1Wrap->getWorldTransform();
+
+		//like btGjkPairDetector, move the origin between both objects to improve precision far from the world origin
+		btVector3 positionOffset = (transA.getOrigin() + transB.getOrigin()) * btScalar(0.5);
+		btGjkShapeWrap<btShapeTypeA> a(shape0,transA);
+		btGjkShapeWrap<btShapeTypeB> b(shape1,transB);
+		a.m_worldTrans.getOrigin() -= positionOffset;
+		b.m_worldTrans.getOrigin() -= positionOffset;
+
+		btGjkCollisionDescription colDesc;
+		//the separating axis points from B to A, the center difference is a good first guess for it
+		btVector3 centerDelta = transA.getOrigin() - transB.getOrigin();
+		if (centerDelta.length2() > SIMD_EPSILON)
+		{
+			colDesc.m_firstDir = centerDelta;
+		}
+		btScalar maximumDistance = a.getMargin() + b.getMargin() + m_manifoldPtr->getContactBreakingThreshold() + resultOut->m_closestPointDistanceThreshold;
+		colDesc.m_maximumDistanceSquared = maximumDistance * maximumDistance;
+#ifdef BT_USE_DOUBLE_PRECISION
+		colDesc.m_gjkRelError2 = btScalar(1.0e-12);
+#endif
+		colDesc.m_penetrationTolerance = gGjkEpaPenetrationTolerance;
+
+		btVoronoiSimplexSolver simplexSolver;
+		btGjkDistanceInfo distInfo;
+		if (btComputeGjkEpaPenetration(a,b,colDesc,simplexSolver,&distInfo) == 0)
+		{
+			resultOut->addContactPoint(distInfo.m_normalBtoA,distInfo.m_pointOnB + positionOffset,distInfo.m_distance);
+
+			//perform 'm_numPerturbationIterations' collision queries with the perturbated collision objects,
+			//see btConvexConvexAlgorithm::processCollision
+			if (m_numPerturbationIterations && resultOut->getPersistentManifold()->getNumContacts() < m_minimumPointsPerturbationThreshold)
+			{
+				btVector3 sepNormalWorldSpace = distInfo.m_normalBtoA;
+				btVector3 v0,v1;
+				btPlaneSpace1(sepNormalWorldSpace,v0,v1);
+
+				bool perturbeA = true;
+				const btScalar angleLimit = 0.125f * SIMD_PI;
+				btScalar perturbeAngle;
+				btScalar radiusA = shape0->getAngularMotionDisc();
+				btScalar radiusB = shape1->getAngularMotionDisc();
+				if (radiusA < radiusB)
+				{
+					perturbeAngle = gContactBreakingThreshold /radiusA;
+					perturbeA = true;
+				} else
+				{
+					perturbeAngle = gContactBreakingThreshold / radiusB;
+					perturbeA = false;
+				}
+				if ( perturbeAngle > angleLimit )
+						perturbeAngle = angleLimit;
+
+				if (v0.length2()>SIMD_EPSILON)
+				{
+					btQuaternion perturbeRot(v0,perturbeAngle);
+					for (int i=0;i<m_numPerturbationIterations;i++)
+					{
+						btScalar iterationAngle = i*(SIMD_2_PI/btScalar(m_numPerturbationIterations));
+						btQuaternion rotq(sepNormalWorldSpace,iterationAngle);
+						btMatrix3x3 perturbeBasis(rotq.inverse()*perturbeRot*rotq);
+
+						btTransform perturbedTransA = transA;
+						btTransform perturbedTransB = transB;
+						if (perturbeA)
+						{
+							perturbedTransA.setBasis(perturbeBasis*transA.getBasis());
+						} else
+						{
+							perturbedTransB.setBasis(perturbeBasis*transB.getBasis());
+						}
+						a.m_worldTrans.setBasis(perturbedTransA.getBasis());
+						b.m_worldTrans.setBasis(perturbedTransB.getBasis());
+
+						btPerturbedContactResult perturbedResultOut(resultOut,perturbedTransA,perturbedTransB,perturbeA ? transA : transB,perturbeA,dispatchInfo.m_debugDraw);
+						if (btComputeGjkEpaPenetration(a,b,colDesc,simplexSolver,&distInfo) == 0)
+						{
+							perturbedResultOut.addContactPoint(distInfo.m_normalBtoA,distInfo.m_pointOnB + positionOffset,distInfo.m_distance);
+						}
+					}
+				}
+			}
+		}
+
+		if (m_ownManifold)
+		{
+			resultOut->refreshContactPoints();
+		}
+	}
+};
+
+///btConvexConvexSpecializedCreateFunc creates a btConvexConvexSpecializedAlgorithm for pairs of boxes, spheres, capsules,
+///cylinders and convex hulls, and a btConvexConvexAlgorithm for all other convex pairs and for capsule-capsule and
+///capsule-sphere pairs, which btConvexConvexAlgorithm handles analytically.
+///btDefaultCollisionConfiguration uses it for convex pairs when the EPA penetration solver is enabled.
+struct btConvexConvexSpecializedCreateFunc : public btConvexConvexAlgorithm::CreateFunc
+{
+	btConvexConvexSpecializedCreateFunc(btConvexPenetrationDepthSolver* pdSolver)
+		:btConvexConvexAlgorithm::CreateFunc(pdSolver)
+	{
+	}
+
+	virtual	btCollisionAlgorithm* CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap);
+};
+
+#endif //BT_CONVEX_CONVEX_SPECIALIZED_ALGORITHM_H
@@ -16,6 +16,7 @@ subject to the following restrictions:
 #include "btDefaultCollisionConfiguration.h"
 
 #include "BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h"
+#include "BulletCollision/CollisionDispatch/btConvexConvexSpecializedAlgorithm.h"
 #include "BulletCollision/CollisionDispatch/btEmptyCollisionAlgorithm.h"
 #include "BulletCollision/CollisionDispatch/btConvexConcaveCollisionAlgorithm.h"
 #include "BulletCollision/CollisionDispatch/btCompoundCollisionAlgorithm.h"
@@ -56,8 +57,16 @@ btDefaultCollisionConfiguration::btDefaultCollisionConfiguration(const btDefault
 	}
 	
 	//default CreationFunctions, filling the m_doubleDispatch table
-	mem = btAlignedAlloc(sizeof(btConvexConvexAlgorithm::CreateFunc),16);
-	m_convexConvexCreateFunc = new(mem) btConvexConvexAlgorithm::CreateFunc(m_pdSolver);
+	if (constructionInfo.m_useEpaPenetrationAlgorithm && constructionInfo.m_useSpecializedConvexConvexAlgorithms)
+	{
+		//the specialized algorithms instantiate the templated GJK and EPA for pairs of primitive shapes
+		mem = btAlignedAlloc(sizeof(btConvexConvexSpecializedCreateFunc),16);
+		m_convexConvexCreateFunc = new(mem) btConvexConvexSpecializedCreateFunc(m_pdSolver);
+	} else
+	{
+		mem = btAlignedAlloc(sizeof(btConvexConvexAlgorithm::CreateFunc),16);
+		m_convexConvexCreateFunc = new(mem) btConvexConvexAlgorithm::CreateFunc(m_pdSolver);
+	}
 	mem = btAlignedAlloc(sizeof(btConvexConcaveCollisionAlgorithm::CreateFunc),16);
 	m_convexConcaveCreateFunc = new (mem)btConvexConcaveCollisionAlgorithm::CreateFunc;
 	mem = btAlignedAlloc(sizeof(btConvexConcaveCollisionAlgorithm::CreateFunc),16);
@@ -104,11 +113,13 @@ btDefaultCollisionConfiguration::btDefaultCollisionConfiguration(const btDefault
 	int maxSize2 = sizeof(btConvexConcaveCollisionAlgorithm);
 	int maxSize3 = sizeof(btCompoundCollisionAlgorithm);
 	int maxSize4 = sizeof(btCompoundCompoundCollisionAlgorithm);
+	int maxSize5 = sizeof(btConvexConvexSpecializedAlgorithm<btBoxShape,btBoxShape>);
 
 	int	collisionAlgorithmMaxElementSize = btMax(maxSize,constructionInfo.m_customCollisionAlgorithmMaxElementSize);
 	collisionAlgorithmMaxElementSize = btMax(collisionAlgorithmMaxElementSize,maxSize2);
 	collisionAlgorithmMaxElementSize = btMax(collisionAlgorithmMaxElementSize,maxSize3);
 	collisionAlgorithmMaxElementSize = btMax(collisionAlgorithmMaxElementSize,maxSize4);
+	collisionAlgorithmMaxElementSize = btMax(collisionAlgorithmMaxElementSize,maxSize5);
 		
 	if (constructionInfo.m_persistentManifoldPool)
 	{
@@ -28,6 +28,8 @@ struct	btDefaultCollisionConstructionInfo
 	int					m_defaultMaxCollisionAlgorithmPoolSize;
 	int					m_customCollisionAlgorithmMaxElementSize;
 	int					m_useEpaPenetrationAlgorithm;
+	///use btConvexConvexSpecializedAlgorithm for pairs of primitive convex shapes, requires m_useEpaPenetrationAlgorithm
+	int					m_useSpecializedConvexConvexAlgorithms;
 
 	btDefaultCollisionConstructionInfo()
 		:m_persistentManifoldPool(0),
@@ -35,7 +37,8 @@ struct	btDefaultCollisionConstructionInfo
 		m_defaultMaxPersistentManifoldPoolSize(4096),
 		m_defaultMaxCollisionAlgorithmPoolSize(4096),
 		m_customCollisionAlgorithmMaxElementSize(0),
-		m_useEpaPenetrationAlgorithm(true)
+		m_useEpaPenetrationAlgorithm(true),
+		m_useSpecializedConvexConvexAlgorithms(true)
 	{
 	}
 };
@@ -17,7 +17,9 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
 #include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btAabbUtil2.h"
 
 ///Bvh Concave triangle mesh is a static-triangle mesh shape with Bounding Volume Hierarchy optimization.
 ///Uses an interface to access the triangles to allow for sharing graphics/physics triangles.
@@ -26,7 +28,10 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 m_bvh(0),
 m_triangleInfoMap(0),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
-m_ownsBvh(false)
+m_ownsBvh(false),
+m_internalNodeArea(btScalar(-1.)),
+m_buildTraversalCost(btScalar(-1.)),
+m_refitRebuildRatio(btScalar(2.))
 {
 	m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;
 	//construct bvh from meshInterface
@@ -46,7 +51,10 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 m_bvh(0),
 m_triangleInfoMap(0),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
-m_ownsBvh(false)
+m_ownsBvh(false),
+m_internalNodeArea(btScalar(-1.)),
+m_buildTraversalCost(btScalar(-1.)),
+m_refitRebuildRatio(btScalar(2.))
 {
 	m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;
 	//construct bvh from meshInterface
@@ -68,19 +76,74 @@ m_ownsBvh(false)
 void	btBvhTriangleMeshShape::partialRefitTree(const btVector3& aabbMin,const btVector3& aabbMax)
 {
 	m_bvh->refitPartial( m_meshInterface,aabbMin,aabbMax );
+	m_internalNodeArea = btScalar(-1.);
 	
 	m_localAabbMin.setMin(aabbMin);
 	m_localAabbMax.setMax(aabbMax);
 }
 
+bool	btBvhTriangleMeshShape::partialRefitTree(int subPart,const int* triangleIndices,int numTriangles)
+{
+	btAssert(m_bvh && m_bvh->isQuantized());
+
+	if (m_triangleLeafNodes.size() == 0)
+	{
+		m_bvh->getTriangleLeafNodes(m_triangleLeafNodes,m_partLeafOffsets);
+	}
+	if (m_internalNodeArea < btScalar(0.))
+	{
+		m_internalNodeArea = m_bvh->calculateInternalNodeArea();
+	}
+	if (m_buildTraversalCost < btScalar(0.))
+	{
+		m_buildTraversalCost = m_internalNodeArea / m_bvh->getQuantizedNodeArea(0);
+	}
+
+	m_refitLeafNodes.resize(numTriangles);
+	for (int i=0;i<numTriangles;i++)
+	{
+		m_refitLeafNodes[i] = m_triangleLeafNodes[m_partLeafOffsets[subPart]+triangleIndices[i]];
+	}
+
+	if (!m_bvh->refitLeafNodes(m_meshInterface,subPart,m_refitLeafNodes,m_internalNodeArea))
+	{
+		//the quantization range needs to grow
+		recalcLocalAabb();
+		buildOptimizedBvh();
+		return true;
+	}
+
+	//the root node is conservative, so the local aabb never shrinks, like with the aabb based partialRefitTree
+	btVector3 rootAabbMin = m_bvh->unQuantize(&m_bvh->getQuantizedNodeArray()[0].m_quantizedAabbMin[0]);
+	btVector3 rootAabbMax = m_bvh->unQuantize(&m_bvh->getQuantizedNodeArray()[0].m_quantizedAabbMax[0]);
+	m_localAabbMin.setMin(rootAabbMin);
+	m_localAabbMax.setMax(rootAabbMax);
+
+	if (m_internalNodeArea > m_refitRebuildRatio*m_buildTraversalCost*m_bvh->getQuantizedNodeArea(0))
+	{
+		buildOptimizedBvh();
+		return true;
+	}
+	return false;
+}
+
 
 void	btBvhTriangleMeshShape::refitTree(const btVector3& aabbMin,const btVector3& aabbMax)
 {
 	m_bvh->refit( m_meshInterface, aabbMin,aabbMax );
+	m_internalNodeArea = btScalar(-1.);
 	
 	recalcLocalAabb();
 }
 
+void	btBvhTriangleMeshShape::invalidateRefitState()
+{
+	m_triangleLeafNodes.resize(0);
+	m_partLeafOffsets.resize(0);
+	m_internalNodeArea = btScalar(-1.);
+	m_buildTraversalCost = btScalar(-1.);
+}
+
 btBvhTriangleMeshShape::~btBvhTriangleMeshShape()
 {
 	if (m_ownsBvh)
@@ -90,6 +153,53 @@ btBvhTriangleMeshShape::~btBvhTriangleMeshShape()
 	}
 }
 
+///reads triangle nodeTriangleIndex of subpart nodeSubPart, scaled by the mesh scaling, for the ray and convex cast callbacks
+static void	getScaledTriangle(btStridingMeshInterface* meshInterface, int nodeSubPart, int nodeTriangleIndex, btVector3* triangle)
+{
+	const unsigned char *vertexbase;
+	int numverts;
+	PHY_ScalarType type;
+	int stride;
+	const unsigned char *indexbase;
+	int indexstride;
+	int numfaces;
+	PHY_ScalarType indicestype;
+
+	meshInterface->getLockedReadOnlyVertexIndexBase(
+		&vertexbase,
+		numverts,
+		type,
+		stride,
+		&indexbase,
+		indexstride,
+		numfaces,
+		indicestype,
+		nodeSubPart);
+
+	unsigned int* gfxbase = (unsigned int*)(indexbase+nodeTriangleIndex*indexstride);
+	btAssert(indicestype==PHY_INTEGER||indicestype==PHY_SHORT);
+
+	const btVector3& meshScaling = meshInterface->getScaling();
+	for (int j=2;j>=0;j--)
+	{
+		int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
+		
+		if (type == PHY_FLOAT)
+		{
+			float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
+			
+			triangle[j] = btVector3(graphicsbase[0]*meshScaling.getX(),graphicsbase[1]*meshScaling.getY(),graphicsbase[2]*meshScaling.getZ());		
+		}
+		else
+		{
+			double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
+			
+			triangle[j] = btVector3(btScalar(graphicsbase[0])*meshScaling.getX(),btScalar(graphicsbase[1])*meshScaling.getY(),btScalar(graphicsbase[2])*meshScaling.getZ());		
+		}
+	}
+	meshInterface->unLockReadOnlyVertexBase(nodeSubPart);
+}
+
 void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget)
 {
 	struct	MyNodeOverlapCallback : public btNodeOverlapCallback
@@ -106,51 +216,10 @@ void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const
 		virtual void processNode(int nodeSubPart, int nodeTriangleIndex)
 		{
 			btVector3 m_triangle[3];
-			const unsigned char *vertexbase;
-			int numverts;
-			PHY_ScalarType type;
-			int stride;
-			const unsigned char *indexbase;
-			int indexstride;
-			int numfaces;
-			PHY_ScalarType indicestype;
-
-			m_meshInterface->getLockedReadOnlyVertexIndexBase(
-				&vertexbase,
-				numverts,
-				type,
-				stride,
-				&indexbase,
-				indexstride,
-				numfaces,
-				indicestype,
-				nodeSubPart);
-
-			unsigned int* gfxbase = (unsigned int*)(indexbase+nodeTriangleIndex*indexstride);
-			btAssert(indicestype==PHY_INTEGER||indicestype==PHY_SHORT);
-	
-			const btVector3& meshScaling = m_meshInterface->getScaling();
-			for (int j=2;j>=0;j--)
-			{
-				int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
-				
-				if (type == PHY_FLOAT)
-				{
-					float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
-					
-					m_triangle[j] = btVector3(graphicsbase[0]*meshScaling.getX(),graphicsbase[1]*meshScaling.getY(),graphicsbase[2]*meshScaling.getZ());		
-				}
-				else
-				{
-					double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
-					
-					m_triangle[j] = btVector3(btScalar(graphicsbase[0])*meshScaling.getX(),btScalar(graphicsbase[1])*meshScaling.getY(),btScalar(graphicsbase[2])*meshScaling.getZ());		
-				}
-			}
+			getScaledTriangle(m_meshInterface,nodeSubPart,nodeTriangleIndex,m_triangle);
 
 			/* Perform ray vs. triangle collision here */
 			m_callback->processTriangle(m_triangle,nodeSubPart,nodeTriangleIndex);
-			m_meshInterface->unLockReadOnlyVertexBase(nodeSubPart);
 		}
 	};
 
@@ -159,6 +228,59 @@ void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const
 	m_bvh->reportRayOverlappingNodex(&myNodeCallback,raySource,rayTarget);
 }
 
+void	btBvhTriangleMeshShape::performRaycastPacket (btTriangleRaycastCallback** callbacks, int numRays)
+{
+	struct	MyNodeOverlapCallback : public btNodeOverlapRayPacketCallback
+	{
+		btStridingMeshInterface*	m_meshInterface;
+		btTriangleRaycastCallback** m_callbacks;
+		btRayPacket& m_packet;
+
+		MyNodeOverlapCallback(btTriangleRaycastCallback** callbacks,btStridingMeshInterface* meshInterface,btRayPacket& packet)
+			:m_meshInterface(meshInterface),
+			m_callbacks(callbacks),
+			m_packet(packet)
+		{
+		}
+				
+		virtual void processNode(int nodeSubPart, int nodeTriangleIndex, unsigned int rayMask)
+		{
+			btVector3 m_triangle[3];
+			getScaledTriangle(m_meshInterface,nodeSubPart,nodeTriangleIndex,m_triangle);
+
+			/* Perform ray vs. triangle collision for each ray of the packet that reached this leaf */
+			for (int i=0;rayMask;i++,rayMask>>=1)
+			{
+				if (rayMask&1)
+				{
+					m_callbacks[i]->processTriangle(m_triangle,nodeSubPart,nodeTriangleIndex);
+					m_packet.m_fraction[i] = m_callbacks[i]->m_hitFraction;
+				}
+			}
+		}
+	};
+
+	btRayPacket packet;
+	btVector3 raySource[BT_RAY_PACKET_SIZE];
+	btVector3 rayTarget[BT_RAY_PACKET_SIZE];
+	for (int first=0;first<numRays;first+=BT_RAY_PACKET_SIZE)
+	{
+		int count = btMin(numRays-first,int(BT_RAY_PACKET_SIZE));
+		for (int i=0;i<count;i++)
+		{
+			raySource[i] = callbacks[first+i]->m_from;
+			rayTarget[i] = callbacks[first+i]->m_to;
+		}
+		packet.init(raySource,rayTarget,count);
+		for (int i=0;i<count;i++)
+		{
+			packet.m_fraction[i] = callbacks[first+i]->m_hitFraction;
+		}
+		MyNodeOverlapCallback	myNodeCallback(&callbacks[first],m_meshInterface,packet);
+		m_bvh->reportRayPacketOverlappingNodex(&myNodeCallback,packet);
+	}
+}
+
 void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax)
 {
 	struct	MyNodeOverlapCallback : public btNodeOverlapCallback
@@ -175,51 +297,10 @@ void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, co
 		virtual void processNode(int nodeSubPart, int nodeTriangleIndex)
 		{
 			btVector3 m_triangle[3];
-			const unsigned char *vertexbase;
-			int numverts;
-			PHY_ScalarType type;
-			int stride;
-			const unsigned char *indexbase;
-			int indexstride;
-			int numfaces;
-			PHY_ScalarType indicestype;
-
-			m_meshInterface->getLockedReadOnlyVertexIndexBase(
-				&vertexbase,
-				numverts,
-				type,
-				stride,
-				&indexbase,
-				indexstride,
-				numfaces,
-				indicestype,
-				nodeSubPart);
-
-			unsigned int* gfxbase = (unsigned int*)(indexbase+nodeTriangleIndex*indexstride);
-			btAssert(indicestype==PHY_INTEGER||indicestype==PHY_SHORT);
-	
-			const btVector3& meshScaling = m_meshInterface->getScaling();
-			for (int j=2;j>=0;j--)
-			{
-				int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
-
-				if (type == PHY_FLOAT)
-				{
-					float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
-
-					m_triangle[j] = btVector3(graphicsbase[0]*meshScaling.getX(),graphicsbase[1]*meshScaling.getY(),graphicsbase[2]*meshScaling.getZ());		
-				}
-				else
-				{
-					double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
-					
-					m_triangle[j] = btVector3(btScalar(graphicsbase[0])*meshScaling.getX(),btScalar(graphicsbase[1])*meshScaling.getY(),btScalar(graphicsbase[2])*meshScaling.getZ());		
-				}
-			}
+			getScaledTriangle(m_meshInterface,nodeSubPart,nodeTriangleIndex,m_triangle);
 
 			/* Perform ray vs. triangle collision here */
 			m_callback->processTriangle(m_triangle,nodeSubPart,nodeTriangleIndex);
-			m_meshInterface->unLockReadOnlyVertexBase(nodeSubPart);
 		}
 	};
 
@@ -351,6 +432,7 @@ void   btBvhTriangleMeshShape::buildOptimizedBvh()
 	//rebuild the bvh...
 	m_bvh->build(m_meshInterface,m_useQuantizedAabbCompression,m_localAabbMin,m_localAabbMax);
 	m_ownsBvh = true;
+	invalidateRefitState();
 }
 
 void   btBvhTriangleMeshShape::setOptimizedBvh(btOptimizedBvh* bvh, const btVector3& scaling)
@@ -360,6 +442,7 @@ void   btBvhTriangleMeshShape::setOptimizedBvh(btOptimizedBvh* bvh, const btVect
 
    m_bvh = bvh;
    m_ownsBvh = false;
+   invalidateRefitState();
    // update the scaling without rebuilding the bvh
    if ((getLocalScaling() -scaling).length2() > SIMD_EPSILON)
    {
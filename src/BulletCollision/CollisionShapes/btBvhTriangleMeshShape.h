@@ -21,6 +21,8 @@ subject to the following restrictions:
 #include "LinearMath/btAlignedAllocator.h"
 #include "btTriangleInfoMap.h"
 
+class btTriangleRaycastCallback;
+
 ///The btBvhTriangleMeshShape is a static-triangle mesh shape, it can only be used for fixed/non-moving objects.
 ///If you required moving concave triangle meshes, it is recommended to perform convex decomposition
 ///using HACD, see Bullet/Demos/ConvexDecompositionDemo. 
@@ -45,6 +47,15 @@ ATTRIBUTE_ALIGNED16(class) btBvhTriangleMeshShape : public btTriangleMeshShape
 	bool m_pad[11];////need padding due to alignment
 #endif
 
+	btAlignedObjectArray<int>	m_triangleLeafNodes;	// leaf node of each triangle, at m_partLeafOffsets[subPart]+triangleIndex
+	btAlignedObjectArray<int>	m_partLeafOffsets;
+	btAlignedObjectArray<int>	m_refitLeafNodes;
+	btScalar	m_internalNodeArea;		// maintained by the triangle partialRefitTree, negative when out of date
+	btScalar	m_buildTraversalCost;	// internal node area relative to the root after the bvh was built, negative when unknown
+	btScalar	m_refitRebuildRatio;
+
+	void	invalidateRefitState();
+
 public:
 
 	BT_DECLARE_ALIGNED_ALLOCATOR();
@@ -65,6 +76,9 @@ public:
 
 	
 	void performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget);
+	///performRaycastPacket traces numRays coherent rays together, ray i goes from callbacks[i]->m_from to callbacks[i]->m_to.
+	///Each tree node and triangle is fetched once per packet, and rays are culled beyond their closest hit (m_hitFraction).
+	void performRaycastPacket (btTriangleRaycastCallback** callbacks, int numRays);
 	void performConvexcast (btTriangleCallback* callback, const btVector3& boxSource, const btVector3& boxTarget, const btVector3& boxMin, const btVector3& boxMax);
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
@@ -74,6 +88,22 @@ public:
 	///for a fast incremental refit of parts of the tree. Note: the entire AABB of the tree will become more conservative, it never shrinks
 	void	partialRefitTree(const btVector3& aabbMin,const btVector3& aabbMax);
 
+	///refits only the leaves of the given triangles of a mesh part and their ancestors, for meshes where a few triangles moved.
+	///Needs a quantized bvh, large sets of triangles are refit with btParallelFor in BT_THREADSAFE builds.
+	///The bvh is rebuilt when a triangle left the quantization range, or when refitting made the bvh more than
+	///getRefitRebuildRatio() times more expensive to traverse than after it was built. Returns true if the bvh was rebuilt
+	bool	partialRefitTree(int subPart,const int* triangleIndices,int numTriangles);
+
+	void	setRefitRebuildRatio(btScalar ratio)
+	{
+		m_refitRebuildRatio = ratio;
+	}
+
+	btScalar	getRefitRebuildRatio() const
+	{
+		return m_refitRebuildRatio;
+	}
+
 	//debugging
 	virtual const char*	getName()const {return "BVHTRIANGLEMESH";}
 
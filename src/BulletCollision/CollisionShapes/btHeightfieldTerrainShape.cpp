@@ -16,6 +16,7 @@ subject to the following restrictions:
 #include "btHeightfieldTerrainShape.h"
 
 #include "LinearMath/btTransformUtil.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 
 
 
@@ -81,8 +82,12 @@ PHY_ScalarType hdt, bool flipQuadEdges
 	m_flipQuadEdges = flipQuadEdges;
 	m_useDiamondSubdivision = false;
 	m_useZigzagSubdivision = false;
+	m_useCellWalk = true;
 	m_upAxis = upAxis;
 	m_localScaling.setValue(btScalar(1.), btScalar(1.), btScalar(1.));
+	m_vboundsGridWidth = 0;
+	m_vboundsGridLength = 0;
+	m_vboundsChunkSize = 0;
 
 	// determine min/max axis-aligned bounding box (aabb) values
 	switch (m_upAxis)
@@ -351,47 +356,557 @@ void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
 		}
 	}
 
-	
-  
+	// the height range of the aabb in raw heights, with some slack for the triangles that just touch it
+	btScalar tolerance = btScalar(1e-4)*(btScalar(1.)+m_maxHeight-m_minHeight);
+	btScalar minHeight = btMin(localAabbMin[m_upAxis],localAabbMax[m_upAxis])-tolerance;
+	btScalar maxHeight = btMax(localAabbMin[m_upAxis],localAabbMax[m_upAxis])+tolerance;
+
+	if (m_vboundsGrid.size())
+	{
+		// skip the quadtree nodes the aabb lies above or below
+		int cellRange[4] = {startX,startJ,endX,endJ};
+		processChunk(callback,m_vboundsLevelStart.size()-1,0,0,cellRange,minHeight,maxHeight);
+	}
+	else
+	{
+		for(int j=startJ; j<endJ; j++)
+		{
+			processCellRow(callback,startX,endX,j,minHeight,maxHeight);
+		}
+	}
+}
+
+void	btHeightfieldTerrainShape::getCellTriangles(int x,int j,btVector3* vertices) const
+{
+	btVector3 v00,v01,v10,v11;
+	getVertex(x,j,v00);
+	getVertex(x,j+1,v01);
+	getVertex(x+1,j,v10);
+	getVertex(x+1,j+1,v11);
+	if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1))|| (m_useZigzagSubdivision  && !(j & 1)))
+	{
+		//first triangle
+		vertices[0] = v00;
+		vertices[1] = v01;
+		vertices[2] = v11;
+		//second triangle
+		vertices[3] = v00;
+		vertices[4] = v11;
+		vertices[5] = v10;
+	} else
+	{
+		//first triangle
+		vertices[0] = v00;
+		vertices[1] = v01;
+		vertices[2] = v10;
+		//second triangle
+		vertices[3] = v10;
+		vertices[4] = v01;
+		vertices[5] = v11;
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::processCell(btTriangleCallback* callback,int x,int j) const
+{
+	btVector3 vertices[6];
+	getCellTriangles(x,j,vertices);
+	callback->processTriangle(vertices,x,j);
+	callback->processTriangle(vertices+3,x,j);
+}
+
+
+
+void	btHeightfieldTerrainShape::processCellRow(btTriangleCallback* callback,int startX,int endX,int j,btScalar minHeight,btScalar maxHeight) const
+{
+	const int maxBatchCells = 32;
+	btVector3 triangles[maxBatchCells*6];
+	int partIds[maxBatchCells*2];
+	int triangleIndices[maxBatchCells*2];
+	int numCells = 0;
+
+	// the heights of the left edge of the current cell
+	btScalar h0 = getRawHeightFieldValue(startX,j);
+	btScalar h1 = getRawHeightFieldValue(startX,j+1);
+	for (int x=startX;x<endX;x++)
+	{
+		btScalar h2 = getRawHeightFieldValue(x+1,j);
+		btScalar h3 = getRawHeightFieldValue(x+1,j+1);
+		bool overlaps = btMax(btMax(h0,h1),btMax(h2,h3))>=minHeight && btMin(btMin(h0,h1),btMin(h2,h3))<=maxHeight;
+		h0 = h2;
+		h1 = h3;
+		if (!overlaps)
+		{
+			continue;
+		}
+		getCellTriangles(x,j,&triangles[numCells*6]);
+		partIds[numCells*2] = x;
+		partIds[numCells*2+1] = x;
+		triangleIndices[numCells*2] = j;
+		triangleIndices[numCells*2+1] = j;
+		numCells++;
+		if (numCells==maxBatchCells)
+		{
+			callback->processTriangles(triangles,partIds,triangleIndices,numCells*2);
+			numCells = 0;
+		}
+	}
+	if (numCells)
+	{
+		callback->processTriangles(triangles,partIds,triangleIndices,numCells*2);
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::processChunk(btTriangleCallback* callback,int level,int chunkX,int chunkY,const int cellRange[4],btScalar minHeight,btScalar maxHeight) const
+{
+	int levelWidth = ((m_vboundsGridWidth-1)>>level)+1;
+	const Range& range = m_vboundsGrid[m_vboundsLevelStart[level]+chunkY*levelWidth+chunkX];
+	if (range.max<minHeight || range.min>maxHeight)
+	{
+		return;
+	}
+
+	int chunkCells = m_vboundsChunkSize<<level;
+	int startX = btMax(cellRange[0],chunkX*chunkCells);
+	int startY = btMax(cellRange[1],chunkY*chunkCells);
+	int endX = btMin(cellRange[2],chunkX*chunkCells+chunkCells);
+	int endY = btMin(cellRange[3],chunkY*chunkCells+chunkCells);
+	if (startX>=endX || startY>=endY)
+	{
+		return;
+	}
 
-	for(int j=startJ; j<endJ; j++)
+	if (level==0)
 	{
-		for(int x=startX; x<endX; x++)
+		for (int y=startY;y<endY;y++)
 		{
-			btVector3 vertices[3];
-			if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1))|| (m_useZigzagSubdivision  && !(j & 1)))
+			processCellRow(callback,startX,endX,y,minHeight,maxHeight);
+		}
+		return;
+	}
+
+	int childWidth = ((m_vboundsGridWidth-1)>>(level-1))+1;
+	int childLength = ((m_vboundsGridLength-1)>>(level-1))+1;
+	for (int childY=chunkY*2;childY<btMin(chunkY*2+2,childLength);childY++)
+	{
+		for (int childX=chunkX*2;childX<btMin(chunkX*2+2,childWidth);childX++)
+		{
+			processChunk(callback,level-1,childX,childY,cellRange,minHeight,maxHeight);
+		}
+	}
+}
+
+///clips the segment from+dir*t to the box, returns false if [tBegin,tEnd] becomes empty
+static SIMD_FORCE_INLINE bool clipHeightfieldSegment(const btVector3& from,const btVector3& dir,const btVector3& boxMin,const btVector3& boxMax,btScalar& tBegin,btScalar& tEnd)
+{
+	for (int axis=0;axis<3;axis++)
+	{
+		if (dir[axis]==btScalar(0.))
+		{
+			if (from[axis]<boxMin[axis] || from[axis]>boxMax[axis])
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-		getVertex(x, j + 1, vertices[1]);
-		getVertex(x + 1, j + 1, vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-      //  getVertex(x,j,vertices[0]);//already got this vertex before, thanks to Danny Chapman
-        getVertex(x+1,j+1,vertices[1]);
-		getVertex(x + 1, j, vertices[2]);
-		callback->processTriangle(vertices, x, j);
-
-			} else
+				return false;
+			}
+			continue;
+		}
+		btScalar invDir = btScalar(1.)/dir[axis];
+		btScalar t0 = (boxMin[axis]-from[axis])*invDir;
+		btScalar t1 = (boxMax[axis]-from[axis])*invDir;
+		if (t0>t1)
+		{
+			btSwap(t0,t1);
+		}
+		tBegin = btMax(tBegin,t0);
+		tEnd = btMin(tEnd,t1);
+	}
+	return tBegin<=tEnd;
+}
+
+
+
+/// walks a 2D grid along a segment
+/**
+  Visits the cells touched by the rectangle [boxMin,boxMax] around the point from+dir*t, t in [tBegin,tEnd],
+  each cell once, using a 2D DDA over the cells crossed by the point. The cells touched while the point is in
+  one cell are visited before the cells touched after it left that cell, so the walk is front to back.
+  Cells outside [cellMin,cellMax) are skipped. action(x,y,tEnter) gets the parameter where the point
+  entered its current cell, and returns false to stop the walk. Returns false if the walk was stopped.
+ */
+template <typename Action>
+static bool walkHeightfieldGrid(const btScalar from[2],const btScalar dir[2],btScalar tBegin,btScalar tEnd,const int cellMin[2],const int cellMax[2],const btScalar boxMin[2],const btScalar boxMax[2],Action& action)
+{
+	int cell[2],endCell[2],step[2];
+	btScalar tMax[2],tDelta[2];
+	for (int axis=0;axis<2;axis++)
+	{
+		// the clipped segment stays near the grid, clamping only guards against rounding
+		btScalar lo = btScalar(cellMin[axis]-1)-btScalar(ceil(boxMax[axis]));
+		btScalar hi = btScalar(cellMax[axis])-btScalar(floor(boxMin[axis]));
+		cell[axis] = int(btMax(lo,btMin(hi,btScalar(floor(from[axis]+dir[axis]*tBegin)))));
+		endCell[axis] = int(btMax(lo,btMin(hi,btScalar(floor(from[axis]+dir[axis]*tEnd)))));
+		if (dir[axis]>btScalar(0.))
+		{
+			step[axis] = 1;
+			tMax[axis] = (btScalar(cell[axis]+1)-from[axis])/dir[axis];
+			tDelta[axis] = btScalar(1.)/dir[axis];
+			endCell[axis] = btMax(endCell[axis],cell[axis]);
+		}
+		else if (dir[axis]<btScalar(0.))
+		{
+			step[axis] = -1;
+			tMax[axis] = (btScalar(cell[axis])-from[axis])/dir[axis];
+			tDelta[axis] = btScalar(-1.)/dir[axis];
+			endCell[axis] = btMin(endCell[axis],cell[axis]);
+		}
+		else
+		{
+			step[axis] = 0;
+			tMax[axis] = BT_LARGE_FLOAT;
+			tDelta[axis] = BT_LARGE_FLOAT;
+			endCell[axis] = cell[axis];
+		}
+	}
+
+	// the footprint of the previous cell, footprints move monotonically so a cell is only in consecutive footprints
+	int prevMin[2] = {1,1};
+	int prevMax[2] = {0,0};
+	btScalar tEnter = tBegin;
+	for (;;)
+	{
+		bool last = (cell[0]==endCell[0] && cell[1]==endCell[1]);
+		// step along the axis with the nearest cell boundary, an axis that reached its end cell doesn't move
+		int axis = (cell[0]!=endCell[0] && (cell[1]==endCell[1] || tMax[0]<tMax[1]))? 0 : 1;
+		btScalar tExit = last? tEnd : btMax(tEnter,btMin(tEnd,tMax[axis]));
+
+		// the cells touched by the box while the point is in this cell
+		int footprintMin[2],footprintMax[2];
+		for (int i=0;i<2;i++)
+		{
+			btScalar p0 = from[i]+dir[i]*tEnter;
+			btScalar p1 = from[i]+dir[i]*tExit;
+			btScalar lo = btMin(p0,p1)+boxMin[i];
+			btScalar hi = btMax(p0,p1)+boxMax[i];
+			footprintMin[i] = int(btMax(btScalar(cellMin[i]),btScalar(floor(lo))));
+			footprintMax[i] = int(btMin(btScalar(cellMax[i]-1),btScalar(floor(hi))));
+		}
+		for (int y=footprintMin[1];y<=footprintMax[1];y++)
+		{
+			for (int x=footprintMin[0];x<=footprintMax[0];x++)
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j,vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-        getVertex(x+1,j,vertices[0]);
-        //getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);
+				if (x>=prevMin[0] && x<=prevMax[0] && y>=prevMin[1] && y<=prevMax[1])
+				{
+					continue;
+				}
+				if (!action(x,y,tEnter))
+				{
+					return false;
+				}
 			}
 		}
+		if (last)
+		{
+			break;
+		}
+		for (int i=0;i<2;i++)
+		{
+			prevMin[i] = footprintMin[i];
+			prevMax[i] = footprintMax[i];
+		}
+		tEnter = tExit;
+		cell[axis] += step[axis];
+		tMax[axis] += tDelta[axis];
 	}
+	return true;
+}
 
-	
 
+
+///tests the chunks or cells visited by walkHeightfieldGrid against the swept box, and processes the triangles of the cells it touches
+struct btHeightfieldCastAction
+{
+	const btHeightfieldTerrainShape*	m_shape;
+	btTriangleCallback*		m_callback;
+	const btScalar*			m_hitFraction;	// stop once a hit is closer than the next cell, rays only
+	btVector3				m_from;			// in grid coordinates, the height axis is the raw height
+	btVector3				m_dir;
+	btVector3				m_boxMin;		// box around the swept point, in grid coordinates
+	btVector3				m_boxMax;
+	btScalar				m_tBegin;
+	btScalar				m_tEnd;
+	btScalar				m_tolerance;
+	int						m_axes[3];		// grid x, grid y and up axis
+	btScalar				m_footprintMin[2];	// m_boxMin and m_boxMax along the grid x and y axis
+	btScalar				m_footprintMax[2];
+	bool					m_chunkLevel;
+
+	///computes the parameter range where the box overlaps the cells [xMin,xMax)x[yMin,yMax), and the height range of the box over it
+	bool	overlap(int xMin,int yMin,int xMax,int yMax,btScalar& hMin,btScalar& hMax,btScalar& tBegin,btScalar& tEnd) const
+	{
+		int xAxis = m_axes[0];
+		int yAxis = m_axes[1];
+		int upAxis = m_axes[2];
+		btVector3 rectMin,rectMax;
+		rectMin[xAxis] = btScalar(xMin)-m_boxMax[xAxis];
+		rectMax[xAxis] = btScalar(xMax)-m_boxMin[xAxis];
+		rectMin[yAxis] = btScalar(yMin)-m_boxMax[yAxis];
+		rectMax[yAxis] = btScalar(yMax)-m_boxMin[yAxis];
+		rectMin[upAxis] = -BT_LARGE_FLOAT;
+		rectMax[upAxis] = BT_LARGE_FLOAT;
+		tBegin = m_tBegin;
+		tEnd = m_tEnd;
+		if (!clipHeightfieldSegment(m_from,m_dir,rectMin,rectMax,tBegin,tEnd))
+		{
+			return false;
+		}
+		btScalar h0 = m_from[upAxis]+m_dir[upAxis]*tBegin;
+		btScalar h1 = m_from[upAxis]+m_dir[upAxis]*tEnd;
+		hMin = btMin(h0,h1)+m_boxMin[upAxis]-m_tolerance;
+		hMax = btMax(h0,h1)+m_boxMax[upAxis]+m_tolerance;
+		return true;
+	}
+
+	bool	operator()(int x,int y,btScalar tEnter)
+	{
+		if (m_hitFraction && tEnter>*m_hitFraction)
+		{
+			return false;
+		}
+		btScalar hMin,hMax,tBegin,tEnd;
+		if (m_chunkLevel)
+		{
+			int chunkSize = m_shape->m_vboundsChunkSize;
+			int cellMin[2] = {x*chunkSize,y*chunkSize};
+			int cellMax[2] = {btMin(cellMin[0]+chunkSize,m_shape->m_heightStickWidth-1),btMin(cellMin[1]+chunkSize,m_shape->m_heightStickLength-1)};
+			if (!overlap(cellMin[0],cellMin[1],cellMax[0],cellMax[1],hMin,hMax,tBegin,tEnd))
+			{
+				return true;
+			}
+			const btHeightfieldTerrainShape::Range& range = m_shape->m_vboundsGrid[y*m_shape->m_vboundsGridWidth+x];
+			if (hMax<range.min || hMin>range.max)
+			{
+				return true;
+			}
+			// walk the cells of this chunk, stopping early only skips the rest of this chunk since
+			// the other chunks of the same footprint can still have closer hits
+			btHeightfieldCastAction cellAction = *this;
+			cellAction.m_chunkLevel = false;
+			btScalar from[2] = {m_from[m_axes[0]],m_from[m_axes[1]]};
+			btScalar dir[2] = {m_dir[m_axes[0]],m_dir[m_axes[1]]};
+			walkHeightfieldGrid(from,dir,tBegin,tEnd,cellMin,cellMax,m_footprintMin,m_footprintMax,cellAction);
+			return true;
+		}
+		if (!overlap(x,y,x+1,y+1,hMin,hMax,tBegin,tEnd))
+		{
+			return true;
+		}
+		btScalar h00 = m_shape->getRawHeightFieldValue(x,y);
+		btScalar h10 = m_shape->getRawHeightFieldValue(x+1,y);
+		btScalar h01 = m_shape->getRawHeightFieldValue(x,y+1);
+		btScalar h11 = m_shape->getRawHeightFieldValue(x+1,y+1);
+		if (hMax<btMin(btMin(h00,h10),btMin(h01,h11)) || hMin>btMax(btMax(h00,h10),btMax(h01,h11)))
+		{
+			return true;
+		}
+		m_shape->processCell(m_callback,x,y);
+		return true;
+	}
+};
+
+
+
+/// process the triangles touched by a box swept along a segment
+/**
+  basic algorithm:
+    - convert the segment and box to grid coordinates, where cells have size 1 and the height is the raw height
+    - clip the segment to the parameter range where the box overlaps the heightfield aabb
+    - with an accelerator, walk the chunks along the segment and skip the chunks the box passes above or below
+    - walk the cells along the segment, skip the cells the box passes above or below, and process the others
+ */
+void	btHeightfieldTerrainShape::performCast(btTriangleCallback* callback,const btVector3& source,const btVector3& target,const btVector3& boxMin,const btVector3& boxMax,const btScalar* hitFraction) const
+{
+	int numCells[2] = {m_heightStickWidth-1,m_heightStickLength-1};
+
+	btHeightfieldCastAction action;
+	action.m_shape = this;
+	action.m_callback = callback;
+	action.m_hitFraction = hitFraction;
+	action.m_axes[0] = (m_upAxis==0)? 1 : 0;
+	action.m_axes[1] = (m_upAxis==2)? 1 : 2;
+	action.m_axes[2] = m_upAxis;
+	action.m_chunkLevel = false;
+
+	btVector3 invScaling(btScalar(1.)/m_localScaling[0],btScalar(1.)/m_localScaling[1],btScalar(1.)/m_localScaling[2]);
+	action.m_from = source*invScaling+m_localOrigin;
+	action.m_dir = target*invScaling+m_localOrigin-action.m_from;
+	for (int axis=0;axis<3;axis++)
+	{
+		btScalar lo = boxMin[axis]*invScaling[axis];
+		btScalar hi = boxMax[axis]*invScaling[axis];
+		action.m_boxMin[axis] = btMin(lo,hi);
+		action.m_boxMax[axis] = btMax(lo,hi);
+	}
+	// cells and heights are compared with some slack, so the triangles on the edge of a cell are processed
+	// when the segment runs along that edge
+	action.m_tolerance = btScalar(1e-4)*(btScalar(1.)+m_maxHeight-m_minHeight);
+	for (int i=0;i<2;i++)
+	{
+		action.m_boxMin[action.m_axes[i]] -= btScalar(1e-3);
+		action.m_boxMax[action.m_axes[i]] += btScalar(1e-3);
+	}
+
+	// only the part of the segment where the box overlaps the heightfield
+	btVector3 clipMin,clipMax;
+	for (int i=0;i<2;i++)
+	{
+		int axis = action.m_axes[i];
+		clipMin[axis] = -action.m_boxMax[axis];
+		clipMax[axis] = btScalar(numCells[i])-action.m_boxMin[axis];
+	}
+	clipMin[m_upAxis] = m_minHeight-action.m_boxMax[m_upAxis]-action.m_tolerance;
+	clipMax[m_upAxis] = m_maxHeight-action.m_boxMin[m_upAxis]+action.m_tolerance;
+	action.m_tBegin = btScalar(0.);
+	action.m_tEnd = btScalar(1.);
+	if (!clipHeightfieldSegment(action.m_from,action.m_dir,clipMin,clipMax,action.m_tBegin,action.m_tEnd))
+	{
+		return;
+	}
+
+	btScalar from[2],dir[2];
+	for (int i=0;i<2;i++)
+	{
+		int axis = action.m_axes[i];
+		from[i] = action.m_from[axis];
+		dir[i] = action.m_dir[axis];
+		action.m_footprintMin[i] = action.m_boxMin[axis];
+		action.m_footprintMax[i] = action.m_boxMax[axis];
+	}
+	if (m_vboundsGrid.size())
+	{
+		int chunkMin[2] = {0,0};
+		int chunkMax[2] = {m_vboundsGridWidth,m_vboundsGridLength};
+		btScalar chunkFootprintMin[2],chunkFootprintMax[2];
+		btScalar invChunkSize = btScalar(1.)/btScalar(m_vboundsChunkSize);
+		for (int i=0;i<2;i++)
+		{
+			from[i] *= invChunkSize;
+			dir[i] *= invChunkSize;
+			chunkFootprintMin[i] = action.m_footprintMin[i]*invChunkSize;
+			chunkFootprintMax[i] = action.m_footprintMax[i]*invChunkSize;
+		}
+		action.m_chunkLevel = true;
+		walkHeightfieldGrid(from,dir,action.m_tBegin,action.m_tEnd,chunkMin,chunkMax,chunkFootprintMin,chunkFootprintMax,action);
+	}
+	else
+	{
+		int cellMin[2] = {0,0};
+		walkHeightfieldGrid(from,dir,action.m_tBegin,action.m_tEnd,cellMin,numCells,action.m_footprintMin,action.m_footprintMax,action);
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::performRaycast(btTriangleRaycastCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const
+{
+	btVector3 zero(btScalar(0.),btScalar(0.),btScalar(0.));
+	performCast(callback,raySource,rayTarget,zero,zero,&callback->m_hitFraction);
 }
 
+
+
+void	btHeightfieldTerrainShape::performConvexcast(btTriangleCallback* callback,const btVector3& boxSource,const btVector3& boxTarget,const btVector3& boxMin,const btVector3& boxMax) const
+{
+	// the triangles have the margin of the heightfield
+	btVector3 margin(getMargin(),getMargin(),getMargin());
+	performCast(callback,boxSource,boxTarget,boxMin-margin,boxMax+margin,0);
+}
+
+
+
+void	btHeightfieldTerrainShape::buildAccelerator(int chunkSize)
+{
+	btAssert(chunkSize>0);
+	int numCellsX = m_heightStickWidth-1;
+	int numCellsY = m_heightStickLength-1;
+	m_vboundsChunkSize = chunkSize;
+	m_vboundsGridWidth = (numCellsX+chunkSize-1)/chunkSize;
+	m_vboundsGridLength = (numCellsY+chunkSize-1)/chunkSize;
+	m_vboundsGrid.resize(m_vboundsGridWidth*m_vboundsGridLength);
+	for (int chunkY=0;chunkY<m_vboundsGridLength;chunkY++)
+	{
+		for (int chunkX=0;chunkX<m_vboundsGridWidth;chunkX++)
+		{
+			// the chunk covers the cells [start,start+chunkSize), and the grid points up to start+chunkSize
+			int startX = chunkX*chunkSize;
+			int startY = chunkY*chunkSize;
+			int endX = btMin(startX+chunkSize,numCellsX);
+			int endY = btMin(startY+chunkSize,numCellsY);
+			Range range;
+			range.min = getRawHeightFieldValue(startX,startY);
+			range.max = range.min;
+			for (int y=startY;y<=endY;y++)
+			{
+				for (int x=startX;x<=endX;x++)
+				{
+					btScalar height = getRawHeightFieldValue(x,y);
+					range.min = btMin(range.min,height);
+					range.max = btMax(range.max,height);
+				}
+			}
+			m_vboundsGrid[chunkY*m_vboundsGridWidth+chunkX] = range;
+		}
+	}
+
+	// merge 2x2 nodes into the next level of the quadtree, until a single node is left
+	m_vboundsLevelStart.resize(0);
+	m_vboundsLevelStart.push_back(0);
+	int levelWidth = m_vboundsGridWidth;
+	int levelLength = m_vboundsGridLength;
+	while (levelWidth>1 || levelLength>1)
+	{
+		int childStart = m_vboundsLevelStart[m_vboundsLevelStart.size()-1];
+		int parentStart = m_vboundsGrid.size();
+		int parentWidth = (levelWidth+1)/2;
+		int parentLength = (levelLength+1)/2;
+		m_vboundsLevelStart.push_back(parentStart);
+		m_vboundsGrid.resize(parentStart+parentWidth*parentLength);
+		for (int parentY=0;parentY<parentLength;parentY++)
+		{
+			for (int parentX=0;parentX<parentWidth;parentX++)
+			{
+				Range range = m_vboundsGrid[childStart+parentY*2*levelWidth+parentX*2];
+				for (int childY=parentY*2;childY<btMin(parentY*2+2,levelLength);childY++)
+				{
+					for (int childX=parentX*2;childX<btMin(parentX*2+2,levelWidth);childX++)
+					{
+						const Range& child = m_vboundsGrid[childStart+childY*levelWidth+childX];
+						range.min = btMin(range.min,child.min);
+						range.max = btMax(range.max,child.max);
+					}
+				}
+				m_vboundsGrid[parentStart+parentY*parentWidth+parentX] = range;
+			}
+		}
+		levelWidth = parentWidth;
+		levelLength = parentLength;
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::clearAccelerator()
+{
+	m_vboundsGrid.clear();
+	m_vboundsLevelStart.clear();
+	m_vboundsGridWidth = 0;
+	m_vboundsGridLength = 0;
+	m_vboundsChunkSize = 0;
+}
+
+
+
 void	btHeightfieldTerrainShape::calculateLocalInertia(btScalar ,btVector3& inertia) const
 {
 	//moving concave objects not supported
@@ -17,6 +17,9 @@ subject to the following restrictions:
 #define BT_HEIGHTFIELD_TERRAIN_SHAPE_H
 
 #include "btConcaveShape.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btTriangleRaycastCallback;
 
 ///btHeightfieldTerrainShape simulates a 2D heightfield terrain
 /**
@@ -66,6 +69,14 @@ subject to the following restrictions:
   or maximum heights.  These values are used to determine the heightfield's
   axis-aligned bounding box, multiplied by localScaling.
 
+  performRaycast and performConvexcast only visit the cells along the
+  ray or sweep. buildAccelerator adds the min/max height of blocks of cells,
+  so that whole blocks the ray passes above or below are skipped. The blocks
+  are merged into a quadtree, which processAllTriangles uses to skip the parts
+  of the query aabb that lie entirely above or below the terrain.
+  processAllTriangles hands the triangles to the callback a row of cells at a
+  time, see btTriangleCallback::processTriangles.
+
   For usage and testing see the TerrainDemo.
  */
 ATTRIBUTE_ALIGNED16(class) btHeightfieldTerrainShape : public btConcaveShape
@@ -95,14 +106,39 @@ protected:
 	bool	m_flipQuadEdges;
   	bool  m_useDiamondSubdivision;
 	bool m_useZigzagSubdivision;
+	bool	m_useCellWalk;
 
 	int	m_upAxis;
 	
 	btVector3	m_localScaling;
 
+	///min and max raw height of each chunk of m_vboundsChunkSize x m_vboundsChunkSize cells, empty without accelerator.
+	///The chunks come first, followed by the coarser levels of the quadtree, each node merging 2x2 nodes of the level below.
+	struct Range
+	{
+		btScalar	min;
+		btScalar	max;
+	};
+	btAlignedObjectArray<Range>	m_vboundsGrid;
+	btAlignedObjectArray<int>	m_vboundsLevelStart;	// first node of each quadtree level in m_vboundsGrid, the last level has a single node
+	int	m_vboundsGridWidth;
+	int	m_vboundsGridLength;
+	int	m_vboundsChunkSize;
+
 	virtual btScalar	getRawHeightFieldValue(int x,int y) const;
 	void		quantizeWithClamp(int* out, const btVector3& point,int isMax) const;
 	void		getVertex(int x,int y,btVector3& vertex) const;
+	///get the 6 vertices of the two triangles of the cell between the grid points (x,y) and (x+1,y+1)
+	void		getCellTriangles(int x,int y,btVector3* vertices) const;
+	///process the two triangles of the cell between the grid points (x,y) and (x+1,y+1)
+	void		processCell(btTriangleCallback* callback,int x,int y) const;
+	///process the cells [startX,endX) of row y that reach into the raw height range [minHeight,maxHeight], in batches
+	void		processCellRow(btTriangleCallback* callback,int startX,int endX,int y,btScalar minHeight,btScalar maxHeight) const;
+	///process the cells of a quadtree node within cellRange (startX,startY,endX,endY), skipping nodes outside the height range
+	void		processChunk(btTriangleCallback* callback,int level,int chunkX,int chunkY,const int cellRange[4],btScalar minHeight,btScalar maxHeight) const;
+	void		performCast(btTriangleCallback* callback,const btVector3& source,const btVector3& target,const btVector3& boxMin,const btVector3& boxMax,const btScalar* hitFraction) const;
+
+	friend struct btHeightfieldCastAction;
 
 
 
@@ -149,10 +185,27 @@ public:
 	///could help compatibility with Ogre heightfields. See https://code.google.com/p/bullet/issues/detail?id=625	
 	void setUseZigzagSubdivision(bool useZigzagSubdivision=true) { m_useZigzagSubdivision = useZigzagSubdivision;}
 
+	///btCollisionWorld::rayTest and convexSweepTest use performRaycast and performConvexcast, which only visit the cells along the query.
+	///Disable it to process all triangles in the aabb of the ray or sweep instead, as for other concave shapes.
+	void setUseCellWalk(bool useCellWalk=true) { m_useCellWalk = useCellWalk;}
+	bool getUseCellWalk() const { return m_useCellWalk;}
+
 	virtual void getAabb(const btTransform& t,btVector3& aabbMin,btVector3& aabbMax) const;
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
+	///process the triangles of the cells crossed by the ray from raySource to rayTarget (in local coordinates), front to back.
+	///Stops once the callback has a hit closer than the next cell.
+	void	performRaycast(btTriangleRaycastCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const;
+
+	///process the triangles of the cells touched by the box [boxMin,boxMax] swept from boxSource to boxTarget (in local coordinates)
+	void	performConvexcast(btTriangleCallback* callback,const btVector3& boxSource,const btVector3& boxTarget,const btVector3& boxMin,const btVector3& boxMax) const;
+
+	///computes the min/max height of each chunkSize x chunkSize block of cells and the quadtree over the blocks,
+	///to skip blocks in processAllTriangles, performRaycast and performConvexcast. Call it again after the height data changed.
+	void	buildAccelerator(int chunkSize = 16);
+	void	clearAccelerator();
+
 	virtual void	calculateLocalInertia(btScalar mass,btVector3& inertia) const;
 
 	virtual void	setLocalScaling(const btVector3& scaling);
@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "btStridingMeshInterface.h"
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btIDebugDraw.h"
+#include "LinearMath/btThreads.h"
 
 
 btOptimizedBvh::btOptimizedBvh()
@@ -269,6 +270,40 @@ void	btOptimizedBvh::refitPartial(btStridingMeshInterface* meshInterface,const b
 	
 }
 
+///aabb of a triangle of a locked mesh part
+static void getTriangleAabb(const unsigned char* vertexbase,PHY_ScalarType type,int stride,const unsigned char* indexbase,int indexstride,PHY_ScalarType indicestype,const btVector3& meshScaling,int triangleIndex,btVector3& aabbMin,btVector3& aabbMax)
+{
+	btVector3	triangleVerts[3];
+	unsigned int* gfxbase = (unsigned int*)(indexbase+triangleIndex*indexstride);
+
+	for (int j=2;j>=0;j--)
+	{
+		int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
+		if (type == PHY_FLOAT)
+		{
+			float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
+			triangleVerts[j] = btVector3(
+				graphicsbase[0]*meshScaling.getX(),
+				graphicsbase[1]*meshScaling.getY(),
+				graphicsbase[2]*meshScaling.getZ());
+		}
+		else
+		{
+			double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
+			triangleVerts[j] = btVector3( btScalar(graphicsbase[0]*meshScaling.getX()), btScalar(graphicsbase[1]*meshScaling.getY()), btScalar(graphicsbase[2]*meshScaling.getZ()));
+		}
+	}
+
+	aabbMin.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	aabbMax.setValue(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT)); 
+	aabbMin.setMin(triangleVerts[0]);
+	aabbMax.setMax(triangleVerts[0]);
+	aabbMin.setMin(triangleVerts[1]);
+	aabbMax.setMax(triangleVerts[1]);
+	aabbMin.setMin(triangleVerts[2]);
+	aabbMax.setMax(triangleVerts[2]);
+}
+
 void	btOptimizedBvh::updateBvhNodes(btStridingMeshInterface* meshInterface,int firstNode,int endNode,int index)
 {
 	(void)index;
@@ -287,7 +322,6 @@ void	btOptimizedBvh::updateBvhNodes(btStridingMeshInterface* meshInterface,int f
 		int numfaces = 0;
 		PHY_ScalarType indicestype = PHY_INTEGER;
 
-		btVector3	triangleVerts[3];
 		btVector3	aabbMin,aabbMax;
 		const btVector3& meshScaling = meshInterface->getScaling();
 		
@@ -311,40 +345,7 @@ void	btOptimizedBvh::updateBvhNodes(btStridingMeshInterface* meshInterface,int f
 					curNodeSubPart = nodeSubPart;
 					btAssert(indicestype==PHY_INTEGER||indicestype==PHY_SHORT);
 				}
-				//triangles->getLockedReadOnlyVertexIndexBase(vertexBase,numVerts,
-
-				unsigned int* gfxbase = (unsigned int*)(indexbase+nodeTriangleIndex*indexstride);
-				
-				
-				for (int j=2;j>=0;j--)
-				{
-					
-					int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
-					if (type == PHY_FLOAT)
-					{
-						float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
-						triangleVerts[j] = btVector3(
-							graphicsbase[0]*meshScaling.getX(),
-							graphicsbase[1]*meshScaling.getY(),
-							graphicsbase[2]*meshScaling.getZ());
-					}
-					else
-					{
-						double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
-						triangleVerts[j] = btVector3( btScalar(graphicsbase[0]*meshScaling.getX()), btScalar(graphicsbase[1]*meshScaling.getY()), btScalar(graphicsbase[2]*meshScaling.getZ()));
-					}
-				}
-
-
-				
-				aabbMin.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
-				aabbMax.setValue(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT)); 
-				aabbMin.setMin(triangleVerts[0]);
-				aabbMax.setMax(triangleVerts[0]);
-				aabbMin.setMin(triangleVerts[1]);
-				aabbMax.setMax(triangleVerts[1]);
-				aabbMin.setMin(triangleVerts[2]);
-				aabbMax.setMax(triangleVerts[2]);
+				getTriangleAabb(vertexbase,type,stride,indexbase,indexstride,indicestype,meshScaling,nodeTriangleIndex,aabbMin,aabbMax);
 
 				quantize(&curNode.m_quantizedAabbMin[0],aabbMin,0);
 				quantize(&curNode.m_quantizedAabbMax[0],aabbMax,1);
@@ -381,6 +382,230 @@ void	btOptimizedBvh::updateBvhNodes(btStridingMeshInterface* meshInterface,int f
 		
 }
 
+int btOptimizedBvh::s_minimumLeafNodesForParallelRefit = 1024;
+
+///refits a range of leaf nodes of one locked mesh part, the leaves that don't fit in the quantization range are counted and left alone
+struct btOptimizedBvhRefitLeafLoop : public btIParallelForBody
+{
+	btOptimizedBvh* m_bvh;
+	const btAlignedObjectArray<int>* m_leafNodes;
+	btVector3 m_bvhAabbMin;
+	btVector3 m_bvhAabbMax;
+	btVector3 m_meshScaling;
+	const unsigned char* m_vertexbase;
+	PHY_ScalarType m_type;
+	int m_stride;
+	const unsigned char* m_indexbase;
+	int m_indexstride;
+	PHY_ScalarType m_indicestype;
+	btAlignedObjectArray<int>* m_taskOutsideCounts;
+	int m_grainSize;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		QuantizedNodeArray& nodes = m_bvh->getQuantizedNodeArray();
+		for (int task = iBegin; task < iEnd; ++task)
+		{
+			int leafBegin = task*m_grainSize;
+			int leafEnd = btMin(leafBegin+m_grainSize,m_leafNodes->size());
+			int outsideCount = 0;
+			for (int i = leafBegin; i < leafEnd; ++i)
+			{
+				btQuantizedBvhNode& leaf = nodes[(*m_leafNodes)[i]];
+				btVector3 aabbMin,aabbMax;
+				getTriangleAabb(m_vertexbase,m_type,m_stride,m_indexbase,m_indexstride,m_indicestype,m_meshScaling,leaf.getTriangleIndex(),aabbMin,aabbMax);
+				if (aabbMin.getX() < m_bvhAabbMin.getX() || aabbMin.getY() < m_bvhAabbMin.getY() || aabbMin.getZ() < m_bvhAabbMin.getZ() ||
+					aabbMax.getX() > m_bvhAabbMax.getX() || aabbMax.getY() > m_bvhAabbMax.getY() || aabbMax.getZ() > m_bvhAabbMax.getZ())
+				{
+					outsideCount++;
+					continue;
+				}
+				m_bvh->quantize(&leaf.m_quantizedAabbMin[0],aabbMin,0);
+				m_bvh->quantize(&leaf.m_quantizedAabbMax[0],aabbMax,1);
+			}
+			(*m_taskOutsideCounts)[task] = outsideCount;
+		}
+	}
+};
+
+struct btLessNodeIndex
+{
+	bool operator() (int a, int b) const
+	{
+		return a < b;
+	}
+};
+
+///merges the children of the internal nodes in the subtree of nodeIndex that contain one of the sorted leaf nodes, bottom-up
+static void mergeAncestorNodes(btOptimizedBvh* bvh,const int* sortedLeafNodes,int numLeafNodes,int nodeIndex,btScalar& internalNodeArea)
+{
+	QuantizedNodeArray& nodes = bvh->getQuantizedNodeArray();
+	if (nodes[nodeIndex].isLeafNode())
+		return;
+
+	int leftChild = nodeIndex+1;
+	int rightChild = nodes[leftChild].isLeafNode() ? nodeIndex+2 : leftChild+nodes[leftChild].getEscapeIndex();
+
+	//the leaves before the right child are in the left subtree
+	int numLeft = 0;
+	int high = numLeafNodes;
+	while (numLeft < high)
+	{
+		int mid = (numLeft+high)/2;
+		if (sortedLeafNodes[mid] < rightChild)
+			numLeft = mid+1;
+		else
+			high = mid;
+	}
+	if (numLeft > 0)
+		mergeAncestorNodes(bvh,sortedLeafNodes,numLeft,leftChild,internalNodeArea);
+	if (numLeft < numLeafNodes)
+		mergeAncestorNodes(bvh,sortedLeafNodes+numLeft,numLeafNodes-numLeft,rightChild,internalNodeArea);
+
+	btQuantizedBvhNode& curNode = nodes[nodeIndex];
+	const btQuantizedBvhNode& leftChildNode = nodes[leftChild];
+	const btQuantizedBvhNode& rightChildNode = nodes[rightChild];
+	internalNodeArea -= bvh->getQuantizedNodeArea(nodeIndex);
+	for (int i=0;i<3;i++)
+	{
+		curNode.m_quantizedAabbMin[i] = btMin(leftChildNode.m_quantizedAabbMin[i],rightChildNode.m_quantizedAabbMin[i]);
+		curNode.m_quantizedAabbMax[i] = btMax(leftChildNode.m_quantizedAabbMax[i],rightChildNode.m_quantizedAabbMax[i]);
+	}
+	internalNodeArea += bvh->getQuantizedNodeArea(nodeIndex);
+}
+
+bool	btOptimizedBvh::refitLeafNodes(btStridingMeshInterface* meshInterface,int subPart,btAlignedObjectArray<int>& leafNodes,btScalar& internalNodeArea)
+{
+	btAssert(m_useQuantization);
+
+	const unsigned char *vertexbase = 0;
+	int numverts = 0;
+	PHY_ScalarType type = PHY_INTEGER;
+	int stride = 0;
+	const unsigned char *indexbase = 0;
+	int indexstride = 0;
+	int numfaces = 0;
+	PHY_ScalarType indicestype = PHY_INTEGER;
+	meshInterface->getLockedReadOnlyVertexIndexBase(&vertexbase,numverts,type,stride,&indexbase,indexstride,numfaces,indicestype,subPart);
+	btAssert(indicestype==PHY_INTEGER||indicestype==PHY_SHORT);
+
+	//in memory order
+	leafNodes.quickSort(btLessNodeIndex());
+
+	const int grainSize = 256;
+	int numTasks = (leafNodes.size()+grainSize-1)/grainSize;
+	btAlignedObjectArray<int> taskOutsideCounts;
+	taskOutsideCounts.resize(numTasks);
+	btOptimizedBvhRefitLeafLoop loop;
+	loop.m_bvh = this;
+	loop.m_leafNodes = &leafNodes;
+	loop.m_bvhAabbMin = m_bvhAabbMin;
+	loop.m_bvhAabbMax = m_bvhAabbMax;
+	loop.m_meshScaling = meshInterface->getScaling();
+	loop.m_vertexbase = vertexbase;
+	loop.m_type = type;
+	loop.m_stride = stride;
+	loop.m_indexbase = indexbase;
+	loop.m_indexstride = indexstride;
+	loop.m_indicestype = indicestype;
+	loop.m_taskOutsideCounts = &taskOutsideCounts;
+	loop.m_grainSize = grainSize;
+#if BT_THREADSAFE
+	if (leafNodes.size() >= s_minimumLeafNodesForParallelRefit && btGetTaskScheduler() && !btThreadsAreRunning())
+	{
+		btParallelFor(0,numTasks,1,loop);
+	}
+	else
+#endif
+	{
+		loop.forLoop(0,numTasks);
+	}
+
+	meshInterface->unLockReadOnlyVertexBase(subPart);
+
+	for (int task = 0; task < numTasks; ++task)
+	{
+		if (taskOutsideCounts[task])
+		{
+			return false;
+		}
+	}
+
+	if (leafNodes.size())
+	{
+		mergeAncestorNodes(this,&leafNodes[0],leafNodes.size(),0,internalNodeArea);
+	}
+
+	for (int i=0;i<m_SubtreeHeaders.size();i++)
+	{
+		btBvhSubtreeInfo& subtree = m_SubtreeHeaders[i];
+		subtree.setAabbFromQuantizeNode(m_quantizedContiguousNodes[subtree.m_rootNodeIndex]);
+	}
+	return true;
+}
+
+void	btOptimizedBvh::getTriangleLeafNodes(btAlignedObjectArray<int>& leafNodes,btAlignedObjectArray<int>& partOffsets) const
+{
+	btAssert(m_useQuantization);
+
+	partOffsets.resize(0);
+	for (int i=0;i<m_curNodeIndex;i++)
+	{
+		const btQuantizedBvhNode& node = m_quantizedContiguousNodes[i];
+		if (node.isLeafNode())
+		{
+			while (partOffsets.size() <= node.getPartId())
+			{
+				partOffsets.push_back(0);
+			}
+			partOffsets[node.getPartId()] = btMax(partOffsets[node.getPartId()],node.getTriangleIndex()+1);
+		}
+	}
+	//triangle counts to offsets
+	int numTriangles = 0;
+	for (int i=0;i<partOffsets.size();i++)
+	{
+		int count = partOffsets[i];
+		partOffsets[i] = numTriangles;
+		numTriangles += count;
+	}
+
+	leafNodes.resize(numTriangles);
+	for (int i=0;i<m_curNodeIndex;i++)
+	{
+		const btQuantizedBvhNode& node = m_quantizedContiguousNodes[i];
+		if (node.isLeafNode())
+		{
+			leafNodes[partOffsets[node.getPartId()]+node.getTriangleIndex()] = i;
+		}
+	}
+}
+
+btScalar	btOptimizedBvh::getQuantizedNodeArea(int nodeIndex) const
+{
+	const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+	btVector3 extent(
+		btScalar(node.m_quantizedAabbMax[0]-node.m_quantizedAabbMin[0]),
+		btScalar(node.m_quantizedAabbMax[1]-node.m_quantizedAabbMin[1]),
+		btScalar(node.m_quantizedAabbMax[2]-node.m_quantizedAabbMin[2]));
+	extent = extent / m_bvhQuantization;
+	return btScalar(2.)*(extent.getX()*extent.getY()+extent.getY()*extent.getZ()+extent.getZ()*extent.getX());
+}
+
+btScalar	btOptimizedBvh::calculateInternalNodeArea() const
+{
+	btAssert(m_useQuantization);
+	btScalar area = btScalar(0.);
+	for (int i=0;i<m_curNodeIndex;i++)
+	{
+		if (!m_quantizedContiguousNodes[i].isLeafNode())
+		{
+			area += getQuantizedNodeArea(i);
+		}
+	}
+	return area;
+}
+
 ///deSerializeInPlace loads and initializes a BVH from a buffer in memory 'in place'
 btOptimizedBvh* btOptimizedBvh::deSerializeInPlace(void *i_alignedDataBuffer, unsigned int i_dataBufferSize, bool i_swapEndian)
 {
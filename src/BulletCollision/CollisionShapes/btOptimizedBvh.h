@@ -46,6 +46,23 @@ public:
 
 	void	updateBvhNodes(btStridingMeshInterface* meshInterface,int firstNode,int endNode,int index);
 
+	///refits the given leaf nodes, which must all belong to mesh part subPart, and then their ancestors and the subtree headers.
+	///leafNodes gets sorted, large sets of leaves are refit with btParallelFor in BT_THREADSAFE builds.
+	///internalNodeArea is updated with the change in surface area of the internal nodes.
+	///Returns false if a triangle left the quantization range, the bvh needs to be rebuilt then
+	bool	refitLeafNodes(btStridingMeshInterface* meshInterface,int subPart,btAlignedObjectArray<int>& leafNodes,btScalar& internalNodeArea);
+
+	///fills the leaf node of each triangle, at partOffsets[subPart]+triangleIndex
+	void	getTriangleLeafNodes(btAlignedObjectArray<int>& leafNodes,btAlignedObjectArray<int>& partOffsets) const;
+
+	btScalar	getQuantizedNodeArea(int nodeIndex) const;
+
+	///sum of the surface areas of the internal nodes, a measure of the traversal cost when divided by the area of the root node
+	btScalar	calculateInternalNodeArea() const;
+
+	///leaf sets at least this large are refit with btParallelFor by refitLeafNodes
+	static int	s_minimumLeafNodesForParallelRefit;
+
 	/// Data buffer MUST be 16 byte aligned
 	virtual bool serializeInPlace(void *o_alignedDataBuffer, unsigned i_dataBufferSize, bool i_swapEndian) const
 	{
@@ -20,6 +20,14 @@ btTriangleCallback::~btTriangleCallback()
 
 }
 
+void btTriangleCallback::processTriangles(btVector3* triangles, const int* partIds, const int* triangleIndices, int numTriangles)
+{
+	for (int i=0;i<numTriangles;i++)
+	{
+		processTriangle(&triangles[i*3],partIds[i],triangleIndices[i]);
+	}
+}
+
 
 btInternalTriangleIndexCallback::~btInternalTriangleIndexCallback()
 {
@@ -27,6 +27,11 @@ public:
 
 	virtual ~btTriangleCallback();
 	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex) = 0;
+
+	///processes a batch of triangles, 3 consecutive vertices per triangle. Shapes that generate many triangles at once,
+	///such as btHeightfieldTerrainShape, use this so the callback can share work between the triangles.
+	///The default implementation calls processTriangle for each triangle.
+	virtual void processTriangles(btVector3* triangles, const int* partIds, const int* triangleIndices, int numTriangles);
 };
 
 class btInternalTriangleIndexCallback
@@ -30,6 +30,7 @@ Concave-Concave Collision
 #include "btGImpactCollisionAlgorithm.h"
 #include "btContactProcessing.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
 
 
 //! Class for accessing the plane equation
@@ -193,6 +194,8 @@ float btGImpactCollisionAlgorithm::getAverageTriangleCollisionTime()
 
 
 
+int btGImpactCollisionAlgorithm::s_minimumTrianglePairsForParallelLoops = 512;
+
 btGImpactCollisionAlgorithm::btGImpactCollisionAlgorithm( const btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap)
 : btActivatingCollisionAlgorithm(ci,body0Wrap,body1Wrap)
 {
@@ -391,6 +394,14 @@ void btGImpactCollisionAlgorithm::collide_sat_triangles(const btCollisionObjectW
 					  const btGImpactMeshShapePart * shape1,
 					  const int * pairs, int pair_count)
 {
+#if BT_THREADSAFE
+	if (pair_count >= s_minimumTrianglePairsForParallelLoops && btGetTaskScheduler() && !btThreadsAreRunning())
+	{
+		collide_sat_triangles_parallel(body0Wrap,body1Wrap,shape0,shape1,pairs,pair_count);
+		return;
+	}
+#endif //BT_THREADSAFE
+
 	btTransform orgtrans0 = body0Wrap->getWorldTransform();
 	btTransform orgtrans1 = body1Wrap->getWorldTransform();
 
@@ -458,6 +469,112 @@ void btGImpactCollisionAlgorithm::collide_sat_triangles(const btCollisionObjectW
 }
 
 
+//! contact found by the parallel triangle test, m_pair indexes the triangle pair
+struct btGImpactTriangleContact
+{
+	btVector3 m_point;
+	btVector3 m_normal;
+	btScalar m_depth;
+	int m_pair;
+};
+
+struct btGImpactTriangleCollisionLoop : public btIParallelForBody
+{
+	const btGImpactMeshShapePart * m_shape0;
+	const btGImpactMeshShapePart * m_shape1;
+	btTransform m_trans0;
+	btTransform m_trans1;
+	const int * m_pairs;
+	int m_pairCount;
+	int m_grainSize;
+	btAlignedObjectArray< btAlignedObjectArray<btGImpactTriangleContact> > * m_taskContacts;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		btPrimitiveTriangle ptri0;
+		btPrimitiveTriangle ptri1;
+		GIM_TRIANGLE_CONTACT contact_data;
+
+		for (int task = iBegin; task < iEnd; ++task)
+		{
+			btAlignedObjectArray<btGImpactTriangleContact> & contacts = (*m_taskContacts)[task];
+			contacts.resize(0);
+			int pairBegin = task*m_grainSize;
+			int pairEnd = btMin(pairBegin+m_grainSize,m_pairCount);
+			for (int pair = pairBegin; pair < pairEnd; ++pair)
+			{
+				m_shape0->getPrimitiveTriangle(m_pairs[pair*2],ptri0);
+				m_shape1->getPrimitiveTriangle(m_pairs[pair*2+1],ptri1);
+
+				ptri0.applyTransform(m_trans0);
+				ptri1.applyTransform(m_trans1);
+
+				ptri0.buildTriPlane();
+				ptri1.buildTriPlane();
+
+				if(ptri0.overlap_test_conservative(ptri1) && ptri0.find_triangle_collision_clip_method(ptri1,contact_data))
+				{
+					int j = contact_data.m_point_count;
+					while(j--)
+					{
+						btGImpactTriangleContact& contact = contacts.expandNonInitializing();
+						contact.m_point = contact_data.m_points[j];
+						contact.m_normal = contact_data.m_separating_normal;
+						contact.m_depth = -contact_data.m_penetration_depth;
+						contact.m_pair = pair;
+					}
+				}
+			}
+		}
+	}
+};
+
+void btGImpactCollisionAlgorithm::collide_sat_triangles_parallel(const btCollisionObjectWrapper* body0Wrap,
+					  const btCollisionObjectWrapper* body1Wrap,
+					  const btGImpactMeshShapePart * shape0,
+					  const btGImpactMeshShapePart * shape1,
+					  const int * pairs, int pair_count)
+{
+	BT_PROFILE("collide_sat_triangles_parallel");
+	const int grainSize = 64;
+	int numTasks = (pair_count+grainSize-1)/grainSize;
+	btAlignedObjectArray< btAlignedObjectArray<btGImpactTriangleContact> > taskContacts;
+	taskContacts.resize(numTasks);
+
+	shape0->lockChildShapes();
+	shape1->lockChildShapes();
+
+	btGImpactTriangleCollisionLoop loop;
+	loop.m_shape0 = shape0;
+	loop.m_shape1 = shape1;
+	loop.m_trans0 = body0Wrap->getWorldTransform();
+	loop.m_trans1 = body1Wrap->getWorldTransform();
+	loop.m_pairs = pairs;
+	loop.m_pairCount = pair_count;
+	loop.m_grainSize = grainSize;
+	loop.m_taskContacts = &taskContacts;
+	btParallelFor(0,numTasks,1,loop);
+
+	shape0->unlockChildShapes();
+	shape1->unlockChildShapes();
+
+	//the manifold is not thread safe, the contacts are added in the order of the triangle pairs
+	for (int task = 0; task < numTasks; ++task)
+	{
+		const btAlignedObjectArray<btGImpactTriangleContact> & contacts = taskContacts[task];
+		for (int i = 0; i < contacts.size(); ++i)
+		{
+			const btGImpactTriangleContact & contact = contacts[i];
+			m_triface0 = pairs[contact.m_pair*2];
+			m_triface1 = pairs[contact.m_pair*2+1];
+			addContactPoint(body0Wrap, body1Wrap, contact.m_point, contact.m_normal, contact.m_depth);
+		}
+	}
+	m_triface0 = pairs[(pair_count-1)*2];
+	m_triface1 = pairs[(pair_count-1)*2+1];
+}
+
+
 void btGImpactCollisionAlgorithm::gimpact_vs_gimpact(
 						const btCollisionObjectWrapper* body0Wrap,
 					   	const btCollisionObjectWrapper * body1Wrap,
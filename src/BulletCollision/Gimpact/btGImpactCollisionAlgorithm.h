@@ -157,6 +157,12 @@ protected:
 					  const btGImpactMeshShapePart * shape1,
 					  const int * pairs, int pair_count);
 
+	void collide_sat_triangles_parallel(const btCollisionObjectWrapper* body0Wrap,
+					  const btCollisionObjectWrapper* body1Wrap,
+					  const btGImpactMeshShapePart * shape0,
+					  const btGImpactMeshShapePart * shape1,
+					  const int * pairs, int pair_count);
+
 
 
 
@@ -195,6 +201,9 @@ protected:
 
 
 public:
+	//! triangle pair sets of at least this size are tested with btParallelFor, in BT_THREADSAFE builds only.
+	//! The contacts are added to the manifold afterwards in the same order as the sequential test
+	static int s_minimumTrianglePairsForParallelLoops;
 
 	btGImpactCollisionAlgorithm( const btCollisionAlgorithmConstructionInfo& ci,const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap);
 
@@ -23,6 +23,7 @@ subject to the following restrictions:
 
 #include "btGImpactQuantizedBvh.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
 
 #ifdef TRI_COLLISION_PROFILING
 btClock g_q_tree_clock;
@@ -244,43 +245,207 @@ void btQuantizedBvhTree::build_tree(
 
 ////////////////////////////////////class btGImpactQuantizedBvh
 
+int btGImpactQuantizedBvh::s_minimumNodesForParallelLoops = 4096;
+
+static bool useParallelLoops(int nodecount)
+{
+#if BT_THREADSAFE
+	return nodecount >= btGImpactQuantizedBvh::s_minimumNodesForParallelLoops && btGetTaskScheduler() && !btThreadsAreRunning();
+#else
+	(void)nodecount;
+	return false;
+#endif
+}
+
+//! refits a range of leaf nodes, or of the given leaf nodes, the leaves that don't fit in the quantization range of the tree are counted
+struct btGImpactQuantizedBvhRefitLoop : public btIParallelForBody
+{
+	btGImpactQuantizedBvh* m_bvh;
+	const btAlignedObjectArray<int>* m_leafNodes;//all nodes if NULL
+	int m_nodeCount;
+	btAlignedObjectArray<int>* m_taskOutsideCounts;
+	int m_grainSize;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for (int task = iBegin; task < iEnd; ++task)
+		{
+			int nodeBegin = task*m_grainSize;
+			int nodeEnd = btMin(nodeBegin+m_grainSize,m_nodeCount);
+			int outsideCount = 0;
+			for (int i = nodeBegin; i < nodeEnd; ++i)
+			{
+				int node = m_leafNodes ? (*m_leafNodes)[i] : i;
+				if (m_bvh->isLeafNode(node))
+				{
+					btAABB leafbox;
+					m_bvh->m_primitive_manager->get_primitive_box(m_bvh->getNodeData(node),leafbox);
+					if (!m_bvh->m_box_tree.isInsideQuantizationBound(leafbox))
+					{
+						outsideCount++;
+					}
+					m_bvh->setNodeBound(node,leafbox);
+				}
+			}
+			(*m_taskOutsideCounts)[task] = outsideCount;
+		}
+	}
+};
+
+//! refits all leaves, or only the given ones. Returns false if a leaf doesn't fit in the quantization range
+static bool _refit_leaf_nodes(btGImpactQuantizedBvh * bvh, const btAlignedObjectArray<int> * leaf_nodes)
+{
+	int nodecount = leaf_nodes ? leaf_nodes->size() : bvh->getNodeCount();
+	const int grainSize = 256;
+	int numTasks = (nodecount+grainSize-1)/grainSize;
+	btAlignedObjectArray<int> taskOutsideCounts;
+	taskOutsideCounts.resize(numTasks);
+	btGImpactQuantizedBvhRefitLoop loop;
+	loop.m_bvh = bvh;
+	loop.m_leafNodes = leaf_nodes;
+	loop.m_nodeCount = nodecount;
+	loop.m_taskOutsideCounts = &taskOutsideCounts;
+	loop.m_grainSize = grainSize;
+	if (useParallelLoops(nodecount))
+	{
+		btParallelFor(0,numTasks,1,loop);
+	}
+	else
+	{
+		loop.forLoop(0,numTasks);
+	}
+
+	for (int task = 0; task < numTasks; ++task)
+	{
+		if (taskOutsideCounts[task])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 void btGImpactQuantizedBvh::refit()
 {
 	int nodecount = getNodeCount();
+	if (nodecount == 0)
+		return;
+
+	//leaves first, they only depend on the primitives
+	if (!_refit_leaf_nodes(this,NULL))
+	{
+		//a deformed mesh left the quantization range, the clamped bounds would miss collisions
+		buildSet();
+		return;
+	}
+
+	//children are stored after their parent
+	m_internal_node_area = btScalar(0.);
 	while(nodecount--)
 	{
-		if(isLeafNode(nodecount))
+		if(!isLeafNode(nodecount))
 		{
-			btAABB leafbox;
-			m_primitive_manager->get_primitive_box(getNodeData(nodecount),leafbox);
-			setNodeBound(nodecount,leafbox);
+			m_box_tree.mergeChildBounds(nodecount);
+			m_internal_node_area += m_box_tree.getNodeArea(nodecount);
 		}
+	}
+
+	rebuildIfDegraded();
+}
+
+struct btGImpactLessNodeIndex
+{
+	bool operator() (int a, int b) const
+	{
+		return a < b;
+	}
+};
+
+void btGImpactQuantizedBvh::mergeAncestorNodes(const int * sorted_leaf_nodes, int num_leaf_nodes, int nodeindex)
+{
+	if(isLeafNode(nodeindex))
+		return;
+
+	int left = getLeftNode(nodeindex);
+	int right = getRightNode(nodeindex);
+
+	//the leaves before the right node are in the left subtree
+	int num_left = 0;
+	int high = num_leaf_nodes;
+	while(num_left < high)
+	{
+		int mid = (num_left+high)/2;
+		if(sorted_leaf_nodes[mid] < right)
+			num_left = mid+1;
 		else
-		{
-			//const GIM_BVH_TREE_NODE * nodepointer = get_node_pointer(nodecount);
-			//get left bound
-			btAABB bound;
-			bound.invalidate();
+			high = mid;
+	}
+	if(num_left > 0)
+		mergeAncestorNodes(sorted_leaf_nodes,num_left,left);
+	if(num_left < num_leaf_nodes)
+		mergeAncestorNodes(sorted_leaf_nodes+num_left,num_leaf_nodes-num_left,right);
+
+	m_internal_node_area -= m_box_tree.getNodeArea(nodeindex);
+	m_box_tree.mergeChildBounds(nodeindex);
+	m_internal_node_area += m_box_tree.getNodeArea(nodeindex);
+}
 
-			btAABB temp_box;
+void btGImpactQuantizedBvh::refitPrimitives(const int * primitive_indices, int num_primitives)
+{
+	btAssert(getNodeCount() > 0);
+	if (num_primitives == 0)
+		return;
 
-			int child_node = getLeftNode(nodecount);
-			if(child_node)
+	if (m_primitive_leaf_nodes.size() == 0)
+	{
+		m_primitive_leaf_nodes.resize(m_primitive_manager->get_primitive_count());
+		for (int node = 0; node < getNodeCount(); ++node)
+		{
+			if (isLeafNode(node))
 			{
-				getNodeBound(child_node,temp_box);
-				bound.merge(temp_box);
+				m_primitive_leaf_nodes[getNodeData(node)] = node;
 			}
+		}
+	}
 
-			child_node = getRightNode(nodecount);
-			if(child_node)
-			{
-				getNodeBound(child_node,temp_box);
-				bound.merge(temp_box);
-			}
+	m_refit_nodes.resize(num_primitives);
+	for (int i = 0; i < num_primitives; ++i)
+	{
+		m_refit_nodes[i] = m_primitive_leaf_nodes[primitive_indices[i]];
+	}
+
+	m_refit_nodes.quickSort(btGImpactLessNodeIndex());
+
+	if (!_refit_leaf_nodes(this,&m_refit_nodes))
+	{
+		buildSet();
+		return;
+	}
 
-			setNodeBound(nodecount,bound);
+	mergeAncestorNodes(&m_refit_nodes[0],m_refit_nodes.size(),0);
+
+	rebuildIfDegraded();
+}
+
+btScalar btGImpactQuantizedBvh::calcInternalNodeArea() const
+{
+	btScalar area = btScalar(0.);
+	for (int node = 0; node < getNodeCount(); ++node)
+	{
+		if (!isLeafNode(node))
+		{
+			area += m_box_tree.getNodeArea(node);
 		}
 	}
+	return area;
+}
+
+void btGImpactQuantizedBvh::rebuildIfDegraded()
+{
+	if (m_internal_node_area > m_rebuild_ratio*m_build_cost*m_box_tree.getNodeArea(0))
+	{
+		buildSet();
+	}
 }
 
 //! this rebuild the entire set
@@ -297,6 +462,10 @@ void btGImpactQuantizedBvh::buildSet()
 	}
 
 	m_box_tree.build_tree(primitive_boxes);
+
+	m_primitive_leaf_nodes.resize(0);
+	m_internal_node_area = calcInternalNodeArea();
+	m_build_cost = getNodeCount() ? m_internal_node_area/m_box_tree.getNodeArea(0) : btScalar(0.);
 }
 
 //! returns the indices of the primitives in the m_primitive_manager
@@ -501,6 +670,127 @@ static void _find_quantized_collision_pairs_recursive(
 }
 
 
+//! appends the node pairs visited by _find_quantized_collision_pairs_recursive after a successful node test, in the same order
+static void _expand_quantized_node_pair(
+	const btGImpactQuantizedBvh * boxset0, const btGImpactQuantizedBvh * boxset1,
+	int node0, int node1, btPairSet & node_pairs)
+{
+	if(boxset0->isLeafNode(node0))
+	{
+		node_pairs.push_pair(node0,boxset1->getLeftNode(node1));
+		node_pairs.push_pair(node0,boxset1->getRightNode(node1));
+	}
+	else if(boxset1->isLeafNode(node1))
+	{
+		node_pairs.push_pair(boxset0->getLeftNode(node0),node1);
+		node_pairs.push_pair(boxset0->getRightNode(node0),node1);
+	}
+	else
+	{
+		node_pairs.push_pair(boxset0->getLeftNode(node0),boxset1->getLeftNode(node1));
+		node_pairs.push_pair(boxset0->getLeftNode(node0),boxset1->getRightNode(node1));
+		node_pairs.push_pair(boxset0->getRightNode(node0),boxset1->getLeftNode(node1));
+		node_pairs.push_pair(boxset0->getRightNode(node0),boxset1->getRightNode(node1));
+	}
+}
+
+//! collides a range of node pairs, each task collects its primitive pairs separately
+struct btGImpactQuantizedBvhPairLoop : public btIParallelForBody
+{
+	const btGImpactQuantizedBvh * m_boxset0;
+	const btGImpactQuantizedBvh * m_boxset1;
+	const BT_BOX_BOX_TRANSFORM_CACHE * m_trans_cache_1to0;
+	const btPairSet * m_node_pairs;
+	btAlignedObjectArray<btPairSet> * m_task_pairs;
+	int m_grainSize;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for (int task = iBegin; task < iEnd; ++task)
+		{
+			btPairSet & pairs = (*m_task_pairs)[task];
+			pairs.resize(0);
+			int pairBegin = task*m_grainSize;
+			int pairEnd = btMin(pairBegin+m_grainSize,m_node_pairs->size());
+			for (int i = pairBegin; i < pairEnd; ++i)
+			{
+				const GIM_PAIR & node_pair = (*m_node_pairs)[i];
+				_find_quantized_collision_pairs_recursive(
+					m_boxset0,m_boxset1,
+					&pairs,*m_trans_cache_1to0,node_pair.m_index1,node_pair.m_index2,false);
+			}
+		}
+	}
+};
+
+//! splits the traversal into independent node pairs and collides them with btParallelFor.
+//! The node pairs are expanded in traversal order and the results are concatenated in the same order,
+//! so the primitive pairs are the same as with the recursive traversal
+static void _find_quantized_collision_pairs_parallel(
+	const btGImpactQuantizedBvh * boxset0, const btGImpactQuantizedBvh * boxset1,
+	btPairSet * collision_pairs,
+	const BT_BOX_BOX_TRANSFORM_CACHE & trans_cache_1to0)
+{
+	if( _quantized_node_collision(
+		boxset0,boxset1,trans_cache_1to0,
+		0,0,true) ==false) return;
+
+	if(boxset0->isLeafNode(0) && boxset1->isLeafNode(0))
+	{
+		collision_pairs->push_pair(boxset0->getNodeData(0),boxset1->getNodeData(0));
+		return;
+	}
+
+	const int targetNodePairs = 256;
+	btPairSet node_pair_buffers[2];
+	btPairSet * node_pairs = &node_pair_buffers[0];
+	btPairSet * next_node_pairs = &node_pair_buffers[1];
+	_expand_quantized_node_pair(boxset0,boxset1,0,0,*node_pairs);
+	bool expanded = true;
+	while(expanded && node_pairs->size() < targetNodePairs)
+	{
+		expanded = false;
+		next_node_pairs->resize(0);
+		for (int i = 0; i < node_pairs->size(); ++i)
+		{
+			int node0 = (*node_pairs)[i].m_index1;
+			int node1 = (*node_pairs)[i].m_index2;
+			if(boxset0->isLeafNode(node0) && boxset1->isLeafNode(node1))
+			{
+				next_node_pairs->push_pair(node0,node1);
+			}
+			else if(_quantized_node_collision(boxset0,boxset1,trans_cache_1to0,node0,node1,false))
+			{
+				_expand_quantized_node_pair(boxset0,boxset1,node0,node1,*next_node_pairs);
+				expanded = true;
+			}
+		}
+		btSwap(node_pairs,next_node_pairs);
+	}
+
+	const int grainSize = 4;
+	int numTasks = (node_pairs->size()+grainSize-1)/grainSize;
+	btAlignedObjectArray<btPairSet> task_pairs;
+	task_pairs.resize(numTasks);
+	btGImpactQuantizedBvhPairLoop loop;
+	loop.m_boxset0 = boxset0;
+	loop.m_boxset1 = boxset1;
+	loop.m_trans_cache_1to0 = &trans_cache_1to0;
+	loop.m_node_pairs = node_pairs;
+	loop.m_task_pairs = &task_pairs;
+	loop.m_grainSize = grainSize;
+	btParallelFor(0,numTasks,1,loop);
+
+	for (int task = 0; task < numTasks; ++task)
+	{
+		for (int i = 0; i < task_pairs[task].size(); ++i)
+		{
+			collision_pairs->push_back(task_pairs[task][i]);
+		}
+	}
+}
+
+
 void btGImpactQuantizedBvh::find_collision(const btGImpactQuantizedBvh * boxset0, const btTransform & trans0,
 		const btGImpactQuantizedBvh * boxset1, const btTransform & trans1,
 		btPairSet & collision_pairs)
@@ -516,9 +806,18 @@ void btGImpactQuantizedBvh::find_collision(const btGImpactQuantizedBvh * boxset0
 	bt_begin_gim02_q_tree_time();
 #endif //TRI_COLLISION_PROFILING
 
-	_find_quantized_collision_pairs_recursive(
-		boxset0,boxset1,
-		&collision_pairs,trans_cache_1to0,0,0,true);
+	if (useParallelLoops(btMax(boxset0->getNodeCount(),boxset1->getNodeCount())))
+	{
+		_find_quantized_collision_pairs_parallel(
+			boxset0,boxset1,
+			&collision_pairs,trans_cache_1to0);
+	}
+	else
+	{
+		_find_quantized_collision_pairs_recursive(
+			boxset0,boxset1,
+			&collision_pairs,trans_cache_1to0,0,0,true);
+	}
 #ifdef TRI_COLLISION_PROFILING
 	bt_end_gim02_q_tree_time();
 #endif //TRI_COLLISION_PROFILING
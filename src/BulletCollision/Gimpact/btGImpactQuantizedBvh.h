@@ -126,6 +126,38 @@ public:
 							m_bvhQuantization);
 	}
 
+	//! tells if the bound can be quantized without clamping
+	SIMD_FORCE_INLINE bool isInsideQuantizationBound(const btAABB & bound) const
+	{
+		return m_global_bound.m_min[0] <= bound.m_min[0] && m_global_bound.m_min[1] <= bound.m_min[1] && m_global_bound.m_min[2] <= bound.m_min[2] &&
+			bound.m_max[0] <= m_global_bound.m_max[0] && bound.m_max[1] <= m_global_bound.m_max[1] && bound.m_max[2] <= m_global_bound.m_max[2];
+	}
+
+	//! sets the bound of an internal node to the union of the bounds of its children, without unquantizing them
+	SIMD_FORCE_INLINE void mergeChildBounds(int nodeindex)
+	{
+		BT_QUANTIZED_BVH_NODE & node = m_node_array[nodeindex];
+		const BT_QUANTIZED_BVH_NODE & left = m_node_array[getLeftNode(nodeindex)];
+		const BT_QUANTIZED_BVH_NODE & right = m_node_array[getRightNode(nodeindex)];
+		for (int i=0;i<3;i++)
+		{
+			node.m_quantizedAabbMin[i] = btMin(left.m_quantizedAabbMin[i],right.m_quantizedAabbMin[i]);
+			node.m_quantizedAabbMax[i] = btMax(left.m_quantizedAabbMax[i],right.m_quantizedAabbMax[i]);
+		}
+	}
+
+	//! surface area of the node bound
+	SIMD_FORCE_INLINE btScalar getNodeArea(int nodeindex) const
+	{
+		const BT_QUANTIZED_BVH_NODE & node = m_node_array[nodeindex];
+		btVector3 extent(
+			btScalar(node.m_quantizedAabbMax[0] - node.m_quantizedAabbMin[0]),
+			btScalar(node.m_quantizedAabbMax[1] - node.m_quantizedAabbMin[1]),
+			btScalar(node.m_quantizedAabbMax[2] - node.m_quantizedAabbMin[2]));
+		extent = extent / m_bvhQuantization;
+		return btScalar(2.)*(extent[0]*extent[1] + extent[1]*extent[2] + extent[2]*extent[0]);
+	}
+
 	SIMD_FORCE_INLINE int getLeftNode(int nodeindex) const
 	{
 		return nodeindex+1;
@@ -164,20 +196,44 @@ protected:
 	btPrimitiveManagerBase * m_primitive_manager;
 
 protected:
+	btAlignedObjectArray<int> m_primitive_leaf_nodes;//!< leaf node of each primitive, built by the first refitPrimitives
+	btAlignedObjectArray<int> m_refit_nodes;
+	btScalar m_internal_node_area;//!< sum of the surface areas of the internal nodes
+	btScalar m_build_cost;//!< m_internal_node_area relative to the area of the root, after buildSet
+	btScalar m_rebuild_ratio;
+
 	//stackless refit
 	void refit();
+
+	btScalar calcInternalNodeArea() const;
+
+	//! merges the internal nodes of the subtree that contain one of the sorted leaf nodes, children first
+	void mergeAncestorNodes(const int * sorted_leaf_nodes, int num_leaf_nodes, int nodeindex);
+
+	//! rebuilds the set if refitting made it more than m_rebuild_ratio times more expensive to traverse than after buildSet
+	void rebuildIfDegraded();
+
+	friend struct btGImpactQuantizedBvhRefitLoop;
 public:
+	//! trees with at least this many nodes are refit and collided with btParallelFor, in BT_THREADSAFE builds only
+	static int s_minimumNodesForParallelLoops;
 
 	//! this constructor doesn't build the tree. you must call	buildSet
 	btGImpactQuantizedBvh()
 	{
 		m_primitive_manager = NULL;
+		m_internal_node_area = btScalar(0.);
+		m_build_cost = btScalar(0.);
+		m_rebuild_ratio = btScalar(2.);
 	}
 
 	//! this constructor doesn't build the tree. you must call	buildSet
 	btGImpactQuantizedBvh(btPrimitiveManagerBase * primitive_manager)
 	{
 		m_primitive_manager = primitive_manager;
+		m_internal_node_area = btScalar(0.);
+		m_build_cost = btScalar(0.);
+		m_rebuild_ratio = btScalar(2.);
 	}
 
 	SIMD_FORCE_INLINE btAABB getGlobalBox()  const
@@ -210,6 +266,26 @@ public:
 	//! this rebuild the entire set
 	void buildSet();
 
+	//! refits the leaves of the given primitives and their ancestors only
+	/*!
+	For sets where only a few primitives moved, otherwise update() is faster. Large sets of primitives are
+	refit with btParallelFor. The set is rebuilt if a primitive left the quantization range, or if the
+	refitted set became more expensive to traverse than getRebuildRatio() times the cost after buildSet.
+	\pre the set is built
+	*/
+	void refitPrimitives(const int * primitive_indices, int num_primitives);
+
+	//! the traversal cost increase, measured as the surface area of the internal nodes relative to the root, that triggers a rebuild on refit
+	SIMD_FORCE_INLINE void setRebuildRatio(btScalar ratio)
+	{
+		m_rebuild_ratio = ratio;
+	}
+
+	SIMD_FORCE_INLINE btScalar getRebuildRatio() const
+	{
+		return m_rebuild_ratio;
+	}
+
 	//! returns the indices of the primitives in the m_primitive_manager
 	bool boxQuery(const btAABB & box, btAlignedObjectArray<int> & collided_results) const;
 
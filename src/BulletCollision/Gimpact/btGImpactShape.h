@@ -145,6 +145,27 @@ public:
     	m_needs_update = true;
     }
 
+	//! Refits the box set for the given primitives only, and updates the local box
+	/*!
+	Use this instead of postUpdate() when only a few primitives moved,
+	see btGImpactQuantizedBvh::refitPrimitives.
+	*/
+	virtual void refitPrimitives(const int * primitive_indices, int num_primitives)
+	{
+		lockChildShapes();
+		if(m_box_set.getNodeCount() == 0)
+		{
+			m_box_set.buildSet();
+		}
+		else
+		{
+			m_box_set.refitPrimitives(primitive_indices,num_primitives);
+		}
+		unlockChildShapes();
+
+		m_localAABB = m_box_set.getGlobalBox();
+	}
+
 	//! Obtains the local box, which is the global calculated box of the total of subshapes
 	SIMD_FORCE_INLINE const btAABB & getLocalBox()
 	{
@@ -1002,6 +1023,27 @@ public:
     	m_needs_update = true;
     }
 
+	//! use refitTriangles instead
+	virtual void refitPrimitives(const int * primitive_indices, int num_primitives)
+	{
+		(void) primitive_indices;
+		(void) num_primitives;
+		btAssert(0);
+	}
+
+	//! Refits the box set of a mesh part for the given triangles of that part only, and updates the local box
+	void refitTriangles(int part, const int * triangle_indices, int num_triangles)
+	{
+		m_mesh_parts[part]->refitPrimitives(triangle_indices,num_triangles);
+
+		m_localAABB.invalidate();
+		int i = m_mesh_parts.size();
+		while(i--)
+		{
+			m_localAABB.merge(m_mesh_parts[i]->getLocalBox());
+		}
+	}
+
 	virtual void	calculateLocalInertia(btScalar mass,btVector3& inertia) const;
 
 
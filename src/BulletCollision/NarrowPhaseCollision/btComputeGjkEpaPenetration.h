@@ -26,8 +26,8 @@ subject to the following restrictions:
 
 
 
-template <typename btConvexTemplate>
-bool btGjkEpaCalcPenDepth(const btConvexTemplate& a, const btConvexTemplate& b,
+template <typename btConvexTemplateA, typename btConvexTemplateB>
+bool btGjkEpaCalcPenDepth(const btConvexTemplateA& a, const btConvexTemplateB& b,
                           const btGjkCollisionDescription& colDesc,
                           btVector3& v, btVector3& wWitnessOnA, btVector3& wWitnessOnB)
 {
@@ -62,8 +62,8 @@ bool btGjkEpaCalcPenDepth(const btConvexTemplate& a, const btConvexTemplate& b,
     return false;
 }
 
-template <typename btConvexTemplate, typename btGjkDistanceTemplate>
-int	btComputeGjkEpaPenetration(const btConvexTemplate& a, const btConvexTemplate& b, const btGjkCollisionDescription& colDesc, btVoronoiSimplexSolver& simplexSolver, btGjkDistanceTemplate* distInfo)
+template <typename btConvexTemplateA, typename btConvexTemplateB, typename btGjkDistanceTemplate>
+int	btComputeGjkEpaPenetration(const btConvexTemplateA& a, const btConvexTemplateB& b, const btGjkCollisionDescription& colDesc, btVoronoiSimplexSolver& simplexSolver, btGjkDistanceTemplate* distInfo)
 {
     
     bool m_catchDegeneracies  = true;
@@ -262,7 +262,7 @@ int	btComputeGjkEpaPenetration(const btConvexTemplate& a, const btConvexTemplate
         }
         
         bool catchDegeneratePenetrationCase =
-        (m_catchDegeneracies &&  m_degenerateSimplex && ((distance+margin) < 0.01));
+        (m_catchDegeneracies &&  m_degenerateSimplex && ((distance+margin) < colDesc.m_penetrationTolerance));
         
         //if (checkPenetration && !isValid)
         if (checkPenetration && (!isValid || catchDegeneratePenetrationCase ))
@@ -354,6 +354,22 @@ int	btComputeGjkEpaPenetration(const btConvexTemplate& a, const btConvexTemplate
         
         m_cachedSeparatingAxis = normalInB;
         m_cachedSeparatingDistance = distance;
+        
+        {
+            ///same as btGjkPairDetector: the penetration solver can report a normal that points in the opposite
+            ///direction, detect the issue and revert the normal
+            btVector3 pInA = a.getLocalSupportWithoutMargin(normalInB* localTransA.getBasis());
+            btVector3 qInB = b.getLocalSupportWithoutMargin(-normalInB* localTransB.getBasis());
+            btScalar d1 = (-normalInB).dot(localTransA(pInA) - localTransB(qInB));
+            
+            pInA = a.getLocalSupportWithoutMargin((-normalInB)* localTransA.getBasis());
+            qInB = b.getLocalSupportWithoutMargin(normalInB* localTransB.getBasis());
+            btScalar d0 = normalInB.dot(localTransA(pInA) - localTransB(qInB));
+            if (d1>d0)
+            {
+                normalInB *= -1;
+            }
+        }
         distInfo->m_distance = distance;
         distInfo->m_normalBtoA = normalInB;
         distInfo->m_pointOnB = pointOnB;
@@ -25,11 +25,13 @@ struct btGjkCollisionDescription
     int			m_maxGjkIterations;
     btScalar	m_maximumDistanceSquared;
     btScalar	m_gjkRelError2;
+    btScalar	m_penetrationTolerance;	//run the penetration solver when GJK ends in a degenerate simplex closer than this
     btGjkCollisionDescription()
     :m_firstDir(0,1,0),
     m_maxGjkIterations(1000),
     m_maximumDistanceSquared(1e30f),
-    m_gjkRelError2(1.0e-6)
+    m_gjkRelError2(1.0e-6),
+    m_penetrationTolerance(0.01)
     {
     }
     virtual ~btGjkCollisionDescription()
@@ -50,8 +50,7 @@ class btManifoldPoint
 	{
 		public:
 			btManifoldPoint()
-				:m_userPersistentData(0),
-				m_contactPointFlags(0),
+				:m_contactPointFlags(0),
 				m_appliedImpulse(0.f),
                 m_appliedImpulseLateral1(0.f),
 				m_appliedImpulseLateral2(0.f),
@@ -60,6 +59,7 @@ class btManifoldPoint
 				m_contactCFM(0.f),
 				m_contactERP(0.f),
 				m_frictionCFM(0.f),
+				m_userPersistentData(0),
 				m_lifeTime(0)
 			{
 			}
@@ -67,15 +67,12 @@ class btManifoldPoint
 			btManifoldPoint( const btVector3 &pointA, const btVector3 &pointB, 
 					const btVector3 &normal, 
 					btScalar distance ) :
-					m_localPointA( pointA ), 
-					m_localPointB( pointB ), 
 					m_normalWorldOnB( normal ), 
 					m_distance1( distance ),
 					m_combinedFriction(btScalar(0.)),
 					m_combinedRollingFriction(btScalar(0.)),
                     m_combinedSpinningFriction(btScalar(0.)),
                     m_combinedRestitution(btScalar(0.)),
-					m_userPersistentData(0),
 					m_contactPointFlags(0),
 					m_appliedImpulse(0.f),
                     m_appliedImpulseLateral1(0.f),
@@ -85,19 +82,23 @@ class btManifoldPoint
 					m_contactCFM(0.f),
 					m_contactERP(0.f),
 					m_frictionCFM(0.f),
-					m_lifeTime(0)
+					m_userPersistentData(0),
+					m_lifeTime(0),
+					m_localPointA( pointA ), 
+					m_localPointB( pointB )
 			{
 				
 			}
 
 			
 
-			btVector3 m_localPointA;			
-			btVector3 m_localPointB;			
+			//the members read and written by the constraint solver come first, so they share as few cache lines as possible
 			btVector3	m_positionWorldOnB;
 			///m_positionWorldOnA is redundant information, see getPositionWorldOnA(), but for clarity
 			btVector3	m_positionWorldOnA;
 			btVector3 m_normalWorldOnB;
+			btVector3		m_lateralFrictionDir1;
+			btVector3		m_lateralFrictionDir2;
 		
 			btScalar	m_distance1;
 			btScalar	m_combinedFriction;
@@ -105,13 +106,6 @@ class btManifoldPoint
             btScalar	m_combinedSpinningFriction;//torsional friction around contact normal, useful for grasping objects
             btScalar	m_combinedRestitution;
 
-			//BP mod, store contact triangles.
-			int			m_partId0;
-			int			m_partId1;
-			int			m_index0;
-			int			m_index1;
-				
-			mutable void*	m_userPersistentData;
 			//bool			m_lateralFrictionInitialized;
 			int				m_contactPointFlags;
 			
@@ -135,10 +129,17 @@ class btManifoldPoint
 
 			btScalar		m_frictionCFM;
 
+			mutable void*	m_userPersistentData;
 			int				m_lifeTime;//lifetime of the contactpoint in frames
-			
-			btVector3		m_lateralFrictionDir1;
-			btVector3		m_lateralFrictionDir2;
+
+			//BP mod, store contact triangles.
+			int			m_partId0;
+			int			m_partId1;
+			int			m_index0;
+			int			m_index1;
+
+			btVector3 m_localPointA;			
+			btVector3 m_localPointB;			
 
 
 
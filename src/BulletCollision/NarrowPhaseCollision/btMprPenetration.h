@@ -180,8 +180,8 @@ inline int btMprVec3Eq(const btVector3* a, const btVector3 *b)
 
 
 
-template <typename btConvexTemplate>
-inline void btFindOrigin(const btConvexTemplate& a, const btConvexTemplate& b, const btMprCollisionDescription& colDesc,btMprSupport_t *center)
+template <typename btConvexTemplateA, typename btConvexTemplateB>
+inline void btFindOrigin(const btConvexTemplateA& a, const btConvexTemplateB& b, const btMprCollisionDescription& colDesc,btMprSupport_t *center)
 {
 
 	center->v1 = a.getObjectCenterInWorld();
@@ -319,8 +319,8 @@ inline void btExpandPortal(btMprSimplex_t *portal,
         }
     }
 }
-template <typename btConvexTemplate>
-inline void btMprSupport(const btConvexTemplate& a, const btConvexTemplate& b,
+template <typename btConvexTemplateA, typename btConvexTemplateB>
+inline void btMprSupport(const btConvexTemplateA& a, const btConvexTemplateB& b,
                          const btMprCollisionDescription& colDesc,
 													const btVector3& dir, btMprSupport_t *supp)
 {
@@ -336,8 +336,8 @@ inline void btMprSupport(const btConvexTemplate& a, const btConvexTemplate& b,
 }
 
 
-template <typename btConvexTemplate>
-static int btDiscoverPortal(const btConvexTemplate& a, const btConvexTemplate& b,
+template <typename btConvexTemplateA, typename btConvexTemplateB>
+static int btDiscoverPortal(const btConvexTemplateA& a, const btConvexTemplateB& b,
                             const btMprCollisionDescription& colDesc,
 													btMprSimplex_t *portal)
 {
@@ -471,8 +471,8 @@ static int btDiscoverPortal(const btConvexTemplate& a, const btConvexTemplate& b
     return 0;
 }
 
-template <typename btConvexTemplate>
-static int btRefinePortal(const btConvexTemplate& a, const btConvexTemplate& b,const btMprCollisionDescription& colDesc,
+template <typename btConvexTemplateA, typename btConvexTemplateB>
+static int btRefinePortal(const btConvexTemplateA& a, const btConvexTemplateB& b,const btMprCollisionDescription& colDesc,
 							btMprSimplex_t *portal)
 {
     btVector3 dir;
@@ -731,8 +731,8 @@ inline float btMprVec3PointTriDist2(const btVector3 *P,
     return dist;
 }
 
-template <typename btConvexTemplate>
-static void btFindPenetr(const btConvexTemplate& a, const btConvexTemplate& b,
+template <typename btConvexTemplateA, typename btConvexTemplateB>
+static void btFindPenetr(const btConvexTemplateA& a, const btConvexTemplateB& b,
                          const btMprCollisionDescription& colDesc,
                          btMprSimplex_t *portal,
                          float *depth, btVector3 *pdir, btVector3 *pos)
@@ -824,8 +824,8 @@ static void btFindPenetrSegment(btMprSimplex_t *portal,
 }
 
 
-template <typename btConvexTemplate>
-inline int btMprPenetration( const btConvexTemplate& a, const btConvexTemplate& b,
+template <typename btConvexTemplateA, typename btConvexTemplateB>
+inline int btMprPenetration( const btConvexTemplateA& a, const btConvexTemplateB& b,
                             const btMprCollisionDescription& colDesc,
 					float *depthOut, btVector3* dirOut, btVector3* posOut)
 {
@@ -883,8 +883,8 @@ inline int btMprPenetration( const btConvexTemplate& a, const btConvexTemplate&
 };
 
 
-template<typename btConvexTemplate, typename btMprDistanceTemplate>
-inline int	btComputeMprPenetration( const btConvexTemplate& a, const btConvexTemplate& b, const
+template<typename btConvexTemplateA, typename btConvexTemplateB, typename btMprDistanceTemplate>
+inline int	btComputeMprPenetration( const btConvexTemplateA& a, const btConvexTemplateB& b, const
                                     btMprCollisionDescription& colDesc, btMprDistanceTemplate* distInfo)
 {
 	btVector3 dir,pos;
@@ -39,6 +39,7 @@ btPersistentManifold::btPersistentManifold()
 m_body0(0),
 m_body1(0),
 m_cachedPoints (0),
+m_contactCallbacksEnabled(true),
 m_companionIdA(0),
 m_companionIdB(0),
 m_index1a(0)
@@ -300,7 +301,7 @@ void btPersistentManifold::refreshContactPoints(const btTransform& trA,const btT
 			} else
 			{
 				//contact point processed callback
-				if (gContactProcessedCallback)
+				if (gContactProcessedCallback && m_contactCallbacksEnabled)
 					(*gContactProcessedCallback)(manifoldPoint,(void*)m_body0,(void*)m_body1);
 			}
 		}
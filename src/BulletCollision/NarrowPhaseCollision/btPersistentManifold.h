@@ -64,8 +64,7 @@ enum btContactManifoldTypes
 //ATTRIBUTE_ALIGNED128( class) btPersistentManifold : public btTypedObject
 ATTRIBUTE_ALIGNED16( class) btPersistentManifold : public btTypedObject
 {
-
-	btManifoldPoint m_pointCache[MANIFOLD_CACHE_SIZE];
+	//the members read by the constraint solver are stored before the contact points
 
 	/// this two body pointers can point to the physics rigidbody class.
 	const btCollisionObject* m_body0;
@@ -76,6 +75,9 @@ ATTRIBUTE_ALIGNED16( class) btPersistentManifold : public btTypedObject
 	btScalar	m_contactBreakingThreshold;
 	btScalar	m_contactProcessingThreshold;
 
+	btManifoldPoint m_pointCache[MANIFOLD_CACHE_SIZE];
+
+	bool	m_contactCallbacksEnabled;
 	
 	/// sort cached points so most isolated points come first
 	int	sortCachedPoints(const btManifoldPoint& pt);
@@ -98,6 +100,7 @@ public:
 	m_body0(body0),m_body1(body1),m_cachedPoints(0),
 		m_contactBreakingThreshold(contactBreakingThreshold),
 		m_contactProcessingThreshold(contactProcessingThreshold),
+		m_contactCallbacksEnabled(true),
 		m_companionIdA(0),
 		m_companionIdB(0),
 		m_index1a(0)
@@ -156,6 +159,18 @@ public:
 	{
 		m_contactProcessingThreshold = contactProcessingThreshold;
 	}
+
+	///manifolds that are private to a collision algorithm and not registered with the dispatcher disable the
+	///gContactStartedCallback, gContactEndedCallback and gContactProcessedCallback. gContactDestroyedCallback is still called for user data.
+	void setContactCallbacksEnabled(bool enabled)
+	{
+		m_contactCallbacksEnabled = enabled;
+	}
+
+	bool getContactCallbacksEnabled() const
+	{
+		return m_contactCallbacksEnabled;
+	}
 	
 	
 
@@ -185,7 +200,7 @@ public:
 		btAssert(m_pointCache[lastUsedIndex].m_userPersistentData==0);
 		m_cachedPoints--;
 
-		if (gContactEndedCallback && m_cachedPoints == 0)
+		if (gContactEndedCallback && m_cachedPoints == 0 && m_contactCallbacksEnabled)
 		{
 			gContactEndedCallback(this);
 		}
@@ -254,7 +269,7 @@ public:
 			clearUserCache(m_pointCache[i]);
 		}
 
-		if (gContactEndedCallback && m_cachedPoints)
+		if (gContactEndedCallback && m_cachedPoints && m_contactCallbacksEnabled)
 		{
 			gContactEndedCallback(this);
 		}
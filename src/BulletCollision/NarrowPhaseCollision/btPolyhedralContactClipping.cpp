@@ -237,7 +237,85 @@ void InverseTransformPoint3x3(btVector3& out, const btVector3& in, const btTrans
 
 
 
-bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, btVector3& sep, btDiscreteCollisionDetectorInterface::Result& resultOut)
+//compute the world space axis of a cached feature, pointing from hullB to hullA
+static bool computeFeatureAxis(const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, const btVector3& DeltaC2, const btSeparatingFeatureCache& featureCache, btVector3& axis, btVector3& worldEdgeA, btVector3& worldEdgeB)
+{
+	switch (featureCache.m_featureType)
+	{
+	case btSeparatingFeatureCache::BT_SEPARATING_FEATURE_FACE_A:
+		{
+			if (featureCache.m_featureA >= hullA.m_faces.size())
+				return false;
+			const btScalar* plane = hullA.m_faces[featureCache.m_featureA].m_plane;
+			axis = transA.getBasis() * btVector3(plane[0], plane[1], plane[2]);
+			break;
+		}
+	case btSeparatingFeatureCache::BT_SEPARATING_FEATURE_FACE_B:
+		{
+			if (featureCache.m_featureB >= hullB.m_faces.size())
+				return false;
+			const btScalar* plane = hullB.m_faces[featureCache.m_featureB].m_plane;
+			axis = transB.getBasis() * btVector3(plane[0], plane[1], plane[2]);
+			break;
+		}
+	case btSeparatingFeatureCache::BT_SEPARATING_FEATURE_EDGE_EDGE:
+		{
+			if (featureCache.m_featureA >= hullA.m_uniqueEdges.size() || featureCache.m_featureB >= hullB.m_uniqueEdges.size())
+				return false;
+			worldEdgeA = transA.getBasis() * hullA.m_uniqueEdges[featureCache.m_featureA];
+			worldEdgeB = transB.getBasis() * hullB.m_uniqueEdges[featureCache.m_featureB];
+			axis = worldEdgeA.cross(worldEdgeB);
+			if (IsAlmostZero(axis))
+				return false;
+			axis.normalize();
+			break;
+		}
+	default:
+		return false;
+	}
+	if (DeltaC2.dot(axis)<0)
+		axis *= -1.f;
+	return true;
+}
+
+//add an edge-edge contact at the closest points of the two edges
+static void addEdgeEdgeContact(const btVector3& DeltaC2, const btVector3& worldEdgeA, const btVector3& worldEdgeB, const btVector3& witnessPointA, const btVector3& witnessPointB, btDiscreteCollisionDetectorInterface::Result& resultOut)
+{
+	btVector3 ptsVector;
+	btVector3 offsetA;
+	btVector3 offsetB;
+	btScalar tA;
+	btScalar tB;
+
+	btVector3 translation = witnessPointB-witnessPointA;
+
+	btVector3 dirA = worldEdgeA;
+	btVector3 dirB = worldEdgeB;
+	
+	btScalar hlenB = 1e30f;
+	btScalar hlenA = 1e30f;
+
+	btSegmentsClosestPoints(ptsVector,offsetA,offsetB,tA,tB,
+		translation,
+		dirA, hlenA,
+		dirB,hlenB);
+
+	btScalar nlSqrt = ptsVector.length2();
+	if (nlSqrt>SIMD_EPSILON)
+	{
+		btScalar nl = btSqrt(nlSqrt);
+		ptsVector *= 1.f/nl;
+		if (ptsVector.dot(DeltaC2)<0.f)
+		{
+			ptsVector*=-1.f;
+		}
+		btVector3 ptOnB = witnessPointB + offsetB;
+		btScalar distance = nl;
+		resultOut.addContactPoint(ptsVector, ptOnB,-distance);
+	}
+}
+
+bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, btVector3& sep, btDiscreteCollisionDetectorInterface::Result& resultOut, btSeparatingFeatureCache* featureCache)
 {
 	gActualSATPairTests++;
 
@@ -248,8 +326,48 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 //#endif
 
 	btScalar dmin = FLT_MAX;
+	btScalar cachedDmin = FLT_MAX;
 	int curPlaneTests=0;
 
+	btVector3 worldEdgeA;
+	btVector3 worldEdgeB;
+	btVector3 witnessPointA(0,0,0),witnessPointB(0,0,0);
+
+	int featureType = btSeparatingFeatureCache::BT_SEPARATING_FEATURE_NONE;
+	int featureA = -1;
+	int featureB = -1;
+
+	if (featureCache)
+	{
+		btTransform relativeTransform = transA.inverseTimes(transB);
+		btVector3 cachedAxis;
+		if (computeFeatureAxis(hullA, hullB, transA, transB, DeltaC2, *featureCache, cachedAxis, worldEdgeA, worldEdgeB))
+		{
+			btScalar d;
+			btVector3 wA,wB;
+			if(!TestSepAxis( hullA, hullB, transA,transB, cachedAxis, d,wA,wB))
+			{
+				featureCache->m_separated = true;
+				return false;
+			}
+
+			if (!featureCache->m_separated && featureCache->hasSmallRelativeMotion(relativeTransform))
+			{
+				if (featureCache->m_featureType == btSeparatingFeatureCache::BT_SEPARATING_FEATURE_EDGE_EDGE)
+				{
+					addEdgeEdgeContact(DeltaC2, worldEdgeA, worldEdgeB, wA, wB, resultOut);
+				}
+				sep = cachedAxis;
+				return true;
+			}
+
+			//the depth along the cached axis lets TestInternalObjects skip more axes below. The axes are still picked
+			//in the same order as without cache, so the result does not change.
+			cachedDmin = d;
+		}
+		featureCache->m_relativeTransform = relativeTransform;
+	}
+
 	int numFacesA = hullA.m_faces.size();
 	// Test normals from hullA
 	for(int i=0;i<numFacesA;i++)
@@ -262,7 +380,7 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 		curPlaneTests++;
 #ifdef TEST_INTERNAL_OBJECTS
 		gExpectedNbTests++;
-		if(gUseInternalObject && !TestInternalObjects(transA,transB, DeltaC2, faceANormalWS, hullA, hullB, dmin))
+		if(gUseInternalObject && !TestInternalObjects(transA,transB, DeltaC2, faceANormalWS, hullA, hullB, btMin(dmin,cachedDmin)))
 			continue;
 		gActualNbTests++;
 #endif
@@ -270,12 +388,19 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 		btScalar d;
 		btVector3 wA,wB;
 		if(!TestSepAxis( hullA, hullB, transA,transB, faceANormalWS, d,wA,wB))
+		{
+			if (featureCache)
+				featureCache->setFeature(btSeparatingFeatureCache::BT_SEPARATING_FEATURE_FACE_A, i, -1, true);
 			return false;
+		}
 
 		if(d<dmin)
 		{
 			dmin = d;
 			sep = faceANormalWS;
+			featureType = btSeparatingFeatureCache::BT_SEPARATING_FEATURE_FACE_A;
+			featureA = i;
+			featureB = -1;
 		}
 	}
 
@@ -291,7 +416,7 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 		curPlaneTests++;
 #ifdef TEST_INTERNAL_OBJECTS
 		gExpectedNbTests++;
-		if(gUseInternalObject && !TestInternalObjects(transA,transB,DeltaC2, WorldNormal, hullA, hullB, dmin))
+		if(gUseInternalObject && !TestInternalObjects(transA,transB,DeltaC2, WorldNormal, hullA, hullB, btMin(dmin,cachedDmin)))
 			continue;
 		gActualNbTests++;
 #endif
@@ -299,23 +424,22 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 		btScalar d;
 		btVector3 wA,wB;
 		if(!TestSepAxis(hullA, hullB,transA,transB, WorldNormal,d,wA,wB))
+		{
+			if (featureCache)
+				featureCache->setFeature(btSeparatingFeatureCache::BT_SEPARATING_FEATURE_FACE_B, -1, i, true);
 			return false;
+		}
 
 		if(d<dmin)
 		{
 			dmin = d;
 			sep = WorldNormal;
+			featureType = btSeparatingFeatureCache::BT_SEPARATING_FEATURE_FACE_B;
+			featureA = -1;
+			featureB = i;
 		}
 	}
 
-	btVector3 edgeAstart,edgeAend,edgeBstart,edgeBend;
-	int edgeA=-1;
-	int edgeB=-1;
-	btVector3 worldEdgeA;
-	btVector3 worldEdgeB;
-	btVector3 witnessPointA(0,0,0),witnessPointB(0,0,0);
-	
-
 	int curEdgeEdge = 0;
 	// Test edges
 	for(int e0=0;e0<hullA.m_uniqueEdges.size();e0++)
@@ -338,7 +462,7 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 
 #ifdef TEST_INTERNAL_OBJECTS
 				gExpectedNbTests++;
-				if(gUseInternalObject && !TestInternalObjects(transA,transB,DeltaC2, Cross, hullA, hullB, dmin))
+				if(gUseInternalObject && !TestInternalObjects(transA,transB,DeltaC2, Cross, hullA, hullB, btMin(dmin,cachedDmin)))
 					continue;
 				gActualNbTests++;
 #endif
@@ -346,62 +470,37 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 				btScalar dist;
 				btVector3 wA,wB;
 				if(!TestSepAxis( hullA, hullB, transA,transB, Cross, dist,wA,wB))
+				{
+					if (featureCache)
+						featureCache->setFeature(btSeparatingFeatureCache::BT_SEPARATING_FEATURE_EDGE_EDGE, e0, e1, true);
 					return false;
+				}
 
 				if(dist<dmin)
 				{
 					dmin = dist;
 					sep = Cross;
-					edgeA=e0;
-					edgeB=e1;
 					worldEdgeA = WorldEdge0;
 					worldEdgeB = WorldEdge1;
 					witnessPointA=wA;
 					witnessPointB=wB;
+					featureType = btSeparatingFeatureCache::BT_SEPARATING_FEATURE_EDGE_EDGE;
+					featureA = e0;
+					featureB = e1;
 				}
 			}
 		}
 
 	}
 
-	if (edgeA>=0&&edgeB>=0)
+	if (featureCache)
 	{
-//		printf("edge-edge\n");
-		//add an edge-edge contact
-
-		btVector3 ptsVector;
-		btVector3 offsetA;
-		btVector3 offsetB;
-		btScalar tA;
-		btScalar tB;
-
-		btVector3 translation = witnessPointB-witnessPointA;
-
-		btVector3 dirA = worldEdgeA;
-		btVector3 dirB = worldEdgeB;
-		
-		btScalar hlenB = 1e30f;
-		btScalar hlenA = 1e30f;
-
-		btSegmentsClosestPoints(ptsVector,offsetA,offsetB,tA,tB,
-			translation,
-			dirA, hlenA,
-			dirB,hlenB);
-
-		btScalar nlSqrt = ptsVector.length2();
-		if (nlSqrt>SIMD_EPSILON)
-		{
-			btScalar nl = btSqrt(nlSqrt);
-			ptsVector *= 1.f/nl;
-			if (ptsVector.dot(DeltaC2)<0.f)
-			{
-				ptsVector*=-1.f;
-			}
-			btVector3 ptOnB = witnessPointB + offsetB;
-			btScalar distance = nl;
-			resultOut.addContactPoint(ptsVector, ptOnB,-distance);
-		}
+		featureCache->setFeature(featureType, featureA, featureB, false);
+	}
 
+	if (featureType == btSeparatingFeatureCache::BT_SEPARATING_FEATURE_EDGE_EDGE)
+	{
+		addEdgeEdgeContact(DeltaC2, worldEdgeA, worldEdgeB, witnessPointA, witnessPointB, resultOut);
 	}
 
 
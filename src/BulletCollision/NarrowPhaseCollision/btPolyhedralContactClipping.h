@@ -29,6 +29,70 @@ class btConvexPolyhedron;
 
 typedef btAlignedObjectArray<btVector3> btVertexArray;
 
+///btSeparatingFeatureCache remembers the feature (face of hullA, face of hullB or edge pair) that gave the separating axis,
+///or the axis of minimum penetration, in the last findSeparatingAxis query of a pair of hulls.
+///The next query tests that axis first: if it still separates the hulls, the other axes are skipped. If the hulls overlap
+///and their relative transform moved less than the tolerances since the last full test, the cached axis is used as is.
+///The tolerances are zero by default, so overlapping hulls always run the full test and give the same contacts as without cache.
+struct btSeparatingFeatureCache
+{
+	enum btSeparatingFeatureType
+	{
+		BT_SEPARATING_FEATURE_NONE,
+		BT_SEPARATING_FEATURE_FACE_A,
+		BT_SEPARATING_FEATURE_FACE_B,
+		BT_SEPARATING_FEATURE_EDGE_EDGE
+	};
+
+	int			m_featureType;
+	int			m_featureA;			// face or unique edge index in hullA
+	int			m_featureB;			// face or unique edge index in hullB
+	bool		m_separated;		// the feature gave a separating axis
+	btTransform	m_relativeTransform;	// transform of hullB relative to hullA in the last full test
+
+	btScalar	m_maxRelativeTranslation;	// set both tolerances to zero to always run the full test for overlapping hulls
+	btScalar	m_maxRelativeRotation;		// in radians
+
+	btSeparatingFeatureCache()
+		:m_featureType(BT_SEPARATING_FEATURE_NONE),
+		m_featureA(-1),
+		m_featureB(-1),
+		m_separated(false),
+		m_maxRelativeTranslation(btScalar(0.)),
+		m_maxRelativeRotation(btScalar(0.))
+	{
+		m_relativeTransform.setIdentity();
+	}
+
+	void	reset()
+	{
+		m_featureType = BT_SEPARATING_FEATURE_NONE;
+		m_featureA = -1;
+		m_featureB = -1;
+	}
+
+	void	setFeature(int featureType, int featureA, int featureB, bool separated)
+	{
+		m_featureType = featureType;
+		m_featureA = featureA;
+		m_featureB = featureB;
+		m_separated = separated;
+	}
+
+	bool	hasSmallRelativeMotion(const btTransform& relativeTransform) const
+	{
+		if (m_maxRelativeTranslation <= btScalar(0.) && m_maxRelativeRotation <= btScalar(0.))
+			return false;
+		if ((relativeTransform.getOrigin()-m_relativeTransform.getOrigin()).length2() > m_maxRelativeTranslation*m_maxRelativeTranslation)
+			return false;
+		//the trace of the rotation between the two relative transforms is 1+2*cos(angle)
+		const btMatrix3x3& basis0 = m_relativeTransform.getBasis();
+		const btMatrix3x3& basis1 = relativeTransform.getBasis();
+		btScalar trace = basis0[0].dot(basis1[0]) + basis0[1].dot(basis1[1]) + basis0[2].dot(basis1[2]);
+		return trace >= btScalar(1.) + btScalar(2.)*btCos(m_maxRelativeRotation);
+	}
+};
+
 // Clips a face to the back of a plane
 struct btPolyhedralContactClipping
 {
@@ -38,7 +102,8 @@ struct btPolyhedralContactClipping
 	static void	clipFaceAgainstHull(const btVector3& separatingNormal, const btConvexPolyhedron& hullA,  const btTransform& transA, btVertexArray& worldVertsB1,btVertexArray& worldVertsB2, const btScalar minDist, btScalar maxDist,btDiscreteCollisionDetectorInterface::Result& resultOut);
 
 
-	static bool findSeparatingAxis(	const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, btVector3& sep, btDiscreteCollisionDetectorInterface::Result& resultOut);
+	///featureCache is optional, it is read and updated when provided
+	static bool findSeparatingAxis(	const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, btVector3& sep, btDiscreteCollisionDetectorInterface::Result& resultOut, btSeparatingFeatureCache* featureCache=0);
 
 	///the clipFace method is used internally
 	static void clipFace(const btVertexArray& pVtxIn, btVertexArray& ppVtxOut, const btVector3& planeNormalWS,btScalar planeEqWS);
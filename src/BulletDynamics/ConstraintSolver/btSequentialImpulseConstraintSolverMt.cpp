@@ -17,6 +17,7 @@ subject to the following restrictions:
 #include "btSequentialImpulseConstraintSolverMt.h"
 
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btCpuFeatureUtility.h"
 
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 
@@ -31,6 +32,231 @@ int btSequentialImpulseConstraintSolverMt::s_minBatchSize = 50;
 int btSequentialImpulseConstraintSolverMt::s_maxBatchSize = 100;
 btBatchedConstraints::BatchingMethod btSequentialImpulseConstraintSolverMt::s_contactBatchingMethod = btBatchedConstraints::BATCHING_METHOD_SPATIAL_GRID_2D;
 btBatchedConstraints::BatchingMethod btSequentialImpulseConstraintSolverMt::s_jointBatchingMethod = btBatchedConstraints::BATCHING_METHOD_SPATIAL_GRID_2D;
+bool btSequentialImpulseConstraintSolverMt::s_allowWideConstraintRowKernels = false;
+
+
+///The wide row kernels are compiled with function target attributes, so the library itself doesn't need -mavx2 or /arch:AVX2,
+///and btCpuFeatureUtility decides at runtime whether they can be used.
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(__x86_64__) || defined(_M_X64))
+#if defined(_MSC_VER) && !defined(__clang__)
+#if _MSC_VER >= 1910
+#define BT_ALLOW_WIDE_SOLVER_KERNELS
+#define BT_TARGET_AVX2
+#endif //_MSC_VER >= 1910
+#elif defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 7)
+#define BT_ALLOW_WIDE_SOLVER_KERNELS
+#define BT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif //!BT_USE_DOUBLE_PRECISION
+
+
+///Per lane fields of the wide rows. The contact, or friction, rows of a group are stored field by field with one lane per contact,
+///so the kernels read them with plain vector loads and only the body velocities need to be transposed.
+enum btWideConstraintRowField
+{
+    WIDE_ROW_CONTACT_NORMAL1 = 0,  // x, y and z are 3 consecutive fields
+    WIDE_ROW_RELPOS1_CROSS_NORMAL = 3,
+    WIDE_ROW_CONTACT_NORMAL2 = 6,
+    WIDE_ROW_RELPOS2_CROSS_NORMAL = 9,
+    WIDE_ROW_LINEAR_COMPONENT_A = 12,  // contact normal 1 times the inverse mass of body A
+    WIDE_ROW_LINEAR_COMPONENT_B = 15,
+    WIDE_ROW_ANGULAR_COMPONENT_A = 18,
+    WIDE_ROW_ANGULAR_COMPONENT_B = 21,
+    WIDE_ROW_RHS = 24,
+    WIDE_ROW_CFM,
+    WIDE_ROW_JAC_DIAG_AB_INV,
+    WIDE_ROW_LOWER_LIMIT,
+    WIDE_ROW_UPPER_LIMIT,
+    WIDE_ROW_FRICTION,
+    WIDE_ROW_APPLIED_IMPULSE,
+    WIDE_ROW_NUM_FIELDS
+};
+
+
+#ifdef BT_ALLOW_WIDE_SOLVER_KERNELS
+#include <immintrin.h>
+
+///Loads the same btVector3 of 8 bodies and transposes it into x, y, z and w registers
+BT_TARGET_AVX2 static inline void btLoadTransposed8( btSolverBody* const* bodies, btVector3 btSolverBody::*field, __m256* xyzw )
+{
+    __m256 r[ 4 ];
+    for ( int j = 0; j < 4; ++j )
+    {
+        r[ j ] = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( ( bodies[ j ]->*field ).m_floats ) ), _mm_loadu_ps( ( bodies[ j + 4 ]->*field ).m_floats ), 1 );
+    }
+    const __m256 t0 = _mm256_unpacklo_ps( r[ 0 ], r[ 1 ] );
+    const __m256 t1 = _mm256_unpackhi_ps( r[ 0 ], r[ 1 ] );
+    const __m256 t2 = _mm256_unpacklo_ps( r[ 2 ], r[ 3 ] );
+    const __m256 t3 = _mm256_unpackhi_ps( r[ 2 ], r[ 3 ] );
+    xyzw[ 0 ] = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+    xyzw[ 1 ] = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+    xyzw[ 2 ] = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+    xyzw[ 3 ] = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+}
+
+///Inverse of btLoadTransposed8, only the first count bodies are written
+BT_TARGET_AVX2 static inline void btStoreTransposed8( const __m256* xyzw, btSolverBody* const* bodies, btVector3 btSolverBody::*field, int count )
+{
+    const __m256 t0 = _mm256_unpacklo_ps( xyzw[ 0 ], xyzw[ 1 ] );
+    const __m256 t1 = _mm256_unpackhi_ps( xyzw[ 0 ], xyzw[ 1 ] );
+    const __m256 t2 = _mm256_unpacklo_ps( xyzw[ 2 ], xyzw[ 3 ] );
+    const __m256 t3 = _mm256_unpackhi_ps( xyzw[ 2 ], xyzw[ 3 ] );
+    __m256 r[ 4 ];
+    r[ 0 ] = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+    r[ 1 ] = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+    r[ 2 ] = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+    r[ 3 ] = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+    for ( int i = 0; i < count; ++i )
+    {
+        const __m128 v = ( i < 4 ) ? _mm256_castps256_ps128( r[ i ] ) : _mm256_extractf128_ps( r[ i - 4 ], 1 );
+        _mm_storeu_ps( ( bodies[ i ]->*field ).m_floats, v );
+    }
+}
+
+///Solves up to 8 independent rows at once, with the same math as gResolveSingleConstraintRowGeneric_sse4_1_fma3.
+///Each lane is one row, bodyIds holds the 8 A bodies followed by the 8 B bodies. No two rows may share a body,
+///except for the fixed body which is never changed by a row. Lanes that are not in activeRows are left as they are.
+BT_TARGET_AVX2 static btScalar gResolveConstraintRowsGeneric_avx2( btSolverBody* bodies, const int* bodyIds, btScalar* rows, int numRows, unsigned int activeRows )
+{
+#define BT_WIDE_ROW( field ) _mm256_loadu_ps( rows + ( field ) * 8 )
+    btSolverBody* bodyA[ 8 ];
+    btSolverBody* bodyB[ 8 ];
+    for ( int i = 0; i < 8; ++i )
+    {
+        bodyA[ i ] = &bodies[ bodyIds[ i ] ];
+        bodyB[ i ] = &bodies[ bodyIds[ 8 + i ] ];
+    }
+    const __m256i laneBits = _mm256_setr_epi32( 1, 2, 4, 8, 16, 32, 64, 128 );
+    const __m256 active = _mm256_castsi256_ps( _mm256_cmpeq_epi32( _mm256_and_si256( _mm256_set1_epi32( int( activeRows ) ), laneBits ), laneBits ) );
+    const __m256 appliedImpulse = BT_WIDE_ROW( WIDE_ROW_APPLIED_IMPULSE );
+    const __m256 lowerLimit = BT_WIDE_ROW( WIDE_ROW_LOWER_LIMIT );
+    const __m256 upperLimit = BT_WIDE_ROW( WIDE_ROW_UPPER_LIMIT );
+    const __m256 jacDiagABInv = BT_WIDE_ROW( WIDE_ROW_JAC_DIAG_AB_INV );
+    __m256 deltaImpulse = _mm256_fnmadd_ps( appliedImpulse, BT_WIDE_ROW( WIDE_ROW_CFM ), BT_WIDE_ROW( WIDE_ROW_RHS ) );
+    __m256 linVelA[ 4 ], angVelA[ 4 ], linVelB[ 4 ], angVelB[ 4 ];
+    btLoadTransposed8( bodyA, &btSolverBody::m_deltaLinearVelocity, linVelA );
+    btLoadTransposed8( bodyA, &btSolverBody::m_deltaAngularVelocity, angVelA );
+    btLoadTransposed8( bodyB, &btSolverBody::m_deltaLinearVelocity, linVelB );
+    btLoadTransposed8( bodyB, &btSolverBody::m_deltaAngularVelocity, angVelB );
+
+    __m256 deltaVel1Dotn = _mm256_mul_ps( BT_WIDE_ROW( WIDE_ROW_CONTACT_NORMAL1 ), linVelA[ 0 ] );
+    __m256 deltaVel2Dotn = _mm256_mul_ps( BT_WIDE_ROW( WIDE_ROW_CONTACT_NORMAL2 ), linVelB[ 0 ] );
+    for ( int k = 1; k < 3; ++k )
+    {
+        deltaVel1Dotn = _mm256_fmadd_ps( BT_WIDE_ROW( WIDE_ROW_CONTACT_NORMAL1 + k ), linVelA[ k ], deltaVel1Dotn );
+        deltaVel2Dotn = _mm256_fmadd_ps( BT_WIDE_ROW( WIDE_ROW_CONTACT_NORMAL2 + k ), linVelB[ k ], deltaVel2Dotn );
+    }
+    for ( int k = 0; k < 3; ++k )
+    {
+        deltaVel1Dotn = _mm256_fmadd_ps( BT_WIDE_ROW( WIDE_ROW_RELPOS1_CROSS_NORMAL + k ), angVelA[ k ], deltaVel1Dotn );
+        deltaVel2Dotn = _mm256_fmadd_ps( BT_WIDE_ROW( WIDE_ROW_RELPOS2_CROSS_NORMAL + k ), angVelB[ k ], deltaVel2Dotn );
+    }
+    deltaImpulse = _mm256_fnmadd_ps( deltaVel1Dotn, jacDiagABInv, deltaImpulse );
+    deltaImpulse = _mm256_fnmadd_ps( deltaVel2Dotn, jacDiagABInv, deltaImpulse );
+
+    const __m256 sum = _mm256_add_ps( appliedImpulse, deltaImpulse );
+    const __m256 belowLower = _mm256_cmp_ps( sum, lowerLimit, _CMP_LT_OQ );
+    const __m256 aboveUpper = _mm256_cmp_ps( sum, upperLimit, _CMP_GT_OQ );
+    deltaImpulse = _mm256_blendv_ps( deltaImpulse, _mm256_sub_ps( upperLimit, appliedImpulse ), aboveUpper );
+    deltaImpulse = _mm256_blendv_ps( deltaImpulse, _mm256_sub_ps( lowerLimit, appliedImpulse ), belowLower );
+    deltaImpulse = _mm256_and_ps( deltaImpulse, active );
+    const __m256 newAppliedImpulse = _mm256_blendv_ps( _mm256_blendv_ps( sum, upperLimit, aboveUpper ), lowerLimit, belowLower );
+    _mm256_storeu_ps( rows + WIDE_ROW_APPLIED_IMPULSE * 8, _mm256_blendv_ps( appliedImpulse, newAppliedImpulse, active ) );
+
+    for ( int k = 0; k < 3; ++k )
+    {
+        linVelA[ k ] = _mm256_fmadd_ps( BT_WIDE_ROW( WIDE_ROW_LINEAR_COMPONENT_A + k ), deltaImpulse, linVelA[ k ] );
+        linVelB[ k ] = _mm256_fmadd_ps( BT_WIDE_ROW( WIDE_ROW_LINEAR_COMPONENT_B + k ), deltaImpulse, linVelB[ k ] );
+        angVelA[ k ] = _mm256_fmadd_ps( BT_WIDE_ROW( WIDE_ROW_ANGULAR_COMPONENT_A + k ), deltaImpulse, angVelA[ k ] );
+        angVelB[ k ] = _mm256_fmadd_ps( BT_WIDE_ROW( WIDE_ROW_ANGULAR_COMPONENT_B + k ), deltaImpulse, angVelB[ k ] );
+    }
+#undef BT_WIDE_ROW
+
+    // rows that share the fixed body all write back its unchanged velocity
+    btStoreTransposed8( linVelA, bodyA, &btSolverBody::m_deltaLinearVelocity, numRows );
+    btStoreTransposed8( angVelA, bodyA, &btSolverBody::m_deltaAngularVelocity, numRows );
+    btStoreTransposed8( linVelB, bodyB, &btSolverBody::m_deltaLinearVelocity, numRows );
+    btStoreTransposed8( angVelB, bodyB, &btSolverBody::m_deltaAngularVelocity, numRows );
+
+    // inactive and unused lanes have a zero delta impulse
+    const __m256 squares = _mm256_mul_ps( deltaImpulse, deltaImpulse );
+    __m128 s = _mm_add_ps( _mm256_castps256_ps128( squares ), _mm256_extractf128_ps( squares, 1 ) );
+    s = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+    s = _mm_add_ss( s, _mm_shuffle_ps( s, s, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+    return _mm_cvtss_f32( s );
+}
+
+
+#endif //BT_ALLOW_WIDE_SOLVER_KERNELS
+
+
+///Scalar reference for the wide kernels, solves the active lanes one after the other with the same math
+static btScalar gResolveConstraintRowsGeneric_scalar_reference( btSolverBody* bodies, const int* bodyIds, btScalar* rows, int numRows, unsigned int activeRows )
+{
+    btScalar leastSquaresResidual = btScalar( 0 );
+    for ( int lane = 0; lane < numRows; ++lane )
+    {
+        if ( !( activeRows & ( 1u << lane ) ) )
+        {
+            continue;
+        }
+#define BT_WIDE_ROW( field ) rows[ ( field ) * 8 + lane ]
+#define BT_WIDE_ROW_VECTOR( field ) btVector3( BT_WIDE_ROW( field ), BT_WIDE_ROW( field + 1 ), BT_WIDE_ROW( field + 2 ) )
+        btSolverBody& bodyA = bodies[ bodyIds[ lane ] ];
+        btSolverBody& bodyB = bodies[ bodyIds[ 8 + lane ] ];
+        const btScalar appliedImpulse = BT_WIDE_ROW( WIDE_ROW_APPLIED_IMPULSE );
+        const btScalar lowerLimit = BT_WIDE_ROW( WIDE_ROW_LOWER_LIMIT );
+        const btScalar upperLimit = BT_WIDE_ROW( WIDE_ROW_UPPER_LIMIT );
+        btScalar deltaImpulse = BT_WIDE_ROW( WIDE_ROW_RHS ) - appliedImpulse * BT_WIDE_ROW( WIDE_ROW_CFM );
+        const btScalar deltaVel1Dotn = BT_WIDE_ROW_VECTOR( WIDE_ROW_CONTACT_NORMAL1 ).dot( bodyA.internalGetDeltaLinearVelocity() ) + BT_WIDE_ROW_VECTOR( WIDE_ROW_RELPOS1_CROSS_NORMAL ).dot( bodyA.internalGetDeltaAngularVelocity() );
+        const btScalar deltaVel2Dotn = BT_WIDE_ROW_VECTOR( WIDE_ROW_CONTACT_NORMAL2 ).dot( bodyB.internalGetDeltaLinearVelocity() ) + BT_WIDE_ROW_VECTOR( WIDE_ROW_RELPOS2_CROSS_NORMAL ).dot( bodyB.internalGetDeltaAngularVelocity() );
+        deltaImpulse -= deltaVel1Dotn * BT_WIDE_ROW( WIDE_ROW_JAC_DIAG_AB_INV );
+        deltaImpulse -= deltaVel2Dotn * BT_WIDE_ROW( WIDE_ROW_JAC_DIAG_AB_INV );
+        const btScalar sum = appliedImpulse + deltaImpulse;
+        if ( sum < lowerLimit )
+        {
+            deltaImpulse = lowerLimit - appliedImpulse;
+            BT_WIDE_ROW( WIDE_ROW_APPLIED_IMPULSE ) = lowerLimit;
+        }
+        else if ( sum > upperLimit )
+        {
+            deltaImpulse = upperLimit - appliedImpulse;
+            BT_WIDE_ROW( WIDE_ROW_APPLIED_IMPULSE ) = upperLimit;
+        }
+        else
+        {
+            BT_WIDE_ROW( WIDE_ROW_APPLIED_IMPULSE ) = sum;
+        }
+        bodyA.internalGetDeltaLinearVelocity() += BT_WIDE_ROW_VECTOR( WIDE_ROW_LINEAR_COMPONENT_A ) * deltaImpulse;
+        bodyA.internalGetDeltaAngularVelocity() += BT_WIDE_ROW_VECTOR( WIDE_ROW_ANGULAR_COMPONENT_A ) * deltaImpulse;
+        bodyB.internalGetDeltaLinearVelocity() += BT_WIDE_ROW_VECTOR( WIDE_ROW_LINEAR_COMPONENT_B ) * deltaImpulse;
+        bodyB.internalGetDeltaAngularVelocity() += BT_WIDE_ROW_VECTOR( WIDE_ROW_ANGULAR_COMPONENT_B ) * deltaImpulse;
+#undef BT_WIDE_ROW_VECTOR
+#undef BT_WIDE_ROW
+        leastSquaresResidual += deltaImpulse * deltaImpulse;
+    }
+    return leastSquaresResidual;
+}
+
+
+btWideConstraintRowsSolver btSequentialImpulseConstraintSolverMt::getScalarWideConstraintRowsSolver()
+{
+    return gResolveConstraintRowsGeneric_scalar_reference;
+}
+
+
+btWideConstraintRowsSolver btSequentialImpulseConstraintSolverMt::getAVX2WideConstraintRowsSolver()
+{
+#ifdef BT_ALLOW_WIDE_SOLVER_KERNELS
+    // a batch rarely has more than 6-8 contacts without a shared body in a row, so 8 lanes are as wide as it gets,
+    // AVX-512 machines run the same kernel
+    if ( btCpuFeatureUtility::getCpuFeatures() & btCpuFeatureUtility::CPU_FEATURE_AVX2 )
+    {
+        return gResolveConstraintRowsGeneric_avx2;
+    }
+#endif //BT_ALLOW_WIDE_SOLVER_KERNELS
+    return NULL;
+}
 
 
 btSequentialImpulseConstraintSolverMt::btSequentialImpulseConstraintSolverMt()
@@ -38,6 +264,10 @@ btSequentialImpulseConstraintSolverMt::btSequentialImpulseConstraintSolverMt()
     m_numFrictionDirections = 1;
     m_useBatching = false;
     m_useObsoleteJointConstraints = false;
+    m_resolveConstraintRowsWide = NULL;
+    m_wideConstraintRowWidth = 0;
+    // query the cpu features once up front, rather than from whichever thread first solves an island
+    m_wideConstraintRowsSolver = getAVX2WideConstraintRowsSolver();
 }
 
 
@@ -56,6 +286,10 @@ void btSequentialImpulseConstraintSolverMt::setupBatchedContactConstraints()
         s_maxBatchSize,
         &m_scratchMemory
     );
+    if ( m_wideConstraintRowWidth > 0 )
+    {
+        setupWideContactGroups();
+    }
 }
 
 
@@ -613,6 +847,10 @@ void btSequentialImpulseConstraintSolverMt::convertContacts(btPersistentManifold
             setupBatchedContactConstraints();
         }
         setupAllContactConstraints( infoGlobal );
+        if ( m_wideConstraintRowWidth > 0 )
+        {
+            setupWideContactRows();
+        }
     }
 }
 
@@ -880,6 +1118,7 @@ btScalar btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySetup(
         m_batchedContactConstraints.m_debugDrawer = debugDrawer;
         m_batchedJointConstraints.m_debugDrawer = debugDrawer;
     }
+    setupWideConstraintRowKernel( infoGlobal );
     btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup( bodies,
                                                                        numBodies,
                                                                        manifoldPtr,
@@ -893,6 +1132,295 @@ btScalar btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySetup(
 }
 
 
+void btSequentialImpulseConstraintSolverMt::setupWideConstraintRowKernel( const btContactSolverInfo& infoGlobal )
+{
+    m_resolveConstraintRowsWide = NULL;
+    m_wideConstraintRowWidth = 0;
+    if ( s_allowWideConstraintRowKernels && m_wideConstraintRowsSolver && m_useBatching && ( infoGlobal.m_solverMode & SOLVER_SIMD ) && !( infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS ) )
+    {
+        m_resolveConstraintRowsWide = m_wideConstraintRowsSolver;
+        m_wideConstraintRowWidth = 8;
+    }
+}
+
+
+void btSequentialImpulseConstraintSolverMt::internalSetupWideContactGroups( int iBatchBegin, int iBatchEnd )
+{
+    // Contacts are pulled from a small window ahead in the batch, and a contact joins the current group unless it
+    // shares a non-fixed body with a contact already in it. Contacts that don't fit stay in the window for the next group.
+    // Groups are written back in place, which is safe because a group only holds contacts that were already read.
+    // The points of a manifold are next to each other and all share their bodies, so the window is several manifolds per lane.
+    const int kMaxWindowSize = MAX_WIDE_CONSTRAINT_ROW_WIDTH * 8;
+    const int windowSize = m_wideConstraintRowWidth * 8;
+    btBatchedConstraints& bc = m_batchedContactConstraints;
+    for ( int iBatch = iBatchBegin; iBatch < iBatchEnd; ++iBatch )
+    {
+        const btBatchedConstraints::Range& batch = bc.m_batches[ iBatch ];
+        int window[ kMaxWindowSize ];
+        int numWindowContacts = 0;
+        int iNext = batch.begin;
+        int iOut = batch.begin;
+        while ( iNext < batch.end || numWindowContacts > 0 )
+        {
+            while ( numWindowContacts < windowSize && iNext < batch.end )
+            {
+                window[ numWindowContacts++ ] = bc.m_constraintIndices[ iNext++ ];
+            }
+            int groupBodies[ MAX_WIDE_CONSTRAINT_ROW_WIDTH * 2 ];
+            int numGroupBodies = 0;
+            int numGroupContacts = 0;
+            int numLeftOver = 0;
+            for ( int i = 0; i < numWindowContacts; ++i )
+            {
+                int iContact = window[ i ];
+                const btSolverConstraint& c = m_tmpSolverContactConstraintPool[ iContact ];
+                bool independent = ( numGroupContacts < m_wideConstraintRowWidth );
+                for ( int j = 0; independent && j < numGroupBodies; ++j )
+                {
+                    independent = ( groupBodies[ j ] != c.m_solverBodyIdA && groupBodies[ j ] != c.m_solverBodyIdB );
+                }
+                if ( independent )
+                {
+                    bc.m_constraintIndices[ iOut + numGroupContacts ] = iContact;
+                    m_wideContactGroupSizes[ iOut + numGroupContacts ] = 0;
+                    numGroupContacts++;
+                    if ( c.m_solverBodyIdA != m_fixedBodyId )
+                    {
+                        groupBodies[ numGroupBodies++ ] = c.m_solverBodyIdA;
+                    }
+                    if ( c.m_solverBodyIdB != m_fixedBodyId )
+                    {
+                        groupBodies[ numGroupBodies++ ] = c.m_solverBodyIdB;
+                    }
+                }
+                else
+                {
+                    window[ numLeftOver++ ] = iContact;
+                }
+            }
+            m_wideContactGroupSizes[ iOut ] = numGroupContacts;
+            iOut += numGroupContacts;
+            numWindowContacts = numLeftOver;
+        }
+    }
+}
+
+
+struct SetupWideContactGroupsLoop : public btIParallelForBody
+{
+    btSequentialImpulseConstraintSolverMt* m_solver;
+
+    SetupWideContactGroupsLoop( btSequentialImpulseConstraintSolverMt* solver )
+    {
+        m_solver = solver;
+    }
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        m_solver->internalSetupWideContactGroups( iBegin, iEnd );
+    }
+};
+
+
+void btSequentialImpulseConstraintSolverMt::setupWideContactGroups()
+{
+    BT_PROFILE( "setupWideContactGroups" );
+    m_wideContactGroupSizes.resizeNoInitialize( m_batchedContactConstraints.m_constraintIndices.size() );
+    SetupWideContactGroupsLoop loop( this );
+    int grainSize = 4;
+    btParallelFor( 0, m_batchedContactConstraints.m_batches.size(), grainSize, loop );
+}
+
+
+void btSequentialImpulseConstraintSolverMt::randomizeWideContactGroupOrdering()
+{
+    // same as randomizeBatchedConstraintOrdering, except that whole groups are shuffled within a batch
+    btBatchedConstraints& bc = m_batchedContactConstraints;
+    for ( int iBatch = 0; iBatch < bc.m_batches.size(); ++iBatch )
+    {
+        const btBatchedConstraints::Range& batch = bc.m_batches[ iBatch ];
+        int numContacts = batch.end - batch.begin;
+        m_wideContactGroupScratch.resizeNoInitialize( numContacts * 3 );
+        int* groupStarts = &m_wideContactGroupScratch[ 0 ];
+        int* groupBlocks = &m_wideContactGroupScratch[ numContacts ];
+        int* contacts = &m_wideContactGroupScratch[ numContacts * 2 ];
+        int numGroups = 0;
+        for ( int iiCons = batch.begin; iiCons < batch.end; iiCons += m_wideContactGroupSizes[ iiCons ] )
+        {
+            int iSwap = btRandInt2( numGroups + 1 );
+            groupStarts[ numGroups++ ] = groupStarts[ iSwap ];
+            groupStarts[ iSwap ] = iiCons;
+        }
+        for ( int i = 0; i < numContacts; ++i )
+        {
+            contacts[ i ] = bc.m_constraintIndices[ batch.begin + i ];
+        }
+        int iOut = batch.begin;
+        for ( int iGroup = 0; iGroup < numGroups; ++iGroup )
+        {
+            int iStart = groupStarts[ iGroup ];
+            int numGroupContacts = m_wideContactGroupSizes[ iStart ];
+            for ( int i = 0; i < numGroupContacts; ++i )
+            {
+                bc.m_constraintIndices[ iOut + i ] = contacts[ iStart - batch.begin + i ];
+            }
+            groupBlocks[ iGroup ] = m_wideContactGroupBlocks[ iStart ];
+            groupStarts[ iGroup ] = numGroupContacts;
+            iOut += numGroupContacts;
+        }
+        iOut = batch.begin;
+        for ( int iGroup = 0; iGroup < numGroups; ++iGroup )
+        {
+            for ( int i = 0; i < groupStarts[ iGroup ]; ++i )
+            {
+                m_wideContactGroupSizes[ iOut + i ] = ( i == 0 ) ? groupStarts[ iGroup ] : 0;
+            }
+            m_wideContactGroupBlocks[ iOut ] = groupBlocks[ iGroup ];
+            iOut += groupStarts[ iGroup ];
+        }
+    }
+}
+
+
+static inline void btSetWideRowVector( btScalar* rows, int field, int width, int lane, const btVector3& v )
+{
+    rows[ field * width + lane ] = v.x();
+    rows[ ( field + 1 ) * width + lane ] = v.y();
+    rows[ ( field + 2 ) * width + lane ] = v.z();
+}
+
+
+void btSequentialImpulseConstraintSolverMt::internalSetupWideContactRows( int iBatchBegin, int iBatchEnd )
+{
+    const int width = m_wideConstraintRowWidth;
+    const int numRowSets = 1 + m_numFrictionDirections;
+    const btBatchedConstraints& bc = m_batchedContactConstraints;
+    for ( int iBatch = iBatchBegin; iBatch < iBatchEnd; ++iBatch )
+    {
+        const btBatchedConstraints::Range& batch = bc.m_batches[ iBatch ];
+        for ( int iiCons = batch.begin; iiCons < batch.end; iiCons += m_wideContactGroupSizes[ iiCons ] )
+        {
+            int numContacts = m_wideContactGroupSizes[ iiCons ];
+            int iBlock = m_wideContactGroupBlocks[ iiCons ];
+            // unused lanes point at the fixed body and have all-zero rows
+            int* bodyIds = &m_wideRowBodies[ iBlock * 2 * width ];
+            for ( int lane = 0; lane < width; ++lane )
+            {
+                const btSolverConstraint* c = ( lane < numContacts ) ? &m_tmpSolverContactConstraintPool[ bc.m_constraintIndices[ iiCons + lane ] ] : NULL;
+                bodyIds[ lane ] = c ? c->m_solverBodyIdA : m_fixedBodyId;
+                bodyIds[ width + lane ] = c ? c->m_solverBodyIdB : m_fixedBodyId;
+            }
+            for ( int iRowSet = 0; iRowSet < numRowSets; ++iRowSet )
+            {
+                btScalar* rows = getWideConstraintRows( iBlock, iRowSet );
+                int* rowIndices = &m_wideRowIndices[ ( iBlock * numRowSets + iRowSet ) * width ];
+                for ( int lane = 0; lane < width; ++lane )
+                {
+                    if ( lane >= numContacts )
+                    {
+                        rowIndices[ lane ] = -1;
+                        for ( int iField = 0; iField < WIDE_ROW_NUM_FIELDS; ++iField )
+                        {
+                            rows[ iField * width + lane ] = btScalar( 0 );
+                        }
+                        continue;
+                    }
+                    int iContact = bc.m_constraintIndices[ iiCons + lane ];
+                    int iRow = ( iRowSet == 0 ) ? iContact : iContact * m_numFrictionDirections + iRowSet - 1;
+                    const btSolverConstraint& c = ( iRowSet == 0 ) ? m_tmpSolverContactConstraintPool[ iRow ] : m_tmpSolverContactFrictionConstraintPool[ iRow ];
+                    btAssert( c.m_solverBodyIdA == bodyIds[ lane ] && c.m_solverBodyIdB == bodyIds[ width + lane ] );
+                    rowIndices[ lane ] = iRow;
+                    btSetWideRowVector( rows, WIDE_ROW_CONTACT_NORMAL1, width, lane, c.m_contactNormal1 );
+                    btSetWideRowVector( rows, WIDE_ROW_RELPOS1_CROSS_NORMAL, width, lane, c.m_relpos1CrossNormal );
+                    btSetWideRowVector( rows, WIDE_ROW_CONTACT_NORMAL2, width, lane, c.m_contactNormal2 );
+                    btSetWideRowVector( rows, WIDE_ROW_RELPOS2_CROSS_NORMAL, width, lane, c.m_relpos2CrossNormal );
+                    // the same linear impulse as btSolverBody::internalApplyImpulse
+                    const btSolverBody& bodyA = m_tmpSolverBodyPool[ c.m_solverBodyIdA ];
+                    const btSolverBody& bodyB = m_tmpSolverBodyPool[ c.m_solverBodyIdB ];
+                    btSetWideRowVector( rows, WIDE_ROW_LINEAR_COMPONENT_A, width, lane, c.m_contactNormal1*bodyA.internalGetInvMass()*bodyA.m_linearFactor );
+                    btSetWideRowVector( rows, WIDE_ROW_LINEAR_COMPONENT_B, width, lane, c.m_contactNormal2*bodyB.internalGetInvMass()*bodyB.m_linearFactor );
+                    btSetWideRowVector( rows, WIDE_ROW_ANGULAR_COMPONENT_A, width, lane, c.m_angularComponentA );
+                    btSetWideRowVector( rows, WIDE_ROW_ANGULAR_COMPONENT_B, width, lane, c.m_angularComponentB );
+                    rows[ WIDE_ROW_RHS * width + lane ] = c.m_rhs;
+                    rows[ WIDE_ROW_CFM * width + lane ] = c.m_cfm;
+                    rows[ WIDE_ROW_JAC_DIAG_AB_INV * width + lane ] = c.m_jacDiagABInv;
+                    rows[ WIDE_ROW_LOWER_LIMIT * width + lane ] = c.m_lowerLimit;
+                    rows[ WIDE_ROW_UPPER_LIMIT * width + lane ] = c.m_upperLimit;
+                    rows[ WIDE_ROW_FRICTION * width + lane ] = c.m_friction;
+                    rows[ WIDE_ROW_APPLIED_IMPULSE * width + lane ] = c.m_appliedImpulse;
+                }
+            }
+        }
+    }
+}
+
+
+struct SetupWideContactRowsLoop : public btIParallelForBody
+{
+    btSequentialImpulseConstraintSolverMt* m_solver;
+
+    SetupWideContactRowsLoop( btSequentialImpulseConstraintSolverMt* solver )
+    {
+        m_solver = solver;
+    }
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        m_solver->internalSetupWideContactRows( iBegin, iEnd );
+    }
+};
+
+
+void btSequentialImpulseConstraintSolverMt::setupWideContactRows()
+{
+    BT_PROFILE( "setupWideContactRows" );
+    // number the groups, so every group owns one block of rows for the whole solve
+    const btBatchedConstraints& bc = m_batchedContactConstraints;
+    m_wideContactGroupBlocks.resizeNoInitialize( bc.m_constraintIndices.size() );
+    int numBlocks = 0;
+    for ( int iBatch = 0; iBatch < bc.m_batches.size(); ++iBatch )
+    {
+        const btBatchedConstraints::Range& batch = bc.m_batches[ iBatch ];
+        for ( int iiCons = batch.begin; iiCons < batch.end; iiCons += m_wideContactGroupSizes[ iiCons ] )
+        {
+            m_wideContactGroupBlocks[ iiCons ] = numBlocks++;
+        }
+    }
+    const int width = m_wideConstraintRowWidth;
+    const int numRowSets = 1 + m_numFrictionDirections;
+    m_wideRowData.resizeNoInitialize( numBlocks * numRowSets * width * WIDE_ROW_NUM_FIELDS );
+    m_wideRowIndices.resizeNoInitialize( numBlocks * numRowSets * width );
+    m_wideRowBodies.resizeNoInitialize( numBlocks * 2 * width );
+    SetupWideContactRowsLoop loop( this );
+    int grainSize = 4;
+    btParallelFor( 0, bc.m_batches.size(), grainSize, loop );
+}
+
+
+btScalar* btSequentialImpulseConstraintSolverMt::getWideConstraintRows( int iBlock, int iRowSet )
+{
+    // row set 0 holds the contact rows, row set 1 + i the friction rows of direction i
+    return &m_wideRowData[ ( iBlock * ( 1 + m_numFrictionDirections ) + iRowSet ) * m_wideConstraintRowWidth * WIDE_ROW_NUM_FIELDS ];
+}
+
+
+btScalar btSequentialImpulseConstraintSolverMt::resolveWideConstraintRows( btConstraintArray& constraintPool, int iBlock, int iRowSet, int numRows, unsigned int activeRows )
+{
+    btAssert( numRows > 0 && numRows <= m_wideConstraintRowWidth );
+    const int width = m_wideConstraintRowWidth;
+    btScalar* rows = getWideConstraintRows( iBlock, iRowSet );
+    btScalar leastSquaresResidual = m_resolveConstraintRowsWide( &m_tmpSolverBodyPool[ 0 ], &m_wideRowBodies[ iBlock * 2 * width ], rows, numRows, activeRows );
+    // keep the applied impulses of the pool current, for the rolling friction and the write back
+    const int* rowIndices = &m_wideRowIndices[ ( iBlock * ( 1 + m_numFrictionDirections ) + iRowSet ) * width ];
+    for ( int lane = 0; lane < numRows; ++lane )
+    {
+        if ( activeRows & ( 1u << lane ) )
+        {
+            constraintPool[ rowIndices[ lane ] ].m_appliedImpulse = rows[ WIDE_ROW_APPLIED_IMPULSE * width + lane ];
+        }
+    }
+    return leastSquaresResidual;
+}
+
+
 btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactSplitPenetrationImpulseConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd )
 {
     btScalar leastSquaresResidual = 0.f;
@@ -1056,6 +1584,16 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleJointConstraints(
 btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd )
 {
     btScalar leastSquaresResidual = 0.f;
+    if ( m_wideConstraintRowWidth > 0 )
+    {
+        // contact rows have an upper limit of 1e10, so the generic wide kernel clamps them like the lower limit one
+        for ( int iiCons = batchBegin; iiCons < batchEnd; iiCons += m_wideContactGroupSizes[ iiCons ] )
+        {
+            int numContacts = m_wideContactGroupSizes[ iiCons ];
+            leastSquaresResidual += resolveWideConstraintRows( m_tmpSolverContactConstraintPool, m_wideContactGroupBlocks[ iiCons ], 0, numContacts, ( 1u << numContacts ) - 1 );
+        }
+        return leastSquaresResidual;
+    }
     for ( int iiCons = batchBegin; iiCons < batchEnd; ++iiCons )
     {
         int iCons = consIndices[ iiCons ];
@@ -1072,6 +1610,39 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactConstraint
 btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactFrictionConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd )
 {
     btScalar leastSquaresResidual = 0.f;
+    if ( m_wideConstraintRowWidth > 0 )
+    {
+        // the friction rows of a group of contacts are as independent as the contacts, so each friction direction is one group
+        // and the lanes of the contacts without a normal impulse are left alone
+        const int width = m_wideConstraintRowWidth;
+        for ( int iiCons = batchBegin; iiCons < batchEnd; iiCons += m_wideContactGroupSizes[ iiCons ] )
+        {
+            int numContacts = m_wideContactGroupSizes[ iiCons ];
+            int iBlock = m_wideContactGroupBlocks[ iiCons ];
+            const btScalar* contactRows = getWideConstraintRows( iBlock, 0 );
+            for ( int iDirection = 0; iDirection < m_numFrictionDirections; ++iDirection )
+            {
+                btScalar* rows = getWideConstraintRows( iBlock, 1 + iDirection );
+                unsigned int activeRows = 0;
+                for ( int lane = 0; lane < numContacts; ++lane )
+                {
+                    btScalar totalImpulse = contactRows[ WIDE_ROW_APPLIED_IMPULSE * width + lane ];
+                    if ( totalImpulse > 0.0f )
+                    {
+                        btScalar friction = rows[ WIDE_ROW_FRICTION * width + lane ];
+                        rows[ WIDE_ROW_LOWER_LIMIT * width + lane ] = -( friction*totalImpulse );
+                        rows[ WIDE_ROW_UPPER_LIMIT * width + lane ] = friction*totalImpulse;
+                        activeRows |= 1u << lane;
+                    }
+                }
+                if ( activeRows )
+                {
+                    leastSquaresResidual += resolveWideConstraintRows( m_tmpSolverContactFrictionConstraintPool, iBlock, 1 + iDirection, numContacts, activeRows );
+                }
+            }
+        }
+        return leastSquaresResidual;
+    }
     for ( int iiCons = batchBegin; iiCons < batchEnd; ++iiCons )
     {
         int iContact = consIndices[ iiCons ];
@@ -1084,7 +1655,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactFrictionCo
             int iEnd = iBegin + m_numFrictionDirections;
             for ( int iFriction = iBegin; iFriction < iEnd; ++iFriction )
             {
-                btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[ iFriction++ ];
+                btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[ iFriction ];
                 btAssert( solveManifold.m_frictionIndex == iContact );
 
                 solveManifold.m_lowerLimit = -( solveManifold.m_friction*totalImpulse );
@@ -1222,6 +1793,11 @@ void btSequentialImpulseConstraintSolverMt::randomizeBatchedConstraintOrdering(
         int iSwap = btRandInt2( ii + 1 );
         bc.m_phaseOrder.swap( ii, iSwap );
     }
+    if ( batchedConstraints == &m_batchedContactConstraints && m_wideConstraintRowWidth > 0 )
+    {
+        randomizeWideContactGroupOrdering();
+        return;
+    }
 
     // for each batch,
     for ( int iBatch = 0; iBatch < bc.m_batches.size(); ++iBatch )
@@ -20,6 +20,9 @@ subject to the following restrictions:
 #include "btBatchedConstraints.h"
 #include "LinearMath/btThreads.h"
 
+///solves up to 8 independent contact or friction rows, stored one row per lane, see btSequentialImpulseConstraintSolverMt.cpp
+typedef btScalar (*btWideConstraintRowsSolver)( btSolverBody* bodies, const int* bodyIds, btScalar* rows, int numRows, unsigned int activeRows );
+
 ///
 /// btSequentialImpulseConstraintSolverMt
 ///
@@ -48,6 +51,14 @@ subject to the following restrictions:
 ///  is randomized, however it does not swap constraints between batches.
 ///  This is to avoid regenerating the batches for each solver iteration which would be quite costly in performance.
 ///
+///  When s_allowWideConstraintRowKernels is set and the solver mode has SOLVER_SIMD (without interleaving), the contacts of
+///  each batch are reordered once per solve into groups that don't share a dynamic body, and the contact and friction rows of a
+///  group are solved 8 rows at a time by an AVX2 kernel, when btCpuFeatureUtility reports AVX2 at runtime.
+///  The rows of each group are copied into a lane-per-contact layout after setup, so the iterations only transpose the body velocities.
+///  SOLVER_RANDMIZE_ORDER then shuffles whole groups within a batch instead of single constraints.
+///  Groups only fill up when a batch spans enough manifolds, so this pays off with larger batches (s_minBatchSize of 200 or so),
+///  with the default batch sizes it is no faster than the one row kernels. It is off by default.
+///
 ///  Note that a non-zero leastSquaresResidualThreshold could possibly affect the determinism of the simulation
 ///  if the task scheduler's parallelSum operation is non-deterministic. The parallelSum operation can be non-deterministic
 ///  because floating point addition is not associative due to rounding errors.
@@ -90,9 +101,11 @@ public:
     static btBatchedConstraints::BatchingMethod s_jointBatchingMethod;
     static int s_minBatchSize;  // desired number of constraints per batch
     static int s_maxBatchSize;
+    static bool s_allowWideConstraintRowKernels;  // solve independent contact and friction rows of a batch 8 at a time with AVX2 when the CPU has it
 
 protected:
     static const int CACHE_LINE_SIZE = 64;
+    static const int MAX_WIDE_CONSTRAINT_ROW_WIDTH = 8;
 
     btBatchedConstraints m_batchedContactConstraints;
     btBatchedConstraints m_batchedJointConstraints;
@@ -105,6 +118,15 @@ protected:
     char m_antiFalseSharingPadding[CACHE_LINE_SIZE]; // padding to keep mutexes in separate cachelines
     btSpinMutex m_kinematicBodyUniqueIdToSolverBodyTableMutex;
     btAlignedObjectArray<char> m_scratchMemory;
+    btWideConstraintRowsSolver m_wideConstraintRowsSolver;  // picked from the cpu features at construction, NULL if there is no wide kernel
+    btWideConstraintRowsSolver m_resolveConstraintRowsWide;  // kernel used by the current solve
+    int m_wideConstraintRowWidth;  // number of rows the wide kernel solves at once, 0 if rows are solved one at a time
+    btAlignedObjectArray<int> m_wideContactGroupSizes;  // for each entry of the batched contact indices, the size of the group starting there (0 inside a group)
+    btAlignedObjectArray<int> m_wideContactGroupBlocks;  // for each entry of the batched contact indices, the block of wide rows of the group starting there
+    btAlignedObjectArray<btScalar> m_wideRowData;  // per block, the contact rows then the friction rows of each direction, one lane per contact
+    btAlignedObjectArray<int> m_wideRowIndices;  // per block and lane, the pool index of the contact and friction rows (-1 for unused lanes)
+    btAlignedObjectArray<int> m_wideRowBodies;  // per block, the solver body A of each lane followed by the solver body B of each lane
+    btAlignedObjectArray<int> m_wideContactGroupScratch;
 
     virtual void randomizeConstraintOrdering( int iteration, int numIterations );
     virtual btScalar resolveAllJointConstraints( int iteration );
@@ -123,6 +145,12 @@ protected:
     void allocAllContactConstraints(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal);
     void setupAllContactConstraints(const btContactSolverInfo& infoGlobal);
     void randomizeBatchedConstraintOrdering( btBatchedConstraints* batchedConstraints );
+    void setupWideConstraintRowKernel( const btContactSolverInfo& infoGlobal );
+    void setupWideContactGroups();
+    void setupWideContactRows();
+    void randomizeWideContactGroupOrdering();
+    btScalar* getWideConstraintRows( int iBlock, int iRowSet );
+    btScalar resolveWideConstraintRows( btConstraintArray& constraintPool, int iBlock, int iRowSet, int numRows, unsigned int activeRows );
 
 public:
 
@@ -131,6 +159,14 @@ public:
 	btSequentialImpulseConstraintSolverMt();
 	virtual ~btSequentialImpulseConstraintSolverMt();
 
+    btWideConstraintRowsSolver getActiveWideConstraintRowsSolver() const { return m_wideConstraintRowsSolver; }
+    void setWideConstraintRowsSolver( btWideConstraintRowsSolver rowsSolver ) { m_wideConstraintRowsSolver = rowsSolver; }
+
+    ///Implementations of the wide row kernel: a scalar reference that solves the lanes one after the other,
+    ///and AVX2 (NULL when it is not compiled in or the CPU doesn't have it)
+    static btWideConstraintRowsSolver getScalarWideConstraintRowsSolver();
+    static btWideConstraintRowsSolver getAVX2WideConstraintRowsSolver();
+
     btScalar resolveMultipleJointConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd, int iteration );
     btScalar resolveMultipleContactConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd );
     btScalar resolveMultipleContactSplitPenetrationImpulseConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd );
@@ -141,6 +177,8 @@ public:
     void internalCollectContactManifoldCachedInfo(btContactManifoldCachedInfo* cachedInfoArray, btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal);
     void internalAllocContactConstraints(const btContactManifoldCachedInfo* cachedInfoArray, int numManifolds);
     void internalSetupContactConstraints(int iContactConstraint, const btContactSolverInfo& infoGlobal);
+    void internalSetupWideContactGroups(int iBatchBegin, int iBatchEnd);
+    void internalSetupWideContactRows(int iBatchBegin, int iBatchEnd);
     void internalConvertBodies(btCollisionObject** bodies, int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
     void internalWriteBackContacts(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
     void internalWriteBackJoints(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
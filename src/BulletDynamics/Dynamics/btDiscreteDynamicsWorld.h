@@ -33,6 +33,14 @@ struct InplaceSolverIslandCallback;
 #include "LinearMath/btThreads.h"
 
 
+///first hit of the swept sphere of a fast moving object, see btDiscreteDynamicsWorld::predictiveConvexSweep
+struct btPredictiveSweepResult
+{
+	const btCollisionObject*	m_hitCollisionObject;
+	btVector3	m_hitNormalWorld;
+	btScalar	m_closestHitFraction;
+};
+
 ///btDiscreteDynamicsWorld provides discrete rigid body simulation
 ///those classes replace the obsolete CcdPhysicsEnvironment/CcdPhysicsController
 ATTRIBUTE_ALIGNED16(class) btDiscreteDynamicsWorld : public btDynamicsWorld
@@ -90,6 +98,8 @@ protected:
 
     void releasePredictiveContacts();
     void createPredictiveContactsInternal( btRigidBody** bodies, int numBodies, btScalar timeStep );  // can be called in parallel
+    bool predictiveConvexSweep( btCollisionObject* colObj, const btTransform& predictedTrans, btPredictiveSweepResult& result );  // can be called in parallel
+    void addPredictiveContact( btCollisionObject* colObj, const btTransform& predictedTrans, const btPredictiveSweepResult& result );  // can be called in parallel with btCollisionDispatcherMt
 	virtual void	createPredictiveContacts(btScalar timeStep);
 
 	virtual void	saveKinematicState(btScalar timeStep);
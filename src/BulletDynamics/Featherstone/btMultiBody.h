@@ -387,6 +387,14 @@ void addJointTorque(int i, btScalar Q);
                         m_deltaV[dof] += delta_vee[dof] * multiplier;
                 }
 	}
+	//same as above, restricted to the dofs in [dofBegin, dofEnd)
+	void applyDeltaVeeMultiDof2(const btScalar * delta_vee, btScalar multiplier, int dofBegin, int dofEnd)
+	{
+		for (int dof = dofBegin; dof < dofEnd; ++dof)
+		{
+			m_deltaV[dof] += delta_vee[dof] * multiplier;
+		}
+	}
 	void processDeltaVeeMultiDof2()
 	{
 		applyDeltaVeeMultiDof(&m_deltaV[0],1);
@@ -479,6 +487,13 @@ void addJointTorque(int i, btScalar Q);
 		    return m_fixedBase;
 	}
 
+	///a fixed base without dofs, such as a ground plane loaded from URDF, never moves.
+	///The solver and the btMultiBodyDynamicsWorld treat its link colliders like static rigid bodies
+	bool isStaticMultiBody() const
+	{
+		return m_fixedBase && getNumDofs() == 0;
+	}
+
 	int getCompanionId() const
 	{
 		return m_companionId;
@@ -30,6 +30,7 @@ struct btMultiBodyJacobianData
 	btAlignedObjectArray<btScalar>		m_jacobians;
 	btAlignedObjectArray<btScalar>		m_deltaVelocitiesUnitImpulse;	//holds the joint-space response of the corresp. tree to the test impulse in each constraint space dimension
 	btAlignedObjectArray<btScalar>		m_deltaVelocities;				//holds joint-space vectors of all the constrained trees accumulating the effect of corrective impulses applied in SI
+	btAlignedObjectArray<int>			m_jacobianSpans;				//holds the [begin,end) ranges of the nonzero entries of a row in m_jacobians and m_deltaVelocitiesUnitImpulse, see btMultiBodyConstraintSolver::setupJacobianSpans
 	btAlignedObjectArray<btScalar>		scratch_r;
 	btAlignedObjectArray<btVector3>		scratch_v;
 	btAlignedObjectArray<btMatrix3x3>	scratch_m;
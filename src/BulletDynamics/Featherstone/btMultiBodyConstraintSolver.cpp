@@ -172,6 +172,8 @@ btScalar btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup(btCollisionOb
 	m_data.m_deltaVelocitiesUnitImpulse.resize(0);
 	m_data.m_deltaVelocities.resize(0);
 
+	m_data.m_jacobianSpans.resize(0);
+
 	for (int i=0;i<numBodies;i++)
 	{
 		const btMultiBodyLinkCollider* fcA = btMultiBodyLinkCollider::upcast(bodies[i]);
@@ -183,9 +185,104 @@ btScalar btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup(btCollisionOb
 
 	btScalar val = btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup( bodies,numBodies,manifoldPtr, numManifolds, constraints,numConstraints,infoGlobal,debugDrawer);
 
+	setupJacobianSpans(m_multiBodyNonContactConstraints);
+	setupJacobianSpans(m_multiBodyNormalContactConstraints);
+	setupJacobianSpans(m_multiBodyFrictionContactConstraints);
+	setupJacobianSpans(m_multiBodyTorsionalFrictionContactConstraints);
+
 	return val;
 }
 
+int btMultiBodyConstraintSolver::addJacobianSpans(int jacIndex, int ndof)
+{
+	//a jacobian row only touches the base and the dofs on the path from the link to the root, the unit impulse response
+	//is zero for the base of a fixed base btMultiBody and for the branches that don't move. Both arrays are laid out as
+	//[numSpans, (begin,end) * numSpans], jacobian first, followed by the response. Runs of fewer than maxGap zeros are
+	//kept inside a span, skipping them is not worth the extra loop.
+	//The skipped entries are exact zeros, so the sparse dot products and updates give the same results as the dense ones.
+	const int maxGap = 4;
+	const int spanIndex = m_data.m_jacobianSpans.size();
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		const btScalar* values = pass == 0 ? &m_data.m_jacobians[jacIndex] : &m_data.m_deltaVelocitiesUnitImpulse[jacIndex];
+		const int countIndex = m_data.m_jacobianSpans.size();
+		m_data.m_jacobianSpans.push_back(0);
+		int i = 0;
+		while (i < ndof)
+		{
+			if (values[i] == btScalar(0))
+			{
+				++i;
+				continue;
+			}
+			const int begin = i;
+			int end = i + 1;
+			for (i = end; i < ndof && i - end < maxGap; ++i)
+			{
+				if (values[i] != btScalar(0))
+				{
+					end = i + 1;
+				}
+			}
+			i = end;
+			m_data.m_jacobianSpans.push_back(begin);
+			m_data.m_jacobianSpans.push_back(end);
+			m_data.m_jacobianSpans[countIndex]++;
+		}
+	}
+	return spanIndex;
+}
+
+void btMultiBodyConstraintSolver::setupJacobianSpans(btMultiBodyConstraintArray& rows)
+{
+	for (int i = 0; i < rows.size(); ++i)
+	{
+		btMultiBodySolverConstraint& row = rows[i];
+		if (row.m_multiBodyA)
+		{
+			row.m_jacAspanIndex = addJacobianSpans(row.m_jacAindex, row.m_multiBodyA->getNumDofs() + 6);
+		}
+		if (row.m_multiBodyB)
+		{
+			row.m_jacBspanIndex = addJacobianSpans(row.m_jacBindex, row.m_multiBodyB->getNumDofs() + 6);
+		}
+	}
+}
+
+btScalar btMultiBodyConstraintSolver::dotJacobianSpans(int spanIndex, int jacIndex, int velocityIndex) const
+{
+	const int* spans = &m_data.m_jacobianSpans[spanIndex];
+	const btScalar* jac = &m_data.m_jacobians[jacIndex];
+	const btScalar* deltaV = &m_data.m_deltaVelocities[velocityIndex];
+	btScalar dot = 0;
+	for (int s = 0; s < spans[0]; ++s)
+	{
+		for (int i = spans[1 + 2 * s]; i < spans[2 + 2 * s]; ++i)
+			dot += jac[i] * deltaV[i];
+	}
+	return dot;
+}
+
+void btMultiBodyConstraintSolver::applyDeltaVeeSpans(btMultiBody* multiBody, int spanIndex, int jacIndex, btScalar impulse, int velocityIndex)
+{
+	const int* spans = &m_data.m_jacobianSpans[spanIndex];
+	spans += 1 + 2 * spans[0];	//skip the jacobian spans
+	const btScalar* delta_vee = &m_data.m_deltaVelocitiesUnitImpulse[jacIndex];
+	btScalar* deltaV = &m_data.m_deltaVelocities[velocityIndex];
+	for (int s = 0; s < spans[0]; ++s)
+	{
+		const int begin = spans[1 + 2 * s];
+		const int end = spans[2 + 2 * s];
+		for (int i = begin; i < end; ++i)
+			deltaV[i] += delta_vee[i] * impulse;
+#ifdef DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
+		//note: update of the actual velocities (below) in the multibody does not have to happen now since m_deltaVelocities can be applied after all iterations
+		//it would make the multibody solver more like the regular one with m_deltaVelocities being equivalent to btSolverBody::m_deltaLinearVelocity/m_deltaAngularVelocity
+		multiBody->applyDeltaVeeMultiDof2(delta_vee, impulse, begin, end);
+#endif //DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
+	}
+}
+
 void	btMultiBodyConstraintSolver::applyDeltaVee(btScalar* delta_vee, btScalar impulse, int velocityIndex, int ndof)
 {
     for (int i = 0; i < ndof; ++i) 
@@ -200,14 +297,10 @@ btScalar btMultiBodyConstraintSolver::resolveSingleConstraintRowGeneric(const bt
 	btScalar deltaVelBDotn = 0;
 	btSolverBody* bodyA = 0;
 	btSolverBody* bodyB = 0;
-	int ndofA = 0;
-	int ndofB = 0;
 
 	if (c.m_multiBodyA)
 	{
-		ndofA = c.m_multiBodyA->getNumDofs() + 6;
-		for (int i = 0; i < ndofA; ++i)
-			deltaVelADotn += m_data.m_jacobians[c.m_jacAindex + i] * m_data.m_deltaVelocities[c.m_deltaVelAindex + i];
+		deltaVelADotn += dotJacobianSpans(c.m_jacAspanIndex, c.m_jacAindex, c.m_deltaVelAindex);
 	}
 	else if (c.m_solverBodyIdA >= 0)
 	{
@@ -217,9 +310,7 @@ btScalar btMultiBodyConstraintSolver::resolveSingleConstraintRowGeneric(const bt
 
 	if (c.m_multiBodyB)
 	{
-		ndofB = c.m_multiBodyB->getNumDofs() + 6;
-		for (int i = 0; i < ndofB; ++i)
-			deltaVelBDotn += m_data.m_jacobians[c.m_jacBindex + i] * m_data.m_deltaVelocities[c.m_deltaVelBindex + i];
+		deltaVelBDotn += dotJacobianSpans(c.m_jacBspanIndex, c.m_jacBindex, c.m_deltaVelBindex);
 	}
 	else if (c.m_solverBodyIdB >= 0)
 	{
@@ -249,12 +340,7 @@ btScalar btMultiBodyConstraintSolver::resolveSingleConstraintRowGeneric(const bt
 
 	if (c.m_multiBodyA)
 	{
-		applyDeltaVee(&m_data.m_deltaVelocitiesUnitImpulse[c.m_jacAindex], deltaImpulse, c.m_deltaVelAindex, ndofA);
-#ifdef DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
-		//note: update of the actual velocities (below) in the multibody does not have to happen now since m_deltaVelocities can be applied after all iterations
-		//it would make the multibody solver more like the regular one with m_deltaVelocities being equivalent to btSolverBody::m_deltaLinearVelocity/m_deltaAngularVelocity
-		c.m_multiBodyA->applyDeltaVeeMultiDof2(&m_data.m_deltaVelocitiesUnitImpulse[c.m_jacAindex], deltaImpulse);
-#endif //DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
+		applyDeltaVeeSpans(c.m_multiBodyA, c.m_jacAspanIndex, c.m_jacAindex, deltaImpulse, c.m_deltaVelAindex);
 	}
 	else if (c.m_solverBodyIdA >= 0)
 	{
@@ -263,12 +349,7 @@ btScalar btMultiBodyConstraintSolver::resolveSingleConstraintRowGeneric(const bt
 	}
 	if (c.m_multiBodyB)
 	{
-		applyDeltaVee(&m_data.m_deltaVelocitiesUnitImpulse[c.m_jacBindex], deltaImpulse, c.m_deltaVelBindex, ndofB);
-#ifdef DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
-		//note: update of the actual velocities (below) in the multibody does not have to happen now since m_deltaVelocities can be applied after all iterations
-		//it would make the multibody solver more like the regular one with m_deltaVelocities being equivalent to btSolverBody::m_deltaLinearVelocity/m_deltaAngularVelocity
-		c.m_multiBodyB->applyDeltaVeeMultiDof2(&m_data.m_deltaVelocitiesUnitImpulse[c.m_jacBindex], deltaImpulse);
-#endif //DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
+		applyDeltaVeeSpans(c.m_multiBodyB, c.m_jacBspanIndex, c.m_jacBindex, deltaImpulse, c.m_deltaVelBindex);
 	}
 	else if (c.m_solverBodyIdB >= 0)
 	{
@@ -280,8 +361,6 @@ btScalar btMultiBodyConstraintSolver::resolveSingleConstraintRowGeneric(const bt
 
 btScalar btMultiBodyConstraintSolver::resolveConeFrictionConstraintRows(const btMultiBodySolverConstraint& cA1,const btMultiBodySolverConstraint& cB)
 {
-	int ndofA=0;
-	int ndofB=0;
 	btSolverBody* bodyA = 0;
 	btSolverBody* bodyB = 0;
 	btScalar deltaImpulseB = 0.f;
@@ -292,9 +371,7 @@ btScalar btMultiBodyConstraintSolver::resolveConeFrictionConstraintRows(const bt
 		btScalar deltaVelBDotn=0;
 		if (cB.m_multiBodyA)
 		{
-			ndofA  = cB.m_multiBodyA->getNumDofs() + 6;
-			for (int i = 0; i < ndofA; ++i) 
-				deltaVelADotn += m_data.m_jacobians[cB.m_jacAindex+i] * m_data.m_deltaVelocities[cB.m_deltaVelAindex+i];
+			deltaVelADotn += dotJacobianSpans(cB.m_jacAspanIndex, cB.m_jacAindex, cB.m_deltaVelAindex);
 		} else if(cB.m_solverBodyIdA >= 0)
 		{
 			bodyA = &m_tmpSolverBodyPool[cB.m_solverBodyIdA];
@@ -303,9 +380,7 @@ btScalar btMultiBodyConstraintSolver::resolveConeFrictionConstraintRows(const bt
 
 		if (cB.m_multiBodyB)
 		{
-			ndofB  = cB.m_multiBodyB->getNumDofs() + 6;
-			for (int i = 0; i < ndofB; ++i) 
-				deltaVelBDotn += m_data.m_jacobians[cB.m_jacBindex+i] * m_data.m_deltaVelocities[cB.m_deltaVelBindex+i];
+			deltaVelBDotn += dotJacobianSpans(cB.m_jacBspanIndex, cB.m_jacBindex, cB.m_deltaVelBindex);
 		} else if(cB.m_solverBodyIdB >= 0)
 		{
 			bodyB = &m_tmpSolverBodyPool[cB.m_solverBodyIdB];
@@ -328,9 +403,7 @@ btScalar btMultiBodyConstraintSolver::resolveConeFrictionConstraintRows(const bt
 			btScalar deltaVelBDotn=0;
 			if (cA.m_multiBodyA)
 			{
-				ndofA  = cA.m_multiBodyA->getNumDofs() + 6;
-				for (int i = 0; i < ndofA; ++i) 
-					deltaVelADotn += m_data.m_jacobians[cA.m_jacAindex+i] * m_data.m_deltaVelocities[cA.m_deltaVelAindex+i];
+				deltaVelADotn += dotJacobianSpans(cA.m_jacAspanIndex, cA.m_jacAindex, cA.m_deltaVelAindex);
 			} else if(cA.m_solverBodyIdA >= 0)
 			{
 				bodyA = &m_tmpSolverBodyPool[cA.m_solverBodyIdA];
@@ -339,9 +412,7 @@ btScalar btMultiBodyConstraintSolver::resolveConeFrictionConstraintRows(const bt
 
 			if (cA.m_multiBodyB)
 			{
-				ndofB  = cA.m_multiBodyB->getNumDofs() + 6;
-				for (int i = 0; i < ndofB; ++i) 
-					deltaVelBDotn += m_data.m_jacobians[cA.m_jacBindex+i] * m_data.m_deltaVelocities[cA.m_deltaVelBindex+i];
+				deltaVelBDotn += dotJacobianSpans(cA.m_jacBspanIndex, cA.m_jacBindex, cA.m_deltaVelBindex);
 			} else if(cA.m_solverBodyIdB >= 0)
 			{
 				bodyB = &m_tmpSolverBodyPool[cA.m_solverBodyIdB];
@@ -404,12 +475,7 @@ btScalar btMultiBodyConstraintSolver::resolveConeFrictionConstraintRows(const bt
 	
 	if (cA.m_multiBodyA)
 	{
-		applyDeltaVee(&m_data.m_deltaVelocitiesUnitImpulse[cA.m_jacAindex],deltaImpulseA,cA.m_deltaVelAindex,ndofA);
-#ifdef DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
-		//note: update of the actual velocities (below) in the multibody does not have to happen now since m_deltaVelocities can be applied after all iterations
-		//it would make the multibody solver more like the regular one with m_deltaVelocities being equivalent to btSolverBody::m_deltaLinearVelocity/m_deltaAngularVelocity
-		cA.m_multiBodyA->applyDeltaVeeMultiDof2(&m_data.m_deltaVelocitiesUnitImpulse[cA.m_jacAindex],deltaImpulseA);
-#endif //DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
+		applyDeltaVeeSpans(cA.m_multiBodyA, cA.m_jacAspanIndex, cA.m_jacAindex, deltaImpulseA, cA.m_deltaVelAindex);
 	} else if(cA.m_solverBodyIdA >= 0)
 	{
 		bodyA->internalApplyImpulse(cA.m_contactNormal1*bodyA->internalGetInvMass(),cA.m_angularComponentA,deltaImpulseA);
@@ -417,12 +483,7 @@ btScalar btMultiBodyConstraintSolver::resolveConeFrictionConstraintRows(const bt
 	}
 	if (cA.m_multiBodyB)
 	{
-		applyDeltaVee(&m_data.m_deltaVelocitiesUnitImpulse[cA.m_jacBindex],deltaImpulseA,cA.m_deltaVelBindex,ndofB);
-#ifdef DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
-		//note: update of the actual velocities (below) in the multibody does not have to happen now since m_deltaVelocities can be applied after all iterations
-		//it would make the multibody solver more like the regular one with m_deltaVelocities being equivalent to btSolverBody::m_deltaLinearVelocity/m_deltaAngularVelocity
-		cA.m_multiBodyB->applyDeltaVeeMultiDof2(&m_data.m_deltaVelocitiesUnitImpulse[cA.m_jacBindex],deltaImpulseA);
-#endif //DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
+		applyDeltaVeeSpans(cA.m_multiBodyB, cA.m_jacBspanIndex, cA.m_jacBindex, deltaImpulseA, cA.m_deltaVelBindex);
 	} else if(cA.m_solverBodyIdB >= 0)
 	{
 		bodyB->internalApplyImpulse(cA.m_contactNormal2*bodyB->internalGetInvMass(),cA.m_angularComponentB,deltaImpulseA);
@@ -430,24 +491,14 @@ btScalar btMultiBodyConstraintSolver::resolveConeFrictionConstraintRows(const bt
 
 	if (cB.m_multiBodyA)
 	{
-		applyDeltaVee(&m_data.m_deltaVelocitiesUnitImpulse[cB.m_jacAindex],deltaImpulseB,cB.m_deltaVelAindex,ndofA);
-#ifdef DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
-		//note: update of the actual velocities (below) in the multibody does not have to happen now since m_deltaVelocities can be applied after all iterations
-		//it would make the multibody solver more like the regular one with m_deltaVelocities being equivalent to btSolverBody::m_deltaLinearVelocity/m_deltaAngularVelocity
-		cB.m_multiBodyA->applyDeltaVeeMultiDof2(&m_data.m_deltaVelocitiesUnitImpulse[cB.m_jacAindex],deltaImpulseB);
-#endif //DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
+		applyDeltaVeeSpans(cB.m_multiBodyA, cB.m_jacAspanIndex, cB.m_jacAindex, deltaImpulseB, cB.m_deltaVelAindex);
 	} else if(cB.m_solverBodyIdA >= 0)
 	{
 		bodyA->internalApplyImpulse(cB.m_contactNormal1*bodyA->internalGetInvMass(),cB.m_angularComponentA,deltaImpulseB);
 	}
 	if (cB.m_multiBodyB)
 	{
-		applyDeltaVee(&m_data.m_deltaVelocitiesUnitImpulse[cB.m_jacBindex],deltaImpulseB,cB.m_deltaVelBindex,ndofB);
-#ifdef DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
-		//note: update of the actual velocities (below) in the multibody does not have to happen now since m_deltaVelocities can be applied after all iterations
-		//it would make the multibody solver more like the regular one with m_deltaVelocities being equivalent to btSolverBody::m_deltaLinearVelocity/m_deltaAngularVelocity
-		cB.m_multiBodyB->applyDeltaVeeMultiDof2(&m_data.m_deltaVelocitiesUnitImpulse[cB.m_jacBindex],deltaImpulseB);
-#endif //DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
+		applyDeltaVeeSpans(cB.m_multiBodyB, cB.m_jacBspanIndex, cB.m_jacBindex, deltaImpulseB, cB.m_deltaVelBindex);
 	} else if(cB.m_solverBodyIdB >= 0)
 	{
 		bodyB->internalApplyImpulse(cB.m_contactNormal2*bodyB->internalGetInvMass(),cB.m_angularComponentB,deltaImpulseB);
@@ -1118,6 +1169,16 @@ void btMultiBodyConstraintSolver::setupMultiBodyTorsionalFrictionConstraint(btMu
     
 }
 
+///the link collider of a contact, unless its btMultiBody is static (see btMultiBody::isStaticMultiBody). That side of the
+///contact then uses the fixed solver body like a static rigid body, so the islands that share a ground don't write to it
+static const btMultiBodyLinkCollider* getContactLinkCollider(const btCollisionObject* colObj)
+{
+	const btMultiBodyLinkCollider* fc = btMultiBodyLinkCollider::upcast(colObj);
+	if (fc && fc->m_multiBody && fc->m_multiBody->isStaticMultiBody())
+		return 0;
+	return fc;
+}
+
 btMultiBodySolverConstraint&	btMultiBodyConstraintSolver::addMultiBodyFrictionConstraint(const btVector3& normalAxis,btPersistentManifold* manifold,int frictionIndex,btManifoldPoint& cp,btCollisionObject* colObj0,btCollisionObject* colObj1, btScalar relaxation, const btContactSolverInfo& infoGlobal, btScalar desiredVelocity, btScalar cfmSlip)
 {
 	BT_PROFILE("addMultiBodyFrictionConstraint");
@@ -1128,8 +1189,8 @@ btMultiBodySolverConstraint&	btMultiBodyConstraintSolver::addMultiBodyFrictionCo
 	solverConstraint.m_frictionIndex = frictionIndex;
 	bool isFriction = true;
 
-	const btMultiBodyLinkCollider* fcA = btMultiBodyLinkCollider::upcast(manifold->getBody0());
-	const btMultiBodyLinkCollider* fcB = btMultiBodyLinkCollider::upcast(manifold->getBody1());
+	const btMultiBodyLinkCollider* fcA = getContactLinkCollider(manifold->getBody0());
+	const btMultiBodyLinkCollider* fcB = getContactLinkCollider(manifold->getBody1());
 	
 	btMultiBody* mbA = fcA? fcA->m_multiBody : 0;
 	btMultiBody* mbB = fcB? fcB->m_multiBody : 0;
@@ -1168,8 +1229,8 @@ btMultiBodySolverConstraint&	btMultiBodyConstraintSolver::addMultiBodyTorsionalF
     solverConstraint.m_frictionIndex = frictionIndex;
     bool isFriction = true;
     
-    const btMultiBodyLinkCollider* fcA = btMultiBodyLinkCollider::upcast(manifold->getBody0());
-    const btMultiBodyLinkCollider* fcB = btMultiBodyLinkCollider::upcast(manifold->getBody1());
+    const btMultiBodyLinkCollider* fcA = getContactLinkCollider(manifold->getBody0());
+    const btMultiBodyLinkCollider* fcB = getContactLinkCollider(manifold->getBody1());
     
     btMultiBody* mbA = fcA? fcA->m_multiBody : 0;
     btMultiBody* mbB = fcB? fcB->m_multiBody : 0;
@@ -1195,8 +1256,8 @@ btMultiBodySolverConstraint&	btMultiBodyConstraintSolver::addMultiBodyTorsionalF
 
 void	btMultiBodyConstraintSolver::convertMultiBodyContact(btPersistentManifold* manifold,const btContactSolverInfo& infoGlobal)
 {
-	const btMultiBodyLinkCollider* fcA = btMultiBodyLinkCollider::upcast(manifold->getBody0());
-	const btMultiBodyLinkCollider* fcB = btMultiBodyLinkCollider::upcast(manifold->getBody1());
+	const btMultiBodyLinkCollider* fcA = getContactLinkCollider(manifold->getBody0());
+	const btMultiBodyLinkCollider* fcB = getContactLinkCollider(manifold->getBody1());
 	
 	btMultiBody* mbA = fcA? fcA->m_multiBody : 0;
 	btMultiBody* mbB = fcB? fcB->m_multiBody : 0;
@@ -1374,8 +1435,8 @@ void btMultiBodyConstraintSolver::convertContacts(btPersistentManifold** manifol
 	for (int i=0;i<numManifolds;i++)
 	{
 		btPersistentManifold* manifold= manifoldPtr[i];
-		const btMultiBodyLinkCollider* fcA = btMultiBodyLinkCollider::upcast(manifold->getBody0());
-		const btMultiBodyLinkCollider* fcB = btMultiBodyLinkCollider::upcast(manifold->getBody1());
+		const btMultiBodyLinkCollider* fcA = getContactLinkCollider(manifold->getBody0());
+		const btMultiBodyLinkCollider* fcB = getContactLinkCollider(manifold->getBody1());
 		if (!fcA && !fcB)
 		{
 			//the contact doesn't involve any Featherstone btMultiBody, so deal with the regular btRigidBody/btCollisionObject case
@@ -1680,3 +1741,20 @@ void  btMultiBodyConstraintSolver::solveMultiBodyGroup(btCollisionObject** bodie
 	
 
 }
+
+void btMultiBodyConstraintSolver::copySolverSettings(const btMultiBodyConstraintSolver& other)
+{
+	m_resolveSingleConstraintRowGeneric = other.m_resolveSingleConstraintRowGeneric;
+	m_resolveSingleConstraintRowLowerLimit = other.m_resolveSingleConstraintRowLowerLimit;
+	m_resolveSplitPenetrationImpulse = other.m_resolveSplitPenetrationImpulse;
+	//otherwise the first solve sets up the default row solver functions again
+	m_cachedSolverMode = other.m_cachedSolverMode;
+	m_btSeed2 = other.m_btSeed2;
+}
+
+btMultiBodyConstraintSolver* btMultiBodyConstraintSolver::createThreadSolver() const
+{
+	btMultiBodyConstraintSolver* solver = new btMultiBodyConstraintSolver();
+	solver->copySolverSettings(*this);
+	return solver;
+}
@@ -84,6 +84,13 @@ protected:
 
 	virtual btScalar solveSingleIteration(int iteration, btCollisionObject** bodies ,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer);
 	void	applyDeltaVee(btScalar* deltaV, btScalar impulse, int velocityIndex, int ndof);
+
+	//record the nonzero ranges of the jacobians and unit impulse responses of the rows, once per setup
+	int		addJacobianSpans(int jacIndex, int ndof);
+	void	setupJacobianSpans(btMultiBodyConstraintArray& rows);
+	//sparse versions of the J*deltaV dot product and of applyDeltaVee + btMultiBody::applyDeltaVeeMultiDof2, using the recorded spans
+	btScalar	dotJacobianSpans(int spanIndex, int jacIndex, int velocityIndex) const;
+	void	applyDeltaVeeSpans(btMultiBody* multiBody, int spanIndex, int jacIndex, btScalar impulse, int velocityIndex);
 	void writeBackSolverBodyToMultiBody(btMultiBodySolverConstraint& constraint, btScalar deltaTime);
 public:
 
@@ -94,6 +101,12 @@ public:
 	virtual btScalar solveGroupCacheFriendlyFinish(btCollisionObject** bodies,int numBodies,const btContactSolverInfo& infoGlobal);
 	
 	virtual void solveMultiBodyGroup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifold,int numManifolds,btTypedConstraint** constraints,int numConstraints,btMultiBodyConstraint** multiBodyConstraints, int numMultiBodyConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer,btDispatcher* dispatcher);
+
+	///returns a new solver of the same type and with the same settings, the btMultiBodyDynamicsWorld solves islands on worker threads with it.
+	///Derived solvers override this to return their own type, the caller deletes the returned solver
+	virtual btMultiBodyConstraintSolver* createThreadSolver() const;
+	///copies the row solver functions and the random seed
+	void	copySolverSettings(const btMultiBodyConstraintSolver& other);
 };
 
 	
@@ -0,0 +1,477 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btMultiBodyConstraintSolverMt.h"
+#include "btMultiBody.h"
+
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "LinearMath/btQuickprof.h"
+
+
+bool btMultiBodyConstraintSolverMt::s_allowNestedParallelForLoops = false;  // some task schedulers don't like nested loops
+int btMultiBodyConstraintSolverMt::s_minimumRowsForBatching = 200;
+
+
+btMultiBodyConstraintSolverMt::btMultiBodyConstraintSolverMt()
+{
+    m_useBatching = false;
+}
+
+
+btMultiBodyConstraintSolverMt::~btMultiBodyConstraintSolverMt()
+{
+}
+
+
+btMultiBodyConstraintSolver* btMultiBodyConstraintSolverMt::createThreadSolver() const
+{
+    btMultiBodyConstraintSolverMt* solver = new btMultiBodyConstraintSolverMt();
+    solver->copySolverSettings( *this );
+    return solver;
+}
+
+
+///Returns the key of the body on one side of a row for the conflict graph, or -1 if solving the row never changes that body.
+///A btMultiBody is keyed by the start of its delta velocities, which is unique per btMultiBody within an island,
+///the rigid bodies come after all of them.
+///A fixed base btMultiBody without dofs (a ground plane loaded from URDF) has a zero unit impulse response, so the
+///rows never write its delta velocities and it gets no key, like a static rigid body.
+static int getRowBodyKey( const btMultiBody* multiBody, int deltaVelIndex, int solverBodyId, const btAlignedObjectArray<btSolverBody>& solverBodies, int numMultiBodyKeys )
+{
+    if ( multiBody )
+    {
+        if ( multiBody->isStaticMultiBody() )
+        {
+            return -1;
+        }
+        return deltaVelIndex;
+    }
+    if ( solverBodyId >= 0 )
+    {
+        const btRigidBody* body = solverBodies[ solverBodyId ].m_originalBody;
+        if ( body && !body->isStaticOrKinematicObject() )
+        {
+            return numMultiBodyKeys + solverBodyId;
+        }
+    }
+    return -1;
+}
+
+
+struct btRowBatchKeySortPredicate
+{
+    template <typename T>
+    bool operator() ( const T& a, const T& b ) const
+    {
+        if ( a.m_phase != b.m_phase )
+        {
+            return a.m_phase < b.m_phase;
+        }
+        if ( a.m_bodyKey0 != b.m_bodyKey0 )
+        {
+            return a.m_bodyKey0 < b.m_bodyKey0;
+        }
+        if ( a.m_bodyKey1 != b.m_bodyKey1 )
+        {
+            return a.m_bodyKey1 < b.m_bodyKey1;
+        }
+        return a.m_row < b.m_row;
+    }
+};
+
+
+void btMultiBodyConstraintSolverMt::setupBatchedRows( btBatchedConstraints* batchedRows, const btMultiBodyConstraintArray& rows )
+{
+    BT_PROFILE( "setupBatchedRows" );
+    btBatchedConstraints& bc = *batchedRows;
+    bc.m_constraintIndices.resizeNoInitialize( 0 );
+    bc.m_batches.resizeNoInitialize( 0 );
+    bc.m_phases.resizeNoInitialize( 0 );
+    bc.m_phaseGrainSize.resizeNoInitialize( 0 );
+    bc.m_phaseOrder.resizeNoInitialize( 0 );
+    int numRows = rows.size();
+    if ( numRows == 0 )
+    {
+        return;
+    }
+
+    // key each row by its dynamic bodies, a row on a single dynamic body gets -1 as its first key
+    int numMultiBodyKeys = m_data.m_deltaVelocities.size();
+    m_rowBatchKeys.resizeNoInitialize( numRows );
+    for ( int iRow = 0; iRow < numRows; ++iRow )
+    {
+        const btMultiBodySolverConstraint& c = rows[ iRow ];
+        int keyA = getRowBodyKey( c.m_multiBodyA, c.m_deltaVelAindex, c.m_solverBodyIdA, m_tmpSolverBodyPool, numMultiBodyKeys );
+        int keyB = getRowBodyKey( c.m_multiBodyB, c.m_deltaVelBindex, c.m_solverBodyIdB, m_tmpSolverBodyPool, numMultiBodyKeys );
+        btRowBatchKey& key = m_rowBatchKeys[ iRow ];
+        key.m_phase = 0;
+        key.m_bodyKey0 = ( keyA == keyB ) ? -1 : btMin( keyA, keyB );
+        key.m_bodyKey1 = btMax( keyA, keyB );
+        key.m_row = iRow;
+    }
+    m_rowBatchKeys.quickSort( btRowBatchKeySortPredicate() );
+
+    // rows with the same keys form a batch, which goes into the first phase that none of its bodies is used in yet.
+    // The single body batches sort first, so they all end up in phase 0
+    m_nextFreePhase.resize( 0 );
+    m_nextFreePhase.resize( numMultiBodyKeys + m_tmpSolverBodyPool.size(), 0 );
+    int numPhases = 0;
+    for ( int iBegin = 0; iBegin < numRows; )
+    {
+        int key0 = m_rowBatchKeys[ iBegin ].m_bodyKey0;
+        int key1 = m_rowBatchKeys[ iBegin ].m_bodyKey1;
+        int iEnd = iBegin + 1;
+        while ( iEnd < numRows && m_rowBatchKeys[ iEnd ].m_bodyKey0 == key0 && m_rowBatchKeys[ iEnd ].m_bodyKey1 == key1 )
+        {
+            ++iEnd;
+        }
+        int phase = 0;
+        if ( key0 >= 0 )
+        {
+            phase = btMax( phase, m_nextFreePhase[ key0 ] );
+        }
+        if ( key1 >= 0 )
+        {
+            phase = btMax( phase, m_nextFreePhase[ key1 ] );
+            m_nextFreePhase[ key1 ] = phase + 1;
+        }
+        if ( key0 >= 0 )
+        {
+            m_nextFreePhase[ key0 ] = phase + 1;
+        }
+        for ( int i = iBegin; i < iEnd; ++i )
+        {
+            m_rowBatchKeys[ i ].m_phase = phase;
+        }
+        numPhases = btMax( numPhases, phase + 1 );
+        iBegin = iEnd;
+    }
+    m_rowBatchKeys.quickSort( btRowBatchKeySortPredicate() );
+
+    // write out the batches phase by phase
+    bc.m_constraintIndices.resizeNoInitialize( numRows );
+    for ( int i = 0; i < numRows; ++i )
+    {
+        bc.m_constraintIndices[ i ] = m_rowBatchKeys[ i ].m_row;
+        const btRowBatchKey& key = m_rowBatchKeys[ i ];
+        bool newPhase = ( i == 0 ) || ( m_rowBatchKeys[ i - 1 ].m_phase != key.m_phase );
+        if ( newPhase || m_rowBatchKeys[ i - 1 ].m_bodyKey0 != key.m_bodyKey0 || m_rowBatchKeys[ i - 1 ].m_bodyKey1 != key.m_bodyKey1 )
+        {
+            if ( newPhase )
+            {
+                bc.m_phases.push_back( btBatchedConstraints::Range( bc.m_batches.size(), bc.m_batches.size() ) );
+            }
+            bc.m_batches.push_back( btBatchedConstraints::Range( i, i ) );
+            bc.m_phases[ bc.m_phases.size() - 1 ].end++;
+        }
+        bc.m_batches[ bc.m_batches.size() - 1 ].end++;
+    }
+    btAssert( bc.m_phases.size() == numPhases );
+
+    // same grain sizes as btBatchedConstraints
+    int numThreads = btGetTaskScheduler() ? btGetTaskScheduler()->getNumThreads() : 1;
+    bc.m_phaseGrainSize.resizeNoInitialize( numPhases );
+    bc.m_phaseOrder.resizeNoInitialize( numPhases );
+    for ( int iPhase = 0; iPhase < numPhases; ++iPhase )
+    {
+        const btBatchedConstraints::Range& phase = bc.m_phases[ iPhase ];
+        int numBatches = phase.end - phase.begin;
+        int grainSize = int( 0.25f*numBatches / float( numThreads ) );
+        bc.m_phaseGrainSize[ iPhase ] = char( btMin( 127, btMax( 1, grainSize ) ) );
+        bc.m_phaseOrder[ iPhase ] = iPhase;
+    }
+}
+
+
+btScalar btMultiBodyConstraintSolverMt::solveGroupCacheFriendlySetup( btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer )
+{
+    btScalar val = btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup( bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer );
+
+    int numRows = m_multiBodyNonContactConstraints.size() +
+        m_multiBodyNormalContactConstraints.size() +
+        m_multiBodyFrictionContactConstraints.size() +
+        m_multiBodyTorsionalFrictionContactConstraints.size();
+    m_useBatching = ( numRows >= s_minimumRowsForBatching ) && ( s_allowNestedParallelForLoops || !btThreadsAreRunning() );
+    if ( m_useBatching )
+    {
+        BT_PROFILE( "batch multibody rows" );
+        setupBatchedRows( &m_batchedNonContactRows, m_multiBodyNonContactConstraints );
+        setupBatchedRows( &m_batchedNormalContactRows, m_multiBodyNormalContactConstraints );
+        setupBatchedRows( &m_batchedFrictionContactRows, m_multiBodyFrictionContactConstraints );
+        setupBatchedRows( &m_batchedTorsionalFrictionContactRows, m_multiBodyTorsionalFrictionContactConstraints );
+    }
+    return val;
+}
+
+
+btScalar btMultiBodyConstraintSolverMt::resolveMultipleNonContactConstraints( const btAlignedObjectArray<int>& rowIndices, int batchBegin, int batchEnd, int iteration )
+{
+    btScalar leastSquaredResidual = 0.f;
+    int numRows = batchEnd - batchBegin;
+    for ( int j = 0; j < numRows; ++j )
+    {
+        // alternate the direction like the serial solver
+        int iiRow = ( iteration & 1 ) ? batchBegin + j : batchEnd - 1 - j;
+        btMultiBodySolverConstraint& constraint = m_multiBodyNonContactConstraints[ rowIndices[ iiRow ] ];
+
+        btScalar residual = resolveSingleConstraintRowGeneric( constraint );
+        leastSquaredResidual += residual*residual;
+
+        if ( constraint.m_multiBodyA )
+            constraint.m_multiBodyA->setPosUpdated( false );
+        if ( constraint.m_multiBodyB )
+            constraint.m_multiBodyB->setPosUpdated( false );
+    }
+    return leastSquaredResidual;
+}
+
+
+btScalar btMultiBodyConstraintSolverMt::resolveMultipleNormalContactConstraints( const btAlignedObjectArray<int>& rowIndices, int batchBegin, int batchEnd )
+{
+    btScalar leastSquaredResidual = 0.f;
+    for ( int iiRow = batchBegin; iiRow < batchEnd; ++iiRow )
+    {
+        btMultiBodySolverConstraint& constraint = m_multiBodyNormalContactConstraints[ rowIndices[ iiRow ] ];
+
+        btScalar residual = resolveSingleConstraintRowGeneric( constraint );
+        leastSquaredResidual += residual*residual;
+
+        if ( constraint.m_multiBodyA )
+            constraint.m_multiBodyA->setPosUpdated( false );
+        if ( constraint.m_multiBodyB )
+            constraint.m_multiBodyB->setPosUpdated( false );
+    }
+    return leastSquaredResidual;
+}
+
+
+btScalar btMultiBodyConstraintSolverMt::resolveMultipleFrictionContactConstraints( btMultiBodyConstraintArray& frictionRows, const btAlignedObjectArray<int>& rowIndices, int batchBegin, int batchEnd )
+{
+    btScalar leastSquaredResidual = 0.f;
+    for ( int iiRow = batchBegin; iiRow < batchEnd; ++iiRow )
+    {
+        btMultiBodySolverConstraint& frictionConstraint = frictionRows[ rowIndices[ iiRow ] ];
+        btScalar totalImpulse = m_multiBodyNormalContactConstraints[ frictionConstraint.m_frictionIndex ].m_appliedImpulse;
+        //adjust friction limits here
+        if ( totalImpulse > btScalar( 0 ) )
+        {
+            frictionConstraint.m_lowerLimit = -( frictionConstraint.m_friction*totalImpulse );
+            frictionConstraint.m_upperLimit = frictionConstraint.m_friction*totalImpulse;
+            btScalar residual = resolveSingleConstraintRowGeneric( frictionConstraint );
+            leastSquaredResidual += residual*residual;
+
+            if ( frictionConstraint.m_multiBodyA )
+                frictionConstraint.m_multiBodyA->setPosUpdated( false );
+            if ( frictionConstraint.m_multiBodyB )
+                frictionConstraint.m_multiBodyB->setPosUpdated( false );
+        }
+    }
+    return leastSquaredResidual;
+}
+
+
+btScalar btMultiBodyConstraintSolverMt::resolveMultipleConeFrictionContactConstraints( const btAlignedObjectArray<int>& rowIndices, int batchBegin, int batchEnd )
+{
+    // the two friction rows of a contact are next to each other in the pool and have the same bodies,
+    // so they are also next to each other in the batch
+    btScalar leastSquaredResidual = 0.f;
+    for ( int iiRow = batchBegin; iiRow + 1 < batchEnd; iiRow += 2 )
+    {
+        btMultiBodySolverConstraint& frictionConstraint = m_multiBodyFrictionContactConstraints[ rowIndices[ iiRow ] ];
+        btMultiBodySolverConstraint& frictionConstraintB = m_multiBodyFrictionContactConstraints[ rowIndices[ iiRow + 1 ] ];
+        btAssert( rowIndices[ iiRow ] + 1 == rowIndices[ iiRow + 1 ] );
+        btAssert( frictionConstraint.m_frictionIndex == frictionConstraintB.m_frictionIndex );
+        btScalar totalImpulse = m_multiBodyNormalContactConstraints[ frictionConstraint.m_frictionIndex ].m_appliedImpulse;
+
+        if ( frictionConstraint.m_frictionIndex == frictionConstraintB.m_frictionIndex )
+        {
+            frictionConstraint.m_lowerLimit = -( frictionConstraint.m_friction*totalImpulse );
+            frictionConstraint.m_upperLimit = frictionConstraint.m_friction*totalImpulse;
+            frictionConstraintB.m_lowerLimit = -( frictionConstraintB.m_friction*totalImpulse );
+            frictionConstraintB.m_upperLimit = frictionConstraintB.m_friction*totalImpulse;
+            btScalar residual = resolveConeFrictionConstraintRows( frictionConstraint, frictionConstraintB );
+            leastSquaredResidual += residual*residual;
+
+            if ( frictionConstraintB.m_multiBodyA )
+                frictionConstraintB.m_multiBodyA->setPosUpdated( false );
+            if ( frictionConstraintB.m_multiBodyB )
+                frictionConstraintB.m_multiBodyB->setPosUpdated( false );
+
+            if ( frictionConstraint.m_multiBodyA )
+                frictionConstraint.m_multiBodyA->setPosUpdated( false );
+            if ( frictionConstraint.m_multiBodyB )
+                frictionConstraint.m_multiBodyB->setPosUpdated( false );
+        }
+    }
+    return leastSquaredResidual;
+}
+
+
+struct MultiBodyNonContactSolverLoop : public btIParallelSumBody
+{
+    btMultiBodyConstraintSolverMt* m_solver;
+    const btBatchedConstraints* m_bc;
+    int m_iteration;
+
+    MultiBodyNonContactSolverLoop( btMultiBodyConstraintSolverMt* solver, const btBatchedConstraints* bc, int iteration )
+    {
+        m_solver = solver;
+        m_bc = bc;
+        m_iteration = iteration;
+    }
+    btScalar sumLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        BT_PROFILE( "MultiBodyNonContactSolverLoop" );
+        btScalar sum = 0;
+        for ( int iBatch = iBegin; iBatch < iEnd; ++iBatch )
+        {
+            const btBatchedConstraints::Range& batch = m_bc->m_batches[ iBatch ];
+            sum += m_solver->resolveMultipleNonContactConstraints( m_bc->m_constraintIndices, batch.begin, batch.end, m_iteration );
+        }
+        return sum;
+    }
+};
+
+
+struct MultiBodyNormalContactSolverLoop : public btIParallelSumBody
+{
+    btMultiBodyConstraintSolverMt* m_solver;
+    const btBatchedConstraints* m_bc;
+
+    MultiBodyNormalContactSolverLoop( btMultiBodyConstraintSolverMt* solver, const btBatchedConstraints* bc )
+    {
+        m_solver = solver;
+        m_bc = bc;
+    }
+    btScalar sumLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        BT_PROFILE( "MultiBodyNormalContactSolverLoop" );
+        btScalar sum = 0;
+        for ( int iBatch = iBegin; iBatch < iEnd; ++iBatch )
+        {
+            const btBatchedConstraints::Range& batch = m_bc->m_batches[ iBatch ];
+            sum += m_solver->resolveMultipleNormalContactConstraints( m_bc->m_constraintIndices, batch.begin, batch.end );
+        }
+        return sum;
+    }
+};
+
+
+struct MultiBodyFrictionContactSolverLoop : public btIParallelSumBody
+{
+    btMultiBodyConstraintSolverMt* m_solver;
+    const btBatchedConstraints* m_bc;
+    btMultiBodyConstraintArray* m_frictionRows;
+
+    MultiBodyFrictionContactSolverLoop( btMultiBodyConstraintSolverMt* solver, const btBatchedConstraints* bc, btMultiBodyConstraintArray* frictionRows )
+    {
+        m_solver = solver;
+        m_bc = bc;
+        m_frictionRows = frictionRows;
+    }
+    btScalar sumLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        BT_PROFILE( "MultiBodyFrictionContactSolverLoop" );
+        btScalar sum = 0;
+        for ( int iBatch = iBegin; iBatch < iEnd; ++iBatch )
+        {
+            const btBatchedConstraints::Range& batch = m_bc->m_batches[ iBatch ];
+            sum += m_solver->resolveMultipleFrictionContactConstraints( *m_frictionRows, m_bc->m_constraintIndices, batch.begin, batch.end );
+        }
+        return sum;
+    }
+};
+
+
+struct MultiBodyConeFrictionContactSolverLoop : public btIParallelSumBody
+{
+    btMultiBodyConstraintSolverMt* m_solver;
+    const btBatchedConstraints* m_bc;
+
+    MultiBodyConeFrictionContactSolverLoop( btMultiBodyConstraintSolverMt* solver, const btBatchedConstraints* bc )
+    {
+        m_solver = solver;
+        m_bc = bc;
+    }
+    btScalar sumLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        BT_PROFILE( "MultiBodyConeFrictionContactSolverLoop" );
+        btScalar sum = 0;
+        for ( int iBatch = iBegin; iBatch < iEnd; ++iBatch )
+        {
+            const btBatchedConstraints::Range& batch = m_bc->m_batches[ iBatch ];
+            sum += m_solver->resolveMultipleConeFrictionContactConstraints( m_bc->m_constraintIndices, batch.begin, batch.end );
+        }
+        return sum;
+    }
+};
+
+
+btScalar btMultiBodyConstraintSolverMt::resolveAllBatchedRows( const btBatchedConstraints& batchedRows, const btIParallelSumBody& loop )
+{
+    btScalar leastSquaredResidual = 0.f;
+    for ( int iiPhase = 0; iiPhase < batchedRows.m_phases.size(); ++iiPhase )
+    {
+        int iPhase = batchedRows.m_phaseOrder[ iiPhase ];
+        const btBatchedConstraints::Range& phase = batchedRows.m_phases[ iPhase ];
+        int grainSize = batchedRows.m_phaseGrainSize[ iPhase ];
+        leastSquaredResidual += btParallelSum( phase.begin, phase.end, grainSize, loop );
+    }
+    return leastSquaredResidual;
+}
+
+
+btScalar btMultiBodyConstraintSolverMt::solveSingleIteration( int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer )
+{
+    if ( !m_useBatching )
+    {
+        return btMultiBodyConstraintSolver::solveSingleIteration( iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer );
+    }
+    BT_PROFILE( "solveSingleIterationMt" );
+    // the rows between rigid bodies only
+    btScalar leastSquaredResidual = btSequentialImpulseConstraintSolver::solveSingleIteration( iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer );
+
+    //solve featherstone non-contact constraints
+    {
+        MultiBodyNonContactSolverLoop loop( this, &m_batchedNonContactRows, iteration );
+        leastSquaredResidual += resolveAllBatchedRows( m_batchedNonContactRows, loop );
+    }
+
+    if ( iteration < infoGlobal.m_numIterations )
+    {
+        //solve featherstone normal contact
+        {
+            MultiBodyNormalContactSolverLoop loop( this, &m_batchedNormalContactRows );
+            leastSquaredResidual += resolveAllBatchedRows( m_batchedNormalContactRows, loop );
+        }
+
+        //solve featherstone frictional contact
+        if ( infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS && ( ( infoGlobal.m_solverMode&SOLVER_DISABLE_IMPLICIT_CONE_FRICTION ) == 0 ) )
+        {
+            MultiBodyFrictionContactSolverLoop torsionalLoop( this, &m_batchedTorsionalFrictionContactRows, &m_multiBodyTorsionalFrictionContactConstraints );
+            leastSquaredResidual += resolveAllBatchedRows( m_batchedTorsionalFrictionContactRows, torsionalLoop );
+
+            MultiBodyConeFrictionContactSolverLoop loop( this, &m_batchedFrictionContactRows );
+            leastSquaredResidual += resolveAllBatchedRows( m_batchedFrictionContactRows, loop );
+        }
+        else
+        {
+            MultiBodyFrictionContactSolverLoop loop( this, &m_batchedFrictionContactRows, &m_multiBodyFrictionContactConstraints );
+            leastSquaredResidual += resolveAllBatchedRows( m_batchedFrictionContactRows, loop );
+        }
+    }
+    return leastSquaredResidual;
+}
@@ -0,0 +1,85 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_MULTIBODY_CONSTRAINT_SOLVER_MT_H
+#define BT_MULTIBODY_CONSTRAINT_SOLVER_MT_H
+
+#include "btMultiBodyConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btBatchedConstraints.h"
+#include "LinearMath/btThreads.h"
+
+///
+/// btMultiBodyConstraintSolverMt
+///
+///  A multithreaded variant of the btMultiBodyConstraintSolver. The btMultiBodySolverConstraint rows of an island are put
+///  into batches by the dynamic bodies they touch: all rows between the same pair of bodies (or on a single body, when the
+///  other side is static) form one batch, and the batches are spread over phases so that no two batches of a phase share a
+///  btMultiBody or a dynamic rigid body. The batches of a phase are solved in parallel with btParallelSum, the rows within
+///  a batch keep the order and direction of the serial solver.
+///  Static and kinematic bodies and fixed base btMultiBodies without dofs don't change during solving, so they are left
+///  out of the conflict graph. Many robots that only touch a shared ground plane end up as one batch each, all in the
+///  first phase.
+///
+///  Rows between rigid bodies only are solved serially by the btSequentialImpulseConstraintSolver as before.
+///  Islands with fewer than s_minimumRowsForBatching multibody rows are solved serially as well.
+///
+ATTRIBUTE_ALIGNED16(class) btMultiBodyConstraintSolverMt : public btMultiBodyConstraintSolver
+{
+public:
+    // parameters to control batching
+    static bool s_allowNestedParallelForLoops;  // whether to allow nested parallel operations
+    static int s_minimumRowsForBatching;  // don't batch if the island has fewer multibody rows than this
+
+protected:
+    // temp struct used to sort the rows into batches and phases
+    struct btRowBatchKey
+    {
+        int m_phase;
+        int m_bodyKey0;  // smaller of the two dynamic body keys, -1 if the row has fewer than 2 distinct dynamic bodies
+        int m_bodyKey1;
+        int m_row;
+    };
+
+    btBatchedConstraints m_batchedNonContactRows;
+    btBatchedConstraints m_batchedNormalContactRows;
+    btBatchedConstraints m_batchedFrictionContactRows;
+    btBatchedConstraints m_batchedTorsionalFrictionContactRows;
+    bool m_useBatching;
+    btAlignedObjectArray<btRowBatchKey> m_rowBatchKeys;
+    btAlignedObjectArray<int> m_nextFreePhase;  // per body key, the first phase the body isn't used in yet
+
+    virtual btScalar solveGroupCacheFriendlySetup( btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer ) BT_OVERRIDE;
+    virtual btScalar solveSingleIteration( int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer ) BT_OVERRIDE;
+
+    void setupBatchedRows( btBatchedConstraints* batchedRows, const btMultiBodyConstraintArray& rows );
+    btScalar resolveAllBatchedRows( const btBatchedConstraints& batchedRows, const btIParallelSumBody& loop );
+
+public:
+
+    BT_DECLARE_ALIGNED_ALLOCATOR();
+
+    btMultiBodyConstraintSolverMt();
+    virtual ~btMultiBodyConstraintSolverMt();
+
+    virtual btMultiBodyConstraintSolver* createThreadSolver() const BT_OVERRIDE;
+
+    btScalar resolveMultipleNonContactConstraints( const btAlignedObjectArray<int>& rowIndices, int batchBegin, int batchEnd, int iteration );
+    btScalar resolveMultipleNormalContactConstraints( const btAlignedObjectArray<int>& rowIndices, int batchBegin, int batchEnd );
+    btScalar resolveMultipleFrictionContactConstraints( btMultiBodyConstraintArray& frictionRows, const btAlignedObjectArray<int>& rowIndices, int batchBegin, int batchEnd );
+    btScalar resolveMultipleConeFrictionContactConstraints( const btAlignedObjectArray<int>& rowIndices, int batchBegin, int batchEnd );
+};
+
+
+#endif //BT_MULTIBODY_CONSTRAINT_SOLVER_MT_H
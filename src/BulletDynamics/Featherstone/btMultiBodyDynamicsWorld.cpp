@@ -18,16 +18,43 @@ subject to the following restrictions:
 #include "btMultiBody.h"
 #include "btMultiBodyLinkCollider.h"
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
 #include "LinearMath/btQuickprof.h"
 #include "btMultiBodyConstraint.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btThreads.h"
 
 
 void	btMultiBodyDynamicsWorld::addMultiBody(btMultiBody* body, int group, int mask)
 {
 	m_multiBodies.push_back(body);
 
+	//the link colliders of a static btMultiBody are flagged static once, like a static rigid body they don't merge islands.
+	//Otherwise all btMultiBodies on a shared ground plane end up in a single island
+	if (body->isStaticMultiBody())
+	{
+		for (int b=-1;b<body->getNumLinks();b++)
+		{
+			btMultiBodyLinkCollider* col = b<0 ? body->getBaseCollider() : body->getLink(b).m_collider;
+			if (col)
+			{
+				col->setCollisionFlags(col->getCollisionFlags() | btCollisionObject::CF_STATIC_OBJECT);
+			}
+		}
+	}
+}
+
+void	btMultiBodyDynamicsWorld::addCollisionObject(btCollisionObject* collisionObject, int collisionFilterGroup, int collisionFilterMask)
+{
+	//a link collider added after its static btMultiBody is flagged here, the ones added before in addMultiBody
+	btMultiBodyLinkCollider* col = btMultiBodyLinkCollider::upcast(collisionObject);
+	if (col && col->m_multiBody && col->m_multiBody->isStaticMultiBody() && m_multiBodies.findLinearSearch(col->m_multiBody) < m_multiBodies.size())
+	{
+		col->setCollisionFlags(col->getCollisionFlags() | btCollisionObject::CF_STATIC_OBJECT);
+	}
+	btDiscreteDynamicsWorld::addCollisionObject(collisionObject, collisionFilterGroup, collisionFilterMask);
 }
 
 void	btMultiBodyDynamicsWorld::removeMultiBody(btMultiBody* body)
@@ -240,6 +267,23 @@ struct MultiBodyInplaceSolverIslandCallback : public btSimulationIslandManager::
 	btAlignedObjectArray<btTypedConstraint*> m_constraints;
 	btAlignedObjectArray<btMultiBodyConstraint*> m_multiBodyConstraints;
 
+	///a group of islands that is solved with a single solveMultiBodyGroup call
+	struct IslandBatch
+	{
+		btAlignedObjectArray<btCollisionObject*> m_bodies;
+		btAlignedObjectArray<btPersistentManifold*> m_manifolds;
+		btAlignedObjectArray<btTypedConstraint*> m_constraints;
+		btAlignedObjectArray<btMultiBodyConstraint*> m_multiBodyConstraints;
+		bool m_isShared;  // reaches a btMultiBody that another batch reaches too, so it can't run alongside it
+	};
+
+	//when set, processConstraints only stores the batch and solveIslandBatches solves the stored batches in parallel
+	bool					m_deferIslandBatches;
+	btAlignedObjectArray<IslandBatch*> m_islandBatches;
+	int						m_numIslandBatches;
+	btAlignedObjectArray<btMultiBodyConstraintSolver*> m_threadSolvers;  // per worker thread, the main thread uses m_solver
+	btHashMap<btHashPtr,int> m_multiBodyBatch;
+
 
 	MultiBodyInplaceSolverIslandCallback(	btMultiBodyConstraintSolver*	solver,
 									btDispatcher* dispatcher)
@@ -248,11 +292,25 @@ struct MultiBodyInplaceSolverIslandCallback : public btSimulationIslandManager::
 		m_multiBodySortedConstraints(NULL),
 		m_numConstraints(0),
 		m_debugDrawer(NULL),
-		m_dispatcher(dispatcher)
+		m_dispatcher(dispatcher),
+		m_deferIslandBatches(false),
+		m_numIslandBatches(0)
 	{
 
 	}
 
+	virtual ~MultiBodyInplaceSolverIslandCallback()
+	{
+		for (int i=0;i<m_islandBatches.size();i++)
+		{
+			delete m_islandBatches[i];
+		}
+		for (int i=0;i<m_threadSolvers.size();i++)
+		{
+			delete m_threadSolvers[i];
+		}
+	}
+
 	MultiBodyInplaceSolverIslandCallback& operator=(MultiBodyInplaceSolverIslandCallback& other)
 	{
 		btAssert(0);
@@ -360,6 +418,26 @@ struct MultiBodyInplaceSolverIslandCallback : public btSimulationIslandManager::
 	}
 	void	processConstraints()
 	{
+		if (m_deferIslandBatches)
+		{
+			if (m_bodies.size() || m_manifolds.size() || m_constraints.size() || m_multiBodyConstraints.size())
+			{
+				if (m_numIslandBatches == m_islandBatches.size())
+				{
+					m_islandBatches.push_back(new IslandBatch());
+				}
+				IslandBatch* batch = m_islandBatches[m_numIslandBatches++];
+				batch->m_bodies.copyFromArray(m_bodies);
+				batch->m_manifolds.copyFromArray(m_manifolds);
+				batch->m_constraints.copyFromArray(m_constraints);
+				batch->m_multiBodyConstraints.copyFromArray(m_multiBodyConstraints);
+			}
+			m_bodies.resize(0);
+			m_manifolds.resize(0);
+			m_constraints.resize(0);
+			m_multiBodyConstraints.resize(0);
+			return;
+		}
 
 		btCollisionObject** bodies = m_bodies.size()? &m_bodies[0]:0;
 		btPersistentManifold** manifold = m_manifolds.size()?&m_manifolds[0]:0;
@@ -375,9 +453,285 @@ struct MultiBodyInplaceSolverIslandCallback : public btSimulationIslandManager::
 		m_multiBodyConstraints.resize(0);
 	}
 
+	void	solveIslandBatch(btMultiBodyConstraintSolver* solver, IslandBatch& batch)
+	{
+		btCollisionObject** bodies = batch.m_bodies.size()? &batch.m_bodies[0]:0;
+		btPersistentManifold** manifold = batch.m_manifolds.size()?&batch.m_manifolds[0]:0;
+		btTypedConstraint** constraints = batch.m_constraints.size()?&batch.m_constraints[0]:0;
+		btMultiBodyConstraint** multiBodyConstraints = batch.m_multiBodyConstraints.size() ? &batch.m_multiBodyConstraints[0] : 0;
+
+		solver->solveMultiBodyGroup( bodies,batch.m_bodies.size(),manifold, batch.m_manifolds.size(),constraints, batch.m_constraints.size() ,multiBodyConstraints, batch.m_multiBodyConstraints.size(), *m_solverInfo,m_debugDrawer,m_dispatcher);
+	}
+
+	///the solver for the calling thread. The worker threads solve with copies of m_solver, see btMultiBodyConstraintSolver::createThreadSolver
+	btMultiBodyConstraintSolver*	getThreadSolver()
+	{
+		int threadIndex = 0;
+#if BT_THREADSAFE
+		threadIndex = btGetCurrentThreadIndex();
+#endif
+		if (threadIndex == 0)
+		{
+			return m_solver;
+		}
+		btMultiBodyConstraintSolver*& solver = m_threadSolvers[threadIndex];
+		if (!solver)
+		{
+			//only for thread indices beyond the thread count of the task scheduler, the others are created up front
+			solver = m_solver->createThreadSolver();
+		}
+		return solver;
+	}
+
+	void	markMultiBody(const btMultiBody* multiBody, int iBatch)
+	{
+		if (!multiBody)
+			return;
+		int* otherBatch = m_multiBodyBatch.find(btHashPtr(multiBody));
+		if (!otherBatch)
+		{
+			m_multiBodyBatch.insert(btHashPtr(multiBody),iBatch);
+		} else if (*otherBatch != iBatch)
+		{
+			m_islandBatches[*otherBatch]->m_isShared = true;
+			m_islandBatches[iBatch]->m_isShared = true;
+		}
+	}
+
+	///the bodies of different islands are disjoint, but a btMultiBody can still be reached from outside its own island,
+	///through a static or kinematic link collider in a contact or through a btMultiBodyConstraint.
+	///The solver writes to every btMultiBody it reaches, so the batches that share one are solved one after another.
+	///The contacts with a static btMultiBody use the fixed solver body instead, like a static rigid body they don't count
+	void	findSharedIslandBatches()
+	{
+		m_multiBodyBatch.clear();
+		for (int iBatch=0;iBatch<m_numIslandBatches;iBatch++)
+		{
+			IslandBatch& batch = *m_islandBatches[iBatch];
+			batch.m_isShared = false;
+			for (int i=0;i<batch.m_manifolds.size();i++)
+			{
+				const btMultiBodyLinkCollider* fcA = btMultiBodyLinkCollider::upcast(batch.m_manifolds[i]->getBody0());
+				const btMultiBodyLinkCollider* fcB = btMultiBodyLinkCollider::upcast(batch.m_manifolds[i]->getBody1());
+				if (fcA && fcA->isStaticOrKinematicObject() && fcA->m_multiBody && !fcA->m_multiBody->isStaticMultiBody())
+					markMultiBody(fcA->m_multiBody,iBatch);
+				if (fcB && fcB->isStaticOrKinematicObject() && fcB->m_multiBody && !fcB->m_multiBody->isStaticMultiBody())
+					markMultiBody(fcB->m_multiBody,iBatch);
+			}
+			for (int i=0;i<batch.m_multiBodyConstraints.size();i++)
+			{
+				markMultiBody(batch.m_multiBodyConstraints[i]->getMultiBodyA(),iBatch);
+				markMultiBody(batch.m_multiBodyConstraints[i]->getMultiBodyB(),iBatch);
+			}
+		}
+		if (m_multiBodyBatch.size() == 0)
+			return;
+		for (int iBatch=0;iBatch<m_numIslandBatches;iBatch++)
+		{
+			IslandBatch& batch = *m_islandBatches[iBatch];
+			for (int i=0;i<batch.m_bodies.size();i++)
+			{
+				const btMultiBodyLinkCollider* fc = btMultiBodyLinkCollider::upcast(batch.m_bodies[i]);
+				if (fc)
+					markMultiBody(fc->m_multiBody,iBatch);
+			}
+		}
+	}
+
+	void	solveIslandBatches();
+
+};
+
+
+struct MultiBodyIslandBatchSolverLoop : public btIParallelForBody
+{
+	MultiBodyInplaceSolverIslandCallback* m_callback;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		btMultiBodyConstraintSolver* solver = m_callback->getThreadSolver();
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			MultiBodyInplaceSolverIslandCallback::IslandBatch* batch = m_callback->m_islandBatches[i];
+			if (!batch->m_isShared)
+			{
+				m_callback->solveIslandBatch(solver,*batch);
+			}
+		}
+	}
 };
 
 
+void	MultiBodyInplaceSolverIslandCallback::solveIslandBatches()
+{
+	if (m_numIslandBatches == 0)
+		return;
+
+	BT_PROFILE("solveIslandBatches");
+	if (m_numIslandBatches > 1)
+	{
+		findSharedIslandBatches();
+		if (m_threadSolvers.size() == 0)
+		{
+			m_threadSolvers.resize(BT_MAX_THREAD_COUNT,0);
+		}
+		//create the solvers of the worker threads here, while m_solver isn't solving yet, and pass on
+		//the settings that changed since
+		int numThreads = btMin(btGetTaskScheduler()->getNumThreads(),int(BT_MAX_THREAD_COUNT));
+		for (int i=1;i<m_threadSolvers.size();i++)
+		{
+			if (m_threadSolvers[i])
+			{
+				m_threadSolvers[i]->copySolverSettings(*m_solver);
+			} else if (i<numThreads)
+			{
+				m_threadSolvers[i] = m_solver->createThreadSolver();
+			}
+		}
+		MultiBodyIslandBatchSolverLoop loop;
+		loop.m_callback = this;
+		btParallelFor(0,m_numIslandBatches,1,loop);
+	} else
+	{
+		m_islandBatches[0]->m_isShared = true;
+	}
+	for (int i=0;i<m_numIslandBatches;i++)
+	{
+		if (m_islandBatches[i]->m_isShared)
+		{
+			solveIslandBatch(m_solver,*m_islandBatches[i]);
+		}
+	}
+	m_numIslandBatches = 0;
+}
+
+
+
+static bool btIsMultiBodySleeping(const btMultiBody* bod)
+{
+	if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
+	{
+		return true;
+	} 
+	for (int b=0;b<bod->getNumLinks();b++)
+	{
+		if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
+			return true;
+	}
+	return false;
+}
+
+///the btMultiBodies are updated independently of each other, with the scratch memory of the thread.
+///Runs serially when the world itself is stepped from a parallel loop
+static void btMultiBodyParallelFor(int iBegin, int iEnd, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	if (btGetTaskScheduler() && !btThreadsAreRunning())
+	{
+		int grainSize = 4;  // num of multibodies per task, the ABA of an articulated body is a lot more work than a rigid body update
+		btParallelFor(iBegin,iEnd,grainSize,body);
+		return;
+	}
+#endif
+	body.forLoop(iBegin,iEnd);
+}
+
+struct btMultiBodyForwardKinematicsLoop : public btIParallelForBody
+{
+	btMultiBodyDynamicsWorld* m_world;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		btMultiBodyThreadScratch& scratch = m_world->getThreadScratch();
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_world->m_multiBodies[i]->forwardKinematics(scratch.m_scratch_world_to_local,scratch.m_scratch_local_origin);
+		}
+	}
+};
+
+struct btMultiBodyIntegrateVelocitiesLoop : public btIParallelForBody
+{
+	btMultiBodyDynamicsWorld* m_world;
+	const btContactSolverInfo* m_solverInfo;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		btMultiBodyThreadScratch& scratch = m_world->getThreadScratch();
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btMultiBody* bod = m_world->m_multiBodies[i];
+			if (!btIsMultiBodySleeping(bod))
+			{
+				m_world->integrateMultiBodyVelocities(bod,*m_solverInfo,scratch);
+			}
+		}
+	}
+};
+
+struct btMultiBodyConstraintVelocitiesLoop : public btIParallelForBody
+{
+	btMultiBodyDynamicsWorld* m_world;
+	const btContactSolverInfo* m_solverInfo;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		btMultiBodyThreadScratch& scratch = m_world->getThreadScratch();
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btMultiBody* bod = m_world->m_multiBodies[i];
+			if (!btIsMultiBodySleeping(bod) && !bod->isUsingRK4Integration())
+			{
+				scratch.m_scratch_r.resize(bod->getNumLinks()+1);
+				scratch.m_scratch_v.resize(bod->getNumLinks()+1);
+				scratch.m_scratch_m.resize(bod->getNumLinks()+1);
+				bool isConstraintPass = true;
+				bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(m_solverInfo->m_timeStep, scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m, isConstraintPass);
+			}
+			bod->processDeltaVeeMultiDof2();
+		}
+	}
+};
+
+struct btMultiBodyIntegrateTransformsLoop : public btIParallelForBody
+{
+	btMultiBodyDynamicsWorld* m_world;
+	btScalar m_timeStep;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		btMultiBodyThreadScratch& scratch = m_world->getThreadScratch();
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btMultiBody* bod = m_world->m_multiBodies[i];
+			if (!btIsMultiBodySleeping(bod))
+			{
+				int nLinks = bod->getNumLinks();
+
+				///base + num m_links
+				if(!bod->isPosUpdated())
+					bod->stepPositionsMultiDof(m_timeStep);
+				else
+				{
+					btScalar *pRealBuf = const_cast<btScalar *>(bod->getVelocityVector());
+					pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs()*bod->getNumDofs();
+
+					bod->stepPositionsMultiDof(1, 0, pRealBuf);
+					bod->setPosUpdated(false);
+				}
+
+				scratch.m_scratch_world_to_local.resize(nLinks+1);
+				scratch.m_scratch_local_origin.resize(nLinks+1);
+
+				bod->updateCollisionObjectWorldTransforms(scratch.m_scratch_world_to_local,scratch.m_scratch_local_origin);
+			} else
+			{
+				bod->clearVelocities();
+			}
+		}
+	}
+};
+
 
 btMultiBodyDynamicsWorld::btMultiBodyDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btMultiBodyConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration)
 	:btDiscreteDynamicsWorld(dispatcher,pairCache,constraintSolver,collisionConfiguration),
@@ -387,6 +741,11 @@ btMultiBodyDynamicsWorld::btMultiBodyDynamicsWorld(btDispatcher* dispatcher,btBr
 //	getSolverInfo().m_splitImpulse = false;
 	getSolverInfo().m_solverMode |=SOLVER_USE_2_FRICTION_DIRECTIONS;
 	m_solverMultiBodyIslandCallback = new MultiBodyInplaceSolverIslandCallback(constraintSolver,dispatcher);
+#if BT_THREADSAFE
+	m_threadScratch.resize(BT_MAX_THREAD_COUNT);
+#else
+	m_threadScratch.resize(1);
+#endif
 }
 
 btMultiBodyDynamicsWorld::~btMultiBodyDynamicsWorld ()
@@ -394,14 +753,20 @@ btMultiBodyDynamicsWorld::~btMultiBodyDynamicsWorld ()
 	delete m_solverMultiBodyIslandCallback;
 }
 
-void	btMultiBodyDynamicsWorld::forwardKinematics()
+btMultiBodyThreadScratch&	btMultiBodyDynamicsWorld::getThreadScratch()
 {
+	int threadIndex = 0;
+#if BT_THREADSAFE
+	threadIndex = btGetCurrentThreadIndex();
+#endif
+	return m_threadScratch[threadIndex];
+}
 
-	for (int b=0;b<m_multiBodies.size();b++)
-	{
-		btMultiBody* bod = m_multiBodies[b];
-		bod->forwardKinematics(m_scratch_world_to_local,m_scratch_local_origin);
-	}
+void	btMultiBodyDynamicsWorld::forwardKinematics()
+{
+	btMultiBodyForwardKinematicsLoop loop;
+	loop.m_world = this;
+	btMultiBodyParallelFor(0,m_multiBodies.size(),loop);
 }
 void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 {
@@ -434,292 +799,311 @@ void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 
 	m_solverMultiBodyIslandCallback->setup(&solverInfo,constraintsPtr,m_sortedConstraints.size(),sortedMultiBodyConstraints,m_sortedMultiBodyConstraints.size(), getDebugDrawer());
 	m_constraintSolver->prepareSolve(getCollisionWorld()->getNumCollisionObjects(), getCollisionWorld()->getDispatcher()->getNumManifolds());
-	
+
+	//the island batches are independent, so with worker threads available they are gathered first and then solved
+	//in parallel, each thread with a solver of its own. Other solver types keep solving the batches one by one
+	m_solverMultiBodyIslandCallback->m_deferIslandBatches = m_islandManager->getSplitIslands() &&
+		btGetTaskScheduler() && btGetTaskScheduler()->getNumThreads() > 1 && !btThreadsAreRunning() &&
+		m_multiBodyConstraintSolver->getSolverType() == BT_SEQUENTIAL_IMPULSE_SOLVER;
+
 	/// solve all the constraints for this island
 	m_islandManager->buildAndProcessIslands(getCollisionWorld()->getDispatcher(),getCollisionWorld(),m_solverMultiBodyIslandCallback);
+	m_solverMultiBodyIslandCallback->solveIslandBatches();
 
-#ifndef BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
 	{
-		BT_PROFILE("btMultiBody addForce");
-		for (int i=0;i<this->m_multiBodies.size();i++)
-		{
-			btMultiBody* bod = m_multiBodies[i];
+		BT_PROFILE("btMultiBody stepVelocities");
+		btMultiBodyIntegrateVelocitiesLoop loop;
+		loop.m_world = this;
+		loop.m_solverInfo = &solverInfo;
+		btMultiBodyParallelFor(0,m_multiBodies.size(),loop);
+	}
 
-			bool isSleeping = false;
-			
-			if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-			{
-				isSleeping = true;
-			} 
-			for (int b=0;b<bod->getNumLinks();b++)
-			{
-				if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
-					isSleeping = true;
-			} 
 
-			if (!isSleeping)
-			{
-				//useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
-				m_scratch_r.resize(bod->getNumLinks()+1);			//multidof? ("Y"s use it and it is used to store qdd)
-				m_scratch_v.resize(bod->getNumLinks()+1);
-				m_scratch_m.resize(bod->getNumLinks()+1);
+	m_solverMultiBodyIslandCallback->processConstraints();
+	m_solverMultiBodyIslandCallback->solveIslandBatches();
+	
+	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
 
-				bod->addBaseForce(m_gravity * bod->getBaseMass());
+	{
+		BT_PROFILE("btMultiBody stepVelocities");
+		btMultiBodyConstraintVelocitiesLoop loop;
+		loop.m_world = this;
+		loop.m_solverInfo = &solverInfo;
+		btMultiBodyParallelFor(0,m_multiBodies.size(),loop);
+	}
+}
 
-				for (int j = 0; j < bod->getNumLinks(); ++j) 
-				{
-					bod->addLinkForce(j, m_gravity * bod->getLinkMass(j));
-				}
-			}//if (!isSleeping)
-		}
+void	btMultiBodyDynamicsWorld::integrateMultiBodyVelocities(btMultiBody* bod, const btContactSolverInfo& solverInfo, btMultiBodyThreadScratch& scratch)
+{
+#ifndef BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
+	bod->addBaseForce(m_gravity * bod->getBaseMass());
+
+	for (int j = 0; j < bod->getNumLinks(); ++j) 
+	{
+		bod->addLinkForce(j, m_gravity * bod->getLinkMass(j));
 	}
 #endif //BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
-	
+
+	//useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
+	scratch.m_scratch_r.resize(bod->getNumLinks()+1);			//multidof? ("Y"s use it and it is used to store qdd)
+	scratch.m_scratch_v.resize(bod->getNumLinks()+1);
+	scratch.m_scratch_m.resize(bod->getNumLinks()+1);
+	bool doNotUpdatePos = false;
 
 	{
-		BT_PROFILE("btMultiBody stepVelocities");
-		for (int i=0;i<this->m_multiBodies.size();i++)
+		if(!bod->isUsingRK4Integration())
 		{
-			btMultiBody* bod = m_multiBodies[i];
-
-			bool isSleeping = false;
-			
-			if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
+			bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep, scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m);
+		}
+		else
+		{						
+			//
+			int numDofs = bod->getNumDofs() + 6;
+			int numPosVars = bod->getNumPosVars() + 7;
+			btAlignedObjectArray<btScalar> scratch_r2; scratch_r2.resize(2*numPosVars + 8*numDofs);
+			//convenience
+			btScalar *pMem = &scratch_r2[0];
+			btScalar *scratch_q0 = pMem; pMem += numPosVars;
+			btScalar *scratch_qx = pMem; pMem += numPosVars;
+			btScalar *scratch_qd0 = pMem; pMem += numDofs;
+			btScalar *scratch_qd1 = pMem; pMem += numDofs;
+			btScalar *scratch_qd2 = pMem; pMem += numDofs;
+			btScalar *scratch_qd3 = pMem; pMem += numDofs;
+			btScalar *scratch_qdd0 = pMem; pMem += numDofs;
+			btScalar *scratch_qdd1 = pMem; pMem += numDofs;
+			btScalar *scratch_qdd2 = pMem; pMem += numDofs;
+			btScalar *scratch_qdd3 = pMem; pMem += numDofs;
+			btAssert((pMem - (2*numPosVars + 8*numDofs)) == &scratch_r2[0]);
+
+			/////						
+			//copy q0 to scratch_q0 and qd0 to scratch_qd0
+			scratch_q0[0] = bod->getWorldToBaseRot().x();
+			scratch_q0[1] = bod->getWorldToBaseRot().y();
+			scratch_q0[2] = bod->getWorldToBaseRot().z();
+			scratch_q0[3] = bod->getWorldToBaseRot().w();
+			scratch_q0[4] = bod->getBasePos().x();
+			scratch_q0[5] = bod->getBasePos().y();
+			scratch_q0[6] = bod->getBasePos().z();
+			//
+			for(int link = 0; link < bod->getNumLinks(); ++link)
 			{
-				isSleeping = true;
-			} 
-			for (int b=0;b<bod->getNumLinks();b++)
+				for(int dof = 0; dof < bod->getLink(link).m_posVarCount; ++dof)
+					scratch_q0[7 + bod->getLink(link).m_cfgOffset + dof] = bod->getLink(link).m_jointPos[dof];							
+			}
+			//
+			for(int dof = 0; dof < numDofs; ++dof)								
+				scratch_qd0[dof] = bod->getVelocityVector()[dof];
+			////
+			struct
 			{
-				if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
-					isSleeping = true;
-			} 
+				btMultiBody *bod;
+				btScalar *scratch_qx, *scratch_q0;
 
-			if (!isSleeping)
+				void operator()()
+				{
+					for(int dof = 0; dof < bod->getNumPosVars() + 7; ++dof)
+						scratch_qx[dof] = scratch_q0[dof];
+				}
+			} pResetQx = {bod, scratch_qx, scratch_q0};
+			//
+			struct
 			{
-				//useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
-				m_scratch_r.resize(bod->getNumLinks()+1);			//multidof? ("Y"s use it and it is used to store qdd)
-				m_scratch_v.resize(bod->getNumLinks()+1);
-				m_scratch_m.resize(bod->getNumLinks()+1);
-				bool doNotUpdatePos = false;
+				void operator()(btScalar dt, const btScalar *pDer, const btScalar *pCurVal, btScalar *pVal, int size)
+				{
+					for(int i = 0; i < size; ++i)
+						pVal[i] = pCurVal[i] + dt * pDer[i];
+				}
 
+			} pEulerIntegrate;
+			//
+			struct
+			{
+				void operator()(btMultiBody *pBody, const btScalar *pData)
 				{
-					if(!bod->isUsingRK4Integration())
-					{
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep, m_scratch_r, m_scratch_v, m_scratch_m);
-					}
-					else
-					{						
-						//
-						int numDofs = bod->getNumDofs() + 6;
-						int numPosVars = bod->getNumPosVars() + 7;
-						btAlignedObjectArray<btScalar> scratch_r2; scratch_r2.resize(2*numPosVars + 8*numDofs);
-						//convenience
-						btScalar *pMem = &scratch_r2[0];
-						btScalar *scratch_q0 = pMem; pMem += numPosVars;
-						btScalar *scratch_qx = pMem; pMem += numPosVars;
-						btScalar *scratch_qd0 = pMem; pMem += numDofs;
-						btScalar *scratch_qd1 = pMem; pMem += numDofs;
-						btScalar *scratch_qd2 = pMem; pMem += numDofs;
-						btScalar *scratch_qd3 = pMem; pMem += numDofs;
-						btScalar *scratch_qdd0 = pMem; pMem += numDofs;
-						btScalar *scratch_qdd1 = pMem; pMem += numDofs;
-						btScalar *scratch_qdd2 = pMem; pMem += numDofs;
-						btScalar *scratch_qdd3 = pMem; pMem += numDofs;
-						btAssert((pMem - (2*numPosVars + 8*numDofs)) == &scratch_r2[0]);
-
-						/////						
-						//copy q0 to scratch_q0 and qd0 to scratch_qd0
-						scratch_q0[0] = bod->getWorldToBaseRot().x();
-						scratch_q0[1] = bod->getWorldToBaseRot().y();
-						scratch_q0[2] = bod->getWorldToBaseRot().z();
-						scratch_q0[3] = bod->getWorldToBaseRot().w();
-						scratch_q0[4] = bod->getBasePos().x();
-						scratch_q0[5] = bod->getBasePos().y();
-						scratch_q0[6] = bod->getBasePos().z();
-						//
-						for(int link = 0; link < bod->getNumLinks(); ++link)
-						{
-							for(int dof = 0; dof < bod->getLink(link).m_posVarCount; ++dof)
-								scratch_q0[7 + bod->getLink(link).m_cfgOffset + dof] = bod->getLink(link).m_jointPos[dof];							
-						}
-						//
-						for(int dof = 0; dof < numDofs; ++dof)								
-							scratch_qd0[dof] = bod->getVelocityVector()[dof];
-						////
-						struct
-						{
-						    btMultiBody *bod;
-                            btScalar *scratch_qx, *scratch_q0;
-
-						    void operator()()
-						    {
-						        for(int dof = 0; dof < bod->getNumPosVars() + 7; ++dof)
-                                    scratch_qx[dof] = scratch_q0[dof];
-						    }
-						} pResetQx = {bod, scratch_qx, scratch_q0};
-						//
-						struct
-						{
-						    void operator()(btScalar dt, const btScalar *pDer, const btScalar *pCurVal, btScalar *pVal, int size)
-						    {
-						        for(int i = 0; i < size; ++i)
-                                    pVal[i] = pCurVal[i] + dt * pDer[i];
-						    }
-
-						} pEulerIntegrate;
-						//
-						struct
-                        {
-                            void operator()(btMultiBody *pBody, const btScalar *pData)
-                            {
-                                btScalar *pVel = const_cast<btScalar*>(pBody->getVelocityVector());
-
-                                for(int i = 0; i < pBody->getNumDofs() + 6; ++i)
-                                    pVel[i] = pData[i];
-
-                            }
-                        } pCopyToVelocityVector;
-						//
-                        struct
-						{
-						    void operator()(const btScalar *pSrc, btScalar *pDst, int start, int size)
-						    {
-						        for(int i = 0; i < size; ++i)
-                                    pDst[i] = pSrc[start + i];
-						    }
-						} pCopy;
-						//
-
-						btScalar h = solverInfo.m_timeStep;
-						#define output &m_scratch_r[bod->getNumDofs()]
-						//calc qdd0 from: q0 & qd0	
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., m_scratch_r, m_scratch_v, m_scratch_m);
-						pCopy(output, scratch_qdd0, 0, numDofs);
-						//calc q1 = q0 + h/2 * qd0
-						pResetQx();
-						bod->stepPositionsMultiDof(btScalar(.5)*h, scratch_qx, scratch_qd0);
-						//calc qd1 = qd0 + h/2 * qdd0
-						pEulerIntegrate(btScalar(.5)*h, scratch_qdd0, scratch_qd0, scratch_qd1, numDofs);
-						//
-						//calc qdd1 from: q1 & qd1
-						pCopyToVelocityVector(bod, scratch_qd1);
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., m_scratch_r, m_scratch_v, m_scratch_m);
-						pCopy(output, scratch_qdd1, 0, numDofs);
-						//calc q2 = q0 + h/2 * qd1
-						pResetQx();
-						bod->stepPositionsMultiDof(btScalar(.5)*h, scratch_qx, scratch_qd1);
-						//calc qd2 = qd0 + h/2 * qdd1
-						pEulerIntegrate(btScalar(.5)*h, scratch_qdd1, scratch_qd0, scratch_qd2, numDofs);
-						//
-						//calc qdd2 from: q2 & qd2
-						pCopyToVelocityVector(bod, scratch_qd2);
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., m_scratch_r, m_scratch_v, m_scratch_m);
-						pCopy(output, scratch_qdd2, 0, numDofs);
-						//calc q3 = q0 + h * qd2
-						pResetQx();
-						bod->stepPositionsMultiDof(h, scratch_qx, scratch_qd2);
-						//calc qd3 = qd0 + h * qdd2
-						pEulerIntegrate(h, scratch_qdd2, scratch_qd0, scratch_qd3, numDofs);
-						//
-						//calc qdd3 from: q3 & qd3
-						pCopyToVelocityVector(bod, scratch_qd3);
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., m_scratch_r, m_scratch_v, m_scratch_m);
-						pCopy(output, scratch_qdd3, 0, numDofs);
-
-						//
-						//calc q = q0 + h/6(qd0 + 2*(qd1 + qd2) + qd3)
-						//calc qd = qd0 + h/6(qdd0 + 2*(qdd1 + qdd2) + qdd3)						
-						btAlignedObjectArray<btScalar> delta_q; delta_q.resize(numDofs);
-						btAlignedObjectArray<btScalar> delta_qd; delta_qd.resize(numDofs);
-						for(int i = 0; i < numDofs; ++i)
-						{
-							delta_q[i] = h/btScalar(6.)*(scratch_qd0[i] + 2*scratch_qd1[i] + 2*scratch_qd2[i] + scratch_qd3[i]);
-							delta_qd[i] = h/btScalar(6.)*(scratch_qdd0[i] + 2*scratch_qdd1[i] + 2*scratch_qdd2[i] + scratch_qdd3[i]);							
-							//delta_q[i] = h*scratch_qd0[i];
-							//delta_qd[i] = h*scratch_qdd0[i];
-						}
-						//
-						pCopyToVelocityVector(bod, scratch_qd0);
-						bod->applyDeltaVeeMultiDof(&delta_qd[0], 1);						
-						//
-						if(!doNotUpdatePos)
-						{
-							btScalar *pRealBuf = const_cast<btScalar *>(bod->getVelocityVector());
-							pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs()*bod->getNumDofs();
-
-							for(int i = 0; i < numDofs; ++i)
-								pRealBuf[i] = delta_q[i];
-
-							//bod->stepPositionsMultiDof(1, 0, &delta_q[0]);
-							bod->setPosUpdated(true);							
-						}
-
-						//ugly hack which resets the cached data to t0 (needed for constraint solver)
-						{
-							for(int link = 0; link < bod->getNumLinks(); ++link)
-								bod->getLink(link).updateCacheMultiDof();
-							bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0, m_scratch_r, m_scratch_v, m_scratch_m);
-						}
-						
-					}
+					btScalar *pVel = const_cast<btScalar*>(pBody->getVelocityVector());
+
+					for(int i = 0; i < pBody->getNumDofs() + 6; ++i)
+						pVel[i] = pData[i];
+
 				}
-				
+			} pCopyToVelocityVector;
+			//
+			struct
+			{
+				void operator()(const btScalar *pSrc, btScalar *pDst, int start, int size)
+				{
+					for(int i = 0; i < size; ++i)
+						pDst[i] = pSrc[start + i];
+				}
+			} pCopy;
+			//
+
+			btScalar h = solverInfo.m_timeStep;
+			#define output &scratch.m_scratch_r[bod->getNumDofs()]
+			//calc qdd0 from: q0 & qd0	
+			bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m);
+			pCopy(output, scratch_qdd0, 0, numDofs);
+			//calc q1 = q0 + h/2 * qd0
+			pResetQx();
+			bod->stepPositionsMultiDof(btScalar(.5)*h, scratch_qx, scratch_qd0);
+			//calc qd1 = qd0 + h/2 * qdd0
+			pEulerIntegrate(btScalar(.5)*h, scratch_qdd0, scratch_qd0, scratch_qd1, numDofs);
+			//
+			//calc qdd1 from: q1 & qd1
+			pCopyToVelocityVector(bod, scratch_qd1);
+			bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m);
+			pCopy(output, scratch_qdd1, 0, numDofs);
+			//calc q2 = q0 + h/2 * qd1
+			pResetQx();
+			bod->stepPositionsMultiDof(btScalar(.5)*h, scratch_qx, scratch_qd1);
+			//calc qd2 = qd0 + h/2 * qdd1
+			pEulerIntegrate(btScalar(.5)*h, scratch_qdd1, scratch_qd0, scratch_qd2, numDofs);
+			//
+			//calc qdd2 from: q2 & qd2
+			pCopyToVelocityVector(bod, scratch_qd2);
+			bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m);
+			pCopy(output, scratch_qdd2, 0, numDofs);
+			//calc q3 = q0 + h * qd2
+			pResetQx();
+			bod->stepPositionsMultiDof(h, scratch_qx, scratch_qd2);
+			//calc qd3 = qd0 + h * qdd2
+			pEulerIntegrate(h, scratch_qdd2, scratch_qd0, scratch_qd3, numDofs);
+			//
+			//calc qdd3 from: q3 & qd3
+			pCopyToVelocityVector(bod, scratch_qd3);
+			bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m);
+			pCopy(output, scratch_qdd3, 0, numDofs);
+
+			//
+			//calc q = q0 + h/6(qd0 + 2*(qd1 + qd2) + qd3)
+			//calc qd = qd0 + h/6(qdd0 + 2*(qdd1 + qdd2) + qdd3)						
+			btAlignedObjectArray<btScalar> delta_q; delta_q.resize(numDofs);
+			btAlignedObjectArray<btScalar> delta_qd; delta_qd.resize(numDofs);
+			for(int i = 0; i < numDofs; ++i)
+			{
+				delta_q[i] = h/btScalar(6.)*(scratch_qd0[i] + 2*scratch_qd1[i] + 2*scratch_qd2[i] + scratch_qd3[i]);
+				delta_qd[i] = h/btScalar(6.)*(scratch_qdd0[i] + 2*scratch_qdd1[i] + 2*scratch_qdd2[i] + scratch_qdd3[i]);							
+				//delta_q[i] = h*scratch_qd0[i];
+				//delta_qd[i] = h*scratch_qdd0[i];
+			}
+			//
+			pCopyToVelocityVector(bod, scratch_qd0);
+			bod->applyDeltaVeeMultiDof(&delta_qd[0], 1);						
+			//
+			if(!doNotUpdatePos)
+			{
+				btScalar *pRealBuf = const_cast<btScalar *>(bod->getVelocityVector());
+				pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs()*bod->getNumDofs();
+
+				for(int i = 0; i < numDofs; ++i)
+					pRealBuf[i] = delta_q[i];
+
+				//bod->stepPositionsMultiDof(1, 0, &delta_q[0]);
+				bod->setPosUpdated(true);							
+			}
+
+			//ugly hack which resets the cached data to t0 (needed for constraint solver)
+			{
+				for(int link = 0; link < bod->getNumLinks(); ++link)
+					bod->getLink(link).updateCacheMultiDof();
+				bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0, scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m);
+			}
+			
+		}
+	}
+	
 #ifndef BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
-				bod->clearForcesAndTorques();
+	bod->clearForcesAndTorques();
 #endif //BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
-			}//if (!isSleeping)
+#undef output
+}
+
+struct btMultiBodyPredictiveSweepLoop : public btIParallelForBody
+{
+	btMultiBodyDynamicsWorld* m_world;
+	btMultiBodyPredictiveSweep* m_sweeps;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btMultiBodyPredictiveSweep& sweep = m_sweeps[i];
+			sweep.m_hasHit = m_world->predictiveConvexSweep(sweep.m_collider,sweep.m_predictedTransform,sweep.m_result);
 		}
 	}
+};
 
-	
+void	btMultiBodyDynamicsWorld::createPredictiveContacts(btScalar timeStep)
+{
+	btDiscreteDynamicsWorld::createPredictiveContacts(timeStep);
 
-	m_solverMultiBodyIslandCallback->processConstraints();
-	
-	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
+	if (!getDispatchInfo().m_useContinuous)
+		return;
 
-	{
-                BT_PROFILE("btMultiBody stepVelocities");
-                for (int i=0;i<this->m_multiBodies.size();i++)
-                {
-                        btMultiBody* bod = m_multiBodies[i];
+	BT_PROFILE("createPredictiveMultiBodyContacts");
 
-                        bool isSleeping = false;
+	//the link velocities are extrapolated linearly, like the rigid body motion in predictIntegratedTransform
+	m_predictiveSweeps.resize(0);
+	for (int b=0;b<m_multiBodies.size();b++)
+	{
+		btMultiBody* bod = m_multiBodies[b];
+		if (!bod->isAwake())
+			continue;
 
-                        if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-                        {
-                                isSleeping = true;
-                        }
-                        for (int b=0;b<bod->getNumLinks();b++)
-                        {
-                                if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
-                                        isSleeping = true;
-                        }
+		bool linkVelocitiesComputed = false;
+		for (int link=-1;link<bod->getNumLinks();link++)
+		{
+			btMultiBodyLinkCollider* col = link<0 ? bod->getBaseCollider() : bod->getLink(link).m_collider;
+			if (!col || col->isStaticOrKinematicObject() || !col->getCcdSquareMotionThreshold() || !col->getCollisionShape()->isConvex())
+				continue;
+			if (!linkVelocitiesComputed)
+			{
+				m_scratch_link_omega.resize(bod->getNumLinks()+1);
+				m_scratch_link_vel.resize(bod->getNumLinks()+1);
+				bod->compTreeLinkVelocities(&m_scratch_link_omega[0],&m_scratch_link_vel[0]);
+				linkVelocitiesComputed = true;
+			}
 
-                        if (!isSleeping)
-                        {
-                                //useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
-                                m_scratch_r.resize(bod->getNumLinks()+1);                 //multidof? ("Y"s use it and it is used to store qdd)
-                                m_scratch_v.resize(bod->getNumLinks()+1);
-                                m_scratch_m.resize(bod->getNumLinks()+1);
-
-                                
-                            {
-                                if(!bod->isUsingRK4Integration())
-                                {
-									bool isConstraintPass = true;
-                                    bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep, m_scratch_r, m_scratch_v, m_scratch_m, isConstraintPass);
-                                }
-				}
+			//link velocities are in the link frame, which is the frame of the collider
+			btVector3 motion = col->getWorldTransform().getBasis()*m_scratch_link_vel[link+1]*timeStep;
+			if (col->getCcdSquareMotionThreshold() < motion.length2())
+			{
+				btMultiBodyPredictiveSweep& sweep = m_predictiveSweeps.expandNonInitializing();
+				sweep.m_collider = col;
+				sweep.m_predictedTransform = col->getWorldTransform();
+				sweep.m_predictedTransform.getOrigin() += motion;
+				sweep.m_hasHit = false;
 			}
 		}
 	}
 
-	for (int i=0;i<this->m_multiBodies.size();i++)
+	if (m_predictiveSweeps.size() == 0)
+		return;
+
+	btMultiBodyPredictiveSweepLoop loop;
+	loop.m_world = this;
+	loop.m_sweeps = &m_predictiveSweeps[0];
+#if BT_THREADSAFE
+	if (btGetTaskScheduler() && !btThreadsAreRunning())
 	{
-		btMultiBody* bod = m_multiBodies[i];
-		bod->processDeltaVeeMultiDof2();
+		int grainSize = 50;  // num of iterations per task for task scheduler
+		btParallelFor(0,m_predictiveSweeps.size(),grainSize,loop);
+	}
+	else
+#endif
+	{
+		loop.forLoop(0,m_predictiveSweeps.size());
 	}
 
+	//the manifolds are added in a fixed order, and the dispatcher doesn't need to be thread safe
+	for (int i=0;i<m_predictiveSweeps.size();i++)
+	{
+		const btMultiBodyPredictiveSweep& sweep = m_predictiveSweeps[i];
+		if (sweep.m_hasHit)
+		{
+			addPredictiveContact(sweep.m_collider,sweep.m_predictedTransform,sweep.m_result);
+		}
+	}
 }
 
 void	btMultiBodyDynamicsWorld::integrateTransforms(btScalar timeStep)
@@ -729,52 +1113,10 @@ void	btMultiBodyDynamicsWorld::integrateTransforms(btScalar timeStep)
 	{
 		BT_PROFILE("btMultiBody stepPositions");
 		//integrate and update the Featherstone hierarchies
-	
-		for (int b=0;b<m_multiBodies.size();b++)
-		{
-			btMultiBody* bod = m_multiBodies[b];
-			bool isSleeping = false;
-			if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-			{
-				isSleeping = true;
-			} 
-			for (int b=0;b<bod->getNumLinks();b++)
-			{
-				if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
-					isSleeping = true;
-			}
-
-
-			if (!isSleeping)
-			{
-				int nLinks = bod->getNumLinks();
-
-				///base + num m_links
-			
-				
-				{
-					if(!bod->isPosUpdated())
-						bod->stepPositionsMultiDof(timeStep);
-					else
-					{
-						btScalar *pRealBuf = const_cast<btScalar *>(bod->getVelocityVector());
-						pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs()*bod->getNumDofs();
-
-						bod->stepPositionsMultiDof(1, 0, pRealBuf);
-						bod->setPosUpdated(false);
-					}
-				}
-				
-				m_scratch_world_to_local.resize(nLinks+1);
-				m_scratch_local_origin.resize(nLinks+1);
-
-				bod->updateCollisionObjectWorldTransforms(m_scratch_world_to_local,m_scratch_local_origin);
-				
-			} else
-			{
-				bod->clearVelocities();
-			}
-		}
+		btMultiBodyIntegrateTransformsLoop loop;
+		loop.m_world = this;
+		loop.m_timeStep = timeStep;
+		btMultiBodyParallelFor(0,m_multiBodies.size(),loop);
 	}
 }
 
@@ -23,10 +23,32 @@ subject to the following restrictions:
 class btMultiBody;
 class btMultiBodyConstraint;
 class btMultiBodyConstraintSolver;
+class btMultiBodyLinkCollider;
 struct MultiBodyInplaceSolverIslandCallback;
 
+///a link collider that moves further than its ccd motion threshold in one step
+struct btMultiBodyPredictiveSweep
+{
+	btMultiBodyLinkCollider*	m_collider;
+	btTransform	m_predictedTransform;
+	btPredictiveSweepResult	m_result;
+	bool	m_hasHit;
+};
+
+///scratch memory for the btMultiBody computations, each thread has its own
+struct btMultiBodyThreadScratch
+{
+	btAlignedObjectArray<btScalar> m_scratch_r;
+	btAlignedObjectArray<btVector3> m_scratch_v;
+	btAlignedObjectArray<btMatrix3x3> m_scratch_m;
+	btAlignedObjectArray<btQuaternion> m_scratch_world_to_local;
+	btAlignedObjectArray<btVector3> m_scratch_local_origin;
+};
+
 ///The btMultiBodyDynamicsWorld adds Featherstone multi body dynamics to Bullet
 ///This implementation is still preliminary/experimental.
+///When the task scheduler has more than one thread, the simulation islands are solved in parallel (see solveConstraints),
+///and the forward kinematics, forward dynamics and integration run with btParallelFor over the btMultiBodies.
 class btMultiBodyDynamicsWorld : public btDiscreteDynamicsWorld
 {
 protected:
@@ -37,13 +59,12 @@ protected:
 	MultiBodyInplaceSolverIslandCallback*	m_solverMultiBodyIslandCallback;
 
 	//cached data to avoid memory allocations
-	btAlignedObjectArray<btQuaternion> m_scratch_world_to_local;
-	btAlignedObjectArray<btVector3> m_scratch_local_origin;
 	btAlignedObjectArray<btQuaternion> m_scratch_world_to_local1;
 	btAlignedObjectArray<btVector3> m_scratch_local_origin1;
-	btAlignedObjectArray<btScalar> m_scratch_r;
-	btAlignedObjectArray<btVector3> m_scratch_v;
-	btAlignedObjectArray<btMatrix3x3> m_scratch_m;
+	btAlignedObjectArray<btMultiBodyThreadScratch> m_threadScratch;  // indexed by thread, for the loops over the btMultiBodies
+	btAlignedObjectArray<btVector3> m_scratch_link_omega;
+	btAlignedObjectArray<btVector3> m_scratch_link_vel;
+	btAlignedObjectArray<btMultiBodyPredictiveSweep> m_predictiveSweeps;
 
 	
 	virtual void	calculateSimulationIslands();
@@ -52,14 +73,33 @@ protected:
 	
 	virtual void	serializeMultiBodies(btSerializer* serializer);
 
+	///adds predictive contacts for fast moving link colliders too, the sweeps run with btParallelFor in BT_THREADSAFE builds
+	virtual void	createPredictiveContacts(btScalar timeStep);
+
+	btMultiBodyThreadScratch&	getThreadScratch();
+
+	///adds gravity and runs the forward dynamics of an awake btMultiBody, before the constraints are solved
+	void	integrateMultiBodyVelocities(btMultiBody* bod, const btContactSolverInfo& solverInfo, btMultiBodyThreadScratch& scratch);
+
+	friend struct btMultiBodyPredictiveSweepLoop;
+	friend struct btMultiBodyForwardKinematicsLoop;
+	friend struct btMultiBodyIntegrateVelocitiesLoop;
+	friend struct btMultiBodyConstraintVelocitiesLoop;
+	friend struct btMultiBodyIntegrateTransformsLoop;
+
 public:
 
 	btMultiBodyDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btMultiBodyConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration);
 
 	virtual ~btMultiBodyDynamicsWorld ();
 
+	///the link colliders of a static btMultiBody (see btMultiBody::isStaticMultiBody) get the CF_STATIC_OBJECT flag,
+	///whether they are added before or after the btMultiBody. So like static rigid bodies they don't merge simulation islands.
+	///Set up the links and call finalizeMultiDof before adding the btMultiBody, the flag is not cleared again
 	virtual void	addMultiBody(btMultiBody* body, int group= btBroadphaseProxy::DefaultFilter, int mask=btBroadphaseProxy::AllFilter);
 
+	virtual void	addCollisionObject(btCollisionObject* collisionObject, int collisionFilterGroup=btBroadphaseProxy::StaticFilter, int collisionFilterMask=btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+
 	virtual void	removeMultiBody(btMultiBody* body);
 
 	virtual int		getNumMultibodies() const
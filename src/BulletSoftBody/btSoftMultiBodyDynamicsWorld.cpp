@@ -280,6 +280,15 @@ void	btSoftMultiBodyDynamicsWorld::rayTest(const btVector3& rayFromWorld, const
 }
 
 
+void	btSoftMultiBodyDynamicsWorld::rayTestPacket(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const
+{
+	for (int i=0;i<numRays;i++)
+	{
+		rayTest(rayFromWorld[i],rayToWorld[i],*resultCallbacks[i]);
+	}
+}
+
+
 void	btSoftMultiBodyDynamicsWorld::rayTestSingle(const btTransform& rayFromTrans,const btTransform& rayToTrans,
 					  btCollisionObject* collisionObject,
 					  const btCollisionShape* collisionShape,
@@ -94,6 +94,9 @@ public:
 
 	virtual void rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const; 
 
+	///rayTestPacket casts the rays one by one with rayTest, so that the soft bodies are hit as well
+	virtual void rayTestPacket(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const;
+
 	/// rayTestSingle performs a raycast call and calls the resultCallback. It is used internally by rayTest.
 	/// In a future implementation, we consider moving the ray test as a virtual method in btCollisionShape.
 	/// This allows more customization.
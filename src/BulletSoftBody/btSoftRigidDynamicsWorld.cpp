@@ -280,6 +280,15 @@ void	btSoftRigidDynamicsWorld::rayTest(const btVector3& rayFromWorld, const btVe
 }
 
 
+void	btSoftRigidDynamicsWorld::rayTestPacket(const btVector3* rayFromWorld, const btVector3* rayToWorld, RayResultCallback** resultCallbacks, int numRays) const
+{
+	for (int i=0;i<numRays;i++)
+	{
+		rayTest(rayFromWorld[i],rayToWorld[i],*resultCallbacks[i]);
+	}
+}
+
+
 void	btSoftRigidDynamicsWorld::rayTestSingle(const btTransform& rayFromTrans,const btTransform& rayToTrans,
 					  btCollisionObject* collisionObject,
 					  const btCollisionShape* collisionShape,
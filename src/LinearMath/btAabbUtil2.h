@@ -122,6 +122,108 @@ SIMD_FORCE_INLINE bool btRayAabb2(const btVector3& rayFrom,
 	return ( (tmin < lambda_max) && (tmax > lambda_min) );
 }
 
+#define BT_RAY_PACKET_SIZE 16
+
+///btRayPacket stores up to BT_RAY_PACKET_SIZE coherent rays (camera, lidar scans) in SoA layout,
+///so that a tree traversal can test each node against all rays of the packet at once, see btRayAabbPacket.
+///Ray i covers rayFrom[i]+(rayTo[i]-rayFrom[i])*t for 0<=t<=m_fraction[i]. The traversals read m_fraction at each node,
+///so a callback that lowers it to the closest hit found so far culls the remainder of that ray.
+struct btRayPacket
+{
+	btScalar	m_origin[3][BT_RAY_PACKET_SIZE];
+	btScalar	m_invDirection[3][BT_RAY_PACKET_SIZE];
+	btScalar	m_fraction[BT_RAY_PACKET_SIZE];
+	///bounds of all segments, used to reject nodes away from the whole packet
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+	int			m_numRays;
+
+	void	init(const btVector3* rayFrom, const btVector3* rayTo, int numRays)
+	{
+		btAssert(numRays>0 && numRays<=BT_RAY_PACKET_SIZE);
+		m_numRays = numRays;
+		m_aabbMin = rayFrom[0];
+		m_aabbMax = rayFrom[0];
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			//unused lanes repeat the last ray, they are masked out by btRayAabbPacket
+			int r = i<numRays ? i : numRays-1;
+			btVector3 rayDir = rayTo[r]-rayFrom[r];
+			for (int k=0;k<3;k++)
+			{
+				m_origin[k][i] = rayFrom[r][k];
+				///what about division by zero? --> just set rayDirection[i] to INF/BT_LARGE_FLOAT
+				m_invDirection[k][i] = rayDir[k] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[k];
+			}
+			m_fraction[i] = btScalar(1.0);
+			m_aabbMin.setMin(rayFrom[r]);
+			m_aabbMin.setMin(rayTo[r]);
+			m_aabbMax.setMax(rayFrom[r]);
+			m_aabbMax.setMax(rayTo[r]);
+		}
+	}
+
+	unsigned int	getRayMask() const
+	{
+		return (1u<<m_numRays)-1;
+	}
+};
+
+#if defined (BT_USE_SSE) || (defined (__SSE2__) && !defined (BT_USE_DOUBLE_PRECISION))
+#define BT_RAY_PACKET_SSE
+#include <emmintrin.h>
+#endif
+
+///btRayAabbPacket returns a mask with bit i set if ray i of the packet hits the box bounds[0]..bounds[1].
+///Only the rays in activeMask are tested, traversals pass the mask of the parent node.
+SIMD_FORCE_INLINE unsigned int btRayAabbPacket(const btRayPacket& packet, const btVector3 bounds[2], unsigned int activeMask = ~0u)
+{
+	if (!TestAabbAgainstAabb2(packet.m_aabbMin,packet.m_aabbMax,bounds[0],bounds[1]))
+		return 0;
+	unsigned int mask = 0;
+#ifdef BT_RAY_PACKET_SSE
+	for (int i=0;i<packet.m_numRays;i+=4)
+	{
+		if (((activeMask>>i)&0xf)==0)
+			continue;
+		__m128 tnear = _mm_setzero_ps();
+		__m128 tfar = _mm_set1_ps(BT_LARGE_FLOAT);
+		for (int k=0;k<3;k++)
+		{
+			const __m128 org = _mm_loadu_ps(&packet.m_origin[k][i]);
+			const __m128 inv = _mm_loadu_ps(&packet.m_invDirection[k][i]);
+			const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds[0][k]),org),inv);
+			const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds[1][k]),org),inv);
+			tnear = _mm_max_ps(tnear,_mm_min_ps(t0,t1));
+			tfar = _mm_min_ps(tfar,_mm_max_ps(t0,t1));
+		}
+		//rays that graze an edge of the box must not be lost to rounding
+		tfar = _mm_mul_ps(tfar,_mm_set1_ps(btScalar(1.0)+SIMD_EPSILON*btScalar(16.0)));
+		const __m128 hit = _mm_and_ps(_mm_cmple_ps(tnear,tfar),_mm_cmple_ps(tnear,_mm_loadu_ps(&packet.m_fraction[i])));
+		mask |= ((unsigned int)_mm_movemask_ps(hit))<<i;
+	}
+#else
+	for (int i=0;i<packet.m_numRays;i++)
+	{
+		if (((activeMask>>i)&1)==0)
+			continue;
+		btScalar tnear = btScalar(0.0);
+		btScalar tfar = btScalar(BT_LARGE_FLOAT);
+		for (int k=0;k<3;k++)
+		{
+			const btScalar t0 = (bounds[0][k]-packet.m_origin[k][i])*packet.m_invDirection[k][i];
+			const btScalar t1 = (bounds[1][k]-packet.m_origin[k][i])*packet.m_invDirection[k][i];
+			tnear = btMax(tnear,btMin(t0,t1));
+			tfar = btMin(tfar,btMax(t0,t1));
+		}
+		//rays that graze an edge of the box must not be lost to rounding
+		tfar *= btScalar(1.0)+SIMD_EPSILON*btScalar(16.0);
+		mask |= (unsigned int)((tnear<=tfar) & (tnear<=packet.m_fraction[i]))<<i;
+	}
+#endif
+	return mask & activeMask & packet.getRayMask();
+}
+
 SIMD_FORCE_INLINE bool btRayAabb(const btVector3& rayFrom, 
 								 const btVector3& rayTo, 
 								 const btVector3& aabbMin, 
@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btCpuFeatureUtility.h"
+
+#ifdef BT_CPU_FEATURE_GCC_CPUID
+#include <cpuid.h>
+
+int btCpuFeatureUtility::getGccCpuidFeatures()
+{
+	int capabilities = 0;
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	unsigned int maxLeaf = __get_cpuid_max(0, 0);
+	if (maxLeaf >= 1)
+	{
+		__cpuid(1, eax, ebx, ecx, edx);
+		unsigned long long xcr0 = 0;
+		const unsigned int OSXSAVEFlag = (1U << 27);
+		const unsigned int AVXFlag = ((1U << 28) | OSXSAVEFlag);
+		const unsigned int FMAFlag = ((1U << 12) | AVXFlag);
+		if ((ecx & AVXFlag) == AVXFlag)
+		{
+			unsigned int xcr0Low = 0, xcr0High = 0;
+			//xgetbv, spelled out for assemblers that don't know the mnemonic
+			__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+			xcr0 = ((unsigned long long)xcr0High << 32) | xcr0Low;
+		}
+		if ((ecx & FMAFlag) == FMAFlag && (xcr0 & 6) == 6)
+		{
+			capabilities |= CPU_FEATURE_FMA3;
+		}
+		const unsigned int SSE41Flag = (1U << 19);
+		if (ecx & SSE41Flag)
+		{
+			capabilities |= CPU_FEATURE_SSE4_1;
+		}
+		if (maxLeaf >= 7)
+		{
+			__cpuid_count(7, 0, eax, ebx, ecx, edx);
+			capabilities |= getAvxFeatures((capabilities & CPU_FEATURE_FMA3) != 0, ebx, xcr0);
+		}
+	}
+	return capabilities;
+}
+#endif //BT_CPU_FEATURE_GCC_CPUID
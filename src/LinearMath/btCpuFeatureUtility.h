@@ -12,6 +12,10 @@
 #endif //BT_ALLOW_SSE4
 #endif //USE_SIMD
 
+#if !defined(BT_ALLOW_SSE4) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BT_CPU_FEATURE_GCC_CPUID
+#endif //__GNUC__
+
 #if defined BT_USE_NEON
 #define ARM_NEON_GCC_COMPATIBILITY  1
 #include <arm_neon.h>
@@ -19,7 +23,7 @@
 #include <sys/sysctl.h> //for sysctlbyname
 #endif //BT_USE_NEON
 
-///Rudimentary btCpuFeatureUtility for CPU features: only report the features that Bullet actually uses (SSE4/FMA3, NEON_HPFP)
+///Rudimentary btCpuFeatureUtility for CPU features: only report the features that Bullet actually uses (SSE4/FMA3, AVX2, NEON_HPFP)
 ///We assume SSE2 in case BT_USE_SSE2 is defined in LinearMath/btScalar.h
 class btCpuFeatureUtility
 {
@@ -28,9 +32,26 @@ public:
 	{
 		CPU_FEATURE_FMA3=1,
 		CPU_FEATURE_SSE4_1=2,
-		CPU_FEATURE_NEON_HPFP=4
+		CPU_FEATURE_NEON_HPFP=4,
+		CPU_FEATURE_AVX2=8
 	};
 
+	///AVX2 is only reported together with FMA3, and needs the OS to save the ymm registers on a context switch (XCR0 bits 1-2)
+	static int getAvxFeatures(bool hasFma3, unsigned int extendedFeatures, unsigned long long xcr0)
+	{
+		const unsigned int AVX2Flag = (1U << 5);
+		if (hasFma3 && (extendedFeatures & AVX2Flag) && (xcr0 & 0x6) == 0x6)
+		{
+			return CPU_FEATURE_AVX2;
+		}
+		return 0;
+	}
+
+#ifdef BT_CPU_FEATURE_GCC_CPUID
+	///queries cpuid and xcr0 through the GCC builtins, implemented in btCpuFeatureUtility.cpp so that <cpuid.h> stays out of this header
+	static int getGccCpuidFeatures();
+#endif //BT_CPU_FEATURE_GCC_CPUID
+
 	static int getCpuFeatures()
 	{
 
@@ -78,7 +99,20 @@ public:
 			{
 				capabilities |= btCpuFeatureUtility::CPU_FEATURE_SSE4_1;
 			}
+
+			int maxLeafInfo[4];
+			memset(maxLeafInfo, 0, sizeof(maxLeafInfo));
+			__cpuid(maxLeafInfo, 0);
+			if (maxLeafInfo[0] >= 7)
+			{
+				int extendedInfo[4];
+				memset(extendedInfo, 0, sizeof(extendedInfo));
+				__cpuidex(extendedInfo, 7, 0);
+				capabilities |= getAvxFeatures((capabilities & CPU_FEATURE_FMA3) != 0, (unsigned int)extendedInfo[1], sseExt);
+			}
 		}
+#elif defined(BT_CPU_FEATURE_GCC_CPUID)
+		capabilities |= getGccCpuidFeatures();
 #endif//BT_ALLOW_SSE4
 
 		testedCapabilities = true;
@@ -39,6 +39,7 @@
 #include "Test_3x3getRot.h"
 
 #include "Test_btDbvt.h"
+#include "Test_gjkSpecialized.h"
 #include "Test_quat_aos_neon.h"
 
 #include "LinearMath/btScalar.h"
@@ -86,6 +87,7 @@ TestDesc  gTestList[] =
     ENTRY( "3x3getRot", Test_3x3getRot ),
   
     ENTRY( "btDbvt", Test_btDbvt ),
+    ENTRY( "gjkSpecialized", Test_gjkSpecialized ),
     ENTRY("quat_aos_neon", Test_quat_aos_neon),
     
     { NULL, NULL }
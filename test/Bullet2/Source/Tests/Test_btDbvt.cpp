@@ -16,6 +16,9 @@
 #include "main.h"
 #include <math.h>
 #include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 #include <BulletCollision/BroadphaseCollision/btDbvt.h>
 
@@ -93,6 +96,246 @@ SIMD_FORCE_INLINE void		Merge_ref(	 btDbvtAabbMm& a,
 [3]	float32_t	0.765338
 */
 
+// collects the leaves reported by the collide functions by the index stored in their data
+struct LeafCollector : btDbvt::ICollide
+{
+    std::vector< std::pair<int,int> >   pairs;
+    std::vector<int>                    leaves;
+
+    void    Process(const btDbvtNode* a, const btDbvtNode* b)
+    {
+        int ia = (int)(size_t)a->data;
+        int ib = (int)(size_t)b->data;
+        pairs.push_back(std::make_pair(btMin(ia, ib), btMax(ia, ib)));
+    }
+    void    Process(const btDbvtNode* n)
+    {
+        leaves.push_back((int)(size_t)n->data);
+    }
+    void    sort()
+    {
+        std::sort(pairs.begin(), pairs.end());
+        std::sort(leaves.begin(), leaves.end());
+    }
+};
+
+// a generator of its own, so the tests after this one see the same rand() sequence as before
+static float RandomUnit(unsigned int& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (float)(seed >> 8) / (float)(1u << 24);
+}
+
+static btDbvtVolume RandomVolume(unsigned int& seed, float extent, float size)
+{
+    btVector3 center(extent * (RandomUnit(seed) - 0.5f),
+                     extent * (RandomUnit(seed) - 0.5f),
+                     extent * (RandomUnit(seed) - 0.5f));
+    btVector3 halfExtents(size * (RandomUnit(seed) + 0.1f),
+                          size * (RandomUnit(seed) + 0.1f),
+                          size * (RandomUnit(seed) + 0.1f));
+    return btDbvtVolume::FromCE(center, halfExtents);
+}
+
+// the leaf pairs of the tree with itself and the leaves in a few volumes
+static void CollideAll(const btDbvt& tree, LeafCollector& collector)
+{
+    btDbvt& t = const_cast<btDbvt&>(tree);
+    t.collideTTpersistentStack(tree.m_root, tree.m_root, collector);
+    unsigned int seed = 4711;
+    for (int i = 0; i < 16; i++)
+    {
+        tree.collideTV(tree.m_root, RandomVolume(seed, 20.f, 4.f), collector);
+    }
+    collector.sort();
+}
+
+// checks the parent links, the leaf count and that every internal node contains its children
+static int CheckTree(const btDbvt& tree)
+{
+    if (!tree.m_root)
+        return tree.m_leaves != 0;
+    if (tree.m_root->parent)
+        return 1;
+    int numLeaves = 0;
+    std::vector<const btDbvtNode*> stack;
+    stack.push_back(tree.m_root);
+    while (!stack.empty())
+    {
+        const btDbvtNode* n = stack.back();
+        stack.pop_back();
+        if (n->isleaf())
+        {
+            numLeaves++;
+            continue;
+        }
+        for (int j = 0; j < 2; j++)
+        {
+            const btDbvtNode* c = n->childs[j];
+            if (c->parent != n || !n->volume.Contain(c->volume))
+                return 1;
+            stack.push_back(c);
+        }
+    }
+    return numLeaves != tree.m_leaves;
+}
+
+// inserts, removes and updates leaves, then checks that optimizeLayout keeps the topology:
+// the links stay consistent, the internal nodes are laid out depth first in one block
+// and the tree reports the same overlaps as before
+static int Test_btDbvtLayout(void)
+{
+    btDbvt tree;
+    std::vector<btDbvtNode*> leaves;
+    unsigned int seed = 1234;
+    for (int i = 0; i < 500; i++)
+    {
+        leaves.push_back(tree.insert(RandomVolume(seed, 20.f, 1.f), (void*)(size_t)i));
+    }
+    int nextIndex = 500;
+    for (int round = 0; round < 20; round++)
+    {
+        for (int i = 0; i < 50; i++)
+        {
+            int k = (int)(RandomUnit(seed) * leaves.size());
+            tree.remove(leaves[k]);
+            leaves[k] = tree.insert(RandomVolume(seed, 20.f, 1.f), (void*)(size_t)nextIndex++);
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            btDbvtVolume volume = RandomVolume(seed, 20.f, 1.f);
+            tree.update(leaves[(int)(RandomUnit(seed) * leaves.size())], volume);
+        }
+        tree.optimizeIncremental(10);
+        if (round % 5 == 4)
+        {
+            // a shrinking tree, the freed internal nodes stay in the blocks
+            for (int i = 0; i < 40; i++)
+            {
+                tree.remove(leaves.back());
+                leaves.pop_back();
+            }
+        }
+
+        LeafCollector before;
+        CollideAll(tree, before);
+        if (CheckTree(tree))
+        {
+            printf("btDbvt links broken before optimizeLayout in round %d\n", round);
+            return 1;
+        }
+        tree.optimizeLayout();
+        if (tree.m_ichanges != 0 || tree.m_iblocks.size() != 1 || CheckTree(tree))
+        {
+            printf("btDbvt links broken by optimizeLayout in round %d\n", round);
+            return 1;
+        }
+        // depth first: the first child of an internal node is the next node in memory
+        std::vector<const btDbvtNode*> stack;
+        const btDbvtNode* expected = tree.m_iblocks[0];
+        stack.push_back(tree.m_root);
+        while (!stack.empty())
+        {
+            const btDbvtNode* n = stack.back();
+            stack.pop_back();
+            if (n != expected++)
+            {
+                printf("btDbvt::optimizeLayout did not lay out the nodes depth first in round %d\n", round);
+                return 1;
+            }
+            if (n->childs[1]->isinternal()) stack.push_back(n->childs[1]);
+            if (n->childs[0]->isinternal()) stack.push_back(n->childs[0]);
+        }
+        LeafCollector after;
+        CollideAll(tree, after);
+        if (before.pairs != after.pairs || before.leaves != after.leaves || before.pairs.empty())
+        {
+            printf("btDbvt::optimizeLayout changed the overlaps in round %d: %d/%d pairs\n", round, (int)before.pairs.size(), (int)after.pairs.size());
+            return 1;
+        }
+    }
+    // the tree keeps working after the relayout
+    while (!leaves.empty())
+    {
+        tree.remove(leaves.back());
+        leaves.pop_back();
+    }
+    tree.optimizeLayout();
+    return CheckTree(tree);
+}
+
+// the wide snapshot has to report exactly the leaf pairs and leaves of the binary tree,
+// also for leaf counts that leave lanes of the wide nodes empty
+static int Test_btDbvtWideMatchesBinary(void)
+{
+    static const int leafCounts[] = { 0, 1, 2, 3, 5, 7, 13, 100, 257 };
+    unsigned int seed = 5678;
+    int numPairs = 0;
+    for (int c = 0; c < (int)(sizeof(leafCounts) / sizeof(leafCounts[0])); c++)
+    {
+        const int n = leafCounts[c];
+        // keep the density similar, so small trees have overlaps too
+        const float extent = 3.f * powf((float)n + 1.f, 1.f / 3.f);
+        btDbvt treeA, treeB;
+        for (int i = 0; i < n; i++)
+        {
+            treeA.insert(RandomVolume(seed, extent, 1.f), (void*)(size_t)i);
+            // the leaves of the second tree get indices of their own
+            treeB.insert(RandomVolume(seed, extent, 1.f), (void*)(size_t)(100000 + i));
+        }
+        btDbvtWide wideA, wideB;
+        wideA.build(treeA);
+        wideB.build(treeB);
+        if (wideA.m_leaves.size() != n || wideB.m_leaves.size() != n)
+        {
+            printf("btDbvtWide::build with %d leaves kept %d and %d\n", n, wideA.m_leaves.size(), wideB.m_leaves.size());
+            return 1;
+        }
+
+        LeafCollector binarySelf, wideSelf;
+        treeA.collideTTpersistentStack(treeA.m_root, treeA.m_root, binarySelf);
+        wideA.collideTT(wideA, wideSelf);
+        binarySelf.sort();
+        wideSelf.sort();
+        if (binarySelf.pairs != wideSelf.pairs)
+        {
+            printf("btDbvtWide::collideTT with itself and %d leaves: %d pairs, binary %d\n", n, (int)wideSelf.pairs.size(), (int)binarySelf.pairs.size());
+            return 1;
+        }
+
+        LeafCollector binaryTwo, wideTwo;
+        treeA.collideTTpersistentStack(treeA.m_root, treeB.m_root, binaryTwo);
+        wideA.collideTT(wideB, wideTwo);
+        binaryTwo.sort();
+        wideTwo.sort();
+        if (binaryTwo.pairs != wideTwo.pairs)
+        {
+            printf("btDbvtWide::collideTT of two trees with %d leaves: %d pairs, binary %d\n", n, (int)wideTwo.pairs.size(), (int)binaryTwo.pairs.size());
+            return 1;
+        }
+
+        for (int i = 0; i < 20; i++)
+        {
+            const btDbvtVolume volume = RandomVolume(seed, extent, 2.f);
+            LeafCollector binaryLeaves, wideLeaves;
+            treeA.collideTV(treeA.m_root, volume, binaryLeaves);
+            wideA.collideTV(volume, wideLeaves);
+            binaryLeaves.sort();
+            wideLeaves.sort();
+            if (binaryLeaves.leaves != wideLeaves.leaves)
+            {
+                printf("btDbvtWide::collideTV with %d leaves: %d leaves, binary %d\n", n, (int)wideLeaves.leaves.size(), (int)binaryLeaves.leaves.size());
+                return 1;
+            }
+        }
+        numPairs += (int)binarySelf.pairs.size() + (int)binaryTwo.pairs.size();
+        treeA.clear();
+        treeB.clear();
+    }
+    // the trees overlap, the comparisons above were not all empty
+    return numPairs == 0;
+}
+
 #define LOOPCOUNT 1000
 #define NUM_CYCLES 10000
 #define DATA_SIZE 1024
@@ -486,6 +729,16 @@ c   [0]	float32_t	0.829904
         
     }
     
+    if (Test_btDbvtLayout())
+    {
+        return 1;
+    }
+    
+    if (Test_btDbvtWideMatchesBinary())
+    {
+        return 1;
+    }
+    
     return 0;
 }
 #endif
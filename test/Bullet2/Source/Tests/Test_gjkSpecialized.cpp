@@ -0,0 +1,327 @@
+//
+//  Test_gjkSpecialized.cpp
+//  BulletTest
+//
+//  Copyright (c) 2011 Apple Inc.
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+
+#include "Test_gjkSpecialized.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include "BulletCollision/CollisionDispatch/btConvexConvexSpecializedAlgorithm.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btPointCollector.h"
+#include "BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h"
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcher.h"
+#include "BulletCollision/CollisionDispatch/btManifoldResult.h"
+
+// Compares the virtual btGjkPairDetector path against the templated GJK/EPA instantiated for a shape pair,
+// as used by btConvexConvexSpecializedAlgorithm, and btConvexConvexSpecializedAlgorithm::processCollision
+// against btConvexConvexAlgorithm::processCollision.
+
+#define LOOPCOUNT 100
+#define DATA_SIZE 256
+
+static btTransform transformA[DATA_SIZE], transformB[DATA_SIZE];
+
+static float randUnit(void)
+{
+    return (float)rand() / (float)RAND_MAX - 0.5f;
+}
+
+static void initTransforms(float range, float minDistance = 0.f)
+{
+    int i;
+    for (i = 0; i < DATA_SIZE; i++)
+    {
+        btQuaternion rotA(randUnit(), randUnit(), randUnit(), randUnit());
+        btQuaternion rotB(randUnit(), randUnit(), randUnit(), randUnit());
+        transformA[i].setIdentity();
+        transformA[i].setRotation(rotA.normalized());
+        transformB[i].setIdentity();
+        transformB[i].setRotation(rotB.normalized());
+        transformB[i].setOrigin(btVector3(randUnit(), randUnit(), randUnit()).normalized() * (minDistance + (range - minDistance) * (randUnit() + 0.5f)));
+    }
+}
+
+template <typename btShapeTypeA, typename btShapeTypeB>
+static int testPair(const char* name, const btShapeTypeA* shapeA, const btShapeTypeB* shapeB)
+{
+    bool hit_Ref_Res[DATA_SIZE], hit_Test_Res[DATA_SIZE];
+    btScalar distance_Ref_Res[DATA_SIZE], distance_Test_Res[DATA_SIZE];
+    btScalar contactDistance = btScalar(0.02);
+    btScalar maxDistance = shapeA->getMargin() + shapeB->getMargin() + contactDistance;
+    btGjkEpaPenetrationDepthSolver epaSolver;
+    uint64_t scalarTime;
+    uint64_t vectorTime;
+    size_t j;
+    int i;
+    
+    {
+        uint64_t startTime, bestTime, currentTime;
+        
+        bestTime = -1LL;
+        scalarTime = 0;
+        for (j = 0; j < LOOPCOUNT; j++) 
+		{
+            startTime = ReadTicks();
+            
+            for (i = 0; i < DATA_SIZE; i++)
+            {
+                btVoronoiSimplexSolver simplexSolver;
+                btGjkPairDetector gjk(shapeA, shapeB, &simplexSolver, &epaSolver);
+                btGjkPairDetector::ClosestPointInput input;
+                input.m_transformA = transformA[i];
+                input.m_transformB = transformB[i];
+                input.m_maximumDistanceSquared = maxDistance * maxDistance;
+                btPointCollector output;
+                gjk.getClosestPoints(input, output, 0);
+                hit_Ref_Res[i] = output.m_hasResult;
+                distance_Ref_Res[i] = output.m_distance;
+            }
+            
+			currentTime = ReadTicks() - startTime;
+            scalarTime += currentTime;
+            if( currentTime < bestTime )
+                bestTime = currentTime;
+        }
+        if( 0 == gReportAverageTimes )
+            scalarTime = bestTime;        
+        else
+            scalarTime /= LOOPCOUNT;
+    }
+    
+    {
+        uint64_t startTime, bestTime, currentTime;
+        
+        bestTime = -1LL;
+        vectorTime = 0;
+        for (j = 0; j < LOOPCOUNT; j++) 
+		{
+            startTime = ReadTicks();
+            
+            for (i = 0; i < DATA_SIZE; i++)
+            {
+                btGjkShapeWrap<btShapeTypeA> a(shapeA, transformA[i]);
+                btGjkShapeWrap<btShapeTypeB> b(shapeB, transformB[i]);
+                btGjkCollisionDescription colDesc;
+                colDesc.m_maximumDistanceSquared = maxDistance * maxDistance;
+                colDesc.m_penetrationTolerance = gGjkEpaPenetrationTolerance;
+                btVoronoiSimplexSolver simplexSolver;
+                btGjkDistanceInfo distInfo;
+                hit_Test_Res[i] = btComputeGjkEpaPenetration(a, b, colDesc, simplexSolver, &distInfo) == 0;
+                distance_Test_Res[i] = hit_Test_Res[i] ? distInfo.m_distance : btScalar(BT_LARGE_FLOAT);
+            }
+            
+			currentTime = ReadTicks() - startTime;
+            vectorTime += currentTime;
+            if( currentTime < bestTime )
+                bestTime = currentTime;
+        }
+        if( 0 == gReportAverageTimes )
+            vectorTime = bestTime;        
+        else
+            vectorTime /= LOOPCOUNT;
+    }
+    
+    vlog( "%s Timing:\n", name );
+    vlog( "     \t   virtual\tspecialized\n" );
+    vlog( "    \t%10.4f\t%10.4f\n", TicksToCycles( scalarTime ) / DATA_SIZE, TicksToCycles( vectorTime ) / DATA_SIZE );
+    
+    for (i = 0; i < DATA_SIZE; i++)
+    {
+        // beyond the contact distance GJK may stop as soon as it knows, so the distances only match for contacts
+        bool refContact = hit_Ref_Res[i] && distance_Ref_Res[i] < contactDistance;
+        bool testContact = hit_Test_Res[i] && distance_Test_Res[i] < contactDistance;
+        if( (refContact || testContact) &&
+            (hit_Test_Res[i] != hit_Ref_Res[i] || fabs(distance_Test_Res[i] - distance_Ref_Res[i]) > 1e-3f) )
+        {
+            vlog( "%s fail at %d: %d %g, %d %g\n", name, i, hit_Ref_Res[i], distance_Ref_Res[i], hit_Test_Res[i], distance_Test_Res[i] );
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+// deepest contact of one processCollision call, the manifold is created by the algorithm
+struct AlgorithmContact
+{
+    int numContacts;
+    btScalar distance;
+    btVector3 normal;
+};
+
+static AlgorithmContact processPair(btCollisionDispatcher* dispatcher, btCollisionAlgorithm* algorithm,
+                                    const btCollisionObjectWrapper* obA, const btCollisionObjectWrapper* obB)
+{
+    btDispatcherInfo dispatchInfo;
+    btManifoldResult result(obA, obB);
+    algorithm->processCollision(obA, obB, dispatchInfo, &result);
+
+    AlgorithmContact contact;
+    contact.numContacts = 0;
+    contact.distance = BT_LARGE_FLOAT;
+    contact.normal.setZero();
+    btManifoldArray manifolds;
+    algorithm->getAllContactManifolds(manifolds);
+    for (int m = 0; m < manifolds.size(); m++)
+    {
+        for (int p = 0; p < manifolds[m]->getNumContacts(); p++)
+        {
+            const btManifoldPoint& pt = manifolds[m]->getContactPoint(p);
+            contact.numContacts++;
+            if (pt.getDistance() < contact.distance)
+            {
+                contact.distance = pt.getDistance();
+                contact.normal = pt.m_normalWorldOnB;
+            }
+        }
+        manifolds[m]->clearManifold();
+    }
+    return contact;
+}
+
+// signed distance of the shapes along the normal that points from B to A
+static btScalar separationAlong(const btConvexShape* shapeA, const btTransform& transA,
+                                const btConvexShape* shapeB, const btTransform& transB, const btVector3& normal)
+{
+    btVector3 pointOnA = transA(shapeA->localGetSupportingVertex((-normal) * transA.getBasis()));
+    btVector3 pointOnB = transB(shapeB->localGetSupportingVertex(normal * transB.getBasis()));
+    return (pointOnA - pointOnB).dot(normal);
+}
+
+static bool contactsMatch(const AlgorithmContact& ref, const AlgorithmContact& test, btScalar contactThreshold,
+                          const btConvexShape* shapeA, const btTransform& transA, const btConvexShape* shapeB, const btTransform& transB)
+{
+    // close to the contact breaking threshold either algorithm may miss the contact
+    if ((ref.numContacts > 0) != (test.numContacts > 0))
+    {
+        btScalar distance = ref.numContacts ? ref.distance : test.distance;
+        return fabs(distance - contactThreshold) < 1e-3f;
+    }
+    if (!ref.numContacts)
+        return true;
+    // both EPA implementations stop at a relative tolerance, so allow more for deep penetrations
+    btScalar tolerance = 1e-3f + 1e-2f * fabs(ref.distance);
+    if (fabs(ref.distance - test.distance) > tolerance)
+        return false;
+    if (ref.normal.dot(test.normal) > 0.99f)
+        return true;
+    // nearly concentric shapes have several equally deep directions, any of them is fine, but a flipped
+    // normal would not separate the shapes by the reported distance
+    return fabs(separationAlong(shapeA, transA, shapeB, transB, test.normal) - test.distance) < 10 * tolerance;
+}
+
+template <typename btShapeTypeA, typename btShapeTypeB>
+static int testAlgorithmPair(const char* name, const btShapeTypeA* shapeA, const btShapeTypeB* shapeB)
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher(&collisionConfiguration);
+    btGjkEpaPenetrationDepthSolver epaSolver;
+    btCollisionObject objA, objB;
+    objA.setCollisionShape(const_cast<btShapeTypeA*>(shapeA));
+    objB.setCollisionShape(const_cast<btShapeTypeB*>(shapeB));
+    btCollisionAlgorithmConstructionInfo ci(&dispatcher, 1);
+    int i;
+
+    for (i = 0; i < DATA_SIZE; i++)
+    {
+        objA.setWorldTransform(transformA[i]);
+        objB.setWorldTransform(transformB[i]);
+        btCollisionObjectWrapper obA(0, shapeA, &objA, transformA[i], -1, -1);
+        btCollisionObjectWrapper obB(0, shapeB, &objB, transformB[i], -1, -1);
+
+        btConvexConvexAlgorithm refAlgorithm(0, ci, &obA, &obB, &epaSolver, 0, 3);
+        btConvexConvexSpecializedAlgorithm<btShapeTypeA, btShapeTypeB> testAlgorithm(0, ci, &obA, &obB, &epaSolver, 0, 3);
+        AlgorithmContact ref = processPair(&dispatcher, &refAlgorithm, &obA, &obB);
+        AlgorithmContact test = processPair(&dispatcher, &testAlgorithm, &obA, &obB);
+        btScalar contactThreshold = gContactBreakingThreshold;
+        if (!contactsMatch(ref, test, contactThreshold, shapeA, transformA[i], shapeB, transformB[i]))
+        {
+            vlog("%s processCollision fail at %d: %d %g, %d %g\n", name, i, ref.numContacts, ref.distance, test.numContacts, test.distance);
+            return 1;
+        }
+
+        // the contacts may not depend on the previous query of the same algorithm
+        int previous = (i + 1) % DATA_SIZE;
+        btCollisionObjectWrapper prevA(0, shapeA, &objA, transformA[previous], -1, -1);
+        btCollisionObjectWrapper prevB(0, shapeB, &objB, transformB[previous], -1, -1);
+        btConvexConvexSpecializedAlgorithm<btShapeTypeA, btShapeTypeB> reusedAlgorithm(0, ci, &prevA, &prevB, &epaSolver, 0, 3);
+        processPair(&dispatcher, &reusedAlgorithm, &prevA, &prevB);
+        AlgorithmContact reused = processPair(&dispatcher, &reusedAlgorithm, &obA, &obB);
+        if (reused.numContacts != test.numContacts || reused.distance != test.distance || reused.normal != test.normal)
+        {
+            vlog("%s processCollision depends on the previous query at %d\n", name, i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int Test_gjkSpecialized(void)
+{
+    btBoxShape box(btVector3(1, 1, 1));
+    btSphereShape sphere(1);
+    btCapsuleShape capsule(0.5f, 1);
+    btCylinderShape cylinder(btVector3(1, 1, 1));
+    btConvexHullShape hull;
+    
+    int i;
+    for (i = 0; i < 40; i++)
+    {
+        hull.addPoint(btVector3(randUnit(), randUnit(), randUnit()).normalized() * 1.2f, false);
+    }
+    hull.recalcLocalAabb();
+    
+    initTransforms(2.2f);
+    
+    if( testPair("box-sphere", &box, &sphere) )
+        return 1;
+    if( testPair("capsule-box", &capsule, &box) )
+        return 1;
+    if( testPair("capsule-cylinder", &capsule, &cylinder) )
+        return 1;
+    if( testPair("cylinder-hull", &cylinder, &hull) )
+        return 1;
+    if( testPair("hull-hull", &hull, &hull) )
+        return 1;
+    
+    // touching and deeply penetrating pairs, where EPA and the normal flip check run.
+    // EPA reports a flipped normal for roughly 1 in 1000 box pairs, so run enough of them.
+    // Nearly concentric shapes are left out, they have many equally deep directions.
+    for (i = 0; i < 40; i++)
+    {
+        if (i % 2)
+            initTransforms(1.f, 0.3f);
+        else
+            initTransforms(2.1f);
+        if( testAlgorithmPair("box-box", &box, &box) )
+            return 1;
+        if( testAlgorithmPair("box-sphere", &box, &sphere) )
+            return 1;
+        if( testAlgorithmPair("capsule-box", &capsule, &box) )
+            return 1;
+        if( testAlgorithmPair("sphere-cylinder", &sphere, &cylinder) )
+            return 1;
+        if( testAlgorithmPair("cylinder-hull", &cylinder, &hull) )
+            return 1;
+        if( testAlgorithmPair("hull-capsule", &hull, &capsule) )
+            return 1;
+    }
+    
+    return 0;
+}
+
+#endif //BT_USE_SSE
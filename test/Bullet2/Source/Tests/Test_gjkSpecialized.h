@@ -0,0 +1,22 @@
+//
+//  Test_gjkSpecialized.h
+//  BulletTest
+//
+//  Copyright (c) 2011 Apple Inc.
+//
+
+#ifndef BulletTest_Test_gjkSpecialized_h
+#define BulletTest_Test_gjkSpecialized_h
+
+#ifdef __cplusplus
+extern "C" { 
+#endif
+
+int Test_gjkSpecialized(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+    
+#endif
@@ -0,0 +1,374 @@
+#ifndef BROADPHASE_TEST_SCENE_H
+#define BROADPHASE_TEST_SCENE_H
+
+#include <btBulletCollisionCommon.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+typedef std::pair<int, int> IndexPair;
+
+// collects the indices of the proxies reported by rayTest, rayTestPacket or aabbTest,
+// the client object of every proxy of a BroadphaseTestScene is its index
+struct CollectProxiesCallback : public btBroadphaseRayCallback
+{
+	std::vector<int> m_indices;
+
+	CollectProxiesCallback()
+	{
+		m_lambda_max = 0;
+	}
+	// set up the cached ray data the way btCollisionWorld::rayTest does
+	CollectProxiesCallback(const btVector3& rayFrom, const btVector3& rayTo)
+	{
+		btVector3 rayDir = (rayTo - rayFrom).normalized();
+		m_rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[0];
+		m_rayDirectionInverse[1] = rayDir[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[1];
+		m_rayDirectionInverse[2] = rayDir[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[2];
+		m_signs[0] = m_rayDirectionInverse[0] < 0.0;
+		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
+		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
+		m_lambda_max = rayDir.dot(rayTo - rayFrom);
+	}
+	virtual bool process(const btBroadphaseProxy* proxy)
+	{
+		m_indices.push_back(int(size_t(proxy->m_clientObject)));
+		return true;
+	}
+};
+
+// the same proxies in several broadphases, the first broadphase is the reference the others are compared to.
+// Only the overlaps of the actual aabbs are compared, btDbvtBroadphase also keeps pairs of its enlarged leaves
+// until its incremental cleanup removes them.
+struct BroadphaseTestScene
+{
+	btDefaultCollisionConfiguration m_config;
+	btCollisionDispatcher m_dispatcher;
+	btAlignedObjectArray<btBroadphaseInterface*> m_broadphases;  // owned
+	btAlignedObjectArray<bool> m_noStalePairs;                   // the pair cache holds exactly the overlapping pairs
+	btAlignedObjectArray<btVector3> m_aabbMin;
+	btAlignedObjectArray<btVector3> m_aabbMax;
+	btAlignedObjectArray<bool> m_alive;
+	btAlignedObjectArray<btAlignedObjectArray<btBroadphaseProxy*> > m_proxies;  // per broadphase, per index
+	unsigned int m_seed;
+
+	BroadphaseTestScene()
+		: m_dispatcher(&m_config),
+		  m_seed(12345)
+	{
+	}
+	~BroadphaseTestScene()
+	{
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			for (int i = 0; i < m_alive.size(); i++)
+			{
+				if (m_alive[i])
+				{
+					m_broadphases[b]->destroyProxy(m_proxies[b][i], &m_dispatcher);
+				}
+			}
+			delete m_broadphases[b];
+		}
+	}
+
+	void addBroadphase(btBroadphaseInterface* broadphase, bool noStalePairs)
+	{
+		btAssert(m_alive.size() == 0);
+		m_broadphases.push_back(broadphase);
+		m_noStalePairs.push_back(noStalePairs);
+		m_proxies.expand();
+	}
+
+	btScalar randomScalar(btScalar lo, btScalar hi)
+	{
+		m_seed = m_seed * 1664525u + 1013904223u;
+		return lo + (hi - lo) * btScalar(m_seed >> 8) / btScalar(1 << 24);
+	}
+	btVector3 randomVector(btScalar lo, btScalar hi)
+	{
+		btScalar x = randomScalar(lo, hi);
+		btScalar y = randomScalar(lo, hi);
+		btScalar z = randomScalar(lo, hi);
+		return btVector3(x, y, z);
+	}
+
+	int addProxy(const btVector3& aabbMin, const btVector3& aabbMax)
+	{
+		int index = m_alive.size();
+		m_aabbMin.push_back(aabbMin);
+		m_aabbMax.push_back(aabbMax);
+		m_alive.push_back(false);
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			m_proxies[b].push_back(0);
+		}
+		createProxies(index);
+		return index;
+	}
+	// a box with random half extents in [minSize, maxSize] around a random point of the cube [-extent, extent]^3
+	int addRandomProxy(btScalar extent, btScalar minSize, btScalar maxSize)
+	{
+		btVector3 center = randomVector(-extent, extent);
+		btVector3 halfExtents = randomVector(minSize, maxSize);
+		return addProxy(center - halfExtents, center + halfExtents);
+	}
+	void createProxies(int index)
+	{
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			m_proxies[b][index] = m_broadphases[b]->createProxy(m_aabbMin[index], m_aabbMax[index], BOX_SHAPE_PROXYTYPE, (void*)size_t(index),
+																 btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, &m_dispatcher);
+		}
+		m_alive[index] = true;
+	}
+	void destroyProxies(int index)
+	{
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			m_broadphases[b]->destroyProxy(m_proxies[b][index], &m_dispatcher);
+			m_proxies[b][index] = 0;
+		}
+		m_alive[index] = false;
+	}
+	void setAabb(int index, const btVector3& aabbMin, const btVector3& aabbMax)
+	{
+		m_aabbMin[index] = aabbMin;
+		m_aabbMax[index] = aabbMax;
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			m_broadphases[b]->setAabb(m_proxies[b][index], aabbMin, aabbMax, &m_dispatcher);
+		}
+	}
+
+	// moves every proxy with probability moveFraction by up to maxStep, and removes or re-adds a few proxies
+	void moveProxies(btScalar moveFraction, btScalar maxStep, btScalar churnFraction)
+	{
+		for (int i = 0; i < m_alive.size(); i++)
+		{
+			if (randomScalar(0, 1) < churnFraction)
+			{
+				if (m_alive[i])
+				{
+					destroyProxies(i);
+				}
+				else
+				{
+					createProxies(i);
+				}
+			}
+			else if (m_alive[i] && randomScalar(0, 1) < moveFraction)
+			{
+				btVector3 step = randomVector(-maxStep, maxStep);
+				setAabb(i, m_aabbMin[i] + step, m_aabbMax[i] + step);
+			}
+		}
+	}
+	void calculateOverlappingPairs()
+	{
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			m_broadphases[b]->calculateOverlappingPairs(&m_dispatcher);
+		}
+	}
+
+	bool overlaps(int i, const btVector3& aabbMin, const btVector3& aabbMax) const
+	{
+		return TestAabbAgainstAabb2(m_aabbMin[i], m_aabbMax[i], aabbMin, aabbMax);
+	}
+	// a box from aabbMin to aabbMax moved along the ray, the same as a ray against the enlarged aabb
+	bool hitByRay(int i, const btVector3& rayFrom, const btVector3& rayTo, const btVector3& aabbMin, const btVector3& aabbMax) const
+	{
+		// slab test of the segment against the actual aabb
+		btVector3 boundsMin = m_aabbMin[i] - aabbMax;
+		btVector3 boundsMax = m_aabbMax[i] - aabbMin;
+		btScalar tmin = 0;
+		btScalar tmax = 1;
+		for (int k = 0; k < 3; k++)
+		{
+			btScalar d = rayTo[k] - rayFrom[k];
+			if (d == btScalar(0.))
+			{
+				if (rayFrom[k] < boundsMin[k] || rayFrom[k] > boundsMax[k])
+					return false;
+				continue;
+			}
+			btScalar t0 = (boundsMin[k] - rayFrom[k]) / d;
+			btScalar t1 = (boundsMax[k] - rayFrom[k]) / d;
+			tmin = btMax(tmin, btMin(t0, t1));
+			tmax = btMin(tmax, btMax(t0, t1));
+		}
+		return tmin <= tmax;
+	}
+
+	std::vector<IndexPair> bruteForcePairs() const
+	{
+		std::vector<IndexPair> pairs;
+		for (int i = 0; i < m_alive.size(); i++)
+		{
+			for (int j = i + 1; j < m_alive.size(); j++)
+			{
+				if (m_alive[i] && m_alive[j] && overlaps(i, m_aabbMin[j], m_aabbMax[j]))
+				{
+					pairs.push_back(IndexPair(i, j));
+				}
+			}
+		}
+		return pairs;
+	}
+	// the pairs in the pair cache of broadphase b, sorted, only those of overlapping aabbs unless allPairs is set
+	std::vector<IndexPair> cachedPairs(int b, bool allPairs) const
+	{
+		std::vector<IndexPair> pairs;
+		const btBroadphasePairArray& pairArray = m_broadphases[b]->getOverlappingPairCache()->getOverlappingPairArray();
+		for (int p = 0; p < pairArray.size(); p++)
+		{
+			int i = int(size_t(pairArray[p].m_pProxy0->m_clientObject));
+			int j = int(size_t(pairArray[p].m_pProxy1->m_clientObject));
+			EXPECT_TRUE(m_alive[i] && m_alive[j]);
+			if (allPairs || overlaps(i, m_aabbMin[j], m_aabbMax[j]))
+			{
+				pairs.push_back(IndexPair(btMin(i, j), btMax(i, j)));
+			}
+		}
+		std::sort(pairs.begin(), pairs.end());
+		return pairs;
+	}
+	void expectSamePairs()
+	{
+		std::vector<IndexPair> reference = cachedPairs(0, false);
+		EXPECT_TRUE(reference == bruteForcePairs());
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			std::vector<IndexPair> allPairs = cachedPairs(b, true);
+			EXPECT_TRUE(std::adjacent_find(allPairs.begin(), allPairs.end()) == allPairs.end()) << "duplicate pair in broadphase " << b;
+			EXPECT_TRUE(cachedPairs(b, false) == reference) << "broadphase " << b;
+			if (m_noStalePairs[b])
+			{
+				EXPECT_TRUE(allPairs == reference) << "broadphase " << b;
+			}
+		}
+	}
+
+	// the reported proxies that are hit by the ray or overlap the aabb, sorted
+	std::vector<int> rayHits(const CollectProxiesCallback& callback, const btVector3& rayFrom, const btVector3& rayTo,
+							 const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0)) const
+	{
+		std::vector<int> hits;
+		for (size_t h = 0; h < callback.m_indices.size(); h++)
+		{
+			if (hitByRay(callback.m_indices[h], rayFrom, rayTo, aabbMin, aabbMax))
+				hits.push_back(callback.m_indices[h]);
+		}
+		std::sort(hits.begin(), hits.end());
+		return hits;
+	}
+	std::vector<int> bruteForceRayHits(const btVector3& rayFrom, const btVector3& rayTo,
+									   const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0)) const
+	{
+		std::vector<int> hits;
+		for (int i = 0; i < m_alive.size(); i++)
+		{
+			if (m_alive[i] && hitByRay(i, rayFrom, rayTo, aabbMin, aabbMax))
+				hits.push_back(i);
+		}
+		return hits;
+	}
+	void expectSameRayHits(const btVector3& rayFrom, const btVector3& rayTo,
+						   const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0))
+	{
+		std::vector<int> expected = bruteForceRayHits(rayFrom, rayTo, aabbMin, aabbMax);
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			CollectProxiesCallback callback(rayFrom, rayTo);
+			m_broadphases[b]->rayTest(rayFrom, rayTo, callback, aabbMin, aabbMax);
+			std::vector<int> reported = callback.m_indices;
+			std::sort(reported.begin(), reported.end());
+			EXPECT_TRUE(std::adjacent_find(reported.begin(), reported.end()) == reported.end()) << "duplicate ray hit in broadphase " << b;
+			EXPECT_TRUE(rayHits(callback, rayFrom, rayTo, aabbMin, aabbMax) == expected) << "broadphase " << b;
+		}
+	}
+	void expectSameRayPacketHits(const btVector3* rayFrom, const btVector3* rayTo, int numRays)
+	{
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			std::vector<CollectProxiesCallback> callbacks;
+			std::vector<btBroadphaseRayCallback*> callbackPtrs;
+			for (int r = 0; r < numRays; r++)
+			{
+				callbacks.push_back(CollectProxiesCallback(rayFrom[r], rayTo[r]));
+			}
+			for (int r = 0; r < numRays; r++)
+			{
+				callbackPtrs.push_back(&callbacks[r]);
+			}
+			m_broadphases[b]->rayTestPacket(rayFrom, rayTo, &callbackPtrs[0], numRays);
+			for (int r = 0; r < numRays; r++)
+			{
+				EXPECT_TRUE(rayHits(callbacks[r], rayFrom[r], rayTo[r]) == bruteForceRayHits(rayFrom[r], rayTo[r])) << "broadphase " << b << " ray " << r;
+			}
+		}
+	}
+	void expectSameAabbHits(const btVector3& aabbMin, const btVector3& aabbMax)
+	{
+		std::vector<int> expected;
+		for (int i = 0; i < m_alive.size(); i++)
+		{
+			if (m_alive[i] && overlaps(i, aabbMin, aabbMax))
+				expected.push_back(i);
+		}
+		for (int b = 0; b < m_broadphases.size(); b++)
+		{
+			CollectProxiesCallback callback;
+			m_broadphases[b]->aabbTest(aabbMin, aabbMax, callback);
+			std::vector<int> reported;
+			for (size_t h = 0; h < callback.m_indices.size(); h++)
+			{
+				if (overlaps(callback.m_indices[h], aabbMin, aabbMax))
+					reported.push_back(callback.m_indices[h]);
+			}
+			std::sort(reported.begin(), reported.end());
+			EXPECT_TRUE(std::adjacent_find(reported.begin(), reported.end()) == reported.end()) << "duplicate aabb hit in broadphase " << b;
+			EXPECT_TRUE(reported == expected) << "broadphase " << b;
+		}
+	}
+
+	// random rays, swept boxes and boxes of all lengths and sizes through the cube [-extent, extent]^3,
+	// including axis aligned rays
+	void expectSameQueries(btScalar extent, int numQueries)
+	{
+		for (int q = 0; q < numQueries; q++)
+		{
+			btVector3 rayFrom = randomVector(-extent, extent);
+			btVector3 rayTo = rayFrom + randomVector(-extent, extent) * randomScalar(0.05f, 2.f);
+			if (q % 4 == 0)
+			{
+				rayTo = rayFrom;
+				rayTo[q % 3] += randomScalar(-2 * extent, 2 * extent);
+			}
+			expectSameRayHits(rayFrom, rayTo);
+			btVector3 sweptHalfExtents = randomVector(0.05f, 1.f);
+			expectSameRayHits(rayFrom, rayTo, -sweptHalfExtents, sweptHalfExtents);
+
+			btVector3 center = randomVector(-extent, extent);
+			btVector3 halfExtents = randomVector(0.01f, 1.f) * randomScalar(0.1f, extent);
+			expectSameAabbHits(center - halfExtents, center + halfExtents);
+		}
+		// a packet of coherent rays
+		const int numRays = 16;
+		btVector3 rayFrom[numRays];
+		btVector3 rayTo[numRays];
+		btVector3 origin = randomVector(-extent, extent);
+		btVector3 target = randomVector(-extent, extent);
+		for (int r = 0; r < numRays; r++)
+		{
+			rayFrom[r] = origin;
+			rayTo[r] = target + randomVector(-0.2f * extent, 0.2f * extent);
+		}
+		expectSameRayPacketHits(rayFrom, rayTo, numRays);
+	}
+};
+
+#endif  //BROADPHASE_TEST_SCENE_H
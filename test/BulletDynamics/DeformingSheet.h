@@ -0,0 +1,98 @@
+#ifndef DEFORMING_SHEET_H
+#define DEFORMING_SHEET_H
+
+#include <btBulletCollisionCommon.h>
+
+// a grid of quads in the xz plane, two triangles each, that a wave deforms in y
+struct DeformingSheet
+{
+	int m_numQuads;
+	btScalar m_size;
+	btAlignedObjectArray<btScalar> m_vertices;
+	btAlignedObjectArray<int> m_indices;
+	btTriangleIndexVertexArray* m_meshInterface;
+
+	DeformingSheet(int numQuads, btScalar size)
+		: m_numQuads(numQuads),
+		  m_size(size)
+	{
+		m_vertices.resize((numQuads + 1) * (numQuads + 1) * 3);
+		for (int i = 0; i <= numQuads; i++)
+		{
+			for (int j = 0; j <= numQuads; j++)
+			{
+				btScalar* v = &m_vertices[(i * (numQuads + 1) + j) * 3];
+				v[0] = size * (btScalar(i) / numQuads - btScalar(0.5));
+				v[2] = size * (btScalar(j) / numQuads - btScalar(0.5));
+			}
+		}
+		for (int i = 0; i < numQuads; i++)
+		{
+			for (int j = 0; j < numQuads; j++)
+			{
+				int v00 = i * (numQuads + 1) + j;
+				int v10 = v00 + numQuads + 1;
+				m_indices.push_back(v00);
+				m_indices.push_back(v10);
+				m_indices.push_back(v00 + 1);
+				m_indices.push_back(v00 + 1);
+				m_indices.push_back(v10);
+				m_indices.push_back(v10 + 1);
+			}
+		}
+		deform(0, 1);
+		m_meshInterface = new btTriangleIndexVertexArray();
+		m_meshInterface->addIndexedMesh(indexedMesh());
+	}
+	~DeformingSheet()
+	{
+		delete m_meshInterface;
+	}
+
+	// the sheet as a mesh part, to build meshes of several sheets
+	btIndexedMesh indexedMesh()
+	{
+		btIndexedMesh mesh;
+		mesh.m_numTriangles = m_indices.size() / 3;
+		mesh.m_triangleIndexBase = (const unsigned char*)&m_indices[0];
+		mesh.m_triangleIndexStride = 3 * sizeof(int);
+		mesh.m_numVertices = m_vertices.size() / 3;
+		mesh.m_vertexBase = (const unsigned char*)&m_vertices[0];
+		mesh.m_vertexStride = 3 * sizeof(btScalar);
+		return mesh;
+	}
+
+	void deform(btScalar phase, btScalar amplitude)
+	{
+		for (int v = 0; v < m_vertices.size(); v += 3)
+		{
+			m_vertices[v + 1] = amplitude * btSin(m_vertices[v] * btScalar(0.7) + phase) * btCos(m_vertices[v + 2] * btScalar(0.5) - phase);
+		}
+	}
+
+	// raises the vertices within radius of (x, z), and returns the triangles that moved
+	void bump(btScalar x, btScalar z, btScalar radius, btScalar height, btAlignedObjectArray<int>& movedTriangles)
+	{
+		btAlignedObjectArray<bool> moved;
+		moved.resize(m_vertices.size() / 3, false);
+		for (int v = 0; v < m_vertices.size(); v += 3)
+		{
+			btScalar distance = btSqrt((m_vertices[v] - x) * (m_vertices[v] - x) + (m_vertices[v + 2] - z) * (m_vertices[v + 2] - z));
+			if (distance < radius)
+			{
+				m_vertices[v + 1] += height * (1 - distance / radius);
+				moved[v / 3] = true;
+			}
+		}
+		movedTriangles.resize(0);
+		for (int t = 0; t < m_indices.size() / 3; t++)
+		{
+			if (moved[m_indices[3 * t]] || moved[m_indices[3 * t + 1]] || moved[m_indices[3 * t + 2]])
+			{
+				movedTriangles.push_back(t);
+			}
+		}
+	}
+};
+
+#endif  //DEFORMING_SHEET_H
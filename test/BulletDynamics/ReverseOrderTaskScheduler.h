@@ -0,0 +1,38 @@
+#ifndef REVERSE_ORDER_TASK_SCHEDULER_H
+#define REVERSE_ORDER_TASK_SCHEDULER_H
+
+#include <LinearMath/btThreads.h>
+#include <LinearMath/btMinMax.h>
+
+// claims several threads, but runs the tasks of a parallel loop on the calling thread, last task first,
+// so the work is done in a different order than by the serial loops
+class ReverseOrderTaskScheduler : public btITaskScheduler
+{
+public:
+	int m_numParallelLoops;
+
+	ReverseOrderTaskScheduler()
+		: btITaskScheduler("ReverseOrder"),
+		  m_numParallelLoops(0)
+	{
+	}
+	virtual int getMaxNumThreads() const { return 4; }
+	virtual int getNumThreads() const { return 4; }
+	virtual void setNumThreads(int numThreads) {}
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+	{
+		m_numParallelLoops++;
+		int numTasks = (iEnd - iBegin + grainSize - 1) / grainSize;
+		for (int task = numTasks - 1; task >= 0; task--)
+		{
+			int taskBegin = iBegin + task * grainSize;
+			body.forLoop(taskBegin, btMin(taskBegin + grainSize, iEnd));
+		}
+	}
+	virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body)
+	{
+		return body.sumLoop(iBegin, iEnd);
+	}
+};
+
+#endif  //REVERSE_ORDER_TASK_SCHEDULER_H
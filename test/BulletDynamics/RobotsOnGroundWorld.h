@@ -0,0 +1,124 @@
+#ifndef ROBOTS_ON_GROUND_WORLD_H
+#define ROBOTS_ON_GROUND_WORLD_H
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h>
+#include <gtest/gtest.h>
+
+// a grid of small three link robots on a ground plane. By default the ground is a fixed base btMultiBody,
+// like plane.urdf in pybullet, otherwise a static btRigidBody
+struct RobotsOnGroundWorld
+{
+	btDefaultCollisionConfiguration m_config;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btMultiBodyDynamicsWorld m_world;
+	btBoxShape m_groundShape;
+	btBoxShape m_linkShape;
+	btRigidBody* m_rigidGround;
+	btAlignedObjectArray<btMultiBody*> m_robots;
+	btAlignedObjectArray<btMultiBody*> m_multiBodies;
+	btAlignedObjectArray<btMultiBodyLinkCollider*> m_colliders;
+
+	RobotsOnGroundWorld(btMultiBodyConstraintSolver* solver, int numRobots, bool multiBodyGround = true)
+		: m_dispatcher(&m_config),
+		  m_world(&m_dispatcher, &m_broadphase, solver, &m_config),
+		  m_groundShape(btVector3(20, 1, 20)),
+		  m_linkShape(btVector3(0.2f, 0.1f, 0.1f)),
+		  m_rigidGround(0)
+	{
+		m_world.setGravity(btVector3(0, -10, 0));
+
+		btTransform groundTransform;
+		groundTransform.setIdentity();
+		groundTransform.setOrigin(btVector3(0, -1, 0));
+		if (multiBodyGround)
+		{
+			btMultiBody* ground = new btMultiBody(0, 0, btVector3(0, 0, 0), true, false);
+			ground->setBaseWorldTransform(groundTransform);
+			ground->finalizeMultiDof();
+			addMultiBody(ground, &m_groundShape);
+		}
+		else
+		{
+			m_rigidGround = new btRigidBody(0, 0, &m_groundShape);
+			m_rigidGround->setWorldTransform(groundTransform);
+			m_world.addRigidBody(m_rigidGround);
+		}
+
+		btScalar linkMass = 1;
+		btVector3 linkInertia;
+		m_linkShape.calculateLocalInertia(linkMass, linkInertia);
+		for (int i = 0; i < numRobots; i++)
+		{
+			btMultiBody* robot = new btMultiBody(2, linkMass, linkInertia, false, false);
+			robot->setBasePos(btVector3(btScalar(i % 4) * 1.5f - 2, 0.12f, btScalar(i / 4) * 0.5f - 2));
+			for (int link = 0; link < 2; link++)
+			{
+				robot->setupRevolute(link, linkMass, linkInertia, link - 1, btQuaternion(0, 0, 0, 1), btVector3(0, 0, 1), btVector3(0.2f, 0, 0), btVector3(0.2f, 0, 0), true);
+			}
+			robot->finalizeMultiDof();
+			robot->setJointVel(0, (i & 1) ? 1.f : -1.f);
+			addMultiBody(robot, &m_linkShape);
+			m_robots.push_back(robot);
+		}
+	}
+	~RobotsOnGroundWorld()
+	{
+		for (int i = 0; i < m_colliders.size(); i++)
+		{
+			m_world.removeCollisionObject(m_colliders[i]);
+			delete m_colliders[i];
+		}
+		for (int i = 0; i < m_multiBodies.size(); i++)
+		{
+			m_world.removeMultiBody(m_multiBodies[i]);
+			delete m_multiBodies[i];
+		}
+		if (m_rigidGround)
+		{
+			m_world.removeRigidBody(m_rigidGround);
+			delete m_rigidGround;
+		}
+	}
+	void addMultiBody(btMultiBody* multiBody, btCollisionShape* shape)
+	{
+		m_world.addMultiBody(multiBody);
+		m_multiBodies.push_back(multiBody);
+		for (int link = -1; link < multiBody->getNumLinks(); link++)
+		{
+			btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(multiBody, link);
+			collider->setCollisionShape(shape);
+			if (link < 0)
+				multiBody->setBaseCollider(collider);
+			else
+				multiBody->getLink(link).m_collider = collider;
+			// static filter for the ground, like URDF2Bullet does for the base of a fixed base btMultiBody
+			if (multiBody->isStaticMultiBody())
+				m_world.addCollisionObject(collider, btBroadphaseProxy::StaticFilter, btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+			else
+				m_world.addCollisionObject(collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+			m_colliders.push_back(collider);
+		}
+		btAlignedObjectArray<btQuaternion> scratchQ;
+		btAlignedObjectArray<btVector3> scratchV;
+		multiBody->updateCollisionObjectWorldTransforms(scratchQ, scratchV);
+	}
+};
+
+inline void expectSameState(const btMultiBody* a, const btMultiBody* b, btScalar tolerance)
+{
+	EXPECT_NEAR(0, (a->getBasePos() - b->getBasePos()).length(), tolerance);
+	EXPECT_NEAR(0, (a->getBaseVel() - b->getBaseVel()).length(), tolerance);
+	EXPECT_NEAR(0, (a->getBaseOmega() - b->getBaseOmega()).length(), tolerance);
+	for (int link = 0; link < a->getNumLinks(); link++)
+	{
+		EXPECT_NEAR(a->getJointPos(link), b->getJointPos(link), tolerance);
+		EXPECT_NEAR(a->getJointVel(link), b->getJointVel(link), tolerance);
+	}
+}
+
+#endif  //ROBOTS_ON_GROUND_WORLD_H
@@ -0,0 +1,148 @@
+
+#include "DeformingSheet.h"
+#include "ReverseOrderTaskScheduler.h"
+#include <btBulletCollisionCommon.h>
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <stdio.h>
+
+static int getNodeCount(btOptimizedBvh* bvh)
+{
+	const btQuantizedBvhNode& root = bvh->getQuantizedNodeArray()[0];
+	return root.isLeafNode() ? 1 : root.getEscapeIndex();
+}
+
+// refits every node and subtree header in the current quantization range of the bvh
+static void fullRefit(btOptimizedBvh* bvh, btStridingMeshInterface* meshInterface)
+{
+	bvh->updateBvhNodes(meshInterface, 0, getNodeCount(bvh), 0);
+	for (int i = 0; i < bvh->getSubtreeInfoArray().size(); i++)
+	{
+		btBvhSubtreeInfo& subtree = bvh->getSubtreeInfoArray()[i];
+		subtree.setAabbFromQuantizeNode(bvh->getQuantizedNodeArray()[subtree.m_rootNodeIndex]);
+	}
+}
+
+// the bvhs have the same nodes and subtree headers
+static void expectSameBvh(btOptimizedBvh* expected, btOptimizedBvh* bvh)
+{
+	ASSERT_EQ(getNodeCount(expected), getNodeCount(bvh));
+	for (int node = 0; node < getNodeCount(expected); node++)
+	{
+		const btQuantizedBvhNode& a = expected->getQuantizedNodeArray()[node];
+		const btQuantizedBvhNode& b = bvh->getQuantizedNodeArray()[node];
+		bool same = a.m_escapeIndexOrTriangleIndex == b.m_escapeIndexOrTriangleIndex;
+		for (int i = 0; i < 3; i++)
+		{
+			same = same && a.m_quantizedAabbMin[i] == b.m_quantizedAabbMin[i] && a.m_quantizedAabbMax[i] == b.m_quantizedAabbMax[i];
+		}
+		if (!same)
+		{
+			ADD_FAILURE() << "node " << node << " differs";
+			break;
+		}
+	}
+	ASSERT_EQ(expected->getSubtreeInfoArray().size(), bvh->getSubtreeInfoArray().size());
+	for (int s = 0; s < expected->getSubtreeInfoArray().size(); s++)
+	{
+		const btBvhSubtreeInfo& a = expected->getSubtreeInfoArray()[s];
+		const btBvhSubtreeInfo& b = bvh->getSubtreeInfoArray()[s];
+		bool same = a.m_rootNodeIndex == b.m_rootNodeIndex && a.m_subtreeSize == b.m_subtreeSize;
+		for (int i = 0; i < 3; i++)
+		{
+			same = same && a.m_quantizedAabbMin[i] == b.m_quantizedAabbMin[i] && a.m_quantizedAabbMax[i] == b.m_quantizedAabbMax[i];
+		}
+		EXPECT_TRUE(same) << "subtree " << s;
+	}
+}
+
+// the local aabb of the shape still contains the mesh
+static void expectAabbContainsMesh(btBvhTriangleMeshShape& shape, btStridingMeshInterface* meshInterface)
+{
+	btVector3 aabbMin, aabbMax, meshMin, meshMax;
+	shape.getAabb(btTransform::getIdentity(), aabbMin, aabbMax);
+	meshInterface->calculateAabbBruteForce(meshMin, meshMax);
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_LE(aabbMin[i], meshMin[i]);
+		EXPECT_GE(aabbMax[i], meshMax[i]);
+	}
+}
+
+// refits the moved triangles of one shape and all of another shape of the same mesh
+static void comparePartialRefit()
+{
+	// a mesh of two parts
+	DeformingSheet sheet0(60, 30);
+	DeformingSheet sheet1(20, 10);
+	btTriangleIndexVertexArray mesh;
+	mesh.addIndexedMesh(sheet0.indexedMesh());
+	mesh.addIndexedMesh(sheet1.indexedMesh());
+	btBvhTriangleMeshShape partialShape(&mesh, true);
+	btBvhTriangleMeshShape fullShape(&mesh, true);
+	// the build rounds the internal nodes outwards, a refit merges the children exactly. From then on
+	// the partial refit only has to touch the ancestors of the moved triangles
+	fullRefit(partialShape.getOptimizedBvh(), &mesh);
+	fullRefit(fullShape.getOptimizedBvh(), &mesh);
+
+	int minimumLeafNodes = btOptimizedBvh::s_minimumLeafNodesForParallelRefit;
+	btAlignedObjectArray<int> movedTriangles;
+	for (int round = 0; round < 12; round++)
+	{
+		int part = round % 3 ? 0 : 1;
+		DeformingSheet& sheet = part ? sheet1 : sheet0;
+		// bumps up and down that stay in the quantization range
+		sheet.bump(btScalar(round % 5 - 2) * sheet.m_size / 5, btScalar(round % 3 - 1) * sheet.m_size / 4,
+				   sheet.m_size / 8, btScalar(round % 2 ? 0.4 : -0.4), movedTriangles);
+		ASSERT_GT(movedTriangles.size(), 0);
+		// with the serial and the parallel leaf loop
+		btOptimizedBvh::s_minimumLeafNodesForParallelRefit = round % 2 ? 0 : INT_MAX;
+		EXPECT_FALSE(partialShape.partialRefitTree(part, &movedTriangles[0], movedTriangles.size()));
+		btOptimizedBvh::s_minimumLeafNodesForParallelRefit = minimumLeafNodes;
+		fullRefit(fullShape.getOptimizedBvh(), &mesh);
+
+		expectSameBvh(fullShape.getOptimizedBvh(), partialShape.getOptimizedBvh());
+		expectAabbContainsMesh(partialShape, &mesh);
+	}
+
+	// out of the quantization range, the bvh is rebuilt like a new one
+	sheet0.bump(0, 0, 3, 5, movedTriangles);
+	EXPECT_TRUE(partialShape.partialRefitTree(0, &movedTriangles[0], movedTriangles.size()));
+	btBvhTriangleMeshShape rebuiltShape(&mesh, true);
+	expectSameBvh(rebuiltShape.getOptimizedBvh(), partialShape.getOptimizedBvh());
+	expectAabbContainsMesh(partialShape, &mesh);
+
+	// and refitting the rebuilt bvh
+	fullRefit(partialShape.getOptimizedBvh(), &mesh);
+	fullRefit(rebuiltShape.getOptimizedBvh(), &mesh);
+	sheet0.bump(5, 5, 3, btScalar(-0.4), movedTriangles);
+	EXPECT_FALSE(partialShape.partialRefitTree(0, &movedTriangles[0], movedTriangles.size()));
+	fullRefit(rebuiltShape.getOptimizedBvh(), &mesh);
+	expectSameBvh(rebuiltShape.getOptimizedBvh(), partialShape.getOptimizedBvh());
+	expectAabbContainsMesh(partialShape, &mesh);
+}
+
+GTEST_TEST(BulletCollision, BvhTriangleMeshShapePartialRefitMatchesFullRefit)
+{
+	comparePartialRefit();
+}
+
+GTEST_TEST(BulletCollision, BvhTriangleMeshShapePartialRefitWithTaskScheduler)
+{
+#if BT_THREADSAFE
+	ReverseOrderTaskScheduler reverseOrderScheduler;
+	btSetTaskScheduler(&reverseOrderScheduler);
+	comparePartialRefit();
+	EXPECT_GT(reverseOrderScheduler.m_numParallelLoops, 0);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+#else
+	printf("BT_THREADSAFE is off, skipping the task scheduler test\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,833 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+#include <BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+// a bumpy grid of triangles, owned by the test
+struct MeshGrid
+{
+	std::vector<btScalar> m_vertices;
+	std::vector<int> m_indices;
+	btTriangleIndexVertexArray* m_meshInterface;
+
+	MeshGrid(int size, btScalar spacing)
+	{
+		for (int j = 0; j <= size; j++)
+		{
+			for (int i = 0; i <= size; i++)
+			{
+				m_vertices.push_back((i - size * 0.5f) * spacing);
+				m_vertices.push_back(btSin(i * 0.7f) * btCos(j * 0.45f));
+				m_vertices.push_back((j - size * 0.5f) * spacing);
+			}
+		}
+		for (int j = 0; j < size; j++)
+		{
+			for (int i = 0; i < size; i++)
+			{
+				int v = j * (size + 1) + i;
+				m_indices.push_back(v);
+				m_indices.push_back(v + 1);
+				m_indices.push_back(v + size + 1);
+				m_indices.push_back(v + 1);
+				m_indices.push_back(v + size + 2);
+				m_indices.push_back(v + size + 1);
+			}
+		}
+		m_meshInterface = new btTriangleIndexVertexArray(int(m_indices.size() / 3), &m_indices[0], 3 * sizeof(int),
+														 int(m_vertices.size() / 3), &m_vertices[0], 3 * sizeof(btScalar));
+	}
+	~MeshGrid()
+	{
+		delete m_meshInterface;
+	}
+};
+
+struct RayTestWorld
+{
+	btDefaultCollisionConfiguration m_config;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btCollisionWorld m_world;
+	MeshGrid m_grid;
+	btAlignedObjectArray<btCollisionShape*> m_shapes;
+	btAlignedObjectArray<btCollisionObject*> m_objects;
+
+	RayTestWorld()
+		: m_dispatcher(&m_config),
+		  m_world(&m_dispatcher, &m_broadphase, &m_config),
+		  m_grid(24, 1.f)
+	{
+		// a quantized and an unquantized mesh, both moved away from the origin
+		btTransform tr;
+		tr.setIdentity();
+		addObject(new btBvhTriangleMeshShape(m_grid.m_meshInterface, true), tr);
+		tr.setOrigin(btVector3(3, 2.5f, -1));
+		tr.setRotation(btQuaternion(btVector3(0, 1, 0), 0.3f));
+		addObject(new btBvhTriangleMeshShape(m_grid.m_meshInterface, false), tr);
+
+		for (int i = 0; i < 12; i++)
+		{
+			tr.setIdentity();
+			tr.setOrigin(btVector3(-10 + i * 1.7f, 1.5f + (i % 3), -8 + i * 1.3f));
+			tr.setRotation(btQuaternion(btVector3(1, 1, 0).normalized(), i * 0.4f));
+			if (i % 2)
+				addObject(new btBoxShape(btVector3(0.6f, 0.4f, 0.8f)), tr);
+			else
+				addObject(new btSphereShape(0.7f), tr);
+		}
+		m_world.updateAabbs();
+	}
+	~RayTestWorld()
+	{
+		for (int i = 0; i < m_objects.size(); i++)
+		{
+			m_world.removeCollisionObject(m_objects[i]);
+			delete m_objects[i];
+		}
+		for (int i = 0; i < m_shapes.size(); i++)
+		{
+			delete m_shapes[i];
+		}
+	}
+	void addObject(btCollisionShape* shape, const btTransform& tr)
+	{
+		btCollisionObject* obj = new btCollisionObject();
+		obj->setCollisionShape(shape);
+		obj->setWorldTransform(tr);
+		m_world.addCollisionObject(obj);
+		m_shapes.push_back(shape);
+		m_objects.push_back(obj);
+	}
+};
+
+// coherent rays from a camera above the scene, and a few long rays across it
+static void createRays(btAlignedObjectArray<btVector3>& rayFrom, btAlignedObjectArray<btVector3>& rayTo)
+{
+	const btVector3 eye(0, 12, -14);
+	for (int j = 0; j < 40; j++)
+	{
+		for (int i = 0; i < 50; i++)
+		{
+			btVector3 target((i - 25) * 0.5f, -2.f, (j - 20) * 0.5f + 2.f);
+			rayFrom.push_back(eye);
+			rayTo.push_back(eye + (target - eye) * 1.5f);
+		}
+	}
+	for (int i = 0; i < 37; i++)
+	{
+		rayFrom.push_back(btVector3(-20, 0.5f + i * 0.1f, -15 + i));
+		rayTo.push_back(btVector3(20, 1.5f - i * 0.05f, 15 - i * 0.5f));
+	}
+}
+
+GTEST_TEST(BulletCollision, RayTestBatchMatchesRayTest)
+{
+	RayTestWorld scene;
+	btAlignedObjectArray<btVector3> rayFrom, rayTo;
+	createRays(rayFrom, rayTo);
+	const int numRays = rayFrom.size();
+
+	btAlignedObjectArray<btScalar> hitFractions;
+	btAlignedObjectArray<const btCollisionObject*> hitObjects;
+	btAlignedObjectArray<btVector3> hitNormals;
+	hitFractions.resize(numRays);
+	hitObjects.resize(numRays);
+	hitNormals.resize(numRays);
+	btCollisionWorld::RayTestBatchResults results;
+	results.m_hitFractions = &hitFractions[0];
+	results.m_collisionObjects = &hitObjects[0];
+	results.m_hitNormalWorld = &hitNormals[0];
+	scene.m_world.rayTestBatch(&rayFrom[0], &rayTo[0], numRays, results);
+
+	int numHits = 0;
+	for (int i = 0; i < numRays; i++)
+	{
+		btCollisionWorld::ClosestRayResultCallback cb(rayFrom[i], rayTo[i]);
+		scene.m_world.rayTest(rayFrom[i], rayTo[i], cb);
+		EXPECT_EQ(cb.m_collisionObject, hitObjects[i]) << "ray " << i;
+		EXPECT_NEAR(cb.m_closestHitFraction, hitFractions[i], 1e-5f) << "ray " << i;
+		if (cb.hasHit() && cb.m_collisionObject == hitObjects[i])
+		{
+			EXPECT_NEAR(0.f, (cb.m_hitNormalWorld - hitNormals[i]).length(), 1e-4f) << "ray " << i;
+			numHits++;
+		}
+	}
+	// most rays hit the meshes, the test would be meaningless otherwise
+	EXPECT_GT(numHits, numRays / 2);
+}
+
+GTEST_TEST(BulletCollision, RayTestPacketReportsAllHits)
+{
+	RayTestWorld scene;
+	btAlignedObjectArray<btVector3> rayFrom, rayTo;
+	createRays(rayFrom, rayTo);
+	const int numRays = 64;
+
+	btAlignedObjectArray<btCollisionWorld::AllHitsRayResultCallback> callbacks;
+	btAlignedObjectArray<btCollisionWorld::RayResultCallback*> callbackPtrs;
+	callbacks.reserve(numRays);
+	for (int i = 0; i < numRays; i++)
+	{
+		int r = 1000 + i * 7;
+		callbacks.push_back(btCollisionWorld::AllHitsRayResultCallback(rayFrom[r], rayTo[r]));
+	}
+	btAlignedObjectArray<btVector3> packetFrom, packetTo;
+	for (int i = 0; i < numRays; i++)
+	{
+		packetFrom.push_back(rayFrom[1000 + i * 7]);
+		packetTo.push_back(rayTo[1000 + i * 7]);
+		callbackPtrs.push_back(&callbacks[i]);
+	}
+	scene.m_world.rayTestPacket(&packetFrom[0], &packetTo[0], &callbackPtrs[0], numRays);
+
+	for (int i = 0; i < numRays; i++)
+	{
+		btCollisionWorld::AllHitsRayResultCallback cb(packetFrom[i], packetTo[i]);
+		scene.m_world.rayTest(packetFrom[i], packetTo[i], cb);
+		// the packet reports mesh hits after the other hits, so compare the sets
+		ASSERT_EQ(cb.m_hitFractions.size(), callbacks[i].m_hitFractions.size()) << "ray " << i;
+		for (int h = 0; h < cb.m_hitFractions.size(); h++)
+		{
+			bool found = false;
+			for (int k = 0; k < callbacks[i].m_hitFractions.size(); k++)
+			{
+				if (callbacks[i].m_collisionObjects[k] == cb.m_collisionObjects[h] &&
+					btFabs(callbacks[i].m_hitFractions[k] - cb.m_hitFractions[h]) < 1e-5f)
+				{
+					found = true;
+				}
+			}
+			EXPECT_TRUE(found) << "ray " << i << " hit " << h;
+		}
+	}
+}
+
+// a heightfield with hills and a few steps, tested with the cell walk queries and with processAllTriangles
+struct TerrainWorld
+{
+	enum
+	{
+		NUM_STICKS = 65
+	};
+	btDefaultCollisionConfiguration m_config;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btCollisionWorld m_world;
+	btAlignedObjectArray<btScalar> m_heights;
+	btHeightfieldTerrainShape* m_shape;
+	btCollisionObject m_object;
+	btVector3 m_scaling;
+
+	TerrainWorld(bool flipQuadEdges, bool useDiamondSubdivision, bool useAccelerator)
+		: m_dispatcher(&m_config),
+		  m_world(&m_dispatcher, &m_broadphase, &m_config),
+		  m_scaling(0.75f, 1.f, 1.25f)
+	{
+		for (int j = 0; j < NUM_STICKS; j++)
+		{
+			for (int i = 0; i < NUM_STICKS; i++)
+			{
+				btScalar h = 2.f * btSin(i * 0.3f) * btCos(j * 0.2f);
+				if ((i / 8 + j / 8) % 3 == 0)
+					h += 1.5f;
+				m_heights.push_back(h);
+			}
+		}
+		m_shape = new btHeightfieldTerrainShape(NUM_STICKS, NUM_STICKS, &m_heights[0], 1.f, -4.f, 4.f, 1, PHY_FLOAT, flipQuadEdges);
+		m_shape->setUseDiamondSubdivision(useDiamondSubdivision);
+		m_shape->setLocalScaling(m_scaling);
+		if (useAccelerator)
+			m_shape->buildAccelerator(8);
+		m_object.setCollisionShape(m_shape);
+		m_world.addCollisionObject(&m_object);
+		m_world.updateAabbs();
+	}
+	~TerrainWorld()
+	{
+		m_world.removeCollisionObject(&m_object);
+		delete m_shape;
+	}
+	// world position of the grid point (i,j) at height y
+	btVector3 gridPoint(btScalar i, btScalar j, btScalar y) const
+	{
+		const btScalar half = btScalar(NUM_STICKS - 1) * 0.5f;
+		return btVector3((i - half) * m_scaling.x(), y, (j - half) * m_scaling.z());
+	}
+};
+
+static void createTerrainRays(const TerrainWorld& terrain, btAlignedObjectArray<btVector3>& rayFrom, btAlignedObjectArray<btVector3>& rayTo, btAlignedObjectArray<bool>& onEdge)
+{
+	// vertical rays through grid points, along cell edges and on both cell diagonals
+	for (int j = 1; j < 63; j += 3)
+	{
+		for (int i = 1; i < 63; i += 5)
+		{
+			const btScalar offsets[5][2] = {{0, 0}, {0, 0.5f}, {0.5f, 0}, {0.3f, 0.3f}, {0.3f, 0.7f}};
+			for (int k = 0; k < 5; k++)
+			{
+				rayFrom.push_back(terrain.gridPoint(i + offsets[k][0], j + offsets[k][1], 10));
+				rayTo.push_back(terrain.gridPoint(i + offsets[k][0], j + offsets[k][1], -10));
+				onEdge.push_back(true);
+			}
+		}
+	}
+	// low rays along the grid lines, across the steps and hills
+	for (int i = 0; i < 64; i += 7)
+	{
+		rayFrom.push_back(terrain.gridPoint(btScalar(i), -5, 4));
+		rayTo.push_back(terrain.gridPoint(btScalar(i), 70, -1));
+		onEdge.push_back(true);
+		rayFrom.push_back(terrain.gridPoint(-5, btScalar(i), 3.5f));
+		rayTo.push_back(terrain.gridPoint(70, btScalar(i), 0.5f));
+		onEdge.push_back(true);
+	}
+	// random rays, including rays from below the terrain, rays starting outside of it and grazing rays
+	srand(1234);
+	for (int i = 0; i < 2000; i++)
+	{
+		btVector3 from = terrain.gridPoint(btScalar(rand() % 900) * 0.1f - 10, btScalar(rand() % 900) * 0.1f - 10, btScalar(rand() % 140) * 0.1f - 6);
+		btVector3 to = terrain.gridPoint(btScalar(rand() % 900) * 0.1f - 10, btScalar(rand() % 900) * 0.1f - 10, btScalar(rand() % 140) * 0.1f - 7);
+		rayFrom.push_back(from);
+		rayTo.push_back(to);
+		onEdge.push_back(false);
+	}
+}
+
+static void testTerrainRays(bool flipQuadEdges, bool useDiamondSubdivision, bool useAccelerator)
+{
+	TerrainWorld terrain(flipQuadEdges, useDiamondSubdivision, useAccelerator);
+	btAlignedObjectArray<btVector3> rayFrom, rayTo;
+	btAlignedObjectArray<bool> onEdge;
+	createTerrainRays(terrain, rayFrom, rayTo, onEdge);
+
+	int numHits = 0;
+	for (int i = 0; i < rayFrom.size(); i++)
+	{
+		btCollisionWorld::ClosestRayResultCallback cellWalk(rayFrom[i], rayTo[i]);
+		terrain.m_shape->setUseCellWalk(true);
+		terrain.m_world.rayTest(rayFrom[i], rayTo[i], cellWalk);
+
+		btCollisionWorld::ClosestRayResultCallback allTriangles(rayFrom[i], rayTo[i]);
+		terrain.m_shape->setUseCellWalk(false);
+		terrain.m_world.rayTest(rayFrom[i], rayTo[i], allTriangles);
+
+		ASSERT_EQ(allTriangles.hasHit(), cellWalk.hasHit()) << "ray " << i;
+		EXPECT_NEAR(allTriangles.m_closestHitFraction, cellWalk.m_closestHitFraction, 1e-5f) << "ray " << i;
+		// a ray through an edge may report either triangle
+		if (allTriangles.hasHit() && !onEdge[i])
+		{
+			EXPECT_NEAR(0.f, (allTriangles.m_hitNormalWorld - cellWalk.m_hitNormalWorld).length(), 1e-4f) << "ray " << i;
+		}
+		numHits += allTriangles.hasHit() ? 1 : 0;
+	}
+	EXPECT_GT(numHits, rayFrom.size() / 3);
+}
+
+GTEST_TEST(BulletCollision, TerrainRaycastMatchesAllTriangles)
+{
+	testTerrainRays(false, false, false);
+	testTerrainRays(true, false, false);
+	testTerrainRays(false, true, false);
+	testTerrainRays(false, false, true);
+	testTerrainRays(true, false, true);
+}
+
+GTEST_TEST(BulletCollision, TerrainConvexSweepMatchesAllTriangles)
+{
+	const bool flipQuadEdges[2] = {false, true};
+	for (int f = 0; f < 2; f++)
+	{
+		TerrainWorld terrain(flipQuadEdges[f], false, true);
+		btSphereShape sphere(0.4f);
+		btBoxShape box(btVector3(0.3f, 0.5f, 0.2f));
+		btAlignedObjectArray<btVector3> rayFrom, rayTo;
+		btAlignedObjectArray<bool> onEdge;
+		createTerrainRays(terrain, rayFrom, rayTo, onEdge);
+
+		int numHits = 0;
+		for (int i = 0; i < rayFrom.size(); i += 3)
+		{
+			const btConvexShape* castShape = (i % 2) ? (const btConvexShape*)&box : (const btConvexShape*)&sphere;
+			btTransform from, to;
+			from.setIdentity();
+			from.setOrigin(rayFrom[i]);
+			to.setIdentity();
+			to.setOrigin(rayTo[i]);
+			to.setRotation(btQuaternion(btVector3(0, 1, 0), 0.5f));
+
+			btCollisionWorld::ClosestConvexResultCallback cellWalk(rayFrom[i], rayTo[i]);
+			terrain.m_shape->setUseCellWalk(true);
+			terrain.m_world.convexSweepTest(castShape, from, to, cellWalk);
+
+			btCollisionWorld::ClosestConvexResultCallback allTriangles(rayFrom[i], rayTo[i]);
+			terrain.m_shape->setUseCellWalk(false);
+			terrain.m_world.convexSweepTest(castShape, from, to, allTriangles);
+
+			ASSERT_EQ(allTriangles.hasHit(), cellWalk.hasHit()) << "sweep " << i;
+			EXPECT_NEAR(allTriangles.m_closestHitFraction, cellWalk.m_closestHitFraction, 1e-4f) << "sweep " << i;
+			numHits += allTriangles.hasHit() ? 1 : 0;
+		}
+		EXPECT_GT(numHits, 100);
+	}
+}
+
+// reports the heightfield triangles one at a time and without culling, as processAllTriangles did before the batches and the quadtree
+class UnculledTerrainShape : public btConcaveShape
+{
+	struct SingleTriangleCallback : public btTriangleCallback
+	{
+		btTriangleCallback* m_callback;
+		virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+		{
+			m_callback->processTriangle(triangle, partId, triangleIndex);
+		}
+	};
+	const btHeightfieldTerrainShape* m_terrain;
+
+public:
+	UnculledTerrainShape(const btHeightfieldTerrainShape* terrain)
+		: m_terrain(terrain)
+	{
+		// a concave shape type that the collision algorithms do not special-case
+		m_shapeType = FAST_CONCAVE_MESH_PROXYTYPE;
+	}
+	virtual void processAllTriangles(btTriangleCallback* callback, const btVector3& aabbMin, const btVector3& aabbMax) const
+	{
+		SingleTriangleCallback single;
+		single.m_callback = callback;
+		btVector3 terrainMin, terrainMax;
+		btTransform tr;
+		tr.setIdentity();
+		m_terrain->getAabb(tr, terrainMin, terrainMax);
+		m_terrain->processAllTriangles(&single, terrainMin - btVector3(1, 1, 1), terrainMax + btVector3(1, 1, 1));
+	}
+	virtual void getAabb(const btTransform& t, btVector3& aabbMin, btVector3& aabbMax) const
+	{
+		m_terrain->getAabb(t, aabbMin, aabbMax);
+	}
+	virtual void setLocalScaling(const btVector3& scaling) {}
+	virtual const btVector3& getLocalScaling() const { return m_terrain->getLocalScaling(); }
+	virtual void calculateLocalInertia(btScalar mass, btVector3& inertia) const { inertia.setZero(); }
+	virtual const char* getName() const { return "UnculledTerrain"; }
+};
+
+struct TerrainContact
+{
+	int m_triangleIndex;
+	btVector3 m_position;
+	btVector3 m_normal;
+	btScalar m_distance;
+};
+
+static bool operator<(const TerrainContact& a, const TerrainContact& b)
+{
+	if (a.m_triangleIndex != b.m_triangleIndex)
+		return a.m_triangleIndex < b.m_triangleIndex;
+	for (int i = 0; i < 3; i++)
+	{
+		if (a.m_position[i] != b.m_position[i])
+			return a.m_position[i] < b.m_position[i];
+	}
+	return a.m_distance < b.m_distance;
+}
+
+struct TerrainContactCallback : public btCollisionWorld::ContactResultCallback
+{
+	const btCollisionObject* m_terrainObject;
+	std::vector<TerrainContact> m_contacts;
+
+	virtual btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0, int index0, const btCollisionObjectWrapper* colObj1Wrap, int partId1, int index1)
+	{
+		TerrainContact contact;
+		bool terrainIsB = colObj1Wrap->getCollisionObject() == m_terrainObject;
+		contact.m_triangleIndex = terrainIsB ? index1 : index0;
+		contact.m_position = terrainIsB ? cp.m_positionWorldOnB : cp.m_positionWorldOnA;
+		contact.m_normal = terrainIsB ? cp.m_normalWorldOnB : -cp.m_normalWorldOnB;
+		contact.m_distance = cp.getDistance();
+		m_contacts.push_back(contact);
+		return 0;
+	}
+};
+
+static void testTerrainContacts(bool flipQuadEdges, bool useDiamondSubdivision, bool useAccelerator)
+{
+	TerrainWorld terrain(flipQuadEdges, useDiamondSubdivision, useAccelerator);
+	UnculledTerrainShape unculledShape(terrain.m_shape);
+	btCollisionObject unculledObject;
+	unculledObject.setCollisionShape(&unculledShape);
+	terrain.m_world.addCollisionObject(&unculledObject);
+
+	btSphereShape sphere(0.6f);
+	btBoxShape box(btVector3(1.5f, 0.4f, 0.9f));
+	btCapsuleShape capsule(0.3f, 4.f);
+	btConvexShape* shapes[3] = {&sphere, &box, &capsule};
+
+	int numContacts = 0;
+	srand(4321);
+	for (int i = 0; i < 300; i++)
+	{
+		// place the query object around the terrain surface, so that it touches a few cells
+		btScalar x = btScalar(rand() % 6000) * 0.01f + 1;
+		btScalar z = btScalar(rand() % 6000) * 0.01f + 1;
+		btVector3 pos = terrain.gridPoint(x, z, 0);
+		btScalar height = terrain.m_heights[int(z) * TerrainWorld::NUM_STICKS + int(x)];
+		pos.setY(height + btScalar(rand() % 100) * 0.01f - 0.7f);
+		btCollisionObject query;
+		query.setCollisionShape(shapes[i % 3]);
+		query.getWorldTransform().setOrigin(pos);
+		query.getWorldTransform().setRotation(btQuaternion(btVector3(1, 2, 3).normalized(), i * 0.37f));
+
+		TerrainContactCallback culled;
+		culled.m_terrainObject = &terrain.m_object;
+		terrain.m_world.contactPairTest(&query, &terrain.m_object, culled);
+
+		TerrainContactCallback unculled;
+		unculled.m_terrainObject = &unculledObject;
+		terrain.m_world.contactPairTest(&query, &unculledObject, unculled);
+
+		// batches and chunks may report the triangles in a different order
+		std::sort(culled.m_contacts.begin(), culled.m_contacts.end());
+		std::sort(unculled.m_contacts.begin(), unculled.m_contacts.end());
+		ASSERT_EQ(unculled.m_contacts.size(), culled.m_contacts.size()) << "query " << i;
+		for (size_t c = 0; c < culled.m_contacts.size(); c++)
+		{
+			EXPECT_EQ(unculled.m_contacts[c].m_triangleIndex, culled.m_contacts[c].m_triangleIndex);
+			EXPECT_EQ(unculled.m_contacts[c].m_position, culled.m_contacts[c].m_position);
+			EXPECT_EQ(unculled.m_contacts[c].m_normal, culled.m_contacts[c].m_normal);
+			EXPECT_EQ(unculled.m_contacts[c].m_distance, culled.m_contacts[c].m_distance);
+		}
+		numContacts += int(culled.m_contacts.size());
+	}
+	EXPECT_GT(numContacts, 300);
+	terrain.m_world.removeCollisionObject(&unculledObject);
+}
+
+GTEST_TEST(BulletCollision, TerrainContactsMatchUnculledTriangles)
+{
+	testTerrainContacts(false, false, false);
+	testTerrainContacts(true, false, false);
+	testTerrainContacts(false, true, false);
+	testTerrainContacts(false, false, true);
+	testTerrainContacts(true, true, true);
+}
+
+// a stack of convex hulls resting on a box, collided with the separating axis test
+struct SatStackWorld
+{
+	// resets the separating feature caches before each collision detection when m_useFeatureCache is false
+	struct CacheWorld : public btDiscreteDynamicsWorld
+	{
+		bool m_useFeatureCache;
+
+		CacheWorld(btDispatcher* dispatcher, btBroadphaseInterface* broadphase, btConstraintSolver* solver, btCollisionConfiguration* collisionConfiguration)
+			: btDiscreteDynamicsWorld(dispatcher, broadphase, solver, collisionConfiguration),
+			  m_useFeatureCache(true)
+		{
+		}
+		virtual void performDiscreteCollisionDetection()
+		{
+			btBroadphasePairArray& pairs = getPairCache()->getOverlappingPairArray();
+			for (int i = 0; i < pairs.size() && !m_useFeatureCache; i++)
+			{
+				btConvexConvexAlgorithm* algorithm = dynamic_cast<btConvexConvexAlgorithm*>(pairs[i].m_algorithm);
+				if (algorithm)
+					algorithm->getSeparatingFeatureCache().reset();
+			}
+			btDiscreteDynamicsWorld::performDiscreteCollisionDetection();
+		}
+	};
+
+	btDefaultCollisionConfiguration m_config;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btSequentialImpulseConstraintSolver m_solver;
+	CacheWorld m_world;
+	btBoxShape m_groundShape;
+	btConvexHullShape m_hull;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+
+	SatStackWorld(bool useFeatureCache, btScalar featureCacheTolerance)
+		: m_dispatcher(&m_config),
+		  m_world(&m_dispatcher, &m_broadphase, &m_solver, &m_config),
+		  m_groundShape(btVector3(20, 1, 20))
+	{
+		m_world.m_useFeatureCache = useFeatureCache;
+		m_world.getDispatchInfo().m_enableSatConvex = true;
+		m_world.getDispatchInfo().m_satFeatureCacheTolerance = featureCacheTolerance;
+		m_groundShape.initializePolyhedralFeatures();
+		btTransform tr;
+		tr.setIdentity();
+		tr.setOrigin(btVector3(0, -1, 0));
+		addBody(0, &m_groundShape, tr);
+
+		for (int i = 0; i < 12; i++)
+		{
+			btScalar angle = SIMD_2_PI * i / 12;
+			m_hull.addPoint(btVector3(0.5f * btCos(angle), -0.25f, 0.5f * btSin(angle)), false);
+			m_hull.addPoint(btVector3(0.4f * btCos(angle + 0.2f), 0.25f, 0.4f * btSin(angle + 0.2f)), false);
+		}
+		m_hull.recalcLocalAabb();
+		m_hull.initializePolyhedralFeatures();
+		for (int i = 0; i < 8; i++)
+		{
+			tr.setIdentity();
+			tr.setOrigin(btVector3((i % 2) * 1.2f, 0.3f + (i / 2) * 0.52f, 0));
+			tr.setRotation(btQuaternion(btVector3(0, 1, 0), 0.3f * i));
+			addBody(1, &m_hull, tr);
+		}
+	}
+	~SatStackWorld()
+	{
+		for (int i = 0; i < m_bodies.size(); i++)
+		{
+			m_world.removeRigidBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+	}
+	void addBody(btScalar mass, btCollisionShape* shape, const btTransform& tr)
+	{
+		btVector3 inertia(0, 0, 0);
+		if (mass > 0)
+			shape->calculateLocalInertia(mass, inertia);
+		btRigidBody* body = new btRigidBody(mass, 0, shape, inertia);
+		body->setWorldTransform(tr);
+		m_world.addRigidBody(body);
+		m_bodies.push_back(body);
+	}
+};
+
+GTEST_TEST(BulletCollision, SatFeatureCacheKeepsContacts)
+{
+	SatStackWorld uncached(false, 0);
+	SatStackWorld cached(true, 0);
+	SatStackWorld coherent(true, 0.02f);
+	for (int step = 0; step < 240; step++)
+	{
+		uncached.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		cached.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		coherent.m_world.stepSimulation(btScalar(1. / 60.), 0);
+
+		// without tolerance the cache only speeds up the test, the contacts are the same
+		ASSERT_EQ(uncached.m_dispatcher.getNumManifolds(), cached.m_dispatcher.getNumManifolds()) << "step " << step;
+		for (int m = 0; m < uncached.m_dispatcher.getNumManifolds(); m++)
+		{
+			const btPersistentManifold* a = uncached.m_dispatcher.getManifoldByIndexInternal(m);
+			const btPersistentManifold* b = cached.m_dispatcher.getManifoldByIndexInternal(m);
+			ASSERT_EQ(a->getNumContacts(), b->getNumContacts()) << "step " << step;
+			for (int p = 0; p < a->getNumContacts(); p++)
+			{
+				EXPECT_EQ(a->getContactPoint(p).m_positionWorldOnB, b->getContactPoint(p).m_positionWorldOnB);
+				EXPECT_EQ(a->getContactPoint(p).m_normalWorldOnB, b->getContactPoint(p).m_normalWorldOnB);
+				EXPECT_EQ(a->getContactPoint(p).getDistance(), b->getContactPoint(p).getDistance());
+			}
+		}
+	}
+	for (int i = 0; i < uncached.m_bodies.size(); i++)
+	{
+		EXPECT_EQ(uncached.m_bodies[i]->getWorldTransform().getOrigin(), cached.m_bodies[i]->getWorldTransform().getOrigin());
+		// reusing the feature of slowly moving hulls keeps the stack at rest
+		EXPECT_NEAR(0, (uncached.m_bodies[i]->getWorldTransform().getOrigin() - coherent.m_bodies[i]->getWorldTransform().getOrigin()).length(), 0.02f);
+	}
+}
+
+// a plate of 4x4 boxes resting on a ground of 4x4 boxes, both compound shapes
+struct CompoundPlateWorld
+{
+	btDefaultCollisionConfiguration m_config;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btSequentialImpulseConstraintSolver m_solver;
+	btDiscreteDynamicsWorld m_world;
+	btBoxShape m_groundBox;
+	btBoxShape m_plateBox;
+	btCompoundShape m_groundShape;
+	btCompoundShape m_plateShape;
+	btRigidBody* m_ground;
+	btRigidBody* m_plate;
+
+	CompoundPlateWorld(bool reduceContacts, const btTransform& plateTransform)
+		: m_dispatcher(&m_config),
+		  m_world(&m_dispatcher, &m_broadphase, &m_solver, &m_config),
+		  m_groundBox(btVector3(2, 0.5f, 2)),
+		  m_plateBox(btVector3(0.25f, 0.1f, 0.25f))
+	{
+		m_world.getDispatchInfo().m_reduceCompoundCompoundContacts = reduceContacts;
+		btTransform tr;
+		tr.setIdentity();
+		for (int i = 0; i < 16; i++)
+		{
+			tr.setOrigin(btVector3((i % 4) * 4 - 6.f, -0.5f, (i / 4) * 4 - 6.f));
+			m_groundShape.addChildShape(tr, &m_groundBox);
+			tr.setOrigin(btVector3((i % 4) * 0.5f - 0.75f, 0, (i / 4) * 0.5f - 0.75f));
+			m_plateShape.addChildShape(tr, &m_plateBox);
+		}
+		m_ground = new btRigidBody(0, 0, &m_groundShape);
+		m_world.addRigidBody(m_ground);
+		btVector3 inertia;
+		m_plateShape.calculateLocalInertia(1, inertia);
+		m_plate = new btRigidBody(1, 0, &m_plateShape, inertia);
+		m_plate->setWorldTransform(plateTransform);
+		m_world.addRigidBody(m_plate);
+	}
+	~CompoundPlateWorld()
+	{
+		m_world.removeRigidBody(m_plate);
+		m_world.removeRigidBody(m_ground);
+		delete m_plate;
+		delete m_ground;
+	}
+};
+
+static int gNumManifoldsStarted;
+static int gNumManifoldsEnded;
+static int gNumUserDataCreated;
+static int gNumUserDataDestroyed;
+static btCollisionDispatcher* gCallbackDispatcher;
+
+static bool isDispatcherManifold(btPersistentManifold* manifold)
+{
+	for (int i = 0; i < gCallbackDispatcher->getNumManifolds(); i++)
+	{
+		if (gCallbackDispatcher->getManifoldByIndexInternal(i) == manifold)
+			return true;
+	}
+	return false;
+}
+
+static void countManifoldStarted(btPersistentManifold* const& manifold)
+{
+	EXPECT_TRUE(isDispatcherManifold(manifold));
+	gNumManifoldsStarted++;
+}
+
+static void countManifoldEnded(btPersistentManifold* const& manifold)
+{
+	EXPECT_TRUE(isDispatcherManifold(manifold));
+	gNumManifoldsEnded++;
+}
+
+static bool createUserData(btManifoldPoint& cp, void* body0, void* body1)
+{
+	if (!cp.m_userPersistentData)
+	{
+		cp.m_userPersistentData = &gNumUserDataCreated;
+		gNumUserDataCreated++;
+	}
+	return false;
+}
+
+static bool destroyUserData(void* userPersistentData)
+{
+	EXPECT_EQ(userPersistentData, &gNumUserDataCreated);
+	gNumUserDataDestroyed++;
+	return false;
+}
+
+GTEST_TEST(BulletCollision, CompoundContactReductionKeepsSupport)
+{
+	// a tilted plate touches the ground with one row of boxes
+	btTransform tr(btQuaternion(btVector3(1, 0, 0), 0.05f), btVector3(0.3f, 0.12f, -0.2f));
+	CompoundPlateWorld full(false, tr);
+	CompoundPlateWorld reduced(true, tr);
+	full.m_world.performDiscreteCollisionDetection();
+	reduced.m_world.performDiscreteCollisionDetection();
+
+	btScalar fullMinDistance = BT_LARGE_FLOAT;
+	btVector3 fullMin(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+	btVector3 fullMax(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+	int numFullContacts = 0;
+	for (int m = 0; m < full.m_dispatcher.getNumManifolds(); m++)
+	{
+		const btPersistentManifold* manifold = full.m_dispatcher.getManifoldByIndexInternal(m);
+		for (int p = 0; p < manifold->getNumContacts(); p++)
+		{
+			const btManifoldPoint& pt = manifold->getContactPoint(p);
+			fullMinDistance = btMin(fullMinDistance, pt.getDistance());
+			fullMin.setMin(pt.m_positionWorldOnB);
+			fullMax.setMax(pt.m_positionWorldOnB);
+			numFullContacts++;
+		}
+	}
+	ASSERT_GT(numFullContacts, 4);
+
+	// a single bounded manifold keeps the deepest contact and the extent of the support polygon
+	ASSERT_EQ(1, reduced.m_dispatcher.getNumManifolds());
+	const btPersistentManifold* manifold = reduced.m_dispatcher.getManifoldByIndexInternal(0);
+	ASSERT_EQ(4, manifold->getNumContacts());
+	btScalar reducedMinDistance = BT_LARGE_FLOAT;
+	btVector3 reducedMin(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+	btVector3 reducedMax(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+	for (int p = 0; p < manifold->getNumContacts(); p++)
+	{
+		const btManifoldPoint& pt = manifold->getContactPoint(p);
+		reducedMinDistance = btMin(reducedMinDistance, pt.getDistance());
+		reducedMin.setMin(pt.m_positionWorldOnB);
+		reducedMax.setMax(pt.m_positionWorldOnB);
+	}
+	EXPECT_NEAR(fullMinDistance, reducedMinDistance, 1e-5f);
+	EXPECT_NEAR(fullMin.x(), reducedMin.x(), 1e-5f);
+	EXPECT_NEAR(fullMin.z(), reducedMin.z(), 1e-5f);
+	EXPECT_NEAR(fullMax.x(), reducedMax.x(), 1e-5f);
+	EXPECT_NEAR(fullMax.z(), reducedMax.z(), 1e-5f);
+}
+
+GTEST_TEST(BulletCollision, CompoundContactReductionIsPersistent)
+{
+	btTransform tr(btQuaternion::getIdentity(), btVector3(0.3f, 0.2f, -0.2f));
+	CompoundPlateWorld full(false, tr);
+	CompoundPlateWorld reduced(true, tr);
+	gCallbackDispatcher = &reduced.m_dispatcher;
+	gNumManifoldsStarted = 0;
+	gNumManifoldsEnded = 0;
+	gNumUserDataCreated = 0;
+	gNumUserDataDestroyed = 0;
+	gContactStartedCallback = countManifoldStarted;
+	gContactEndedCallback = countManifoldEnded;
+	gContactProcessedCallback = createUserData;
+	gContactDestroyedCallback = destroyUserData;
+	for (int step = 0; step < 120; step++)
+	{
+		reduced.m_world.stepSimulation(btScalar(1. / 60.), 0);
+	}
+	// the plate lands once and stays in contact, so the manifold starts once, never ends and keeps its user data
+	EXPECT_EQ(1, gNumManifoldsStarted);
+	EXPECT_EQ(0, gNumManifoldsEnded);
+	ASSERT_EQ(1, reduced.m_dispatcher.getNumManifolds());
+	const btPersistentManifold* manifold = reduced.m_dispatcher.getManifoldByIndexInternal(0);
+	EXPECT_EQ(4, manifold->getNumContacts());
+	EXPECT_EQ(manifold->getNumContacts(), gNumUserDataCreated - gNumUserDataDestroyed);
+	EXPECT_LE(gNumUserDataCreated, 8);
+	gContactStartedCallback = 0;
+	gContactEndedCallback = 0;
+	gContactProcessedCallback = 0;
+
+	// the reduced contacts support the plate like the full set
+	for (int step = 0; step < 120; step++)
+	{
+		full.m_world.stepSimulation(btScalar(1. / 60.), 0);
+	}
+	EXPECT_NEAR(0, (full.m_plate->getWorldTransform().getOrigin() - reduced.m_plate->getWorldTransform().getOrigin()).length(), 0.01f);
+	EXPECT_NEAR(0, full.m_plate->getLinearVelocity().length(), 0.01f);
+	EXPECT_NEAR(0, reduced.m_plate->getLinearVelocity().length(), 0.01f);
+
+	reduced.m_world.removeRigidBody(reduced.m_plate);
+	EXPECT_EQ(gNumUserDataCreated, gNumUserDataDestroyed);
+	reduced.m_world.addRigidBody(reduced.m_plate);
+	gContactDestroyedCallback = 0;
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+#if BT_THREADSAFE
+	// rayTestBatch uses btParallelFor
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+#endif
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+
+#include "BroadphaseTestScene.h"
+#include "ReverseOrderTaskScheduler.h"
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphaseMt.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+// moves random proxies for several frames, queries the broadphases between setAabb and
+// calculateOverlappingPairs, when btDbvtBroadphaseMt has to refit first, and again after the pairs are found
+static void moveAndCompare(BroadphaseTestScene& scene, int numFrames)
+{
+	const btScalar extent = 20;
+	for (int i = 0; i < 400; i++)
+	{
+		scene.addRandomProxy(extent, 0.2f, i % 20 ? 1.5f : 6.f);
+	}
+	scene.calculateOverlappingPairs();
+	scene.expectSamePairs();
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		scene.moveProxies(0.7f, 0.5f, 0.02f);
+		scene.expectSameQueries(extent, 10);
+		scene.calculateOverlappingPairs();
+		scene.expectSamePairs();
+		scene.expectSameQueries(extent, 10);
+	}
+}
+
+static void addBroadphases(BroadphaseTestScene& scene)
+{
+	scene.addBroadphase(new btDbvtBroadphase(), false);
+	scene.addBroadphase(new btDbvtBroadphaseMt(), false);
+	// few large tasks
+	btDbvtBroadphaseMt* broadphase = new btDbvtBroadphaseMt();
+	broadphase->m_numTasks = 3;
+	scene.addBroadphase(broadphase, false);
+}
+
+GTEST_TEST(BulletCollision, DbvtBroadphaseMtMatchesDbvtBroadphase)
+{
+	BroadphaseTestScene scene;
+	addBroadphases(scene);
+	moveAndCompare(scene, 20);
+}
+
+GTEST_TEST(BulletCollision, DbvtBroadphaseMtWithTaskSchedulerMatchesDbvtBroadphase)
+{
+#if BT_THREADSAFE
+	ReverseOrderTaskScheduler reverseOrderScheduler;
+	btSetTaskScheduler(&reverseOrderScheduler);
+	{
+		BroadphaseTestScene scene;
+		addBroadphases(scene);
+		moveAndCompare(scene, 20);
+	}
+	EXPECT_GT(reverseOrderScheduler.m_numParallelLoops, 0);
+
+	btITaskScheduler* threadedScheduler = btCreateDefaultTaskScheduler();
+	if (threadedScheduler)
+	{
+		threadedScheduler->setNumThreads(4);
+		btSetTaskScheduler(threadedScheduler);
+		{
+			BroadphaseTestScene scene;
+			addBroadphases(scene);
+			moveAndCompare(scene, 20);
+		}
+		btSetTaskScheduler(btGetSequentialTaskScheduler());
+		delete threadedScheduler;
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+#else
+	printf("BT_THREADSAFE is off, skipping the task scheduler test\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
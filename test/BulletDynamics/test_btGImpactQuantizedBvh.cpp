@@ -0,0 +1,290 @@
+
+#include "DeformingSheet.h"
+#include "ReverseOrderTaskScheduler.h"
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/Gimpact/btGImpactShape.h>
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <stdio.h>
+
+// runs find_collision with the parallel traversal, in BT_THREADSAFE builds with a task scheduler, or the recursive one
+static void findPairs(const btGImpactBoxSet* boxset0, const btTransform& trans0,
+					  const btGImpactBoxSet* boxset1, const btTransform& trans1,
+					  bool parallel, btPairSet& pairs)
+{
+	int minimumNodes = btGImpactQuantizedBvh::s_minimumNodesForParallelLoops;
+	btGImpactQuantizedBvh::s_minimumNodesForParallelLoops = parallel ? 0 : INT_MAX;
+	pairs.resize(0);
+	btGImpactQuantizedBvh::find_collision(boxset0, trans0, boxset1, trans1, pairs);
+	btGImpactQuantizedBvh::s_minimumNodesForParallelLoops = minimumNodes;
+}
+
+// the parallel traversal has to find the same triangle pairs in the same order, returns the number of pairs
+static int expectSamePairs(const btGImpactBoxSet* boxset0, const btTransform& trans0,
+						   const btGImpactBoxSet* boxset1, const btTransform& trans1)
+{
+	btPairSet serialPairs, parallelPairs;
+	findPairs(boxset0, trans0, boxset1, trans1, false, serialPairs);
+	findPairs(boxset0, trans0, boxset1, trans1, true, parallelPairs);
+	EXPECT_EQ(serialPairs.size(), parallelPairs.size());
+	for (int i = 0; i < btMin(serialPairs.size(), parallelPairs.size()); i++)
+	{
+		if (serialPairs[i].m_index1 != parallelPairs[i].m_index1 || serialPairs[i].m_index2 != parallelPairs[i].m_index2)
+		{
+			ADD_FAILURE() << "pair " << i << " is " << parallelPairs[i].m_index1 << "," << parallelPairs[i].m_index2
+						  << " instead of " << serialPairs[i].m_index1 << "," << serialPairs[i].m_index2;
+			break;
+		}
+	}
+	return serialPairs.size();
+}
+
+// every leaf bound contains its triangle, also after the mesh left the quantization range, and every
+// internal node contains its children
+static void expectBoundsContainPrimitives(const btGImpactMeshShapePart* part)
+{
+	const btScalar tolerance = btScalar(0.01);
+	const btGImpactBoxSet* boxset = part->getBoxSet();
+	// the triangles are only readable while the mesh is locked
+	part->lockChildShapes();
+	for (int node = 0; node < boxset->getNodeCount(); node++)
+	{
+		if (boxset->isLeafNode(node))
+		{
+			btAABB bound, primitiveBox;
+			boxset->getNodeBound(node, bound);
+			boxset->getPrimitiveManager()->get_primitive_box(boxset->getNodeData(node), primitiveBox);
+			for (int i = 0; i < 3; i++)
+			{
+				EXPECT_LE(bound.m_min[i], primitiveBox.m_min[i] + tolerance) << "leaf " << node;
+				EXPECT_GE(bound.m_max[i], primitiveBox.m_max[i] - tolerance) << "leaf " << node;
+			}
+		}
+		else
+		{
+			const BT_QUANTIZED_BVH_NODE* parent = boxset->get_node_pointer(node);
+			const BT_QUANTIZED_BVH_NODE* left = boxset->get_node_pointer(boxset->getLeftNode(node));
+			const BT_QUANTIZED_BVH_NODE* right = boxset->get_node_pointer(boxset->getRightNode(node));
+			for (int i = 0; i < 3; i++)
+			{
+				EXPECT_EQ(btMin(left->m_quantizedAabbMin[i], right->m_quantizedAabbMin[i]), parent->m_quantizedAabbMin[i]) << "node " << node;
+				EXPECT_EQ(btMax(left->m_quantizedAabbMax[i], right->m_quantizedAabbMax[i]), parent->m_quantizedAabbMax[i]) << "node " << node;
+			}
+		}
+	}
+	part->unlockChildShapes();
+}
+
+static void expectSameBox(const btAABB& expected, const btAABB& box)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_EQ(expected.m_min[i], box.m_min[i]);
+		EXPECT_EQ(expected.m_max[i], box.m_max[i]);
+	}
+}
+
+// the sets have the same nodes
+static void expectSameNodes(const btGImpactBoxSet* expected, const btGImpactBoxSet* boxset)
+{
+	ASSERT_EQ(expected->getNodeCount(), boxset->getNodeCount());
+	for (int node = 0; node < expected->getNodeCount(); node++)
+	{
+		const BT_QUANTIZED_BVH_NODE* a = expected->get_node_pointer(node);
+		const BT_QUANTIZED_BVH_NODE* b = boxset->get_node_pointer(node);
+		bool same = a->m_escapeIndexOrDataIndex == b->m_escapeIndexOrDataIndex;
+		for (int i = 0; i < 3; i++)
+		{
+			same = same && a->m_quantizedAabbMin[i] == b->m_quantizedAabbMin[i] && a->m_quantizedAabbMax[i] == b->m_quantizedAabbMax[i];
+		}
+		if (!same)
+		{
+			ADD_FAILURE() << "node " << node << " differs";
+			break;
+		}
+	}
+	expectSameBox(expected->getGlobalBox(), boxset->getGlobalBox());
+}
+
+// refits two shapes of the same mesh, one with the serial and one with the parallel leaf loop, node for node
+static void expectSameRefit(btGImpactMeshShape& serialShape, btGImpactMeshShape& parallelShape)
+{
+	int minimumNodes = btGImpactQuantizedBvh::s_minimumNodesForParallelLoops;
+	btGImpactQuantizedBvh::s_minimumNodesForParallelLoops = INT_MAX;
+	serialShape.postUpdate();
+	serialShape.updateBound();
+	btGImpactQuantizedBvh::s_minimumNodesForParallelLoops = 0;
+	parallelShape.postUpdate();
+	parallelShape.updateBound();
+	btGImpactQuantizedBvh::s_minimumNodesForParallelLoops = minimumNodes;
+
+	expectSameNodes(serialShape.getMeshPart(0)->getBoxSet(), parallelShape.getMeshPart(0)->getBoxSet());
+	expectBoundsContainPrimitives(parallelShape.getMeshPart(0));
+}
+
+static void compareFindCollision()
+{
+	// 7200 and 3200 triangles, more nodes than the default threshold of the parallel traversal
+	DeformingSheet sheet0(60, 30);
+	DeformingSheet sheet1(40, 20);
+	btGImpactMeshShape shape0(sheet0.m_meshInterface);
+	btGImpactMeshShape shape1(sheet1.m_meshInterface);
+	shape0.updateBound();
+	shape1.updateBound();
+	const btGImpactBoxSet* boxset0 = shape0.getMeshPart(0)->getBoxSet();
+	const btGImpactBoxSet* boxset1 = shape1.getMeshPart(0)->getBoxSet();
+
+	int numPairs = 0;
+	for (int frame = 0; frame < 6; frame++)
+	{
+		sheet0.deform(btScalar(0.3) * frame, 1);
+		shape0.postUpdate();
+		shape0.updateBound();
+		btTransform trans0(btQuaternion(btVector3(0, 1, 0), btScalar(0.1) * frame), btVector3(0, 0, 0));
+		// the second sheet crosses the first one at an angle
+		btTransform trans1(btQuaternion(btVector3(1, 0, 1).normalized(), btScalar(0.4) + btScalar(0.2) * frame), btVector3(btScalar(frame), btScalar(0.5), 0));
+		numPairs += expectSamePairs(boxset0, trans0, boxset1, trans1);
+		// lying on top of it
+		numPairs += expectSamePairs(boxset0, trans0, boxset1, btTransform::getIdentity());
+		// and the sheet with itself
+		numPairs += expectSamePairs(boxset0, trans0, boxset0, trans0);
+		// far apart
+		EXPECT_EQ(0, expectSamePairs(boxset0, trans0, boxset1, btTransform(btQuaternion::getIdentity(), btVector3(0, 100, 0))));
+	}
+	EXPECT_GT(numPairs, 1000);
+
+	// a single triangle, the root of its set is a leaf
+	btTriangleIndexVertexArray triangle(1, &sheet1.m_indices[0], 3 * sizeof(int), sheet1.m_vertices.size() / 3, &sheet1.m_vertices[0], 3 * sizeof(btScalar));
+	btGImpactMeshShape triangleShape(&triangle);
+	triangleShape.updateBound();
+	const btGImpactBoxSet* triangleSet = triangleShape.getMeshPart(0)->getBoxSet();
+	// standing upright through the middle of the first sheet
+	btTransform trans1(btQuaternion(btVector3(1, 0, 0), SIMD_HALF_PI), btVector3(btScalar(9.75), btScalar(-9.75), 0));
+	EXPECT_GT(expectSamePairs(boxset0, btTransform::getIdentity(), triangleSet, trans1), 0);
+	EXPECT_GT(expectSamePairs(triangleSet, trans1, boxset0, btTransform::getIdentity()), 0);
+	EXPECT_EQ(1, expectSamePairs(triangleSet, trans1, triangleSet, trans1));
+}
+
+static void compareRefit()
+{
+	DeformingSheet sheet(60, 30);
+	btGImpactMeshShape serialShape(sheet.m_meshInterface);
+	btGImpactMeshShape parallelShape(sheet.m_meshInterface);
+	serialShape.updateBound();
+	parallelShape.updateBound();
+	for (int frame = 1; frame < 6; frame++)
+	{
+		sheet.deform(btScalar(0.3) * frame, 1);
+		expectSameRefit(serialShape, parallelShape);
+	}
+	// out of the quantization range, the sets are rebuilt instead of clamping the leaf bounds
+	sheet.deform(btScalar(0.3), 4);
+	expectSameRefit(serialShape, parallelShape);
+	EXPECT_GT(parallelShape.getMeshPart(0)->getBoxSet()->getGlobalBox().m_max.y(), btScalar(3.));
+	// and back
+	sheet.deform(btScalar(0.6), btScalar(0.5));
+	expectSameRefit(serialShape, parallelShape);
+}
+
+// refits the moved triangles of one shape and all of another shape of the same mesh, node for node
+static void compareRefitTriangles()
+{
+	// a mesh of two parts
+	DeformingSheet sheet0(60, 30);
+	DeformingSheet sheet1(20, 10);
+	btTriangleIndexVertexArray mesh;
+	mesh.addIndexedMesh(sheet0.indexedMesh());
+	mesh.addIndexedMesh(sheet1.indexedMesh());
+	btGImpactMeshShape partialShape(&mesh);
+	btGImpactMeshShape fullShape(&mesh);
+	partialShape.updateBound();
+	fullShape.updateBound();
+
+	int minimumNodes = btGImpactQuantizedBvh::s_minimumNodesForParallelLoops;
+	btAlignedObjectArray<int> movedTriangles;
+	for (int round = 0; round < 12; round++)
+	{
+		int part = round % 3 ? 0 : 1;
+		DeformingSheet& sheet = part ? sheet1 : sheet0;
+		// bumps up and down that stay in the quantization range
+		sheet.bump(btScalar(round % 5 - 2) * sheet.m_size / 5, btScalar(round % 3 - 1) * sheet.m_size / 4,
+				   sheet.m_size / 8, btScalar(round % 2 ? 0.4 : -0.4), movedTriangles);
+		ASSERT_GT(movedTriangles.size(), 0);
+		// with the serial and the parallel leaf loop
+		btGImpactQuantizedBvh::s_minimumNodesForParallelLoops = round % 2 ? 0 : INT_MAX;
+		partialShape.refitTriangles(part, &movedTriangles[0], movedTriangles.size());
+		btGImpactQuantizedBvh::s_minimumNodesForParallelLoops = minimumNodes;
+		fullShape.postUpdate();
+		fullShape.updateBound();
+
+		expectSameNodes(fullShape.getMeshPart(part)->getBoxSet(), partialShape.getMeshPart(part)->getBoxSet());
+		expectBoundsContainPrimitives(partialShape.getMeshPart(part));
+		expectSameBox(fullShape.getLocalBox(), partialShape.getLocalBox());
+	}
+
+	// out of the quantization range, both sets are rebuilt
+	sheet0.bump(0, 0, 3, 5, movedTriangles);
+	partialShape.refitTriangles(0, &movedTriangles[0], movedTriangles.size());
+	fullShape.postUpdate();
+	fullShape.updateBound();
+	expectSameNodes(fullShape.getMeshPart(0)->getBoxSet(), partialShape.getMeshPart(0)->getBoxSet());
+	expectBoundsContainPrimitives(partialShape.getMeshPart(0));
+	EXPECT_GT(partialShape.getLocalBox().m_max.y(), btScalar(4.));
+
+	// and refitting the rebuilt set
+	sheet0.bump(5, 5, 3, btScalar(-0.4), movedTriangles);
+	partialShape.refitTriangles(0, &movedTriangles[0], movedTriangles.size());
+	fullShape.postUpdate();
+	fullShape.updateBound();
+	expectSameNodes(fullShape.getMeshPart(0)->getBoxSet(), partialShape.getMeshPart(0)->getBoxSet());
+	expectBoundsContainPrimitives(partialShape.getMeshPart(0));
+}
+
+GTEST_TEST(BulletCollision, GImpactParallelFindCollisionMatchesSerial)
+{
+	compareFindCollision();
+}
+
+GTEST_TEST(BulletCollision, GImpactParallelRefitMatchesSerial)
+{
+	compareRefit();
+}
+
+GTEST_TEST(BulletCollision, GImpactRefitTrianglesMatchesFullRefit)
+{
+	compareRefitTriangles();
+}
+
+GTEST_TEST(BulletCollision, GImpactWithTaskSchedulerMatchesSerial)
+{
+#if BT_THREADSAFE
+	ReverseOrderTaskScheduler reverseOrderScheduler;
+	btSetTaskScheduler(&reverseOrderScheduler);
+	compareFindCollision();
+	compareRefit();
+	compareRefitTriangles();
+	EXPECT_GT(reverseOrderScheduler.m_numParallelLoops, 0);
+
+	btITaskScheduler* threadedScheduler = btCreateDefaultTaskScheduler();
+	if (threadedScheduler)
+	{
+		threadedScheduler->setNumThreads(4);
+		btSetTaskScheduler(threadedScheduler);
+		compareFindCollision();
+		compareRefit();
+		compareRefitTriangles();
+		btSetTaskScheduler(btGetSequentialTaskScheduler());
+		delete threadedScheduler;
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+#else
+	printf("BT_THREADSAFE is off, skipping the task scheduler test\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+
+#include "BroadphaseTestScene.h"
+#include "ReverseOrderTaskScheduler.h"
+#include <BulletCollision/BroadphaseCollision/btHashedGridBroadphase.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+// proxies for every level of a grid with cells of 1, 2, 4 and 8, and proxies too large for the coarsest cell,
+// queried with rays and boxes long enough to cross cells of all levels
+static void moveAndCompare(BroadphaseTestScene& scene, int numFrames)
+{
+	const btScalar extent = 16;
+	for (int i = 0; i < 500; i++)
+	{
+		switch (i % 10)
+		{
+			case 0:
+				scene.addRandomProxy(extent, 0.5f, 0.9f);
+				break;
+			case 1:
+				scene.addRandomProxy(extent, 1.1f, 1.9f);
+				break;
+			case 2:
+				scene.addRandomProxy(extent, 2.1f, 3.9f);
+				break;
+			default:
+				scene.addRandomProxy(extent, 0.05f, 0.45f);
+				break;
+		}
+	}
+	// huge proxies
+	for (int i = 0; i < 4; i++)
+	{
+		scene.addRandomProxy(extent, 4.5f, 12.f);
+	}
+	scene.addProxy(btVector3(-2 * extent, -extent - 1, -2 * extent), btVector3(2 * extent, -extent, 2 * extent));
+	// proxies exactly at cell borders
+	scene.addProxy(btVector3(-0.5f, -0.5f, -0.5f), btVector3(0.5f, 0.5f, 0.5f));
+	scene.addProxy(btVector3(0, 0, 0), btVector3(1, 1, 1));
+	scene.addProxy(btVector3(-4, -4, -4), btVector3(4, 4, 4));
+
+	scene.calculateOverlappingPairs();
+	scene.expectSamePairs();
+	scene.expectSameQueries(extent, 20);
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		// queries before calculateOverlappingPairs test all proxies, afterwards they walk the grid
+		scene.moveProxies(0.5f, 1.f, 0.02f);
+		scene.expectSameQueries(extent, 5);
+		scene.calculateOverlappingPairs();
+		scene.expectSamePairs();
+		scene.expectSameQueries(extent, 20);
+	}
+}
+
+static void addBroadphases(BroadphaseTestScene& scene)
+{
+	scene.addBroadphase(new btDbvtBroadphase(), false);
+	scene.addBroadphase(new btHashedGridBroadphase(btScalar(1.), 4), true);
+	// a single level, most proxies are huge
+	scene.addBroadphase(new btHashedGridBroadphase(btScalar(0.5), 1), true);
+	btHashedGridBroadphase* broadphase = new btHashedGridBroadphase(btScalar(1.), 4);
+	broadphase->m_grainSize = 7;
+	scene.addBroadphase(broadphase, true);
+}
+
+GTEST_TEST(BulletCollision, HashedGridBroadphaseMatchesDbvtBroadphase)
+{
+	BroadphaseTestScene scene;
+	addBroadphases(scene);
+	moveAndCompare(scene, 10);
+}
+
+GTEST_TEST(BulletCollision, HashedGridBroadphaseWithTaskSchedulerMatchesDbvtBroadphase)
+{
+#if BT_THREADSAFE
+	ReverseOrderTaskScheduler reverseOrderScheduler;
+	btSetTaskScheduler(&reverseOrderScheduler);
+	{
+		BroadphaseTestScene scene;
+		addBroadphases(scene);
+		moveAndCompare(scene, 10);
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	EXPECT_GT(reverseOrderScheduler.m_numParallelLoops, 0);
+#else
+	printf("BT_THREADSAFE is off, skipping the task scheduler test\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,150 @@
+#include "RobotsOnGroundWorld.h"
+#include <gtest/gtest.h>
+
+// solves the rows over their jacobian spans like btMultiBodyConstraintSolver, or, when dense, replaces the spans
+// with a single span over all the dofs, which solves the rows like before the spans existed
+class JacobianSpansSolver : public btMultiBodyConstraintSolver
+{
+public:
+	bool m_dense;
+	int m_numSkippedEntries;
+
+	JacobianSpansSolver(bool dense)
+		: m_dense(dense),
+		  m_numSkippedEntries(0)
+	{
+	}
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+	{
+		btScalar val = btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+		btMultiBodyConstraintArray* rowArrays[4] = {&m_multiBodyNonContactConstraints, &m_multiBodyNormalContactConstraints, &m_multiBodyFrictionContactConstraints, &m_multiBodyTorsionalFrictionContactConstraints};
+		for (int a = 0; a < 4; a++)
+		{
+			for (int i = 0; i < rowArrays[a]->size(); i++)
+			{
+				btMultiBodySolverConstraint& row = rowArrays[a]->at(i);
+				if (row.m_multiBodyA)
+					m_numSkippedEntries += countSkippedEntries(row.m_jacAspanIndex, row.m_multiBodyA->getNumDofs() + 6);
+				if (row.m_multiBodyB)
+					m_numSkippedEntries += countSkippedEntries(row.m_jacBspanIndex, row.m_multiBodyB->getNumDofs() + 6);
+			}
+		}
+		if (m_dense)
+		{
+			m_data.m_jacobianSpans.resize(0);
+			for (int a = 0; a < 4; a++)
+			{
+				for (int i = 0; i < rowArrays[a]->size(); i++)
+				{
+					btMultiBodySolverConstraint& row = rowArrays[a]->at(i);
+					if (row.m_multiBodyA)
+						row.m_jacAspanIndex = addDenseSpans(row.m_multiBodyA->getNumDofs() + 6);
+					if (row.m_multiBodyB)
+						row.m_jacBspanIndex = addDenseSpans(row.m_multiBodyB->getNumDofs() + 6);
+				}
+			}
+		}
+		return val;
+	}
+	int countSkippedEntries(int spanIndex, int ndof) const
+	{
+		// the jacobian spans are followed by the spans of the unit impulse response
+		int skipped = 2 * ndof;
+		const int* spans = &m_data.m_jacobianSpans[spanIndex];
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int s = 0; s < spans[0]; s++)
+			{
+				skipped -= spans[2 + 2 * s] - spans[1 + 2 * s];
+			}
+			spans += 1 + 2 * spans[0];
+		}
+		return skipped;
+	}
+	int addDenseSpans(int ndof)
+	{
+		int spanIndex = m_data.m_jacobianSpans.size();
+		for (int pass = 0; pass < 2; pass++)
+		{
+			m_data.m_jacobianSpans.push_back(1);
+			m_data.m_jacobianSpans.push_back(0);
+			m_data.m_jacobianSpans.push_back(ndof);
+		}
+		return spanIndex;
+	}
+};
+
+// a fixed base arm of five links that swings down onto the ground, next to a few floating base robots
+static btMultiBody* addArm(RobotsOnGroundWorld& robots)
+{
+	const int numLinks = 5;
+	btScalar linkMass = 1;
+	btVector3 linkInertia;
+	robots.m_linkShape.calculateLocalInertia(linkMass, linkInertia);
+	btMultiBody* arm = new btMultiBody(numLinks, linkMass, linkInertia, true, false);
+	arm->setBasePos(btVector3(0, 0.5f, 2));
+	for (int link = 0; link < numLinks; link++)
+	{
+		arm->setupRevolute(link, linkMass, linkInertia, link - 1, btQuaternion(0, 0, 0, 1), btVector3(0, 0, 1), btVector3(0.2f, 0, 0), btVector3(0.2f, 0, 0), true);
+	}
+	arm->finalizeMultiDof();
+	robots.addMultiBody(arm, &robots.m_linkShape);
+	return arm;
+}
+
+GTEST_TEST(BulletDynamics, MultiBodyJacobianSpansMatchDense)
+{
+	const int numRobots = 4;
+	JacobianSpansSolver sparseSolver(false);
+	JacobianSpansSolver denseSolver(true);
+	RobotsOnGroundWorld sparse(&sparseSolver, numRobots);
+	RobotsOnGroundWorld dense(&denseSolver, numRobots);
+	btMultiBody* sparseArm = addArm(sparse);
+	btMultiBody* denseArm = addArm(dense);
+
+	btScalar maxArmImpulse = 0;
+	for (int step = 0; step < 120; step++)
+	{
+		sparse.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		dense.m_world.stepSimulation(btScalar(1. / 60.), 0);
+
+		// the spans only skip exact zeros, so the impulses and velocities don't change a single bit
+		expectSameState(sparseArm, denseArm, 0);
+		for (int i = 0; i < numRobots; i++)
+		{
+			expectSameState(sparse.m_robots[i], dense.m_robots[i], 0);
+		}
+		ASSERT_EQ(sparse.m_dispatcher.getNumManifolds(), dense.m_dispatcher.getNumManifolds());
+		for (int m = 0; m < sparse.m_dispatcher.getNumManifolds(); m++)
+		{
+			const btPersistentManifold* sparseManifold = sparse.m_dispatcher.getManifoldByIndexInternal(m);
+			const btPersistentManifold* denseManifold = dense.m_dispatcher.getManifoldByIndexInternal(m);
+			ASSERT_EQ(sparseManifold->getNumContacts(), denseManifold->getNumContacts());
+			for (int p = 0; p < sparseManifold->getNumContacts(); p++)
+			{
+				const btManifoldPoint& a = sparseManifold->getContactPoint(p);
+				const btManifoldPoint& b = denseManifold->getContactPoint(p);
+				EXPECT_EQ(a.m_appliedImpulse, b.m_appliedImpulse);
+				EXPECT_EQ(a.m_appliedImpulseLateral1, b.m_appliedImpulseLateral1);
+				EXPECT_EQ(a.m_appliedImpulseLateral2, b.m_appliedImpulseLateral2);
+				const btMultiBodyLinkCollider* colliderA = btMultiBodyLinkCollider::upcast(sparseManifold->getBody0());
+				const btMultiBodyLinkCollider* colliderB = btMultiBodyLinkCollider::upcast(sparseManifold->getBody1());
+				if ((colliderA && colliderA->m_multiBody == sparseArm) || (colliderB && colliderB->m_multiBody == sparseArm))
+				{
+					maxArmImpulse = btMax(maxArmImpulse, a.m_appliedImpulse);
+				}
+			}
+		}
+	}
+	// the arm lies on the ground, and the fixed base and the short paths to the root of its links left zeros to skip
+	EXPECT_GT(maxArmImpulse, 0);
+	EXPECT_GT(sparseSolver.m_numSkippedEntries, 0);
+	EXPECT_NEAR(0.1f, sparseArm->getLink(4).m_cachedWorldTransform.getOrigin().y(), 0.02f);
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
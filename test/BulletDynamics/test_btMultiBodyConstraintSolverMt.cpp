@@ -0,0 +1,98 @@
+#include "RobotsOnGroundWorld.h"
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolverMt.h>
+#include <gtest/gtest.h>
+
+// exposes the phases of the batched contact rows, to check that they were used
+class PhaseCountingSolver : public btMultiBodyConstraintSolverMt
+{
+public:
+	int m_numBatchedSolves;
+	int m_maxNormalContactPhases;
+	int m_maxNormalContactBatches;
+
+	PhaseCountingSolver()
+		: m_numBatchedSolves(0),
+		  m_maxNormalContactPhases(0),
+		  m_maxNormalContactBatches(0)
+	{
+	}
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+	{
+		btScalar val = btMultiBodyConstraintSolverMt::solveGroupCacheFriendlySetup(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+		if (m_useBatching)
+		{
+			m_numBatchedSolves++;
+			m_maxNormalContactPhases = btMax(m_maxNormalContactPhases, m_batchedNormalContactRows.m_phases.size());
+			m_maxNormalContactBatches = btMax(m_maxNormalContactBatches, m_batchedNormalContactRows.m_batches.size());
+		}
+		return val;
+	}
+};
+
+GTEST_TEST(BulletDynamics, MultiBodyConstraintSolverMtMatchesSerial)
+{
+	int minimumRowsForBatching = btMultiBodyConstraintSolverMt::s_minimumRowsForBatching;
+	btMultiBodyConstraintSolverMt::s_minimumRowsForBatching = 1;
+
+	const int numRobots = 16;
+	btMultiBodyConstraintSolver serialSolver;
+	PhaseCountingSolver mtSolver;
+	RobotsOnGroundWorld serial(&serialSolver, numRobots);
+	RobotsOnGroundWorld mt(&mtSolver, numRobots);
+	for (int step = 0; step < 60; step++)
+	{
+		serial.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		mt.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		// the robots only share the ground, which never moves, so solving them in a different order gives the same results
+		for (int i = 0; i < numRobots; i++)
+		{
+			expectSameState(serial.m_robots[i], mt.m_robots[i], btScalar(1e-5));
+		}
+	}
+	// the robots rest on the ground instead of sinking through it or jumping off
+	for (int i = 0; i < numRobots; i++)
+	{
+		EXPECT_NEAR(0.1f, mt.m_robots[i]->getBasePos().y(), 0.02f);
+	}
+
+	// the ground has no key, so the contacts of all robots fit into one phase with a batch per robot
+	EXPECT_GT(mtSolver.m_numBatchedSolves, 0);
+	EXPECT_EQ(1, mtSolver.m_maxNormalContactPhases);
+	EXPECT_GE(mtSolver.m_maxNormalContactBatches, numRobots);
+
+	btMultiBodyConstraintSolverMt::s_minimumRowsForBatching = minimumRowsForBatching;
+}
+
+static btSimdScalar dummyRowSolver(btSolverBody& bodyA, btSolverBody& bodyB, const btSolverConstraint& c)
+{
+	return 0;
+}
+
+GTEST_TEST(BulletDynamics, MultiBodyThreadSolverKeepsSettings)
+{
+	btMultiBodyConstraintSolverMt solver;
+	solver.setRandSeed(1234);
+	solver.setConstraintRowSolverGeneric(dummyRowSolver);
+	solver.setConstraintRowSolverLowerLimit(dummyRowSolver);
+
+	// the worker threads of btMultiBodyDynamicsWorld solve with the same type of solver and the same settings
+	btMultiBodyConstraintSolver* threadSolver = solver.createThreadSolver();
+	EXPECT_TRUE(dynamic_cast<btMultiBodyConstraintSolverMt*>(threadSolver) != 0);
+	EXPECT_EQ(1234u, threadSolver->getRandSeed());
+	EXPECT_TRUE(threadSolver->getActiveConstraintRowSolverGeneric() == dummyRowSolver);
+	EXPECT_TRUE(threadSolver->getActiveConstraintRowSolverLowerLimit() == dummyRowSolver);
+
+	// settings that change later are copied again before the islands are solved
+	solver.setRandSeed(5678);
+	threadSolver->copySolverSettings(solver);
+	EXPECT_EQ(5678u, threadSolver->getRandSeed());
+	delete threadSolver;
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	// the batching of the Mt solver reads the thread count of the task scheduler, also when BT_THREADSAFE is off
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
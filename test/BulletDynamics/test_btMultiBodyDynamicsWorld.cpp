@@ -0,0 +1,198 @@
+#include "RobotsOnGroundWorld.h"
+#include "ReverseOrderTaskScheduler.h"
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+GTEST_TEST(BulletDynamics, StaticMultiBodyGroundSplitsIslands)
+{
+	const int numRobots = 16;
+	btMultiBodyConstraintSolver solver;
+	RobotsOnGroundWorld robots(&solver, numRobots);
+	for (int step = 0; step < 10; step++)
+	{
+		robots.m_world.stepSimulation(btScalar(1. / 60.), 0);
+	}
+
+	// the ground doesn't merge islands, so every robot can be solved on its own
+	EXPECT_TRUE(robots.m_multiBodies[0]->getBaseCollider()->isStaticObject());
+	btAlignedObjectArray<int> islandTags;
+	for (int i = 0; i < numRobots; i++)
+	{
+		int islandTag = robots.m_robots[i]->getBaseCollider()->getIslandTag();
+		EXPECT_GE(islandTag, 0);
+		EXPECT_EQ(-1, islandTags.findLinearSearch2(islandTag));
+		islandTags.push_back(islandTag);
+	}
+}
+
+GTEST_TEST(BulletDynamics, StaticMultiBodyCollidersAddedBeforeBody)
+{
+	btDefaultCollisionConfiguration config;
+	btCollisionDispatcher dispatcher(&config);
+	btDbvtBroadphase broadphase;
+	btMultiBodyConstraintSolver solver;
+	btMultiBodyDynamicsWorld world(&dispatcher, &broadphase, &solver, &config);
+	btBoxShape shape(btVector3(1, 1, 1));
+
+	// like URDF2Bullet, the colliders are added before the btMultiBody
+	btMultiBody ground(1, 0, btVector3(0, 0, 0), true, false);
+	ground.setupFixed(0, 0, btVector3(0, 0, 0), -1, btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0), btVector3(0, 0, 0));
+	ground.finalizeMultiDof();
+	btMultiBody robot(1, 1, btVector3(1, 1, 1), true, false);
+	robot.setupRevolute(0, 1, btVector3(1, 1, 1), -1, btQuaternion(0, 0, 0, 1), btVector3(0, 0, 1), btVector3(0, 0, 0), btVector3(0, 0, 0), true);
+	robot.finalizeMultiDof();
+	btMultiBodyLinkCollider groundBase(&ground, -1);
+	btMultiBodyLinkCollider groundLink(&ground, 0);
+	btMultiBodyLinkCollider robotLink(&robot, 0);
+	btMultiBodyLinkCollider* colliders[3] = {&groundBase, &groundLink, &robotLink};
+	for (int i = 0; i < 3; i++)
+	{
+		colliders[i]->setCollisionShape(&shape);
+		world.addCollisionObject(colliders[i]);
+	}
+	ground.setBaseCollider(&groundBase);
+	ground.getLink(0).m_collider = &groundLink;
+	robot.getLink(0).m_collider = &robotLink;
+	EXPECT_FALSE(groundBase.isStaticObject());
+	world.addMultiBody(&ground);
+	world.addMultiBody(&robot);
+
+	EXPECT_TRUE(groundBase.isStaticObject());
+	EXPECT_TRUE(groundLink.isStaticObject());
+	EXPECT_FALSE(robotLink.isStaticObject());
+	for (int i = 0; i < 3; i++)
+	{
+		world.removeCollisionObject(colliders[i]);
+	}
+	world.removeMultiBody(&robot);
+	world.removeMultiBody(&ground);
+}
+
+GTEST_TEST(BulletDynamics, StaticMultiBodyGroundMatchesRigidGround)
+{
+	const int numRobots = 16;
+	btMultiBodyConstraintSolver multiBodyGroundSolver;
+	btMultiBodyConstraintSolver rigidGroundSolver;
+	RobotsOnGroundWorld multiBodyGround(&multiBodyGroundSolver, numRobots, true);
+	RobotsOnGroundWorld rigidGround(&rigidGroundSolver, numRobots, false);
+	for (int step = 0; step < 60; step++)
+	{
+		multiBodyGround.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		rigidGround.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		for (int i = 0; i < numRobots; i++)
+		{
+			expectSameState(multiBodyGround.m_robots[i], rigidGround.m_robots[i], btScalar(1e-5));
+		}
+	}
+	for (int i = 0; i < numRobots; i++)
+	{
+		EXPECT_NEAR(0.1f, multiBodyGround.m_robots[i]->getBasePos().y(), 0.02f);
+	}
+}
+
+GTEST_TEST(BulletDynamics, ParallelMultiBodyIntegrationMatchesSerial)
+{
+#if BT_THREADSAFE
+	const int numRobots = 16;
+	btMultiBodyConstraintSolver serialSolver;
+	btMultiBodyConstraintSolver parallelSolver;
+	RobotsOnGroundWorld serial(&serialSolver, numRobots);
+	RobotsOnGroundWorld parallel(&parallelSolver, numRobots);
+	// the RK4 integration runs the ABA four times per step, with the scratch memory of the thread
+	for (int i = 0; i < numRobots; i += 2)
+	{
+		serial.m_robots[i]->useRK4Integration(true);
+		parallel.m_robots[i]->useRK4Integration(true);
+	}
+	ReverseOrderTaskScheduler reverseOrderScheduler;
+	for (int step = 0; step < 60; step++)
+	{
+		btSetTaskScheduler(btGetSequentialTaskScheduler());
+		serial.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		btSetTaskScheduler(&reverseOrderScheduler);
+		parallel.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		// every btMultiBody is integrated on its own, so the order doesn't change a single bit
+		for (int i = 0; i < numRobots; i++)
+		{
+			expectSameState(serial.m_robots[i], parallel.m_robots[i], 0);
+		}
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	EXPECT_GT(reverseOrderScheduler.m_numParallelLoops, 0);
+#else
+	printf("BT_THREADSAFE is off, skipping the parallel integration test\n");
+#endif
+}
+
+// spins a thin arm at 30 rad/s into a thin wall at 0.75 rad. At 1/60 s it turns by 0.5 rad per step,
+// so without ccd no step ends in contact with the wall. Returns the joint angle after 10 steps
+static btScalar spinArmIntoWall(bool useCcd)
+{
+	btDefaultCollisionConfiguration config;
+	btCollisionDispatcher dispatcher(&config);
+	btDbvtBroadphase broadphase;
+	btMultiBodyConstraintSolver solver;
+	btMultiBodyDynamicsWorld world(&dispatcher, &broadphase, &solver, &config);
+	world.setGravity(btVector3(0, 0, 0));
+
+	const btScalar wallAngle = 0.75f;
+	btBoxShape wallShape(btVector3(0.4f, 0.01f, 0.5f));
+	btRigidBody wall(0, 0, &wallShape);
+	wall.setWorldTransform(btTransform(btQuaternion(btVector3(0, 0, 1), wallAngle), btVector3(0.6f * btCos(wallAngle), 0.6f * btSin(wallAngle), 0)));
+	world.addRigidBody(&wall);
+
+	btBoxShape armShape(btVector3(0.5f, 0.01f, 0.05f));
+	btVector3 armInertia;
+	armShape.calculateLocalInertia(1, armInertia);
+	btMultiBody arm(1, 0, btVector3(0, 0, 0), true, false);
+	arm.setupRevolute(0, 1, armInertia, -1, btQuaternion(0, 0, 0, 1), btVector3(0, 0, 1), btVector3(0, 0, 0), btVector3(0.5f, 0, 0), true);
+	arm.finalizeMultiDof();
+	arm.setJointVel(0, 30);
+	world.addMultiBody(&arm);
+	btMultiBodyLinkCollider collider(&arm, 0);
+	collider.setCollisionShape(&armShape);
+	if (useCcd)
+	{
+		collider.setCcdMotionThreshold(0.01f);
+		collider.setCcdSweptSphereRadius(0.01f);
+	}
+	arm.getLink(0).m_collider = &collider;
+	world.addCollisionObject(&collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+
+	for (int step = 0; step < 10; step++)
+	{
+		world.stepSimulation(btScalar(1. / 60.), 0);
+	}
+	btScalar angle = arm.getJointPos(0);
+	world.removeCollisionObject(&collider);
+	world.removeMultiBody(&arm);
+	world.removeRigidBody(&wall);
+	return angle;
+}
+
+GTEST_TEST(BulletDynamics, FastLinkTunnelsWithoutCcd)
+{
+	// about 5 rad, the arm went through the wall
+	EXPECT_GT(spinArmIntoWall(false), btScalar(2.));
+}
+
+GTEST_TEST(BulletDynamics, FastLinkStoppedWithCcd)
+{
+	// the predictive contact stops the arm in front of the wall
+	EXPECT_LT(spinArmIntoWall(true), btScalar(0.75));
+#if BT_THREADSAFE
+	// the link sweeps run with btParallelFor
+	ReverseOrderTaskScheduler reverseOrderScheduler;
+	btSetTaskScheduler(&reverseOrderScheduler);
+	EXPECT_LT(spinArmIntoWall(true), btScalar(0.75));
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	EXPECT_GT(reverseOrderScheduler.m_numParallelLoops, 0);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,216 @@
+
+#include <btBulletCollisionCommon.h>
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <map>
+#include <new>
+#include <utility>
+#include <vector>
+
+// a collision algorithm that only counts how many instances are alive
+struct CountingAlgorithm : public btCollisionAlgorithm
+{
+	static int s_numAlive;
+
+	CountingAlgorithm()
+	{
+		s_numAlive++;
+	}
+	virtual ~CountingAlgorithm()
+	{
+		s_numAlive--;
+	}
+	virtual void processCollision(const btCollisionObjectWrapper*, const btCollisionObjectWrapper*, const btDispatcherInfo&, btManifoldResult*) {}
+	virtual btScalar calculateTimeOfImpact(btCollisionObject*, btCollisionObject*, const btDispatcherInfo&, btManifoldResult*) { return 1; }
+	virtual void getAllContactManifolds(btManifoldArray&) {}
+};
+int CountingAlgorithm::s_numAlive = 0;
+
+typedef std::pair<int, int> UidPair;
+
+struct SortedPairCacheTest
+{
+	btDefaultCollisionConfiguration m_config;
+	btCollisionDispatcher m_dispatcher;
+	btHashedOverlappingPairCache m_pairCache;
+	btAlignedObjectArray<btBroadphaseProxy> m_proxies;
+	std::map<UidPair, btCollisionAlgorithm*> m_expected;  // the pairs that should be in the cache
+	unsigned int m_seed;
+
+	SortedPairCacheTest(int numProxies)
+		: m_dispatcher(&m_config),
+		  m_seed(4711)
+	{
+		m_pairCache.setSortedPairs(true);
+		m_proxies.resize(numProxies);
+		for (int i = 0; i < numProxies; i++)
+		{
+			// uids in a different order than the proxy indices
+			m_proxies[i].m_uniqueId = (i * 7919) % numProxies + 1;
+			m_proxies[i].m_collisionFilterGroup = btBroadphaseProxy::DefaultFilter;
+			m_proxies[i].m_collisionFilterMask = btBroadphaseProxy::AllFilter;
+		}
+	}
+	~SortedPairCacheTest()
+	{
+		for (int i = 0; i < m_proxies.size(); i++)
+		{
+			m_pairCache.removeOverlappingPairsContainingProxy(&m_proxies[i], &m_dispatcher);
+		}
+	}
+
+	int random(int n)
+	{
+		m_seed = m_seed * 1664525u + 1013904223u;
+		return int((m_seed >> 8) % unsigned(n));
+	}
+	UidPair key(int i, int j) const
+	{
+		return UidPair(btMin(i, j), btMax(i, j));
+	}
+
+	// adds numAdd random pairs, each with a collision algorithm, and removes numRemove of the pairs
+	void addAndRemovePairs(int numAdd, int numRemove)
+	{
+		for (int n = 0; n < numAdd; n++)
+		{
+			int i = random(m_proxies.size());
+			int j = random(m_proxies.size());
+			if (i == j || m_expected.count(key(i, j)))
+				continue;
+			btBroadphasePair* pair = m_pairCache.addOverlappingPair(&m_proxies[i], &m_proxies[j]);
+			ASSERT_TRUE(pair != 0);
+			void* mem = m_dispatcher.allocateCollisionAlgorithm(sizeof(CountingAlgorithm));
+			pair->m_algorithm = new (mem) CountingAlgorithm();
+			m_expected[key(i, j)] = pair->m_algorithm;
+		}
+		for (int n = 0; n < numRemove && !m_expected.empty(); n++)
+		{
+			std::map<UidPair, btCollisionAlgorithm*>::iterator it = m_expected.begin();
+			std::advance(it, random(int(m_expected.size())));
+			// either order of the proxies
+			if (n % 2)
+				m_pairCache.removeOverlappingPair(&m_proxies[it->first.first], &m_proxies[it->first.second], &m_dispatcher);
+			else
+				m_pairCache.removeOverlappingPair(&m_proxies[it->first.second], &m_proxies[it->first.first], &m_dispatcher);
+			m_expected.erase(it);
+		}
+	}
+	void removeProxy(int i)
+	{
+		m_pairCache.removeOverlappingPairsContainingProxy(&m_proxies[i], &m_dispatcher);
+		std::map<UidPair, btCollisionAlgorithm*>::iterator it = m_expected.begin();
+		while (it != m_expected.end())
+		{
+			if (it->first.first == i || it->first.second == i)
+				m_expected.erase(it++);
+			else
+				++it;
+		}
+	}
+
+	void expectSortedPairs()
+	{
+		const btBroadphasePairArray& pairs = m_pairCache.getOverlappingPairArray();
+		EXPECT_EQ(int(m_expected.size()), pairs.size());
+		EXPECT_EQ(int(m_expected.size()), CountingAlgorithm::s_numAlive);
+		for (int p = 0; p < pairs.size(); p++)
+		{
+			// the proxy with the lower uid comes first
+			EXPECT_LT(pairs[p].m_pProxy0->getUid(), pairs[p].m_pProxy1->getUid());
+			if (p > 0)
+			{
+				const btBroadphasePair& prev = pairs[p - 1];
+				bool ordered = prev.m_pProxy0->getUid() < pairs[p].m_pProxy0->getUid() ||
+							   (prev.m_pProxy0->getUid() == pairs[p].m_pProxy0->getUid() && prev.m_pProxy1->getUid() < pairs[p].m_pProxy1->getUid());
+				EXPECT_TRUE(ordered) << "pair " << p;
+			}
+		}
+		// every pair is found through the rebuilt hash table and kept its collision algorithm
+		for (std::map<UidPair, btCollisionAlgorithm*>::iterator it = m_expected.begin(); it != m_expected.end(); ++it)
+		{
+			btBroadphaseProxy* proxy0 = &m_proxies[it->first.first];
+			btBroadphaseProxy* proxy1 = &m_proxies[it->first.second];
+			btBroadphasePair* pair = m_pairCache.findPair(proxy0, proxy1);
+			ASSERT_TRUE(pair != 0);
+			EXPECT_EQ(pair, m_pairCache.findPair(proxy1, proxy0));
+			EXPECT_EQ(it->second, pair->m_algorithm);
+		}
+	}
+};
+
+GTEST_TEST(BulletCollision, SortedPairCacheAcrossFrames)
+{
+	SortedPairCacheTest test(300);
+	for (int frame = 0; frame < 40; frame++)
+	{
+		// the cache grows past several rehashes in the first frames, then pairs come and go
+		if (frame < 10)
+			test.addAndRemovePairs(400, 50);
+		else if (frame % 7 == 0)
+			test.addAndRemovePairs(300, 300);
+		else
+			test.addAndRemovePairs(10, 10);
+		if (frame % 5 == 4)
+		{
+			test.removeProxy(test.random(test.m_proxies.size()));
+		}
+		test.m_pairCache.sortOverlappingPairs(&test.m_dispatcher);
+		test.expectSortedPairs();
+		// sorting a sorted cache changes nothing
+		test.m_pairCache.sortOverlappingPairs(&test.m_dispatcher);
+		test.expectSortedPairs();
+	}
+	while (!test.m_expected.empty())
+	{
+		test.addAndRemovePairs(0, 100);
+		test.m_pairCache.sortOverlappingPairs(&test.m_dispatcher);
+		test.expectSortedPairs();
+	}
+	EXPECT_EQ(0, CountingAlgorithm::s_numAlive);
+}
+
+GTEST_TEST(BulletCollision, SortedPairCacheInBroadphase)
+{
+	// btDbvtBroadphase sorts the pairs at the end of calculateOverlappingPairs
+	btDefaultCollisionConfiguration config;
+	btCollisionDispatcher dispatcher(&config);
+	btHashedOverlappingPairCache* pairCache = new btHashedOverlappingPairCache();
+	pairCache->setSortedPairs(true);
+	btDbvtBroadphase broadphase(pairCache);
+	btAlignedObjectArray<btBroadphaseProxy*> proxies;
+	for (int i = 0; i < 200; i++)
+	{
+		btVector3 center(btScalar((i * 37) % 11), btScalar((i * 13) % 7), btScalar((i * 29) % 5));
+		proxies.push_back(broadphase.createProxy(center - btVector3(1, 1, 1), center + btVector3(1, 1, 1), BOX_SHAPE_PROXYTYPE, 0,
+												 btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, &dispatcher));
+	}
+	for (int frame = 0; frame < 10; frame++)
+	{
+		for (int i = frame % 3; i < proxies.size(); i += 3)
+		{
+			btVector3 center(btScalar((i * 37 + frame) % 11), btScalar((i * 13) % 7), btScalar((i * 29 + 2 * frame) % 5));
+			broadphase.setAabb(proxies[i], center - btVector3(1, 1, 1), center + btVector3(1, 1, 1), &dispatcher);
+		}
+		broadphase.calculateOverlappingPairs(&dispatcher);
+		const btBroadphasePairArray& pairs = pairCache->getOverlappingPairArray();
+		EXPECT_GT(pairs.size(), 0);
+		for (int p = 1; p < pairs.size(); p++)
+		{
+			unsigned int uid0 = pairs[p].m_pProxy0->getUid(), prevUid0 = pairs[p - 1].m_pProxy0->getUid();
+			EXPECT_TRUE(prevUid0 < uid0 || (prevUid0 == uid0 && pairs[p - 1].m_pProxy1->getUid() < pairs[p].m_pProxy1->getUid()));
+		}
+	}
+	for (int i = 0; i < proxies.size(); i++)
+	{
+		broadphase.destroyProxy(proxies[i], &dispatcher);
+	}
+	delete pairCache;
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
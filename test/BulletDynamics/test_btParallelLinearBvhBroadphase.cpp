@@ -0,0 +1,104 @@
+
+#include "BroadphaseTestScene.h"
+#include "ReverseOrderTaskScheduler.h"
+#include <BulletCollision/BroadphaseCollision/btParallelLinearBvhBroadphase.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+// random proxies of mixed sizes, large proxies that are kept out of the bvh, and clusters of proxies with
+// the same morton code: a stack of identical boxes, and boxes whose centers are closer than the 1024^3 grid
+static void addProxies(BroadphaseTestScene& scene, btScalar extent)
+{
+	for (int i = 0; i < 400; i++)
+	{
+		scene.addRandomProxy(extent, 0.1f, i % 10 ? 1.f : 3.f);
+	}
+	scene.addProxy(btVector3(-2 * extent, -extent - 1, -2 * extent), btVector3(2 * extent, -extent, 2 * extent));
+	scene.addRandomProxy(extent, extent * 0.3f, extent * 0.5f);
+	for (int i = 0; i < 100; i++)
+	{
+		scene.addProxy(btVector3(3, 3, 3), btVector3(4, 4.5f, 4));
+	}
+	for (int i = 0; i < 100; i++)
+	{
+		btVector3 offset = scene.randomVector(-extent * 0.0001f, extent * 0.0001f);
+		btVector3 halfExtents = scene.randomVector(0.05f, 0.5f);
+		scene.addProxy(btVector3(-5, 2, 7) + offset - halfExtents, btVector3(-5, 2, 7) + offset + halfExtents);
+	}
+}
+
+static void moveAndCompare(BroadphaseTestScene& scene, int numFrames)
+{
+	const btScalar extent = 20;
+	addProxies(scene, extent);
+	scene.calculateOverlappingPairs();
+	scene.expectSamePairs();
+	scene.expectSameQueries(extent, 20);
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		// queries before calculateOverlappingPairs test all proxies, afterwards they traverse the bvh
+		scene.moveProxies(0.5f, 0.5f, 0.02f);
+		scene.expectSameQueries(extent, 5);
+		scene.calculateOverlappingPairs();
+		scene.expectSamePairs();
+		scene.expectSameQueries(extent, 20);
+	}
+}
+
+static void addBroadphases(BroadphaseTestScene& scene)
+{
+	scene.addBroadphase(new btDbvtBroadphase(), false);
+	scene.addBroadphase(new btParallelLinearBvhBroadphase(), true);
+	// every proxy in the bvh, small tasks
+	btParallelLinearBvhBroadphase* broadphase = new btParallelLinearBvhBroadphase();
+	broadphase->m_largeProxyFraction = BT_LARGE_FLOAT;
+	broadphase->m_grainSize = 5;
+	scene.addBroadphase(broadphase, true);
+}
+
+GTEST_TEST(BulletCollision, ParallelLinearBvhBroadphaseMatchesDbvtBroadphase)
+{
+	BroadphaseTestScene scene;
+	addBroadphases(scene);
+	moveAndCompare(scene, 10);
+}
+
+GTEST_TEST(BulletCollision, ParallelLinearBvhBroadphaseIdenticalBoxes)
+{
+	// nothing but proxies with the same morton code
+	BroadphaseTestScene scene;
+	addBroadphases(scene);
+	for (int i = 0; i < 200; i++)
+	{
+		scene.addProxy(btVector3(1, 1, 1), btVector3(2, 2, 2));
+	}
+	scene.calculateOverlappingPairs();
+	scene.expectSamePairs();
+	EXPECT_EQ(200 * 199 / 2, int(scene.cachedPairs(1, true).size()));
+	scene.expectSameRayHits(btVector3(0, 1.5f, 1.5f), btVector3(3, 1.5f, 1.5f));
+	scene.expectSameAabbHits(btVector3(0, 0, 0), btVector3(1.5f, 1.5f, 1.5f));
+}
+
+GTEST_TEST(BulletCollision, ParallelLinearBvhBroadphaseWithTaskSchedulerMatchesDbvtBroadphase)
+{
+#if BT_THREADSAFE
+	ReverseOrderTaskScheduler reverseOrderScheduler;
+	btSetTaskScheduler(&reverseOrderScheduler);
+	{
+		BroadphaseTestScene scene;
+		addBroadphases(scene);
+		moveAndCompare(scene, 10);
+	}
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	EXPECT_GT(reverseOrderScheduler.m_numParallelLoops, 0);
+#else
+	printf("BT_THREADSAFE is off, skipping the task scheduler test\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,236 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+// exposes the contact groups of the wide row kernels, to check that they were used
+class WideRowsSolver : public btSequentialImpulseConstraintSolverMt
+{
+public:
+	int getLargestWideContactGroup() const
+	{
+		int largest = 0;
+		for (int i = 0; i < m_wideContactGroupSizes.size(); i++)
+		{
+			largest = btMax(largest, m_wideContactGroupSizes[i]);
+		}
+		return largest;
+	}
+};
+
+// the state a solve reads and writes
+struct SolverState
+{
+	btAlignedObjectArray<btTransform> m_transforms;
+	btAlignedObjectArray<btVector3> m_linearVelocities;
+	btAlignedObjectArray<btVector3> m_angularVelocities;
+	btAlignedObjectArray<btManifoldPoint> m_points;
+
+	void save(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds)
+	{
+		m_transforms.resize(0);
+		m_linearVelocities.resize(0);
+		m_angularVelocities.resize(0);
+		m_points.resize(0);
+		for (int i = 0; i < numBodies; i++)
+		{
+			btRigidBody* body = btRigidBody::upcast(bodies[i]);
+			m_transforms.push_back(body->getWorldTransform());
+			m_linearVelocities.push_back(body->getLinearVelocity());
+			m_angularVelocities.push_back(body->getAngularVelocity());
+		}
+		for (int m = 0; m < numManifolds; m++)
+		{
+			for (int p = 0; p < manifolds[m]->getNumContacts(); p++)
+			{
+				m_points.push_back(manifolds[m]->getContactPoint(p));
+			}
+		}
+	}
+	void restore(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds) const
+	{
+		for (int i = 0; i < numBodies; i++)
+		{
+			btRigidBody* body = btRigidBody::upcast(bodies[i]);
+			body->setWorldTransform(m_transforms[i]);
+			body->setLinearVelocity(m_linearVelocities[i]);
+			body->setAngularVelocity(m_angularVelocities[i]);
+		}
+		int index = 0;
+		for (int m = 0; m < numManifolds; m++)
+		{
+			for (int p = 0; p < manifolds[m]->getNumContacts(); p++)
+			{
+				manifolds[m]->getContactPoint(p) = m_points[index++];
+			}
+		}
+	}
+};
+
+// solves every island with the AVX2 kernel, then again from the same state with the scalar kernel, and compares the results
+class CompareWideRowsSolver : public btConstraintSolver
+{
+public:
+	WideRowsSolver m_avx2;
+	WideRowsSolver m_scalar;
+	btScalar m_tolerance;
+	int m_numComparedSolves;
+
+	CompareWideRowsSolver(btWideConstraintRowsSolver avx2RowsSolver)
+		: m_tolerance(0),
+		  m_numComparedSolves(0)
+	{
+		m_avx2.setWideConstraintRowsSolver(avx2RowsSolver);
+		m_scalar.setWideConstraintRowsSolver(btSequentialImpulseConstraintSolverMt::getScalarWideConstraintRowsSolver());
+	}
+	virtual void prepareSolve(int numBodies, int numManifolds)
+	{
+		m_avx2.prepareSolve(numBodies, numManifolds);
+		m_scalar.prepareSolve(numBodies, numManifolds);
+	}
+	virtual btScalar solveGroup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& info, class btIDebugDraw* debugDrawer, btDispatcher* dispatcher)
+	{
+		SolverState before, avx2;
+		before.save(bodies, numBodies, manifolds, numManifolds);
+		m_avx2.solveGroup(bodies, numBodies, manifolds, numManifolds, constraints, numConstraints, info, debugDrawer, dispatcher);
+		avx2.save(bodies, numBodies, manifolds, numManifolds);
+		before.restore(bodies, numBodies, manifolds, numManifolds);
+		m_scalar.solveGroup(bodies, numBodies, manifolds, numManifolds, constraints, numConstraints, info, debugDrawer, dispatcher);
+		if (numManifolds < btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching)
+			return 0;
+
+		// the rows of a group don't share a body, so solving them at once only differs by the rounding of the fused multiply-adds
+		EXPECT_GT(m_avx2.getLargestWideContactGroup(), 1);
+		EXPECT_GT(m_scalar.getLargestWideContactGroup(), 1);
+		int index = 0;
+		for (int m = 0; m < numManifolds; m++)
+		{
+			for (int p = 0; p < manifolds[m]->getNumContacts(); p++)
+			{
+				const btManifoldPoint& a = avx2.m_points[index++];
+				const btManifoldPoint& b = manifolds[m]->getContactPoint(p);
+				EXPECT_NEAR(a.m_appliedImpulse, b.m_appliedImpulse, m_tolerance);
+				EXPECT_NEAR(a.m_appliedImpulseLateral1, b.m_appliedImpulseLateral1, m_tolerance);
+			}
+		}
+		for (int i = 0; i < numBodies; i++)
+		{
+			btRigidBody* body = btRigidBody::upcast(bodies[i]);
+			EXPECT_NEAR(0, (avx2.m_linearVelocities[i] - body->getLinearVelocity()).length(), m_tolerance);
+			EXPECT_NEAR(0, (avx2.m_angularVelocities[i] - body->getAngularVelocity()).length(), m_tolerance);
+		}
+		m_numComparedSolves++;
+		return 0;
+	}
+	virtual void allSolved(const btContactSolverInfo& info, class btIDebugDraw* debugDrawer)
+	{
+		m_avx2.allSolved(info, debugDrawer);
+		m_scalar.allSolved(info, debugDrawer);
+	}
+	virtual void reset()
+	{
+		m_avx2.reset();
+		m_scalar.reset();
+	}
+	virtual btConstraintSolverType getSolverType() const
+	{
+		return BT_SEQUENTIAL_IMPULSE_SOLVER;
+	}
+};
+
+// two layers of boxes packed side by side on a ground box, so the solver gets one island with many manifolds
+struct BoxLayersWorld
+{
+	btDefaultCollisionConfiguration m_config;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	CompareWideRowsSolver m_solver;
+	btDiscreteDynamicsWorld m_world;
+	btBoxShape m_groundShape;
+	btBoxShape m_boxShape;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+
+	BoxLayersWorld(btWideConstraintRowsSolver avx2RowsSolver)
+		: m_dispatcher(&m_config),
+		  m_solver(avx2RowsSolver),
+		  m_world(&m_dispatcher, &m_broadphase, &m_solver, &m_config),
+		  m_groundShape(btVector3(20, 1, 20)),
+		  m_boxShape(btVector3(0.5f, 0.5f, 0.5f))
+	{
+		btTransform tr;
+		tr.setIdentity();
+		tr.setOrigin(btVector3(0, -1, 0));
+		addBody(0, &m_groundShape, tr);
+		for (int i = 0; i < 2 * 10 * 10; i++)
+		{
+			int layer = i / 100;
+			tr.setOrigin(btVector3((i % 10) - 4.5f + 0.25f * layer, 0.5f + layer, ((i / 10) % 10) - 4.5f + 0.25f * layer));
+			addBody(1, &m_boxShape, tr);
+		}
+	}
+	~BoxLayersWorld()
+	{
+		for (int i = 0; i < m_bodies.size(); i++)
+		{
+			m_world.removeRigidBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+	}
+	void addBody(btScalar mass, btCollisionShape* shape, const btTransform& tr)
+	{
+		btVector3 inertia(0, 0, 0);
+		if (mass > 0)
+			shape->calculateLocalInertia(mass, inertia);
+		btRigidBody* body = new btRigidBody(mass, 0, shape, inertia);
+		body->setWorldTransform(tr);
+		body->setActivationState(DISABLE_DEACTIVATION);
+		m_world.addRigidBody(body);
+		m_bodies.push_back(body);
+	}
+};
+
+GTEST_TEST(BulletDynamics, WideConstraintRowsMatchScalar)
+{
+	btWideConstraintRowsSolver avx2RowsSolver = btSequentialImpulseConstraintSolverMt::getAVX2WideConstraintRowsSolver();
+	if (!avx2RowsSolver)
+	{
+		printf("AVX2 is not available, skipping the wide row kernel test\n");
+		return;
+	}
+	bool allowWideConstraintRowKernels = btSequentialImpulseConstraintSolverMt::s_allowWideConstraintRowKernels;
+	int minimumContactManifoldsForBatching = btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching;
+	int minBatchSize = btSequentialImpulseConstraintSolverMt::s_minBatchSize;
+	int maxBatchSize = btSequentialImpulseConstraintSolverMt::s_maxBatchSize;
+	btSequentialImpulseConstraintSolverMt::s_allowWideConstraintRowKernels = true;
+	btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = 50;
+	btSequentialImpulseConstraintSolverMt::s_minBatchSize = 200;
+	btSequentialImpulseConstraintSolverMt::s_maxBatchSize = 400;
+
+	// a single iteration checks the kernels row by row, more iterations let the rounding differences grow
+	int numIterations[2] = {1, 10};
+	btScalar tolerances[2] = {btScalar(1e-6), btScalar(1e-4)};
+	for (int i = 0; i < 2; i++)
+	{
+		BoxLayersWorld boxes(avx2RowsSolver);
+		boxes.m_world.getSolverInfo().m_numIterations = numIterations[i];
+		boxes.m_solver.m_tolerance = tolerances[i];
+		for (int step = 0; step < 60; step++)
+		{
+			boxes.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		}
+		EXPECT_EQ(60, boxes.m_solver.m_numComparedSolves);
+	}
+
+	btSequentialImpulseConstraintSolverMt::s_allowWideConstraintRowKernels = allowWideConstraintRowKernels;
+	btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = minimumContactManifoldsForBatching;
+	btSequentialImpulseConstraintSolverMt::s_minBatchSize = minBatchSize;
+	btSequentialImpulseConstraintSolverMt::s_maxBatchSize = maxBatchSize;
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	// the batching of the Mt solver reads the thread count of the task scheduler, also when BT_THREADSAFE is off
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	return RUN_ALL_TESTS();
+}
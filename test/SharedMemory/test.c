@@ -310,6 +310,57 @@ void testSharedMemory(b3PhysicsClientHandle sm)
 
 
 
+#define TEST_RAYCAST_BATCH_SIZE 1000
+
+//more rays than MAX_RAY_INTERSECTION_BATCH_SIZE, every other ray hits the plane
+void testRaycastBatch(b3PhysicsClientHandle sm)
+{
+	static double rayFrom[TEST_RAYCAST_BATCH_SIZE*3];
+	static double rayTo[TEST_RAYCAST_BATCH_SIZE*3];
+	int i, statusType, planeUniqueId;
+	struct b3RaycastInformation raycastInfo;
+	b3SharedMemoryStatusHandle statusHandle;
+	b3SharedMemoryCommandHandle command = b3LoadUrdfCommandInit(sm, "plane.urdf");
+	statusHandle = b3SubmitClientCommandAndWaitStatus(sm, command);
+	ASSERT_EQ(b3GetStatusType(statusHandle), CMD_URDF_LOADING_COMPLETED);
+	planeUniqueId = b3GetStatusBodyIndex(statusHandle);
+
+	for (i=0;i<TEST_RAYCAST_BATCH_SIZE;i++)
+	{
+		double x = -5.+10.*i/TEST_RAYCAST_BATCH_SIZE;
+		rayFrom[i*3+0] = x;
+		rayFrom[i*3+1] = 0.5;
+		rayFrom[i*3+2] = 1;
+		rayTo[i*3+0] = x;
+		rayTo[i*3+1] = 0.5;
+		//odd rays stop above the plane
+		rayTo[i*3+2] = (i&1) ? 0.5 : -1;
+	}
+	command = b3CreateRaycastBatchCommandInit(sm);
+	b3RaycastBatchAddRays(sm, command, rayFrom, rayTo, TEST_RAYCAST_BATCH_SIZE);
+	statusHandle = b3SubmitClientCommandAndWaitStatus(sm, command);
+	statusType = b3GetStatusType(statusHandle);
+	ASSERT_EQ(statusType, CMD_REQUEST_RAY_CAST_INTERSECTIONS_COMPLETED);
+
+	b3GetRaycastInformation(sm, &raycastInfo);
+	ASSERT_EQ(raycastInfo.m_numRayHits, TEST_RAYCAST_BATCH_SIZE);
+	for (i=0;i<TEST_RAYCAST_BATCH_SIZE;i++)
+	{
+		const struct b3RayHitInfo* hit = &raycastInfo.m_rayHits[i];
+		if (i&1)
+		{
+			ASSERT_EQ(hit->m_hitObjectUniqueId, -1);
+		} else
+		{
+			ASSERT_EQ(hit->m_hitObjectUniqueId, planeUniqueId);
+			ASSERT_EQ(hit->m_hitFraction>0.49 && hit->m_hitFraction<0.51, 1);
+			ASSERT_EQ(hit->m_hitPositionWorld[0]>rayFrom[i*3+0]-1e-6 && hit->m_hitPositionWorld[0]<rayFrom[i*3+0]+1e-6, 1);
+		}
+	}
+
+	b3DisconnectSharedMemory(sm);
+}
+
 #ifdef ENABLE_GTEST
 
 
@@ -318,6 +369,11 @@ TEST(BulletPhysicsClientServerTest, DirectConnection) {
         testSharedMemory(sm);
 }
 
+TEST(BulletPhysicsClientServerTest, DirectConnectionRaycastBatch) {
+        b3PhysicsClientHandle sm = b3ConnectPhysicsDirect();
+        testRaycastBatch(sm);
+}
+
 TEST(BulletPhysicsClientServerTest, LoopBackSharedMemory) {
         b3PhysicsClientHandle sm = b3ConnectPhysicsLoopback(SHARED_MEMORY_KEY);
         testSharedMemory(sm);